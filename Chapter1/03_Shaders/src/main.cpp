@@ -1,9 +1,11 @@
 #include <stdio.h>
+#include <string.h>
 
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
 
-#include "shaders.h"
+#include "window.h"
+#include "program_pipeline.h"
 
 const int SCREEN_WIDTH = 1920;
 const int SCREEN_HEIGHT = 1080;
@@ -58,53 +60,25 @@ const char *fragmentShaderSourceTopRight = "#version 330 core\n"
     "FragColor = vec4(topRightColor, 1.0f);\n"
     "}\0";
 
-int main()
+int main(int argc, char* argv[])
 {
-    // Setup SDL Stuff
-    if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
+    // --classic-link links every combination into its own program, as contexts without separable programs do
+    bool classicLink = false;
+    for (int i = 1; i < argc; i++)
     {
-        printf("Failed to initialize SDL");
-        return -1;
-    }
-
-    // Setup OpenGL Attributes
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-
-    // Create Window
-    SDL_Window* window = SDL_CreateWindow("Learn OpenGL", 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL);
-    if (!window)
-    {
-        printf("Failed to create SDL window");
-        return -1;
-    }
-
-    // Create Context
-    SDL_GLContext context = SDL_GL_CreateContext(window);
-    if (!context)
-    {
-        printf("Failed to create context");
-        return -1;
+        if (strcmp(argv[i], "--classic-link") == 0)
+            classicLink = true;
+        else
+        {
+            printf("Usage: %s [--classic-link]\n", argv[0]);
+            return -1;
+        }
     }
 
-    // Make Current Context
-    SDL_GL_MakeCurrent(window, context);
-
-    // Create View Port
-    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-
-    // Initialize GLEW
-    glewExperimental = GL_TRUE;
-    GLenum glewError = glewInit();
-    if (glewError != GLEW_OK)
-    {
-        printf("Error initializing GLEW %s\n", glewGetErrorString(glewError));
+    // Window, GL context and GLEW
+    Window window;
+    if(!window.init("Learn OpenGL", SCREEN_WIDTH, SCREEN_HEIGHT))
         return -1;
-    }
-
-    // Create shader object
-    Shader myShader("/home/tommy/development/learn_opengl_tutorials/03_Shaders/shaders/triangle_bRight.vertex", "/home/tommy/development/learn_opengl_tutorials/03_Shaders/shaders/triangle_bRight.frag");
 
     // Triangle Vertices
     float vertices[] = {
@@ -131,142 +105,20 @@ int main()
         1.0f, -1.0f, 0.0f
     };
 
-    // Compile Shaders
-    unsigned int vertexShader;
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    unsigned int fragmentShader;
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    unsigned int topLeftVertexShader;
-    topLeftVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(topLeftVertexShader, 1, &vertexShaderSourceTopLeft, NULL);
-    glCompileShader(topLeftVertexShader);
-
-    unsigned int topLeftFragmentShader;
-    topLeftFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(topLeftFragmentShader, 1, &fragmentShaderSourceTopLeft, NULL);
-    glCompileShader(topLeftFragmentShader);
-
-    unsigned int topRightVertexShader;
-    topRightVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(topRightVertexShader, 1, &vertexShaderSourceTopRight, NULL);
-    glCompileShader(topRightVertexShader);
-
-    unsigned int topRightFragmentShader;
-    topRightFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(topRightFragmentShader, 1, &fragmentShaderSourceTopRight, NULL);
-    glCompileShader(topRightFragmentShader);
-
-
-
-    // Check Shader Compilation
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        printf("ERROR::SHADER::VERTEX(bottom_left)::COMPILATION_FAILED: %s\n", infoLog);
-        return -1;
-    }
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        printf("ERROR::SHADER::FRAGMENT(bottom_left)::COMPILATION_FAILED: %s\n", infoLog);
+    // Each stage is compiled once, the combinations drawn below are put together from them
+    ProgramPipelineCache pipelines;
+    pipelines.init(!classicLink);
+    int positionVertex = pipelines.add_stage(GL_VERTEX_SHADER, vertexShaderSource, "position");
+    int topLeftVertex = pipelines.add_stage(GL_VERTEX_SHADER, vertexShaderSourceTopLeft, "top_left");
+    int topRightVertex = pipelines.add_stage(GL_VERTEX_SHADER, vertexShaderSourceTopRight, "top_right");
+    int sharedColorFragment = pipelines.add_stage(GL_FRAGMENT_SHADER, fragmentShaderSource, "bottom_left");
+    int topLeftFragment = pipelines.add_stage(GL_FRAGMENT_SHADER, fragmentShaderSourceTopLeft, "top_left");
+    int topRightFragment = pipelines.add_stage(GL_FRAGMENT_SHADER, fragmentShaderSourceTopRight, "top_right");
+    // The bottom right triangle only needs a position too, it shares the bottom left's vertex stage
+    int rgbFragment = pipelines.add_stage_file(GL_FRAGMENT_SHADER, "shaders/triangle_bRight.frag");
+    if (positionVertex < 0 || topLeftVertex < 0 || topRightVertex < 0 || sharedColorFragment < 0
+        || topLeftFragment < 0 || topRightFragment < 0 || rgbFragment < 0)
         return -1;
-    }
-
-    glGetShaderiv(topLeftVertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(topLeftVertexShader, 512, NULL, infoLog);
-        printf("ERROR::SHADER::VERTEX(top_left)::COMPILATION_FAILED: %s\n", infoLog);
-        return -1;
-    }
-
-    glGetShaderiv(topLeftFragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(topLeftFragmentShader, 512, NULL, infoLog);
-        printf("ERROR::SHADER::FRAGMENT(top_left)::COMPILATION_FAILED: %s\n", infoLog);
-        return -1;
-    }
-
-    glGetShaderiv(topRightVertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(topRightVertexShader, 512, NULL, infoLog);
-        printf("ERROR::SHADER::VERTEX(top_right)::COMPILATION_FAILED: %s\n", infoLog);
-        return -1;
-    }
-
-    glGetShaderiv(topRightFragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(topRightFragmentShader, 512, NULL, infoLog);
-        printf("ERROR::SHADER::FRAGMENT(top_right)::COMPILATION_FAILED: %s\n", infoLog);
-        return -1;
-    }
-
-    // Create Shader Program (Link Shaders Together)
-    unsigned int shaderProgram;
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    unsigned int topLeftShaderProgram;
-    topLeftShaderProgram = glCreateProgram();
-    glAttachShader(topLeftShaderProgram, topLeftVertexShader);
-    glAttachShader(topLeftShaderProgram, topLeftFragmentShader);
-    glLinkProgram(topLeftShaderProgram);
-
-    unsigned int topRightShaderProgram;
-    topRightShaderProgram = glCreateProgram();
-    glAttachShader(topRightShaderProgram, topRightVertexShader);
-    glAttachShader(topRightShaderProgram, topRightFragmentShader);
-    glLinkProgram(topRightShaderProgram);
-
-
-    // Check Program Linking
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        printf("ERROR::SHADER::PROGRAM:LINKING_FAILED: %s", infoLog);
-        return -1;
-    }
-
-    glGetProgramiv(topLeftShaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(topLeftShaderProgram, 512, NULL, infoLog);
-        printf("ERROR::SHADER::PROGRAM:LINKING_FAILED: %s", infoLog);
-        return -1;
-    }
-
-    glGetProgramiv(topRightShaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(topRightShaderProgram, 512, NULL, infoLog);
-        printf("ERROR::SHADER::PROGRAM:LINKING_FAILED: %s", infoLog);
-        return -1;
-    }
-
-    // Cleanup Shader
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    glDeleteShader(topLeftVertexShader);
-    glDeleteShader(topLeftFragmentShader);
-    glDeleteShader(topRightVertexShader);
-    glDeleteShader(topRightFragmentShader);
 
     // Note: bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
 
@@ -307,61 +159,79 @@ int main()
 
     // Event Loop
     bool quit = false;
+    bool redraw = true;
+    Uint64 nextRedraw = 0;
     SDL_Event event;
 
     while (!quit)
     {
-        while (SDL_PollEvent(&event))
+        // The animation only changes once a second, sleep until then or until an event arrives
+        Uint64 now = SDL_GetTicks64();
+        if (now >= nextRedraw)
+            redraw = true;
+        int haveEvent = redraw ? SDL_PollEvent(&event) : SDL_WaitEventTimeout(&event, (int)(nextRedraw - now));
+        while (haveEvent)
         {
             switch (event.type)
             {
                 case(SDL_QUIT):
                     quit = true;
                     break;
+                // Shown, exposed or resized, the window needs drawing again
+                case(SDL_WINDOWEVENT):
+                    redraw = true;
+                    break;
             }
+            haveEvent = SDL_PollEvent(&event);
         }
+        if (!redraw)
+            continue;
+        redraw = false;
+        nextRedraw = (SDL_GetTicks64() / 1000 + 1) * 1000;
+
         // Set background colour
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
         // Define program, VAO, then draw (This is drawing workflow)
-        glUseProgram(shaderProgram);
+        pipelines.use(positionVertex, sharedColorFragment);
         float timeValue = SDL_GetTicks64() / 1000;
         float greenValue = sin(timeValue) / 2.0f + 0.5f;
-        int vertexColorLocation = glGetUniformLocation(shaderProgram, "sharedColor");
+        int vertexColorLocation = pipelines.select_uniform(positionVertex, sharedColorFragment, sharedColorFragment, "sharedColor");
         glUniform4f(vertexColorLocation, 0.0f, greenValue, 0.0f, 1.0f);
         glBindVertexArray(VAO[0]);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
-        glUseProgram(topLeftShaderProgram);
+        pipelines.use(topLeftVertex, topLeftFragment);
         glBindVertexArray(VAO[1]);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
-        glUseProgram(topRightShaderProgram);
+        pipelines.use(topRightVertex, topRightFragment);
         glBindVertexArray(VAO[2]);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
-        // Use shader program, set uniform float values in shaders
-        myShader.use();
-        myShader.setFloat("red", 0.5f);
-        myShader.setFloat("green", 0.0f);
-        myShader.setFloat("blue", 1.0f);
+        // Set uniform float values in the fragment stage
+        pipelines.use(positionVertex, rgbFragment);
+        glUniform1f(pipelines.select_uniform(positionVertex, rgbFragment, rgbFragment, "red"), 0.5f);
+        glUniform1f(pipelines.select_uniform(positionVertex, rgbFragment, rgbFragment, "green"), 0.0f);
+        glUniform1f(pipelines.select_uniform(positionVertex, rgbFragment, rgbFragment, "blue"), 1.0f);
         glBindVertexArray(VAO[3]);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
 
         // Swap windows
-        SDL_GL_SwapWindow(window);
+        window.swap();
     }
 
+    pipelines.print_report();
+
     /* Cleanup created OpenGL objects. */
     glDeleteVertexArrays(4, VAO);
     glDeleteBuffers(4, VBO);
+    pipelines.destroy();
 
     // SDL Cleanup
-    SDL_GL_DeleteContext(context);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    window.destroy();
 
     return 0;
 }
\ No newline at end of file
@@ -1,29 +0,0 @@
-#ifndef SHADERS_H
-#define SHADERS_H
-
-#include <GL/glew.h>
-#include <string>
-#include <fstream>
-#include <sstream>
-#include <stdio.h>
-
-using namespace std;
-
-class Shader
-{
-public:
-    // The program ID
-    unsigned int ID;
-
-    // Constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* vertextPath);
-
-    // Use/activate shaders
-    void use();
-
-    // Utility uniform functions
-    void setBool(const string &name, bool value) const;
-    void setInt(const string &name, int value) const;
-    void setFloat(const string &name, float value) const;
-};
-#endif // SHADERS_H
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+// Every texture of the scene, see TextureAtlas
+uniform sampler2DArray textures;
+
+// Repeats uv inside an image's region of the atlas: offset and scale in
+// xy/zw, layer picks the array slice. The gradients come from the unwrapped
+// coordinates so the mip level doesn't jump where fract() wraps around.
+vec4 sampleRegion(vec2 uv, vec4 region, float layer)
+{
+    vec2 atlasUV = region.xy + fract(uv) * region.zw;
+    return textureGrad(textures, vec3(atlasUV, layer), dFdx(uv) * region.zw, dFdy(uv) * region.zw);
+}
@@ -0,0 +1,7 @@
+#pragma once
+// Shared camera matrices, uploaded only when the camera changes
+layout (std140) uniform Matrices
+{
+    mat4 projection;
+    mat4 view;
+};
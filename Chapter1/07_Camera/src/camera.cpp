@@ -2,17 +2,19 @@
 
 Camera::Camera(int windowX, int windowY)
 {
-    delta_time = 0.0f; // Time between current frame and last frame
-    last_frame = 0.0f; // Time of last frame
-
     yaw = 0.0f; // Up and down mouse movement
     pitch = 0.0f; // Side to side mouse movement
 
     zoom = 45.0f; // How zoomed in the perspective is
+    aspect_ratio = (float)windowX / (float)windowY;
+    near_plane = 0.1f;
+    far_plane = 100.0f;
+    depth_mode = DEPTH_STANDARD;
 
-    camera_pos = glm::vec3(0.0f, 0.0f, 4.0f);
-    camera_target = glm::vec3(0.0f, 0.0f, 0.0f);
-    camera_direction = glm::normalize(camera_pos - camera_target);
+    camera_pos = glm::dvec3(0.0, 0.0, 4.0);
+    camera_target = glm::dvec3(0.0, 0.0, 0.0);
+    camera_relative = true;
+    camera_direction = glm::vec3(glm::normalize(camera_pos - camera_target));
 
     // Setup right axis
     up = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -23,7 +25,7 @@ Camera::Camera(int windowX, int windowY)
 
     camera_front = glm::vec3(0.5f, 0.5f, -1.0f);
 
-    camera_speed = 0.5f;
+    movement_speed = 5.0;
 
     mouseX = 0;
     mouseY = windowY / 2;
@@ -33,8 +35,10 @@ Camera::Camera(int windowX, int windowY)
 
     scrollwheel_offset = 45;
 
-    view = glm::lookAt(camera_pos, camera_pos + camera_front, camera_up);
-    projection = glm::perspective(glm::radians(zoom), 800.0f / 600.0f, 0.1f, 100.0f);
+    // Everything is built on first use
+    revision = 0;
+    mark_view_dirty();
+    mark_projection_dirty();
 }
 
 Camera::~Camera()
@@ -53,6 +57,10 @@ void Camera::mouse_callback()
     x_offset *= sensitivity;
     y_offset *= sensitivity;
 
+    // Nothing to do while the mouse is held still
+    if(x_offset == 0.0f && y_offset == 0.0f)
+        return;
+
     yaw += x_offset;
     pitch += y_offset;
 
@@ -61,16 +69,22 @@ void Camera::mouse_callback()
         pitch = 89.0f;
     if(pitch < -89.0f)
         pitch = -89.0f;
+
+    calc_mouse_look_direction();
 }
 
 void Camera::scroll_callback()
 {
+    float previous_zoom = zoom;
     zoom -= (float)scrollwheel_offset;
 
     if(zoom < 1.0f)
         zoom = 1.0f;
     if(zoom > 45.0f)
         zoom = 45.0f;
+
+    if(zoom != previous_zoom)
+        mark_projection_dirty();
 }
 
 void Camera::set_mouse_coords(int mouseX, int mouseY)
@@ -86,6 +100,7 @@ void Camera::calc_mouse_look_direction()
     direction.y = sin(glm::radians(pitch));
     direction.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
     camera_front = glm::normalize(direction);
+    mark_view_dirty();
 }
 
 bool Camera::check_mouse_pressed()
@@ -103,52 +118,204 @@ void Camera::set_scrollwheel_offset(int offset)
     this->scrollwheel_offset = offset;
 }
 
-void Camera::set_camera_pos(char key)
+void Camera::move(float forward, float right, double delta_time)
+{
+    if(forward == 0.0f && right == 0.0f)
+        return;
+
+    // Directions are fine as floats, the position they move is accumulated in double
+    glm::vec3 direction = camera_front * forward + glm::normalize(glm::cross(camera_front, camera_up)) * right;
+    // Diagonals are no faster than straight lines
+    float length = glm::length(direction);
+    if(length > 1.0f)
+        direction = direction / length;
+    camera_pos += glm::dvec3(direction) * (movement_speed * delta_time);
+    mark_view_dirty();
+}
+
+void Camera::set_movement_speed(double speed)
+{
+    movement_speed = speed;
+}
+
+void Camera::set_depth_mode(DepthMode mode)
+{
+    if(mode == depth_mode)
+        return;
+    depth_mode = mode;
+    mark_projection_dirty();
+}
+
+void Camera::set_viewport_size(int width, int height)
+{
+    // Minimised windows report a zero size, keep the last aspect
+    if(width <= 0 || height <= 0)
+        return;
+    float aspect = (float)width / (float)height;
+    if(aspect == aspect_ratio)
+        return;
+    aspect_ratio = aspect;
+    mark_projection_dirty();
+}
+
+void Camera::set_position(const glm::dvec3 &position)
+{
+    camera_pos = position;
+    mark_view_dirty();
+}
+
+void Camera::set_camera_relative(bool relative)
+{
+    if(relative == camera_relative)
+        return;
+    camera_relative = relative;
+    mark_view_dirty();
+}
+
+void Camera::mark_view_dirty()
+{
+    view_dirty = true;
+    view_projection_dirty = true;
+    inverse_view_dirty = true;
+    frustum_dirty = true;
+    revision++;
+}
+
+void Camera::mark_projection_dirty()
+{
+    projection_dirty = true;
+    view_projection_dirty = true;
+    inverse_projection_dirty = true;
+    frustum_dirty = true;
+    revision++;
+}
+
+const glm::dvec3& Camera::get_position() const
+{
+    return camera_pos;
+}
+
+const glm::vec3& Camera::get_front() const
+{
+    return camera_front;
+}
+
+glm::dvec3 Camera::get_render_origin() const
 {
-    switch(key)
+    return camera_relative ? camera_pos : glm::dvec3(0.0);
+}
+
+glm::vec3 Camera::to_render_space(const glm::dvec3 &world_position) const
+{
+    // Subtract in double first, the difference is small near the camera
+    return glm::vec3(world_position - get_render_origin());
+}
+
+const glm::mat4& Camera::get_view() const
+{
+    if(view_dirty)
     {
-        case('w'):
-            this->camera_pos += camera_speed * camera_front;
-            break;
-        case('a'):
-            this->camera_pos -= glm::normalize(glm::cross(camera_front, camera_up)) * camera_speed;
-            break;
-        case('s'):
-            this->camera_pos -= camera_speed * camera_front;
-            break;
-        case('d'):
-            this->camera_pos += glm::normalize(glm::cross(camera_front, camera_up)) * camera_speed;
-            break;
+        glm::vec3 eye = to_render_space(camera_pos);
+        view = glm::lookAt(eye, eye + camera_front, camera_up);
+        view_dirty = false;
+    }
+    return view;
+}
 
+const glm::mat4& Camera::get_projection() const
+{
+    if(projection_dirty)
+    {
+        if(depth_mode == DEPTH_REVERSE_Z)
+        {
+            // Infinite far plane with depth = near / distance: 1 at the near plane, 0 at infinity
+            float f = 1.0f / tan(glm::radians(zoom) / 2.0f);
+            projection = glm::mat4(0.0f);
+            projection[0][0] = f / aspect_ratio;
+            projection[1][1] = f;
+            projection[2][3] = -1.0f;
+            projection[3][2] = near_plane;
+        }
+        else
+            projection = glm::perspective(glm::radians(zoom), aspect_ratio, near_plane, far_plane);
+        projection_dirty = false;
     }
+    return projection;
 }
 
-void Camera::sync_camera_frames()
+const glm::mat4& Camera::get_view_projection() const
 {
-    // This ensures that camera speed is the same regardless of computer speed
-    float current_frame = SDL_GetTicks64();
-    delta_time = current_frame - last_frame;
-    last_frame = current_frame;
-    // Multiply by delta time to ensure speed remains constant on all systems
-    camera_speed = 0.03f * delta_time;
+    if(view_projection_dirty)
+    {
+        view_projection = get_projection() * get_view();
+        view_projection_dirty = false;
+    }
+    return view_projection;
 }
 
-void Camera::update_view()
+const glm::mat4& Camera::get_inverse_view() const
 {
-    view = glm::lookAt(camera_pos, camera_pos + camera_front, camera_up);
+    if(inverse_view_dirty)
+    {
+        inverse_view = glm::inverse(get_view());
+        inverse_view_dirty = false;
+    }
+    return inverse_view;
 }
 
-void Camera::update_projection()
+const glm::mat4& Camera::get_inverse_projection() const
 {
-    projection = glm::perspective(glm::radians(zoom), 800.0f / 600.0f, 0.1f, 100.0f);
+    if(inverse_projection_dirty)
+    {
+        inverse_projection = glm::inverse(get_projection());
+        inverse_projection_dirty = false;
+    }
+    return inverse_projection;
 }
 
-glm::mat4 Camera::get_view()
+const glm::vec4* Camera::get_frustum_planes() const
 {
-    return this->view;
+    if(frustum_dirty)
+    {
+        // Gribb/Hartmann: planes are sums and differences of the rows of view_projection
+        const glm::mat4 &m = get_view_projection();
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        frustum_planes[FRUSTUM_LEFT] = row3 + row0;
+        frustum_planes[FRUSTUM_RIGHT] = row3 - row0;
+        frustum_planes[FRUSTUM_BOTTOM] = row3 + row1;
+        frustum_planes[FRUSTUM_TOP] = row3 - row1;
+        if(depth_mode == DEPTH_REVERSE_Z)
+        {
+            // Clip range is 0 <= z <= w with the near plane at z = w
+            frustum_planes[FRUSTUM_NEAR] = row3 - row2;
+            frustum_planes[FRUSTUM_FAR] = row2;
+        }
+        else
+        {
+            frustum_planes[FRUSTUM_NEAR] = row3 + row2;
+            frustum_planes[FRUSTUM_FAR] = row3 - row2;
+        }
+
+        for(int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+        {
+            glm::vec4 &plane = frustum_planes[i];
+            float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+            // With reverse-Z the far plane is at infinity, keep it as one everything is inside of
+            if(length < 1e-6f)
+                plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            else
+                plane /= length;
+        }
+        frustum_dirty = false;
+    }
+    return frustum_planes;
 }
 
-glm::mat4 Camera::get_projection()
+unsigned int Camera::get_revision() const
 {
-    return this->projection;
-}
\ No newline at end of file
+    return revision;
+}
@@ -1,3 +1,6 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <GL/glew.h>
@@ -6,27 +9,37 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "depth.h"
+
+// Frustum plane order returned by get_frustum_planes()
+enum FrustumPlane { FRUSTUM_LEFT, FRUSTUM_RIGHT, FRUSTUM_BOTTOM, FRUSTUM_TOP, FRUSTUM_NEAR, FRUSTUM_FAR, FRUSTUM_PLANE_COUNT };
+
 class Camera
 {
 
 private:
-    float delta_time;
-    float last_frame;
-
     float yaw;
     float pitch;
 
     float zoom;
+    float aspect_ratio;
+    float near_plane;
+    float far_plane; // Standard depth only, reverse-Z puts the far plane at infinity
+    DepthMode depth_mode;
 
+    // World space is double precision. With camera_relative set, the view
+    // matrix is built with the camera at the origin and objects are moved into
+    // that space on the CPU (to_render_space), so float precision is spent
+    // near the camera rather than near the world origin.
+    glm::dvec3 camera_pos;
+    glm::dvec3 camera_target;
+    bool camera_relative;
     glm::vec3 camera_direction;
     glm::vec3 up;
     glm::vec3 camera_right;
     glm::vec3 camera_up;
     glm::vec3 camera_front;
-    float camera_speed;
-
-    glm::mat4 view;
-    glm::mat4 projection;
+    double movement_speed; // Units per second
 
     int mouseX;
     int mouseY;
@@ -36,25 +49,66 @@ private:
 
     int scrollwheel_offset;
 
+    // Matrices are only rebuilt by the getters, and only after something they
+    // depend on has changed
+    mutable glm::mat4 view;
+    mutable glm::mat4 projection;
+    mutable glm::mat4 view_projection;
+    mutable glm::mat4 inverse_view;
+    mutable glm::mat4 inverse_projection;
+    mutable glm::vec4 frustum_planes[FRUSTUM_PLANE_COUNT];
+
+    mutable bool view_dirty;
+    mutable bool projection_dirty;
+    mutable bool view_projection_dirty;
+    mutable bool inverse_view_dirty;
+    mutable bool inverse_projection_dirty;
+    mutable bool frustum_dirty;
+
+    // Bumped whenever view or projection change
+    unsigned int revision;
+
+    void calc_mouse_look_direction();
+    void mark_view_dirty();
+    void mark_projection_dirty();
+
 public:
     Camera(int windowX, int windowY);
     ~Camera();
 
-    glm::vec3 camera_pos;
-    glm::vec3 camera_target;
     void mouse_callback();
     void scroll_callback();
     void set_mouse_coords(int mouseX, int mouseY);
-    void calc_mouse_look_direction();
     bool check_mouse_pressed();
-    void sync_camera_frames();
-    void update_view();
-    void update_projection();
     void set_mouse_pressed(bool pressed);
     void set_scrollwheel_offset(int offset);
-    void set_camera_pos(char key);
+    // Moves along the view direction and its right vector, each axis in [-1, 1]
+    // scaled by movement_speed and delta_time (seconds)
+    void move(float forward, float right, double delta_time);
+    void set_movement_speed(double speed);
+    void set_depth_mode(DepthMode mode);
+    void set_viewport_size(int width, int height);
+    void set_position(const glm::dvec3 &position);
+    void set_camera_relative(bool relative);
+
+    // Where render space is centred: the camera, or the world origin
+    glm::dvec3 get_render_origin() const;
+    // World position to the single precision space the view matrix expects
+    glm::vec3 to_render_space(const glm::dvec3 &world_position) const;
+
+    const glm::dvec3& get_position() const;
+    // Unit view direction
+    const glm::vec3& get_front() const;
+    const glm::mat4& get_view() const;
+    const glm::mat4& get_projection() const;
+    const glm::mat4& get_view_projection() const;
+    const glm::mat4& get_inverse_view() const;
+    const glm::mat4& get_inverse_projection() const;
+    // Render space planes as (normal, distance), normals pointing inwards
+    const glm::vec4* get_frustum_planes() const;
 
-    glm::mat4 get_view();
-    glm::mat4 get_projection();
+    // Changes whenever the matrices do, so uploads can be skipped otherwise
+    unsigned int get_revision() const;
 };
 
+#endif // CAMERA_H
@@ -0,0 +1,40 @@
+#include "depth.h"
+
+#include <stdio.h>
+
+DepthMode choose_depth_mode(bool want_reverse_z)
+{
+    if(!want_reverse_z)
+        return DEPTH_STANDARD;
+
+    // Without clip control depth goes through z * 0.5 + 0.5, which throws away
+    // the float precision reverse-Z relies on
+    if(!GLEW_VERSION_4_5 && !GLEW_ARB_clip_control)
+    {
+        printf("glClipControl not supported, using standard depth\n");
+        return DEPTH_STANDARD;
+    }
+    return DEPTH_REVERSE_Z;
+}
+
+void apply_depth_mode(DepthMode mode)
+{
+    if(mode == DEPTH_REVERSE_Z)
+    {
+        glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        glDepthFunc(GL_GREATER);
+        glClearDepth(0.0);
+    }
+    else
+    {
+        if(GLEW_VERSION_4_5 || GLEW_ARB_clip_control)
+            glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+        glDepthFunc(GL_LESS);
+        glClearDepth(1.0);
+    }
+}
+
+GLenum depth_format(DepthMode mode)
+{
+    return mode == DEPTH_REVERSE_Z ? GL_DEPTH_COMPONENT32F : GL_DEPTH_COMPONENT24;
+}
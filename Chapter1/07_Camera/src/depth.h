@@ -0,0 +1,20 @@
+#ifndef DEPTH_H
+#define DEPTH_H
+
+#include <GL/glew.h>
+
+// DEPTH_REVERSE_Z maps the near plane to depth 1 and infinity to 0 and needs a
+// [0, 1] clip range and a float depth buffer. DEPTH_STANDARD is the usual
+// [-1, 1] mapping with a finite far plane, for contexts without glClipControl.
+enum DepthMode { DEPTH_STANDARD, DEPTH_REVERSE_Z };
+
+// Returns DEPTH_REVERSE_Z if it was asked for and the context can do it
+DepthMode choose_depth_mode(bool want_reverse_z);
+
+// Sets clip control, depth compare and depth clear value for the mode
+void apply_depth_mode(DepthMode mode);
+
+// Depth buffer format a render target should use for the mode
+GLenum depth_format(DepthMode mode);
+
+#endif // DEPTH_H
@@ -1,11 +1,29 @@
 #include <stdio.h>
+#include <math.h>
 
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
 
+#include "window.h"
 #include "shaders.h"
-#include "stb/stb_image.h"
+#include "shader_preprocessor.h"
+#include "program_interface.h"
+#include "vertex_layout.h"
+#include "gl_resources.h"
 #include "camera.h"
+#include "profiler.h"
+#include "options.h"
+#include "gl_intercept.h"
+#include "gl_capture.h"
+#include "depth.h"
+#include "render_target.h"
+#include "clock.h"
+#include "resolution_scaler.h"
+#include "frame_scheduler.h"
+#include "frame_pacer.h"
+#include "input.h"
+#include "texture_atlas.h"
+#include "voxel_world.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -14,50 +32,29 @@
 int SCREEN_WIDTH = 1920;
 int SCREEN_HEIGHT = 1080;
 
-int main()
+int main(int argc, char* argv[])
 {
-    // Setup SDL Stuff
-    if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
-    {
-        printf("Failed to initialize SDL");
+    Options options;
+    if(!parse_options(argc, argv, options))
         return -1;
-    }
-
-    // Setup OpenGL Attributes
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 
-    // Create Window
-    SDL_Window* window = SDL_CreateWindow("Learn OpenGL", 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL);
-    if (!window)
-    {
-        printf("Failed to create SDL window");
+    // Window, GL context and GLEW
+    Window window;
+    if(!window.init("Learn OpenGL", SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_RESIZABLE))
         return -1;
-    }
 
-    // Create Context
-    SDL_GLContext context = SDL_GL_CreateContext(window);
-    if (!context)
-    {
-        printf("Failed to create context");
-        return -1;
-    }
-
-    // Make Current Context
-    SDL_GL_MakeCurrent(window, context);
+    // Drawable size can differ from the window size on high DPI displays
+    int drawable_width, drawable_height;
+    window.get_drawable_size(&drawable_width, &drawable_height);
 
-    // Create View Port
-    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    // Edit GL objects by name where the context allows it
+    GLResources::init(options.dsa);
 
-    // Initialize GLEW
-    glewExperimental = GL_TRUE;
-    GLenum glewError = glewInit();
-    if (glewError != GLEW_OK)
-    {
-        printf("Error initializing GLEW %s\n", glewGetErrorString(glewError));
-        return -1;
-    }
+    // Count GL calls from here on
+    if(options.gl_stats)
+        GLIntercept::enable_stats();
+    if(options.capture_path)
+        GLCapture::start(options.capture_path, options.capture_frame, drawable_width, drawable_height);
 
     // Create shader object
     Shader myShader("shaders/squareTexture.vertex", "shaders/squareTexture.fragment");
@@ -65,47 +62,46 @@ int main()
     // Create camera object
     Camera camera(SCREEN_WIDTH, SCREEN_HEIGHT);
 
-    // Generate Texture
-    unsigned int texture0;
-    glGenTextures(1, &texture0); // Assign ID
-    glBindTexture(GL_TEXTURE_2D, texture0); // Bind ID to 2D texture
-    // Set texture wrapping and filtering options
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  
-    // Load and generate textures
-    int width, height, nbChannels;
-    unsigned char *data = stbi_load("textures/container.jpg", &width, &height, &nbChannels, 0);
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-        printf("Failed to load texture");
-
-    unsigned int texture1;
-    glGenTextures(1, &texture1); // Assign ID
-    glBindTexture(GL_TEXTURE_2D, texture1); // Bind ID to 2D texture
-    // Set texture wrapping and filtering options
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    data = stbi_load("textures/awesomeface.png", &width, &height, &nbChannels, 0);
-    if (data)
+    // The scene is drawn offscreen so reverse-Z can use a float depth buffer
+    DepthMode depth_mode = choose_depth_mode(options.reverse_z);
+    apply_depth_mode(depth_mode);
+    camera.set_depth_mode(depth_mode);
+
+    camera.set_viewport_size(drawable_width, drawable_height);
+
+    RenderTargetPool target_pool;
+    RenderTarget* scene_target = target_pool.acquire(drawable_width, drawable_height, depth_format(depth_mode));
+    if(!scene_target)
+        return -1;
+
+    // The scene may be drawn at a fraction of the window's resolution and stretched to fit
+    ResolutionScaler scaler(options.target_frame_ms, options.min_resolution_scale);
+    if(options.dynamic_resolution)
+        scaler.init();
+    Upscaler upscaler;
+    upscaler.init(options.sharpen_upscale);
+
+    // Both textures go into one array texture, the scene binds it once per frame
+    TextureAtlas atlas;
+    int containerImage = atlas.add_image("textures/container.jpg");
+    int faceImage = atlas.add_image("textures/awesomeface.png");
+    // Mips are filtered in linear light on the CPU, each level split across short lived workers
+    MipOptions mipOptions;
+    mipOptions.filter = (MipFilter)options.mip_filter;
+    ThreadPool mipPool;
+    if(options.mip_filter >= 0)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        mipPool.start(0, "Mip Worker");
+        atlas.set_mip_generation(&mipOptions, &mipPool);
     }
-    else
-        printf("Failed to load texture");
-
-    // Free texture data
-    stbi_image_free(data);
+    bool atlasBuilt = containerImage >= 0 && faceImage >= 0 && atlas.build((AtlasMode)options.atlas_mode);
+    mipPool.stop();
+    if(options.mip_filter >= 0)
+        atlas.set_mip_generation(&mipOptions);
+    if(!atlasBuilt)
+        return -1;
+    if(options.gl_stats)
+        atlas.print_report();
 
     // Texture Coordinates (0,0) bottom left, (1,1) top right
     float vertices[] = {
@@ -153,101 +149,233 @@ int main()
         -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
     };
 
-    glm::vec3 cubePositions[] = {
-      glm::vec3( 0.0f,  0.0f,  0.0f),
-      glm::vec3( 2.0f,  5.0f, -15.0f),
-      glm::vec3(-1.5f, -2.2f, -2.5f),
-      glm::vec3(-3.8f, -2.0f, -12.3f),
-      glm::vec3( 2.4f, -0.4f, -3.5f),
-      glm::vec3(-1.7f,  3.0f, -7.5f),
-      glm::vec3( 1.3f, -2.0f, -2.5f),
-      glm::vec3( 1.5f,  2.0f, -2.5f),
-      glm::vec3( 1.5f,  0.2f, -1.5f),
-      glm::vec3(-1.3f,  1.0f, -1.5f)
+    // World positions are double precision, see Camera::to_render_space
+    glm::dvec3 cubePositions[] = {
+      glm::dvec3( 0.0,  0.0,  0.0),
+      glm::dvec3( 2.0,  5.0, -15.0),
+      glm::dvec3(-1.5, -2.2, -2.5),
+      glm::dvec3(-3.8, -2.0, -12.3),
+      glm::dvec3( 2.4, -0.4, -3.5),
+      glm::dvec3(-1.7,  3.0, -7.5),
+      glm::dvec3( 1.3, -2.0, -2.5),
+      glm::dvec3( 1.5,  2.0, -2.5),
+      glm::dvec3( 1.5,  0.2, -1.5),
+      glm::dvec3(-1.3,  1.0, -1.5)
     };
 
-    // Note: bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-
-    // Setup Buffer Object and Vertex Array Object
-    unsigned int VBO[1];
-    unsigned int VAO[1];
-    glGenVertexArrays(1, VAO);
-    glGenBuffers(1, VBO);
-
-    // Link Vertex Attributes with VAO
-    glBindVertexArray(VAO[0]);
+    // Move the whole scene away from the origin to check precision far out
+    glm::dvec3 world_offset(options.world_offset);
+    for(int i = 0; i < 10; i++)
+        cubePositions[i] += world_offset;
+    camera.set_position(camera.get_position() + world_offset);
+    camera.set_camera_relative(options.camera_relative);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // Camera matrices live in a uniform buffer at binding point 0, every program's Matrices block reads it
+    unsigned int matricesUBO = GLResources::create_buffer();
+    GLResources::buffer_storage(matricesUBO, 2 * sizeof(glm::mat4), NULL, true);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, matricesUBO);
+    UniformBlockBindings::get().add("Matrices", 0, 2 * sizeof(glm::mat4));
 
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // texture coord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // Setup Buffer Object
+    unsigned int VBO[1];
+    VBO[0] = GLResources::create_buffer();
+    GLResources::buffer_storage(VBO[0], sizeof(vertices), vertices, false);
+
+    // Attribute locations come from the shader, the format only names what each vertex holds
+    VertexFormat cubeFormat;
+    cubeFormat.add("aPos", 3).add("aTexCoord", 2);
+    ProgramInterface myInterface;
+    myInterface.reflect(myShader.ID);
+    UniformBlockBindings::get().apply(myInterface);
+    GLuint cubeVAO = VertexArrayCache::get().acquire(myInterface, cubeFormat, VBO[0]);
+    if(!cubeVAO)
+        return -1;
 
     // Set program and texture numbers
     myShader.use();
-    myShader.setInt("texture0", 0);
-    myShader.setInt("texture1", 1);
+    myShader.setInt("textures", 0);
+    atlas.apply_region(myInterface.get_uniform_location("region0"), myInterface.get_uniform_location("layer0"), containerImage);
+    atlas.apply_region(myInterface.get_uniform_location("region1"), myInterface.get_uniform_location("layer1"), faceImage);
+
+    int modelLoc = myInterface.get_uniform_location("model");
+    unsigned int myShaderRevision = myShader.revision;
+
+    // The block world replaces the cubes, it starts generating on worker threads right away
+    VoxelWorld world;
+    if(options.voxel_world)
+    {
+        if(!world.init(options.voxel_size_x, options.voxel_size_y, options.voxel_size_z, options.mesh_threads, 1337))
+            return -1;
+        world.set_origin(world_offset);
+        world.set_detail_texture(atlas, containerImage);
+        // Above the highest hills, over the middle where loading starts
+        camera.set_position(world_offset + glm::dvec3(options.voxel_size_x * 0.5, options.voxel_size_y * 0.85, options.voxel_size_z * 0.5));
+        camera.set_movement_speed(40.0);
+    }
 
     // Makes the cubes look 3D
     glEnable(GL_DEPTH_TEST);
 
     // call mouse_callback before loop to set camera in center of screen
     camera.mouse_callback();
+    unsigned int uploaded_revision = camera.get_revision() - 1;
 
     // Event Loop
     bool quit = false;
     SDL_Event event;
+    unsigned int frame_count = 0;
+    bool resized = false;
+    Clock clock;
+
+    // With --on-demand the loop sleeps whenever nothing on screen can change
+    FrameScheduler scheduler(clock);
+    bool animating = true;
+    double animation_time = 0.0;
+    scheduler.begin_animation();
+    Input input;
+    FramePacer pacer(clock);
+    pacer.init(window.get_window(), (SwapMode)options.swap_interval, options.frames_in_flight, options.late_input);
+
+    bool capturing = GLCapture::active();
+    if(capturing)
+        scheduler.begin_async();
+    // Chunks keep arriving from the workers while the world loads
+    bool voxels_loading = options.voxel_world;
+    if(voxels_loading)
+        scheduler.begin_async();
+
+    // --hot-reload looks for edited shader files twice a second, waking an idle
+    // loop to do so but only drawing when a program was rebuilt
+    const double SHADER_CHECK_INTERVAL = 0.5;
+    double nextShaderCheck = 0.0;
+
+    PROFILE_THREAD_NAME("Main");
 
     while (!quit)
     {
-        while (SDL_PollEvent(&event))
+        PROFILE_ZONE("Frame");
+
+        bool have_event = options.on_demand && scheduler.wait_event(&event);
+        if(scheduler.has_slept())
+            clock.resume();
+
+        // Limit queued frames, then hold off reading input until as late as the frame allows
+        {
+            PROFILE_ZONE("Pacing");
+            pacer.wait_for_frame_slot();
+            pacer.wait_for_input_deadline();
+        }
+        clock.tick();
+
+        {
+            PROFILE_ZONE("Events");
+            input.begin_frame();
+            if(have_event)
+                input.push(event);
+            input.drain();
+        }
+
+        for(unsigned int i = 0; i < input.get_event_count(); i++)
+        {
+            const SDL_Event &window_event = input.get_event(i);
+            // Only note the resize, a drag produces many of these per frame
+            if(window_event.type == SDL_WINDOWEVENT && window_event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                resized = true;
+        }
+
+        if(input.quit_requested() || input.key_pressed(SDL_SCANCODE_ESCAPE))
+            quit = true;
+        // Pause the spinning cubes, lets --on-demand go idle
+        if(input.key_pressed(SDL_SCANCODE_P))
+        {
+            animating = !animating;
+            if(animating)
+                scheduler.begin_animation();
+            else
+                scheduler.end_animation();
+        }
+
+        // All mouse input for moving camera
+        if(input.any_button_pressed())
+        {
+            camera.set_mouse_pressed(true);
+            SDL_SetRelativeMouseMode(SDL_TRUE);
+        }
+        if(input.any_button_released())
+        {
+            camera.set_mouse_pressed(false);
+            SDL_SetRelativeMouseMode(SDL_FALSE);
+        }
+        if(camera.check_mouse_pressed())
+            camera.set_mouse_coords(input.get_motion_x(), input.get_motion_y());
+        if(input.get_wheel() != 0)
+        {
+            camera.set_scrollwheel_offset(input.get_wheel());
+            camera.scroll_callback();
+        }
+
+        // Any input or window change may alter what is on screen, and held keys keep the camera moving
+        if(input.has_input() || input.any_key_held())
+            scheduler.request_redraw();
+
+        if(options.hot_reload && clock.get_time() >= nextShaderCheck)
+        {
+            PROFILE_ZONE("Shader Reload");
+            if(!ShaderPreprocessor::get().reload_changed().empty())
+                scheduler.request_redraw();
+            nextShaderCheck = clock.get_time() + SHADER_CHECK_INTERVAL;
+            if(options.on_demand)
+                scheduler.poll_at(nextShaderCheck);
+        }
+
+        pacer.mark_input_sampled();
+
+        if(options.on_demand && !scheduler.frame_due())
+            continue;
+        if(animating)
+            animation_time += clock.get_delta_time();
+
+        // Movement integrates held keys over the frame, independent of key repeat
+        float forward = (input.key_held(SDL_SCANCODE_W) ? 1.0f : 0.0f) - (input.key_held(SDL_SCANCODE_S) ? 1.0f : 0.0f);
+        float right = (input.key_held(SDL_SCANCODE_D) ? 1.0f : 0.0f) - (input.key_held(SDL_SCANCODE_A) ? 1.0f : 0.0f);
+        camera.move(forward, right, clock.get_delta_time());
+
+        if(options.voxel_world)
         {
-            switch (event.type)
+            // F digs out the block under the crosshair, R places stone in front of it
+            bool dig = input.key_pressed(SDL_SCANCODE_F);
+            bool place = input.key_pressed(SDL_SCANCODE_R);
+            glm::ivec3 hit, before;
+            if((dig || place) && world.raycast(camera.get_position(), camera.get_front(), 64.0f, hit, before))
             {
-                case(SDL_QUIT):
-                    quit = true;
-                    break;
-                case(SDL_KEYDOWN):
-                    switch(event.key.keysym.sym)
-                    {
-                        case(SDLK_w):
-                            camera.set_camera_pos('w');
-                            break;
-                        case(SDLK_a):
-                            camera.set_camera_pos('a');
-                            break;
-                        case(SDLK_s):
-                            camera.set_camera_pos('s');
-                            break;
-                        case(SDLK_d):
-                            camera.set_camera_pos('d');
-                            break;
-                        case(SDLK_ESCAPE):
-                            quit = true;
-                            break;
-                    }
-                // All mouse input for moving camera
-                case(SDL_MOUSEBUTTONDOWN):
-                    camera.set_mouse_pressed(true);
-                    SDL_SetRelativeMouseMode(SDL_TRUE);
-                    break;
-                case(SDL_MOUSEBUTTONUP):
-                    camera.set_mouse_pressed(false);
-                    SDL_SetRelativeMouseMode(SDL_FALSE);
-                    break;
-                case(SDL_MOUSEMOTION):
-                    if(camera.check_mouse_pressed())
-                        camera.set_mouse_coords(event.motion.xrel, event.motion.yrel);
-                    break;
-                case(SDL_MOUSEWHEEL):
-                    camera.set_scrollwheel_offset(event.wheel.y);
-                    camera.scroll_callback();
+                if(dig)
+                    world.set_block(hit.x, hit.y, hit.z, BLOCK_AIR);
+                else
+                    world.set_block(before.x, before.y, before.z, BLOCK_STONE);
             }
+            world.update();
         }
+
+        // Resize the camera and scene target at most once per frame
+        if(resized)
+        {
+            resized = false;
+            int width, height;
+            window.get_drawable_size(&width, &height);
+            if(width > 0 && height > 0 && (width != drawable_width || height != drawable_height))
+            {
+                drawable_width = width;
+                drawable_height = height;
+                camera.set_viewport_size(width, height);
+                scene_target = target_pool.resize(scene_target, width, height);
+            }
+        }
+
+        scene_target->set_size(scaler.scaled(drawable_width), scaler.scaled(drawable_height));
+        scene_target->bind();
+        if(options.dynamic_resolution)
+            scaler.begin_frame();
+
         // Set background colour
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -258,14 +386,21 @@ int main()
             camera.mouse_callback();
         }
 
-        // // This ensures that camera speed is the same regardless of computer speed
-        camera.sync_camera_frames();
+        // The upscale pass switches programs, so set ours every frame
+        myShader.use();
+        if(myShaderRevision != myShader.revision)
+        {
+            // Shares the old array unless the inputs moved
+            myInterface.reflect(myShader.ID);
+            GLuint reloadedVAO = VertexArrayCache::get().acquire(myInterface, cubeFormat, VBO[0]);
+            if(reloadedVAO)
+                cubeVAO = reloadedVAO;
+            modelLoc = myInterface.get_uniform_location("model");
+            myShaderRevision = myShader.revision;
+        }
 
-        // Bind Textures
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture1);
+        // One binding covers every texture in the scene
+        atlas.bind(0);
 
         /* Rotate camera around scene every second
         const float radius = 10.0f;
@@ -274,51 +409,110 @@ int main()
         glm::mat4 view = glm::lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         */
 
-       // Mouse look direction
-       camera.calc_mouse_look_direction();
+        // Camera matrices are rebuilt lazily, only upload them when they changed
+        if(camera.get_revision() != uploaded_revision)
+        {
+            GLResources::buffer_sub_data(matricesUBO, 0, sizeof(glm::mat4), glm::value_ptr(camera.get_projection()));
+            GLResources::buffer_sub_data(matricesUBO, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(camera.get_view()));
+            uploaded_revision = camera.get_revision();
+        }
 
-        // User input to move around camera
-        //glm::mat4 view = glm::lookAt(camera_pos, camera_pos + camera_front, camera_up);
-        camera.update_view();
+        if(options.voxel_world)
+            world.draw(camera);
+        else
+        {
+            PROFILE_ZONE("Draw Cubes");
+            PROFILE_GPU_ZONE("Draw Cubes GPU");
 
-        camera.update_projection();
+            glBindVertexArray(cubeVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
 
-        int viewLoc = glGetUniformLocation(myShader.ID, "view");
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(camera.get_view()));
+            for(int i = 0; i < 10; i++)
+            {
+                // calculate the model matrix for each object and pass it to shader before drawing
+                glm::mat4 model = glm::mat4(1.0f);
+                model = glm::translate(model, camera.to_render_space(cubePositions[i]));
 
-        int projectionLoc = glGetUniformLocation(myShader.ID, "projection");
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(camera.get_projection()));
+                float angle = 20.0f + (i * 2);
+                model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+                // Wrap in double before narrowing so the spin stays smooth on long runs
+                float spin = (float)fmod(animation_time * 50.0, 360.0);
+                model = glm::rotate(model, glm::radians(spin), glm::vec3(0.5f, 1.0f, 0.0f));
 
-        glBindVertexArray(VAO[0]);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
-        for(int i = 0; i < 10; i++)
-        {
-            // calculate the model matrix for each object and pass it to shader before drawing
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+            }
+        }
 
-            float angle = 20.0f + (i * 2);
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            model = glm::rotate(model, ((float)SDL_GetTicks() / 1000) * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
+        if(options.dynamic_resolution)
+            scaler.end_frame();
+        upscaler.draw(*scene_target, drawable_width, drawable_height);
+
+        // Swap windows
+        {
+            PROFILE_ZONE("Swap");
+            pacer.present(window.get_window());
+        }
 
-            int modelLoc = glGetUniformLocation(myShader.ID, "model");
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        PROFILE_FRAME();
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        GLIntercept::end_frame();
+        GLCapture::end_frame();
+        if(++frame_count % options.gl_stats_interval == 0)
+        {
+            if(GLIntercept::stats_enabled())
+                GLIntercept::print_report(10);
+            if(options.dynamic_resolution)
+                scaler.print_report(drawable_width, drawable_height);
+            if(options.on_demand)
+                scheduler.print_report();
+            if(GLIntercept::stats_enabled())
+                input.print_report();
+            if(GLIntercept::stats_enabled())
+                pacer.print_report();
+            if(options.voxel_world && GLIntercept::stats_enabled())
+                world.print_report();
+            if(GLIntercept::stats_enabled())
+                VertexArrayCache::get().print_report();
         }
 
-        // Swap windows
-        SDL_GL_SwapWindow(window);
+        // The capture needs frames to reach its target, keep drawing until it is written
+        if(capturing && !GLCapture::active())
+        {
+            capturing = false;
+            scheduler.end_async();
+        }
+        if(voxels_loading && !world.is_loading())
+        {
+            voxels_loading = false;
+            scheduler.end_async();
+        }
     }
 
+    // Latency since the last interval report, or for the whole run
+    pacer.print_report();
+    PROFILE_WRITE("profile.json");
+
+    if(options.gl_stats_json)
+        GLIntercept::write_json(options.gl_stats_json);
+
     /* Cleanup created OpenGL objects. */
-    glDeleteVertexArrays(1, VAO);
+    atlas.destroy();
+    if(options.voxel_world)
+        world.destroy();
+    VertexArrayCache::get().release_buffer(VBO[0]);
+    glDeleteBuffers(1, VBO);
+    glDeleteBuffers(1, &matricesUBO);
+    pacer.destroy();
+    upscaler.destroy();
+    if(options.dynamic_resolution)
+        scaler.destroy();
+    target_pool.release(scene_target);
+    target_pool.clear();
 
     // SDL Cleanup
-    SDL_GL_DeleteContext(context);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    window.destroy();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "options.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Options::Options()
+{
+    gl_stats = false;
+    gl_stats_interval = 300;
+    gl_stats_json = NULL;
+    capture_path = NULL;
+    capture_frame = 10;
+    reverse_z = true;
+    world_offset = 0.0;
+    camera_relative = true;
+    dynamic_resolution = false;
+    target_frame_ms = 16.6;
+    min_resolution_scale = 0.5f;
+    sharpen_upscale = false;
+    on_demand = false;
+    swap_interval = 1;
+    frames_in_flight = 2;
+    late_input = false;
+    atlas_mode = 0;
+    mip_filter = 0;
+    voxel_world = false;
+    voxel_size_x = 1024;
+    voxel_size_y = 256;
+    voxel_size_z = 1024;
+    mesh_threads = 0;
+    hot_reload = false;
+    dsa = true;
+}
+
+// Returns the text after "name=" if arg starts with it, NULL otherwise
+static const char* option_value(const char* arg, const char* name)
+{
+    size_t length = strlen(name);
+    if(strncmp(arg, name, length) == 0 && arg[length] == '=')
+        return arg + length + 1;
+    return NULL;
+}
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --gl-stats[=N]          Count GL calls per frame, print a report every N frames (default 300)\n");
+    printf("  --gl-stats-json=FILE    Write GL call totals to FILE on exit\n");
+    printf("  --capture=FILE          Record the GL command stream up to the capture frame into FILE\n");
+    printf("  --capture-frame=N       Frame the capture ends with, replayed in a loop (default 10)\n");
+    printf("  --depth=MODE            reverse (default, falls back without glClipControl) or standard\n");
+    printf("  --world-offset=X        Place the scene X units from the origin on every axis\n");
+    printf("  --absolute-coordinates  Build matrices in world space instead of relative to the camera\n");
+    printf("  --dynamic-resolution[=MS] Scale the scene resolution to hold MS of GPU time (default 16.6)\n");
+    printf("  --min-scale=F           Lowest resolution scale dynamic resolution may use (default 0.5)\n");
+    printf("  --upscale=MODE          bilinear (default) or sharpen, how the scene is stretched to the window\n");
+    printf("  --on-demand             Sleep instead of redrawing when nothing changes (P pauses the animation)\n");
+    printf("  --swap=MODE             off, vsync (default) or adaptive\n");
+    printf("  --frames-in-flight=N    Frames the GPU may queue before the CPU waits, 0 for no limit (default 2)\n");
+    printf("  --late-input            With vsync, read input as late before the refresh as the frame allows\n");
+    printf("  --atlas=MODE            How textures share one binding: auto (default), array or packed\n");
+    printf("  --mips=FILTER           Texture mip levels from the driver, or built on the CPU in linear space with box (default) or kaiser\n");
+    printf("  --voxel-world[=WxHxD]   Draw a generated block world instead of the cubes (default 1024x256x1024)\n");
+    printf("  --mesh-threads=N        Threads generating and meshing the block world, 0 for one per spare core (default 0)\n");
+    printf("  --hot-reload            Recompile shaders when they or a file they include change on disk\n");
+    printf("  --no-dsa                Create and edit buffers, textures and vertex arrays by binding them, as on GL 3.3\n");
+}
+
+bool parse_options(int argc, char* argv[], Options &options)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value;
+
+        if(strcmp(arg, "--gl-stats") == 0)
+            options.gl_stats = true;
+        else if((value = option_value(arg, "--gl-stats")))
+        {
+            options.gl_stats = true;
+            options.gl_stats_interval = (unsigned int)atoi(value);
+            if(options.gl_stats_interval == 0)
+                options.gl_stats_interval = 300;
+        }
+        else if((value = option_value(arg, "--gl-stats-json")))
+        {
+            options.gl_stats = true;
+            options.gl_stats_json = value;
+        }
+        else if((value = option_value(arg, "--capture")))
+            options.capture_path = value;
+        else if((value = option_value(arg, "--capture-frame")))
+            options.capture_frame = (unsigned int)atoi(value);
+        else if((value = option_value(arg, "--depth")) && (strcmp(value, "reverse") == 0 || strcmp(value, "standard") == 0))
+            options.reverse_z = strcmp(value, "reverse") == 0;
+        else if((value = option_value(arg, "--world-offset")))
+            options.world_offset = atof(value);
+        else if(strcmp(arg, "--absolute-coordinates") == 0)
+            options.camera_relative = false;
+        else if(strcmp(arg, "--dynamic-resolution") == 0)
+            options.dynamic_resolution = true;
+        else if((value = option_value(arg, "--dynamic-resolution")))
+        {
+            options.dynamic_resolution = true;
+            options.target_frame_ms = atof(value);
+            if(options.target_frame_ms <= 0.0)
+                options.target_frame_ms = 16.6;
+        }
+        else if((value = option_value(arg, "--min-scale")))
+        {
+            options.min_resolution_scale = (float)atof(value);
+            if(options.min_resolution_scale < 0.1f || options.min_resolution_scale > 1.0f)
+                options.min_resolution_scale = 0.5f;
+        }
+        else if((value = option_value(arg, "--upscale")) && (strcmp(value, "bilinear") == 0 || strcmp(value, "sharpen") == 0))
+            options.sharpen_upscale = strcmp(value, "sharpen") == 0;
+        else if(strcmp(arg, "--on-demand") == 0)
+            options.on_demand = true;
+        else if((value = option_value(arg, "--swap")) && strcmp(value, "off") == 0)
+            options.swap_interval = 0;
+        else if((value = option_value(arg, "--swap")) && strcmp(value, "vsync") == 0)
+            options.swap_interval = 1;
+        else if((value = option_value(arg, "--swap")) && strcmp(value, "adaptive") == 0)
+            options.swap_interval = -1;
+        else if((value = option_value(arg, "--frames-in-flight")))
+            options.frames_in_flight = (unsigned int)atoi(value);
+        else if(strcmp(arg, "--late-input") == 0)
+            options.late_input = true;
+        else if((value = option_value(arg, "--atlas")) && strcmp(value, "auto") == 0)
+            options.atlas_mode = 0;
+        else if((value = option_value(arg, "--atlas")) && strcmp(value, "array") == 0)
+            options.atlas_mode = 1;
+        else if((value = option_value(arg, "--atlas")) && strcmp(value, "packed") == 0)
+            options.atlas_mode = 2;
+        else if((value = option_value(arg, "--mips")) && strcmp(value, "driver") == 0)
+            options.mip_filter = -1;
+        else if((value = option_value(arg, "--mips")) && strcmp(value, "box") == 0)
+            options.mip_filter = 0;
+        else if((value = option_value(arg, "--mips")) && strcmp(value, "kaiser") == 0)
+            options.mip_filter = 1;
+        else if(strcmp(arg, "--voxel-world") == 0)
+            options.voxel_world = true;
+        else if((value = option_value(arg, "--voxel-world"))
+                && sscanf(value, "%dx%dx%d", &options.voxel_size_x, &options.voxel_size_y, &options.voxel_size_z) == 3
+                && options.voxel_size_x > 0 && options.voxel_size_y > 0 && options.voxel_size_z > 0)
+            options.voxel_world = true;
+        else if((value = option_value(arg, "--mesh-threads")))
+            options.mesh_threads = (unsigned int)atoi(value);
+        else if(strcmp(arg, "--hot-reload") == 0)
+            options.hot_reload = true;
+        else if(strcmp(arg, "--no-dsa") == 0)
+            options.dsa = false;
+        else
+        {
+            printf("Unknown option %s\n", arg);
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
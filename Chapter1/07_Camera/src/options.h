@@ -0,0 +1,39 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+// Command line options for the camera demo
+struct Options
+{
+    bool gl_stats;                   // --gl-stats[=N]: count GL calls, report every N frames
+    unsigned int gl_stats_interval;
+    const char* gl_stats_json;       // --gl-stats-json=FILE: write run totals on exit
+    const char* capture_path;        // --capture=FILE: record a GL trace for tools/gl_replay
+    unsigned int capture_frame;      // --capture-frame=N: frame the trace ends with
+    bool reverse_z;                  // --depth=reverse|standard: depth mapping, see depth.h
+    double world_offset;             // --world-offset=X: move the scene to (X, X, X)
+    bool camera_relative;            // --absolute-coordinates turns camera relative rendering off
+    bool dynamic_resolution;         // --dynamic-resolution[=MS]: scale the scene to hold MS of GPU time
+    double target_frame_ms;
+    float min_resolution_scale;      // --min-scale=F: lowest scale dynamic resolution may pick
+    bool sharpen_upscale;            // --upscale=bilinear|sharpen
+    bool on_demand;                  // --on-demand: only draw when something changed
+    int swap_interval;               // --swap=off|vsync|adaptive, see SwapMode
+    unsigned int frames_in_flight;   // --frames-in-flight=N: 0 leaves it to the driver
+    bool late_input;                 // --late-input: sample input just before the refresh deadline
+    int atlas_mode;                  // --atlas=auto|array|packed, see AtlasMode
+    int mip_filter;                  // --mips=driver|box|kaiser: -1 for glGenerateMipmap, otherwise a MipFilter
+    bool voxel_world;                // --voxel-world[=WxHxD]: draw a block world of that size instead of the cubes
+    int voxel_size_x;
+    int voxel_size_y;
+    int voxel_size_z;
+    unsigned int mesh_threads;       // --mesh-threads=N: voxel generation and meshing threads, 0 picks from the cores
+    bool hot_reload;                 // --hot-reload: rebuild programs whose shader files changed
+    bool dsa;                        // --no-dsa edits GL objects by binding them even where DSA is available
+
+    Options();
+};
+
+// Fills options from argv. Prints usage and returns false on unknown options.
+bool parse_options(int argc, char* argv[], Options &options);
+
+#endif // OPTIONS_H
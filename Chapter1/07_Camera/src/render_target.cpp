@@ -0,0 +1,211 @@
+#include "render_target.h"
+#include "gl_resources.h"
+
+#include <stdio.h>
+
+RenderTarget::RenderTarget()
+{
+    framebuffer = 0;
+    color_texture = 0;
+    depth_texture = 0;
+    depth_format = 0;
+    allocated_width = 0;
+    allocated_height = 0;
+    width = 0;
+    height = 0;
+}
+
+bool RenderTarget::create(int width, int height, GLenum depth_format)
+{
+    destroy();
+    this->depth_format = depth_format;
+    allocated_width = width;
+    allocated_height = height;
+    this->width = width;
+    this->height = height;
+
+    // Fixed size storage, a resize recreates the target
+    color_texture = GLResources::create_texture(GL_TEXTURE_2D);
+    GLResources::texture_storage_2d(color_texture, GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    GLResources::texture_parameter(color_texture, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    GLResources::texture_parameter(color_texture, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    depth_texture = GLResources::create_texture(GL_TEXTURE_2D);
+    GLResources::texture_storage_2d(depth_texture, GL_TEXTURE_2D, 1, depth_format, width, height);
+    GLResources::texture_parameter(depth_texture, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    GLResources::texture_parameter(depth_texture, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if(!GLResources::has_dsa())
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_texture, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        printf("ERROR::RENDER_TARGET::INCOMPLETE_FRAMEBUFFER 0x%x\n", status);
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void RenderTarget::destroy()
+{
+    if(framebuffer)
+        glDeleteFramebuffers(1, &framebuffer);
+    if(color_texture)
+        glDeleteTextures(1, &color_texture);
+    if(depth_texture)
+        glDeleteTextures(1, &depth_texture);
+    framebuffer = 0;
+    color_texture = 0;
+    depth_texture = 0;
+    allocated_width = 0;
+    allocated_height = 0;
+}
+
+void RenderTarget::set_size(int width, int height)
+{
+    this->width = width < allocated_width ? width : allocated_width;
+    this->height = height < allocated_height ? height : allocated_height;
+}
+
+void RenderTarget::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+void RenderTarget::blit_to_screen(int screen_width, int screen_height) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    GLenum filter = (width == screen_width && height == screen_height) ? GL_NEAREST : GL_LINEAR;
+    glBlitFramebuffer(0, 0, width, height, 0, 0, screen_width, screen_height, GL_COLOR_BUFFER_BIT, filter);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int RenderTarget::get_width() const
+{
+    return width;
+}
+
+int RenderTarget::get_height() const
+{
+    return height;
+}
+
+unsigned int RenderTarget::get_color_texture() const
+{
+    return color_texture;
+}
+
+int RenderTarget::get_allocated_width() const
+{
+    return allocated_width;
+}
+
+int RenderTarget::get_allocated_height() const
+{
+    return allocated_height;
+}
+
+GLenum RenderTarget::get_depth_format() const
+{
+    return depth_format;
+}
+
+RenderTargetPool::RenderTargetPool(unsigned int max_free)
+{
+    this->max_free = max_free;
+    allocations = 0;
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    // Only frees the CPU side, clear() should have released the GL objects
+    for(size_t i = 0; i < free_targets.size(); i++)
+        delete free_targets[i];
+}
+
+static int round_up(int size, int granularity)
+{
+    return (size + granularity - 1) / granularity * granularity;
+}
+
+RenderTarget* RenderTargetPool::acquire(int width, int height, GLenum depth_format)
+{
+    int allocated_width = round_up(width, SIZE_GRANULARITY);
+    int allocated_height = round_up(height, SIZE_GRANULARITY);
+
+    // Most recently released first, it is the likeliest to match
+    for(size_t i = free_targets.size(); i-- > 0;)
+    {
+        RenderTarget* target = free_targets[i];
+        if(target->get_allocated_width() == allocated_width && target->get_allocated_height() == allocated_height &&
+            target->get_depth_format() == depth_format)
+        {
+            free_targets.erase(free_targets.begin() + i);
+            target->set_size(width, height);
+            return target;
+        }
+    }
+
+    RenderTarget* target = new RenderTarget();
+    if(!target->create(allocated_width, allocated_height, depth_format))
+    {
+        delete target;
+        return NULL;
+    }
+    allocations++;
+    target->set_size(width, height);
+    return target;
+}
+
+void RenderTargetPool::release(RenderTarget* target)
+{
+    if(!target)
+        return;
+    free_targets.push_back(target);
+    if(free_targets.size() > max_free)
+    {
+        free_targets[0]->destroy();
+        delete free_targets[0];
+        free_targets.erase(free_targets.begin());
+    }
+}
+
+RenderTarget* RenderTargetPool::resize(RenderTarget* target, int width, int height)
+{
+    if(target->get_allocated_width() == round_up(width, SIZE_GRANULARITY) &&
+        target->get_allocated_height() == round_up(height, SIZE_GRANULARITY))
+    {
+        target->set_size(width, height);
+        return target;
+    }
+
+    RenderTarget* resized = acquire(width, height, target->get_depth_format());
+    if(!resized)
+        return target;
+    release(target);
+    return resized;
+}
+
+void RenderTargetPool::clear()
+{
+    for(size_t i = 0; i < free_targets.size(); i++)
+    {
+        free_targets[i]->destroy();
+        delete free_targets[i];
+    }
+    free_targets.clear();
+}
+
+unsigned int RenderTargetPool::get_allocations() const
+{
+    return allocations;
+}
@@ -0,0 +1,81 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <GL/glew.h>
+#include <vector>
+
+// Offscreen colour and depth textures the scene is drawn into, copied to the
+// window at the end of the frame. Lets the depth format be chosen independently
+// of what the window's framebuffer was created with.
+//
+// The textures may be larger than the area drawn into: set_size() picks the
+// used region, which bind() and blit_to_screen() work on.
+class RenderTarget
+{
+private:
+    unsigned int framebuffer;
+    unsigned int color_texture;
+    unsigned int depth_texture;
+    GLenum depth_format;
+    int allocated_width;
+    int allocated_height;
+    int width;
+    int height;
+
+public:
+    RenderTarget();
+
+    // (Re)creates the attachments. Returns false if the framebuffer is incomplete.
+    bool create(int width, int height, GLenum depth_format);
+    // GL objects are not freed by a destructor since the context may be gone by then
+    void destroy();
+
+    // Size of the region drawn into, at most the allocated size
+    void set_size(int width, int height);
+
+    // Binds the framebuffer and sets the viewport to cover the used region
+    void bind() const;
+    // Copies the used region to the window's framebuffer and leaves it bound
+    void blit_to_screen(int screen_width, int screen_height) const;
+
+    int get_width() const;
+    int get_height() const;
+    unsigned int get_color_texture() const;
+    int get_allocated_width() const;
+    int get_allocated_height() const;
+    GLenum get_depth_format() const;
+};
+
+// Recycles render targets across window resizes. Sizes are rounded up to a
+// multiple of SIZE_GRANULARITY so dragging a window edge reuses one allocation
+// for many sizes, and the last few released targets are kept so switching
+// back (restore after maximise, say) doesn't allocate either.
+class RenderTargetPool
+{
+private:
+    std::vector<RenderTarget*> free_targets; // Least recently released first
+    unsigned int max_free;
+    unsigned int allocations;
+
+public:
+    static const int SIZE_GRANULARITY = 64;
+
+    RenderTargetPool(unsigned int max_free = 4);
+    ~RenderTargetPool();
+
+    // Returns a target sized to width x height, NULL if it couldn't be created
+    RenderTarget* acquire(int width, int height, GLenum depth_format);
+    // Hands a target back for reuse
+    void release(RenderTarget* target);
+    // Returns a target for the new size, which is target itself if its
+    // allocation still fits. target is released otherwise, unless no new one
+    // could be created, in which case it is returned unchanged.
+    RenderTarget* resize(RenderTarget* target, int width, int height);
+    // Deletes the pooled targets. Needs the context to still be current.
+    void clear();
+
+    // Number of targets created so far
+    unsigned int get_allocations() const;
+};
+
+#endif // RENDER_TARGET_H
@@ -0,0 +1,209 @@
+#include "resolution_scaler.h"
+
+#include <math.h>
+#include <stdio.h>
+
+const double ResolutionScaler::UPSCALE_THRESHOLD = 0.8;
+
+ResolutionScaler::ResolutionScaler(double target_ms, float min_scale, float max_scale)
+{
+    for(unsigned int i = 0; i < QUERY_COUNT; i++)
+    {
+        queries[i] = 0;
+        query_pending[i] = false;
+    }
+    query_index = 0;
+
+    this->target_ms = target_ms;
+    this->min_scale = min_scale;
+    this->max_scale = max_scale;
+    scale = max_scale;
+    gpu_ms = -1.0;
+    last_gpu_ms = 0.0;
+    cooldown = 0;
+    changes = 0;
+}
+
+void ResolutionScaler::init()
+{
+    glGenQueries(QUERY_COUNT, queries);
+}
+
+void ResolutionScaler::destroy()
+{
+    glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void ResolutionScaler::begin_frame()
+{
+    // The query about to be reused is the oldest one, read it back if the GPU is done with it
+    if(query_pending[query_index])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[query_index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[query_index], GL_QUERY_RESULT, &elapsed);
+            query_pending[query_index] = false;
+            update(elapsed / 1000000.0);
+        }
+    }
+
+    // Still in flight, skip measuring this frame rather than wait on it
+    if(!query_pending[query_index])
+        glBeginQuery(GL_TIME_ELAPSED, queries[query_index]);
+}
+
+void ResolutionScaler::end_frame()
+{
+    if(query_pending[query_index])
+    {
+        query_index = (query_index + 1) % QUERY_COUNT;
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    query_pending[query_index] = true;
+    query_index = (query_index + 1) % QUERY_COUNT;
+}
+
+void ResolutionScaler::update(double frame_ms)
+{
+    last_gpu_ms = frame_ms;
+    gpu_ms = gpu_ms < 0.0 ? frame_ms : gpu_ms + 0.1 * (frame_ms - gpu_ms);
+
+    if(cooldown > 0)
+    {
+        cooldown--;
+        return;
+    }
+
+    // Inside the band between the thresholds nothing changes
+    if(gpu_ms <= target_ms && gpu_ms >= target_ms * UPSCALE_THRESHOLD)
+        return;
+
+    // Fragment cost goes with the pixel count, the square of the scale.
+    // Drop quickly when over budget, climb back slowly.
+    float desired = scale * (float)sqrt(target_ms / gpu_ms);
+    if(desired < scale * 0.8f)
+        desired = scale * 0.8f;
+    if(desired > scale * 1.05f)
+        desired = scale * 1.05f;
+
+    // Steps of 1/64, rounded down so the result lands under the target.
+    // Either side of the band always takes at least one step, otherwise 5%
+    // of a small scale rounds back down to it and the scale can't climb.
+    desired = floorf(desired * 64.0f) / 64.0f;
+    if(gpu_ms > target_ms && desired >= scale)
+        desired = scale - 1.0f / 64.0f;
+    else if(gpu_ms < target_ms && desired <= scale)
+        desired = scale + 1.0f / 64.0f;
+    if(desired < min_scale)
+        desired = min_scale;
+    if(desired > max_scale)
+        desired = max_scale;
+    if(desired == scale)
+        return;
+
+    // Predict the new time so the smoothing doesn't drag the old one along
+    gpu_ms *= (desired * desired) / (scale * scale);
+    scale = desired;
+    changes++;
+    // Let the in-flight queries for the old scale drain before judging the new one
+    cooldown = QUERY_COUNT + 4;
+}
+
+int ResolutionScaler::scaled(int size) const
+{
+    int result = (int)(size * scale + 0.5f);
+    return result > 0 ? result : 1;
+}
+
+float ResolutionScaler::get_scale() const
+{
+    return scale;
+}
+
+double ResolutionScaler::get_gpu_ms() const
+{
+    return gpu_ms;
+}
+
+void ResolutionScaler::print_report(int window_width, int window_height) const
+{
+    printf("Resolution scale %.3f (%dx%d of %dx%d), scene GPU %.2f ms (last %.2f ms, target %.2f ms), %u changes\n",
+        scale, scaled(window_width), scaled(window_height), window_width, window_height,
+        gpu_ms < 0.0 ? 0.0 : gpu_ms, last_gpu_ms, target_ms, changes);
+}
+
+Upscaler::Upscaler()
+{
+    sharpen = false;
+    sharpness = 0.5f;
+    shader = NULL;
+    shader_revision = 0;
+    empty_vao = 0;
+    source_rect_location = -1;
+}
+
+void Upscaler::init(bool sharpen, float sharpness)
+{
+    this->sharpen = sharpen;
+    this->sharpness = sharpness;
+    if(!sharpen)
+        return;
+
+    shader = new Shader("shaders/upscale.vertex", "shaders/upscaleSharpen.fragment");
+    shader->use();
+    shader->setInt("source", 0);
+    shader->setFloat("sharpness", sharpness);
+    source_rect_location = glGetUniformLocation(shader->ID, "sourceRect");
+
+    // Core profiles need a vertex array bound to draw, even without attributes
+    glGenVertexArrays(1, &empty_vao);
+}
+
+void Upscaler::destroy()
+{
+    if(shader)
+    {
+        glDeleteProgram(shader->ID);
+        delete shader;
+        shader = NULL;
+    }
+    if(empty_vao)
+        glDeleteVertexArrays(1, &empty_vao);
+    empty_vao = 0;
+}
+
+void Upscaler::draw(const RenderTarget &source, int window_width, int window_height)
+{
+    if(!sharpen)
+    {
+        source.blit_to_screen(window_width, window_height);
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, window_width, window_height);
+    glDisable(GL_DEPTH_TEST);
+
+    float texel_width = 1.0f / source.get_allocated_width();
+    float texel_height = 1.0f / source.get_allocated_height();
+    shader->use();
+    // Looked up again after a hot reload
+    if(shader_revision != shader->revision)
+    {
+        source_rect_location = glGetUniformLocation(shader->ID, "sourceRect");
+        shader_revision = shader->revision;
+    }
+    glUniform4f(source_rect_location, source.get_width() * texel_width, source.get_height() * texel_height,
+        texel_width, texel_height);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source.get_color_texture());
+    glBindVertexArray(empty_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glEnable(GL_DEPTH_TEST);
+}
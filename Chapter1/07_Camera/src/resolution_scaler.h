@@ -0,0 +1,82 @@
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+#include <GL/glew.h>
+
+#include "shaders.h"
+#include "render_target.h"
+
+// Picks the fraction of the window's resolution the scene is rendered at so
+// the GPU time of the scene stays near a target. The time comes from
+// GL_TIME_ELAPSED queries read back a few frames late, so the GPU never stalls.
+//
+// To stop the scale from oscillating, the controller only lowers the scale
+// above the target and only raises it once the time is well below, changes
+// it in bounded steps, and waits for the queries to report frames rendered at
+// the new scale before deciding again.
+class ResolutionScaler
+{
+private:
+    static const unsigned int QUERY_COUNT = 4; // Frames of readback latency
+
+    unsigned int queries[QUERY_COUNT];
+    bool query_pending[QUERY_COUNT];
+    unsigned int query_index;
+
+    double target_ms;
+    float min_scale;
+    float max_scale;
+    float scale;
+    double gpu_ms;            // Smoothed scene time
+    double last_gpu_ms;       // Latest raw reading
+    unsigned int cooldown;    // Frames left before the scale may change again
+    unsigned int changes;
+
+    void update(double frame_ms);
+
+public:
+    // Below this fraction of the target the scale goes up
+    static const double UPSCALE_THRESHOLD;
+
+    ResolutionScaler(double target_ms, float min_scale, float max_scale = 1.0f);
+
+    void init();
+    void destroy();
+
+    // Bracket the GPU work being measured. begin_frame() also reads back the
+    // oldest query and adjusts the scale.
+    void begin_frame();
+    void end_frame();
+
+    // size scaled by the current factor, at least 1
+    int scaled(int size) const;
+
+    float get_scale() const;
+    double get_gpu_ms() const;
+    void print_report(int window_width, int window_height) const;
+};
+
+// Draws a render target's used region over the whole window, either with a
+// bilinear blit or with a sharpening pass that makes up for some of the
+// softness of rendering at a lower resolution.
+class Upscaler
+{
+private:
+    bool sharpen;
+    float sharpness;
+    Shader* shader;
+    unsigned int shader_revision;
+    unsigned int empty_vao;
+    int source_rect_location;
+
+public:
+    Upscaler();
+
+    void init(bool sharpen, float sharpness = 0.5f);
+    void destroy();
+
+    // Leaves the window's framebuffer bound
+    void draw(const RenderTarget &source, int window_width, int window_height);
+};
+
+#endif // RESOLUTION_SCALER_H
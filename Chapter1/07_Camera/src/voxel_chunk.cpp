@@ -0,0 +1,203 @@
+#include "voxel_chunk.h"
+
+namespace
+{
+    // Smallest index width that holds size palette entries
+    unsigned int bits_for(size_t size)
+    {
+        if(size <= 1)
+            return 0;
+        if(size <= 2)
+            return 1;
+        if(size <= 4)
+            return 2;
+        if(size <= 16)
+            return 4;
+        if(size <= 256)
+            return 8;
+        return 16;
+    }
+}
+
+Chunk::Chunk(BlockType block)
+{
+    fill(block);
+}
+
+unsigned int Chunk::get_index(int i) const
+{
+    if(bits == 0)
+        return 0;
+    unsigned int bit = (unsigned int)i * bits;
+    return (unsigned int)(indices[bit >> 6] >> (bit & 63)) & ((1u << bits) - 1);
+}
+
+void Chunk::set_index(int i, unsigned int value)
+{
+    unsigned int bit = (unsigned int)i * bits;
+    uint64_t mask = ((1ull << bits) - 1) << (bit & 63);
+    uint64_t &word = indices[bit >> 6];
+    word = (word & ~mask) | ((uint64_t)value << (bit & 63));
+}
+
+unsigned int Chunk::find_or_add(BlockType block)
+{
+    unsigned int free_slot = (unsigned int)palette.size();
+    for(unsigned int i = 0; i < palette.size(); i++)
+    {
+        if(palette[i] == block)
+            return i;
+        if(palette_counts[i] == 0 && free_slot == palette.size())
+            free_slot = i;
+    }
+
+    if(free_slot < palette.size())
+    {
+        palette[free_slot] = block;
+        return free_slot;
+    }
+
+    palette.push_back(block);
+    palette_counts.push_back(0);
+    if(palette.size() > (1u << bits))
+        repack(bits_for(palette.size()));
+    return free_slot;
+}
+
+void Chunk::repack(unsigned int new_bits)
+{
+    std::vector<uint16_t> values(CHUNK_VOLUME);
+    for(int i = 0; i < CHUNK_VOLUME; i++)
+        values[i] = (uint16_t)get_index(i);
+
+    bits = new_bits;
+    indices.assign((size_t)CHUNK_VOLUME * bits / 64, 0);
+    if(bits == 0)
+        return;
+    for(int i = 0; i < CHUNK_VOLUME; i++)
+        set_index(i, values[i]);
+}
+
+BlockType Chunk::get(int x, int y, int z) const
+{
+    return palette[get_index(chunk_index(x, y, z))];
+}
+
+void Chunk::set(int x, int y, int z, BlockType block)
+{
+    int i = chunk_index(x, y, z);
+    unsigned int old_entry = get_index(i);
+    BlockType old_block = palette[old_entry];
+    if(old_block == block)
+        return;
+
+    unsigned int new_entry = find_or_add(block);
+    set_index(i, new_entry);
+    palette_counts[old_entry]--;
+    palette_counts[new_entry]++;
+
+    if(old_block == BLOCK_AIR)
+        solid_count++;
+    else if(block == BLOCK_AIR)
+        solid_count--;
+}
+
+void Chunk::fill(BlockType block)
+{
+    palette.assign(1, block);
+    palette_counts.assign(1, CHUNK_VOLUME);
+    indices.clear();
+    indices.shrink_to_fit();
+    bits = 0;
+    solid_count = block == BLOCK_AIR ? 0 : CHUNK_VOLUME;
+}
+
+void Chunk::unpack(BlockType* out) const
+{
+    if(bits == 0)
+    {
+        for(int i = 0; i < CHUNK_VOLUME; i++)
+            out[i] = palette[0];
+        return;
+    }
+
+    // Walk whole words, every index in a word shares the same shift pattern
+    unsigned int per_word = 64 / bits;
+    uint64_t mask = (1ull << bits) - 1;
+    int i = 0;
+    for(size_t w = 0; w < indices.size(); w++)
+    {
+        uint64_t word = indices[w];
+        for(unsigned int j = 0; j < per_word; j++, word >>= bits)
+            out[i++] = palette[word & mask];
+    }
+}
+
+void Chunk::compact()
+{
+    std::vector<BlockType> new_palette;
+    std::vector<uint32_t> new_counts;
+    std::vector<uint16_t> remap(palette.size(), 0);
+    for(unsigned int i = 0; i < palette.size(); i++)
+    {
+        if(palette_counts[i] == 0)
+            continue;
+        remap[i] = (uint16_t)new_palette.size();
+        new_palette.push_back(palette[i]);
+        new_counts.push_back(palette_counts[i]);
+    }
+
+    if(new_palette.size() == 1)
+    {
+        fill(new_palette[0]);
+        return;
+    }
+
+    std::vector<uint16_t> values(CHUNK_VOLUME);
+    for(int i = 0; i < CHUNK_VOLUME; i++)
+        values[i] = remap[get_index(i)];
+
+    palette.swap(new_palette);
+    palette_counts.swap(new_counts);
+    bits = bits_for(palette.size());
+    indices.assign((size_t)CHUNK_VOLUME * bits / 64, 0);
+    indices.shrink_to_fit();
+    for(int i = 0; i < CHUNK_VOLUME; i++)
+        set_index(i, values[i]);
+}
+
+bool Chunk::is_empty() const
+{
+    return solid_count == 0;
+}
+
+bool Chunk::is_uniform() const
+{
+    return bits == 0;
+}
+
+BlockType Chunk::get_uniform_block() const
+{
+    return palette[0];
+}
+
+unsigned int Chunk::get_solid_count() const
+{
+    return solid_count;
+}
+
+unsigned int Chunk::get_palette_size() const
+{
+    return (unsigned int)palette.size();
+}
+
+unsigned int Chunk::get_bits() const
+{
+    return bits;
+}
+
+size_t Chunk::get_memory_bytes() const
+{
+    return sizeof(Chunk) + palette.capacity() * sizeof(BlockType) + palette_counts.capacity() * sizeof(uint32_t)
+        + indices.capacity() * sizeof(uint64_t);
+}
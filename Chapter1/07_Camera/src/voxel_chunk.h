@@ -0,0 +1,69 @@
+#ifndef VOXEL_CHUNK_H
+#define VOXEL_CHUNK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+typedef uint16_t BlockType;
+
+enum Block
+{
+    BLOCK_AIR,
+    BLOCK_STONE,
+    BLOCK_DIRT,
+    BLOCK_GRASS,
+    BLOCK_SAND,
+    BLOCK_TYPE_COUNT
+};
+
+const int CHUNK_SIZE = 32;
+const int CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
+const int CHUNK_VOLUME = CHUNK_AREA * CHUNK_SIZE;
+
+// Voxels are stored x fastest, then z, then y
+inline int chunk_index(int x, int y, int z)
+{
+    return x + z * CHUNK_SIZE + y * CHUNK_AREA;
+}
+
+// 32^3 blocks, palette compressed. Each voxel stores an index into the
+// chunk's palette using just enough bits for the palette size (0, 1, 2, 4, 8
+// or 16, so an index never straddles two words). A chunk of one block type,
+// like solid stone or open air, stores no indices at all.
+class Chunk
+{
+private:
+    std::vector<BlockType> palette;
+    std::vector<uint32_t> palette_counts; // Voxels using each entry, 0 marks a free slot
+    std::vector<uint64_t> indices;
+    unsigned int bits;
+    unsigned int solid_count;
+
+    unsigned int get_index(int i) const;
+    void set_index(int i, unsigned int value);
+    unsigned int find_or_add(BlockType block);
+    void repack(unsigned int new_bits);
+
+public:
+    explicit Chunk(BlockType block = BLOCK_AIR);
+
+    BlockType get(int x, int y, int z) const;
+    void set(int x, int y, int z, BlockType block);
+    void fill(BlockType block);
+
+    // Decodes every voxel into out[CHUNK_VOLUME], in chunk_index order
+    void unpack(BlockType* out) const;
+    // Drops unused palette entries and shrinks indices to the fewest bits
+    void compact();
+
+    bool is_empty() const;   // Only air
+    bool is_uniform() const; // A single block type
+    BlockType get_uniform_block() const;
+    unsigned int get_solid_count() const;
+    unsigned int get_palette_size() const;
+    unsigned int get_bits() const;
+    size_t get_memory_bytes() const;
+};
+
+#endif // VOXEL_CHUNK_H
@@ -0,0 +1,106 @@
+#include "voxel_mesher.h"
+
+namespace
+{
+    // Padded index step along x, y and z
+    const int PADDED_STRIDE[3] = { 1, MESH_PADDED * MESH_PADDED, MESH_PADDED };
+
+    void emit_quad(std::vector<uint32_t> &vertices, int axis, bool positive, int plane, int i, int j, int w, int h, BlockType block)
+    {
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        int face = axis * 2 + (positive ? 1 : 0);
+
+        // Corners in (u, v), counter-clockwise seen from the positive side of the axis
+        int corners[4][2] = { { i, j }, { i + w, j }, { i + w, j + h }, { i, j + h } };
+        for(int k = 0; k < 4; k++)
+        {
+            // Facing the negative direction, the same corners go the other way round
+            const int* corner = corners[positive ? k : (4 - k) % 4];
+            int position[3];
+            position[axis] = plane;
+            position[u] = corner[0];
+            position[v] = corner[1];
+            vertices.push_back(pack_voxel_vertex(position[0], position[1], position[2], face, block));
+        }
+    }
+}
+
+void mesh_chunk(const BlockType* padded, std::vector<uint32_t> &vertices, MeshStats &stats)
+{
+    stats.faces = 0;
+    stats.quads = 0;
+
+    BlockType mask[CHUNK_AREA];
+
+    for(int axis = 0; axis < 3; axis++)
+    {
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+
+        for(int direction = 0; direction < 2; direction++)
+        {
+            bool positive = direction == 1;
+            int neighbour = positive ? PADDED_STRIDE[axis] : -PADDED_STRIDE[axis];
+
+            for(int slice = 0; slice < CHUNK_SIZE; slice++)
+            {
+                // A face is visible where a solid block meets air
+                int position[3];
+                position[axis] = slice;
+                for(int j = 0; j < CHUNK_SIZE; j++)
+                {
+                    position[v] = j;
+                    for(int i = 0; i < CHUNK_SIZE; i++)
+                    {
+                        position[u] = i;
+                        int index = padded_index(position[0], position[1], position[2]);
+                        BlockType block = padded[index];
+                        bool visible = block != BLOCK_AIR && padded[index + neighbour] == BLOCK_AIR;
+                        mask[i + j * CHUNK_SIZE] = visible ? block : (BlockType)BLOCK_AIR;
+                        if(visible)
+                            stats.faces++;
+                    }
+                }
+
+                // Grow each rectangle along u, then along v while whole rows match
+                int plane = positive ? slice + 1 : slice;
+                for(int j = 0; j < CHUNK_SIZE; j++)
+                {
+                    for(int i = 0; i < CHUNK_SIZE;)
+                    {
+                        BlockType block = mask[i + j * CHUNK_SIZE];
+                        if(block == BLOCK_AIR)
+                        {
+                            i++;
+                            continue;
+                        }
+
+                        int w = 1;
+                        while(i + w < CHUNK_SIZE && mask[i + w + j * CHUNK_SIZE] == block)
+                            w++;
+
+                        int h = 1;
+                        for(; j + h < CHUNK_SIZE; h++)
+                        {
+                            const BlockType* row = mask + (j + h) * CHUNK_SIZE + i;
+                            int k = 0;
+                            while(k < w && row[k] == block)
+                                k++;
+                            if(k < w)
+                                break;
+                        }
+
+                        emit_quad(vertices, axis, positive, plane, i, j, w, h, block);
+                        stats.quads++;
+
+                        for(int y = 0; y < h; y++)
+                            for(int x = 0; x < w; x++)
+                                mask[i + x + (j + y) * CHUNK_SIZE] = BLOCK_AIR;
+                        i += w;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef VOXEL_MESHER_H
+#define VOXEL_MESHER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "voxel_chunk.h"
+
+// The mesher reads a copy of the chunk with one extra layer of its
+// neighbours around it, so faces against the next chunk can be culled too
+const int MESH_PADDED = CHUNK_SIZE + 2;
+const int MESH_PADDED_VOLUME = MESH_PADDED * MESH_PADDED * MESH_PADDED;
+
+// x, y and z from -1 to CHUNK_SIZE
+inline int padded_index(int x, int y, int z)
+{
+    return (x + 1) + (z + 1) * MESH_PADDED + (y + 1) * MESH_PADDED * MESH_PADDED;
+}
+
+// Faces are numbered axis * 2 + (1 if facing the positive direction)
+enum VoxelFace { FACE_NEG_X, FACE_POS_X, FACE_NEG_Y, FACE_POS_Y, FACE_NEG_Z, FACE_POS_Z };
+
+// One vertex is a single uint: chunk local position (6 bits per axis, 0 to
+// 32), face (3 bits) and block type (11 bits). See shaders/voxel.vertex.
+inline uint32_t pack_voxel_vertex(int x, int y, int z, int face, BlockType block)
+{
+    return (uint32_t)x | ((uint32_t)y << 6) | ((uint32_t)z << 12) | ((uint32_t)face << 18) | ((uint32_t)block << 21);
+}
+
+struct MeshStats
+{
+    unsigned int faces; // Visible block faces, what the mesh would be without merging
+    unsigned int quads; // Quads emitted after greedy merging
+};
+
+// Greedy meshing: faces between a solid block and air are gathered slice by
+// slice and merged into the largest rectangles of the same block type. Each
+// quad appends 4 vertices, counter-clockwise seen from outside.
+void mesh_chunk(const BlockType* padded, std::vector<uint32_t> &vertices, MeshStats &stats);
+
+#endif // VOXEL_MESHER_H
@@ -0,0 +1,738 @@
+#include "voxel_world.h"
+#include "gl_resources.h"
+#include "voxel_mesher.h"
+#include "profiler.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    double now_seconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint32_t hash(int x, int z, unsigned int seed)
+    {
+        uint32_t h = (uint32_t)x * 374761393u + (uint32_t)z * 668265263u + seed * 2246822519u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return h ^ (h >> 16);
+    }
+
+    // Smoothly interpolated random values on an integer lattice, 0 to 1
+    float value_noise(float x, float z, unsigned int seed)
+    {
+        int x0 = (int)floorf(x);
+        int z0 = (int)floorf(z);
+        float fx = x - x0;
+        float fz = z - z0;
+        fx = fx * fx * (3.0f - 2.0f * fx);
+        fz = fz * fz * (3.0f - 2.0f * fz);
+
+        const float scale = 1.0f / 4294967295.0f;
+        float a = hash(x0, z0, seed) * scale;
+        float b = hash(x0 + 1, z0, seed) * scale;
+        float c = hash(x0, z0 + 1, seed) * scale;
+        float d = hash(x0 + 1, z0 + 1, seed) * scale;
+        return (a + (b - a) * fx) + ((c + (d - c) * fx) - (a + (b - a) * fx)) * fz;
+    }
+
+    int floor_div(int value, int divisor)
+    {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+}
+
+VoxelWorld::ChunkSlot::ChunkSlot()
+{
+    revision = 0;
+    uploaded_revision = 0;
+    mesh_queued = false;
+    vao = 0;
+    quads = 0;
+    faces = 0;
+}
+
+VoxelWorld::VoxelWorld()
+{
+    chunks_x = chunks_y = chunks_z = 0;
+    origin = glm::dvec3(0.0);
+    seed = 0;
+    columns_ready = 0;
+    meshes_in_flight = 0;
+    shader = NULL;
+    shader_revision = 0;
+    chunk_offset_loc = -1;
+    detail_region_loc = -1;
+    detail_layer_loc = -1;
+    quad_indices = 0;
+    load_start = 0.0;
+    load_seconds = -1.0;
+    mesh_ms_total = 0.0;
+    meshes_built = 0;
+    chunks_drawn = 0;
+    chunks_culled = 0;
+    quads_drawn = 0;
+    array_binds = 0;
+    uploaded_bytes = 0;
+}
+
+VoxelWorld::~VoxelWorld()
+{
+    pool.stop();
+}
+
+bool VoxelWorld::init(int size_x, int size_y, int size_z, unsigned int threads, unsigned int seed)
+{
+    if(size_x <= 0 || size_y <= 0 || size_z <= 0)
+    {
+        printf("ERROR::VOXEL_WORLD::INVALID_SIZE %dx%dx%d\n", size_x, size_y, size_z);
+        return false;
+    }
+
+    chunks_x = (size_x + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks_y = (size_y + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks_z = (size_z + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    this->seed = seed;
+    slots.resize((size_t)chunks_x * chunks_y * chunks_z);
+    columns.assign((size_t)chunks_x * chunks_z, COLUMN_PENDING);
+
+    shader = new Shader("shaders/voxel.vertex", "shaders/voxel.fragment");
+    shader_interface.reflect(shader->ID);
+    UniformBlockBindings::get().apply(shader_interface);
+    shader_revision = shader->revision;
+    shader->use();
+    shader->setInt("textures", 0);
+    chunk_offset_loc = shader_interface.get_uniform_location("chunkOffset");
+    detail_region_loc = shader_interface.get_uniform_location("detailRegion");
+    detail_layer_loc = shader_interface.get_uniform_location("detailLayer");
+    // The packed vertex is read as an integer, see shaders/voxel.vertex
+    vertex_format = VertexFormat();
+    vertex_format.add_integer("aPacked", 1, GL_UNSIGNED_INT);
+    // Whole first layer until set_detail_texture picks an image
+    glUniform4f(detail_region_loc, 0.0f, 0.0f, 1.0f, 1.0f);
+
+    // Every quad is two triangles over its four vertices
+    std::vector<uint32_t> indices(MAX_CHUNK_QUADS * 6);
+    for(uint32_t quad = 0; quad < MAX_CHUNK_QUADS; quad++)
+    {
+        uint32_t* index = &indices[quad * 6];
+        uint32_t first = quad * 4;
+        index[0] = first;
+        index[1] = first + 1;
+        index[2] = first + 2;
+        index[3] = first + 2;
+        index[4] = first + 3;
+        index[5] = first;
+    }
+    quad_indices = GLResources::create_buffer();
+    GLResources::buffer_storage(quad_indices, indices.size() * sizeof(uint32_t), &indices[0], false);
+    mesh_arena.init(MESH_PAGE_BYTES);
+
+    // Generate from the middle out, that is where the camera starts
+    std::vector<int> order(columns.size());
+    for(size_t i = 0; i < order.size(); i++)
+        order[i] = (int)i;
+    int mid_x = chunks_x / 2;
+    int mid_z = chunks_z / 2;
+    int width = chunks_x;
+    std::sort(order.begin(), order.end(), [mid_x, mid_z, width](int a, int b)
+    {
+        int ax = a % width - mid_x, az = a / width - mid_z;
+        int bx = b % width - mid_x, bz = b / width - mid_z;
+        return ax * ax + az * az < bx * bx + bz * bz;
+    });
+
+    load_start = now_seconds();
+    pool.start(threads, "Voxel Worker");
+    for(size_t i = 0; i < order.size(); i++)
+    {
+        int column = order[i];
+        pool.submit([this, column] { generate_column(column % chunks_x, column / chunks_x); });
+    }
+    return true;
+}
+
+void VoxelWorld::destroy()
+{
+    pool.stop();
+
+    for(size_t i = 0; i < finished_meshes.size(); i++)
+        delete finished_meshes[i];
+    finished_meshes.clear();
+    for(size_t i = 0; i < uploads.size(); i++)
+        delete uploads[i];
+    uploads.clear();
+
+    for(size_t i = 0; i < slots.size(); i++)
+    {
+        slots[i].vao = 0;
+        slots[i].mesh = ArenaRange();
+    }
+    for(size_t page = 0; page < mesh_arena.get_page_count(); page++)
+        VertexArrayCache::get().release_buffer(mesh_arena.get_buffer(page));
+    mesh_arena.destroy();
+    if(quad_indices)
+    {
+        VertexArrayCache::get().release_buffer(quad_indices);
+        glDeleteBuffers(1, &quad_indices);
+    }
+    quad_indices = 0;
+    if(shader)
+    {
+        glDeleteProgram(shader->ID);
+        delete shader;
+        shader = NULL;
+    }
+}
+
+void VoxelWorld::set_detail_texture(const TextureAtlas &atlas, int image)
+{
+    shader->use();
+    atlas.apply_region(detail_region_loc, detail_layer_loc, image);
+}
+
+void VoxelWorld::set_origin(const glm::dvec3 &origin)
+{
+    this->origin = origin;
+}
+
+const glm::dvec3& VoxelWorld::get_origin() const
+{
+    return origin;
+}
+
+int VoxelWorld::column_index(int cx, int cz) const
+{
+    return cx + cz * chunks_x;
+}
+
+int VoxelWorld::chunk_slot(int cx, int cy, int cz) const
+{
+    return (cy * chunks_z + cz) * chunks_x + cx;
+}
+
+int VoxelWorld::surface_height(int x, int z) const
+{
+    // A few octaves of value noise: broad hills with smaller bumps on top
+    float height = 0.0f;
+    float amplitude = 0.5f;
+    float frequency = 1.0f / 192.0f;
+    for(int octave = 0; octave < 4; octave++)
+    {
+        height += value_noise(x * frequency, z * frequency, seed + octave) * amplitude;
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+
+    int size_y = chunks_y * CHUNK_SIZE;
+    int result = size_y / 5 + (int)(height * size_y * 0.6f);
+    return std::max(1, std::min(size_y - 2, result));
+}
+
+BlockType VoxelWorld::terrain_block(int y, int height) const
+{
+    if(y > height)
+        return BLOCK_AIR;
+    // Low ground is beach
+    bool beach = height < chunks_y * CHUNK_SIZE / 5 + 6;
+    if(y == height)
+        return beach ? BLOCK_SAND : BLOCK_GRASS;
+    if(y > height - 4)
+        return beach ? BLOCK_SAND : BLOCK_DIRT;
+    return BLOCK_STONE;
+}
+
+void VoxelWorld::generate_column(int cx, int cz)
+{
+    PROFILE_ZONE("Generate Column");
+
+    int heights[CHUNK_AREA];
+    int lowest = chunks_y * CHUNK_SIZE;
+    int highest = 0;
+    for(int z = 0; z < CHUNK_SIZE; z++)
+    {
+        for(int x = 0; x < CHUNK_SIZE; x++)
+        {
+            int height = surface_height(cx * CHUNK_SIZE + x, cz * CHUNK_SIZE + z);
+            heights[x + z * CHUNK_SIZE] = height;
+            lowest = std::min(lowest, height);
+            highest = std::max(highest, height);
+        }
+    }
+
+    // Nothing reads these chunks until the column is reported as generated
+    for(int cy = 0; cy < chunks_y; cy++)
+    {
+        Chunk &chunk = slots[chunk_slot(cx, cy, cz)].chunk;
+        int bottom = cy * CHUNK_SIZE;
+        int top = bottom + CHUNK_SIZE - 1;
+        if(bottom > highest)
+            continue;
+        if(top <= lowest - 4)
+        {
+            chunk.fill(BLOCK_STONE);
+            continue;
+        }
+        for(int y = 0; y < CHUNK_SIZE; y++)
+            for(int z = 0; z < CHUNK_SIZE; z++)
+                for(int x = 0; x < CHUNK_SIZE; x++)
+                    chunk.set(x, y, z, terrain_block(bottom + y, heights[x + z * CHUNK_SIZE]));
+        chunk.compact();
+    }
+
+    std::lock_guard<std::mutex> lock(results_mutex);
+    generated_columns.push_back(column_index(cx, cz));
+}
+
+void VoxelWorld::copy_padded(int cx, int cy, int cz, BlockType* padded) const
+{
+    static thread_local std::vector<BlockType> blocks(CHUNK_VOLUME);
+
+    for(int i = 0; i < MESH_PADDED_VOLUME; i++)
+        padded[i] = BLOCK_AIR;
+
+    std::lock_guard<std::mutex> lock(data_mutex);
+
+    slots[chunk_slot(cx, cy, cz)].chunk.unpack(&blocks[0]);
+    for(int y = 0; y < CHUNK_SIZE; y++)
+        for(int z = 0; z < CHUNK_SIZE; z++)
+            std::copy(&blocks[chunk_index(0, y, z)], &blocks[chunk_index(0, y, z)] + CHUNK_SIZE, &padded[padded_index(0, y, z)]);
+
+    // One layer from each face neighbour. Past the sides and top of the world
+    // is air, below it is solid so the bottom of the world is never drawn.
+    for(int a = 0; a < CHUNK_SIZE; a++)
+    {
+        for(int b = 0; b < CHUNK_SIZE; b++)
+        {
+            if(cx > 0)
+                padded[padded_index(-1, a, b)] = slots[chunk_slot(cx - 1, cy, cz)].chunk.get(CHUNK_SIZE - 1, a, b);
+            if(cx < chunks_x - 1)
+                padded[padded_index(CHUNK_SIZE, a, b)] = slots[chunk_slot(cx + 1, cy, cz)].chunk.get(0, a, b);
+            if(cz > 0)
+                padded[padded_index(a, b, -1)] = slots[chunk_slot(cx, cy, cz - 1)].chunk.get(a, b, CHUNK_SIZE - 1);
+            if(cz < chunks_z - 1)
+                padded[padded_index(a, b, CHUNK_SIZE)] = slots[chunk_slot(cx, cy, cz + 1)].chunk.get(a, b, 0);
+            if(cy > 0)
+                padded[padded_index(a, -1, b)] = slots[chunk_slot(cx, cy - 1, cz)].chunk.get(a, CHUNK_SIZE - 1, b);
+            else
+                padded[padded_index(a, -1, b)] = BLOCK_STONE;
+            if(cy < chunks_y - 1)
+                padded[padded_index(a, CHUNK_SIZE, b)] = slots[chunk_slot(cx, cy + 1, cz)].chunk.get(a, 0, b);
+        }
+    }
+}
+
+void VoxelWorld::mesh_job(int slot, unsigned int revision)
+{
+    PROFILE_ZONE("Mesh Chunk");
+    double start = now_seconds();
+
+    static thread_local std::vector<BlockType> padded(MESH_PADDED_VOLUME);
+    int cx = slot % chunks_x;
+    int cz = slot / chunks_x % chunks_z;
+    int cy = slot / (chunks_x * chunks_z);
+    copy_padded(cx, cy, cz, &padded[0]);
+
+    MeshResult* result = new MeshResult;
+    result->chunk = slot;
+    result->revision = revision;
+    MeshStats stats;
+    mesh_chunk(&padded[0], result->vertices, stats);
+    result->faces = stats.faces;
+    result->quads = stats.quads;
+    result->urgent = revision > 0;
+    result->mesh_ms = (now_seconds() - start) * 1000.0;
+
+    std::lock_guard<std::mutex> lock(results_mutex);
+    finished_meshes.push_back(result);
+}
+
+bool VoxelWorld::is_buried(int cx, int cy, int cz) const
+{
+    // Solid all the way through and to every side, so no face can show
+    const int offsets[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    const Chunk &chunk = slots[chunk_slot(cx, cy, cz)].chunk;
+    if(!chunk.is_uniform() || chunk.is_empty())
+        return false;
+    for(int i = 0; i < 6; i++)
+    {
+        int x = cx + offsets[i][0];
+        int y = cy + offsets[i][1];
+        int z = cz + offsets[i][2];
+        if(y < 0)
+            continue;
+        if(x < 0 || x >= chunks_x || y >= chunks_y || z < 0 || z >= chunks_z)
+            return false;
+        const Chunk &neighbour = slots[chunk_slot(x, y, z)].chunk;
+        if(!neighbour.is_uniform() || neighbour.is_empty())
+            return false;
+    }
+    return true;
+}
+
+void VoxelWorld::queue_mesh(int slot, bool urgent)
+{
+    ChunkSlot &chunk = slots[slot];
+    // Already on its way, update() queues it again if it is out of date by then
+    if(chunk.mesh_queued)
+        return;
+    chunk.mesh_queued = true;
+    meshes_in_flight++;
+    unsigned int revision = chunk.revision;
+    pool.submit([this, slot, revision] { mesh_job(slot, revision); }, urgent);
+}
+
+void VoxelWorld::mark_column_generated(int column)
+{
+    columns[column] = COLUMN_GENERATED;
+
+    // A column can be meshed once every column next to it has its blocks
+    int cx = column % chunks_x;
+    int cz = column / chunks_x;
+    const int offsets[5][2] = { { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for(int i = 0; i < 5; i++)
+    {
+        int x = cx + offsets[i][0];
+        int z = cz + offsets[i][1];
+        if(x < 0 || x >= chunks_x || z < 0 || z >= chunks_z || columns[column_index(x, z)] != COLUMN_GENERATED)
+            continue;
+
+        bool neighbours_generated = true;
+        for(int j = 1; j < 5; j++)
+        {
+            int nx = x + offsets[j][0];
+            int nz = z + offsets[j][1];
+            if(nx >= 0 && nx < chunks_x && nz >= 0 && nz < chunks_z && columns[column_index(nx, nz)] == COLUMN_PENDING)
+                neighbours_generated = false;
+        }
+        if(!neighbours_generated)
+            continue;
+
+        columns[column_index(x, z)] = COLUMN_READY;
+        columns_ready++;
+        for(int cy = 0; cy < chunks_y; cy++)
+        {
+            int slot = chunk_slot(x, cy, z);
+            if(!slots[slot].chunk.is_empty() && !is_buried(x, cy, z))
+                queue_mesh(slot, false);
+        }
+    }
+}
+
+void VoxelWorld::upload(MeshResult* result)
+{
+    ChunkSlot &chunk = slots[result->chunk];
+    // A newer mesh got here first
+    if(result->revision < chunk.uploaded_revision)
+        return;
+
+    // Edits change the mesh size, so the old range goes back to the arena. Draws
+    // still reading it this frame are ordered before the next upload into it.
+    size_t bytes = result->vertices.size() * sizeof(uint32_t);
+    mesh_arena.free(chunk.mesh);
+    chunk.vao = 0;
+    if(bytes > 0 && mesh_arena.allocate(bytes, sizeof(uint32_t), chunk.mesh))
+    {
+        mesh_arena.upload(chunk.mesh, &result->vertices[0], bytes);
+        chunk.vao = VertexArrayCache::get().acquire(shader_interface, vertex_format, chunk.mesh.buffer, quad_indices);
+    }
+
+    chunk.uploaded_revision = result->revision;
+    chunk.quads = result->quads;
+    chunk.faces = result->faces;
+    uploaded_bytes += bytes;
+}
+
+void VoxelWorld::update()
+{
+    PROFILE_ZONE("Voxel Update");
+
+    std::vector<int> columns_done;
+    std::vector<MeshResult*> meshes_done;
+    {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        columns_done.swap(generated_columns);
+        meshes_done.swap(finished_meshes);
+    }
+
+    for(size_t i = 0; i < columns_done.size(); i++)
+        mark_column_generated(columns_done[i]);
+
+    for(size_t i = 0; i < meshes_done.size(); i++)
+    {
+        MeshResult* result = meshes_done[i];
+        ChunkSlot &chunk = slots[result->chunk];
+        chunk.mesh_queued = false;
+        meshes_in_flight--;
+        meshes_built++;
+        mesh_ms_total += result->mesh_ms;
+        // Edited while meshing, show this one for now and mesh again
+        if(result->revision != chunk.revision)
+            queue_mesh(result->chunk, true);
+
+        if(result->urgent)
+            uploads.push_front(result);
+        else
+            uploads.push_back(result);
+    }
+
+    // Bound the upload work per frame so loading never causes a hitch. Edits
+    // are at the front and always go through.
+    size_t budget = 0;
+    while(!uploads.empty())
+    {
+        MeshResult* result = uploads.front();
+        if(!result->urgent && budget >= UPLOAD_BUDGET_BYTES)
+            break;
+        upload(result);
+        budget += result->vertices.size() * sizeof(uint32_t);
+        uploads.pop_front();
+        delete result;
+    }
+
+    if(load_seconds < 0.0 && !is_loading())
+    {
+        load_seconds = now_seconds() - load_start;
+        printf("Voxel world: loaded in %.2f s\n", load_seconds);
+    }
+}
+
+void VoxelWorld::draw(const Camera &camera)
+{
+    PROFILE_ZONE("Draw Voxels");
+
+    chunks_drawn = 0;
+    chunks_culled = 0;
+    quads_drawn = 0;
+    array_binds = 0;
+
+    shader->use();
+    // A hot reloaded program keeps its uniform values, but its locations may move
+    if(shader_revision != shader->revision)
+    {
+        uint64_t vertex_hash = shader_interface.get_vertex_hash();
+        shader_interface.reflect(shader->ID);
+        chunk_offset_loc = shader_interface.get_uniform_location("chunkOffset");
+        detail_region_loc = shader_interface.get_uniform_location("detailRegion");
+        detail_layer_loc = shader_interface.get_uniform_location("detailLayer");
+        // Arrays built for the old inputs would feed the wrong locations
+        if(vertex_hash != shader_interface.get_vertex_hash())
+        {
+            for(size_t i = 0; i < slots.size(); i++)
+                if(slots[i].mesh.page >= 0)
+                    slots[i].vao = VertexArrayCache::get().acquire(shader_interface, vertex_format, slots[i].mesh.buffer, quad_indices);
+        }
+        shader_revision = shader->revision;
+    }
+    // Greedy quads are wound counter-clockwise from outside
+    glEnable(GL_CULL_FACE);
+
+    const glm::vec4* planes = camera.get_frustum_planes();
+    const float size = (float)CHUNK_SIZE;
+    // Chunks in the same arena page share an array, it only changes between pages
+    GLuint bound_array = 0;
+    for(int cy = 0; cy < chunks_y; cy++)
+    {
+        for(int cz = 0; cz < chunks_z; cz++)
+        {
+            for(int cx = 0; cx < chunks_x; cx++)
+            {
+                const ChunkSlot &chunk = slots[chunk_slot(cx, cy, cz)];
+                if(!chunk.vao || chunk.quads == 0)
+                    continue;
+
+                // Chunk corner in render space, the rest of the mesh is small offsets from it
+                glm::vec3 corner = camera.to_render_space(origin + glm::dvec3(cx, cy, cz) * (double)CHUNK_SIZE);
+
+                // Outside if the box corner furthest along a plane's normal is behind it
+                bool visible = true;
+                for(int i = 0; i < FRUSTUM_PLANE_COUNT && visible; i++)
+                {
+                    const glm::vec4 &plane = planes[i];
+                    glm::vec3 far_corner(corner.x + (plane.x > 0.0f ? size : 0.0f),
+                                         corner.y + (plane.y > 0.0f ? size : 0.0f),
+                                         corner.z + (plane.z > 0.0f ? size : 0.0f));
+                    if(glm::dot(glm::vec3(plane), far_corner) + plane.w < 0.0f)
+                        visible = false;
+                }
+                if(!visible)
+                {
+                    chunks_culled++;
+                    continue;
+                }
+
+                glUniform3f(chunk_offset_loc, corner.x, corner.y, corner.z);
+                if(chunk.vao != bound_array)
+                {
+                    glBindVertexArray(chunk.vao);
+                    bound_array = chunk.vao;
+                    array_binds++;
+                }
+                GLint base_vertex = (GLint)(chunk.mesh.offset / sizeof(uint32_t));
+                glDrawElementsBaseVertex(GL_TRIANGLES, chunk.quads * 6, GL_UNSIGNED_INT, (void*)0, base_vertex);
+                chunks_drawn++;
+                quads_drawn += chunk.quads;
+            }
+        }
+    }
+
+    glDisable(GL_CULL_FACE);
+}
+
+BlockType VoxelWorld::get_block(int x, int y, int z) const
+{
+    int cx = floor_div(x, CHUNK_SIZE);
+    int cy = floor_div(y, CHUNK_SIZE);
+    int cz = floor_div(z, CHUNK_SIZE);
+    if(cx < 0 || cx >= chunks_x || cy < 0 || cy >= chunks_y || cz < 0 || cz >= chunks_z)
+        return BLOCK_AIR;
+    if(columns[column_index(cx, cz)] == COLUMN_PENDING)
+        return BLOCK_AIR;
+    // Only the main thread writes generated chunks, so reading needs no lock here
+    return slots[chunk_slot(cx, cy, cz)].chunk.get(x - cx * CHUNK_SIZE, y - cy * CHUNK_SIZE, z - cz * CHUNK_SIZE);
+}
+
+void VoxelWorld::set_block(int x, int y, int z, BlockType block)
+{
+    int cx = floor_div(x, CHUNK_SIZE);
+    int cy = floor_div(y, CHUNK_SIZE);
+    int cz = floor_div(z, CHUNK_SIZE);
+    if(cx < 0 || cx >= chunks_x || cy < 0 || cy >= chunks_y || cz < 0 || cz >= chunks_z)
+        return;
+    if(columns[column_index(cx, cz)] == COLUMN_PENDING)
+        return;
+
+    int lx = x - cx * CHUNK_SIZE;
+    int ly = y - cy * CHUNK_SIZE;
+    int lz = z - cz * CHUNK_SIZE;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        slots[chunk_slot(cx, cy, cz)].chunk.set(lx, ly, lz, block);
+    }
+
+    // The edited chunk, plus whichever neighbours share the changed face (at most one per axis)
+    int touched[4][3] = { { cx, cy, cz } };
+    int count = 1;
+    if(lx == 0 && cx > 0) { touched[count][0] = cx - 1; touched[count][1] = cy; touched[count][2] = cz; count++; }
+    if(lx == CHUNK_SIZE - 1 && cx < chunks_x - 1) { touched[count][0] = cx + 1; touched[count][1] = cy; touched[count][2] = cz; count++; }
+    if(ly == 0 && cy > 0) { touched[count][0] = cx; touched[count][1] = cy - 1; touched[count][2] = cz; count++; }
+    if(ly == CHUNK_SIZE - 1 && cy < chunks_y - 1) { touched[count][0] = cx; touched[count][1] = cy + 1; touched[count][2] = cz; count++; }
+    if(lz == 0 && cz > 0) { touched[count][0] = cx; touched[count][1] = cy; touched[count][2] = cz - 1; count++; }
+    if(lz == CHUNK_SIZE - 1 && cz < chunks_z - 1) { touched[count][0] = cx; touched[count][1] = cy; touched[count][2] = cz + 1; count++; }
+
+    for(int i = 0; i < count; i++)
+    {
+        // Columns that aren't ready yet mesh everything once they are
+        if(columns[column_index(touched[i][0], touched[i][2])] != COLUMN_READY)
+            continue;
+        int slot = chunk_slot(touched[i][0], touched[i][1], touched[i][2]);
+        slots[slot].revision++;
+        queue_mesh(slot, true);
+    }
+}
+
+bool VoxelWorld::raycast(const glm::dvec3 &start, const glm::vec3 &direction, float max_distance, glm::ivec3 &hit, glm::ivec3 &before) const
+{
+    glm::dvec3 position = start - origin;
+    glm::dvec3 dir = glm::normalize(glm::dvec3(direction));
+    glm::ivec3 cell((int)floor(position.x), (int)floor(position.y), (int)floor(position.z));
+    before = cell;
+
+    // Distance along the ray to the next cell boundary on each axis, and between boundaries
+    glm::ivec3 step;
+    glm::dvec3 next, delta;
+    for(int axis = 0; axis < 3; axis++)
+    {
+        if(dir[axis] > 0.0)
+        {
+            step[axis] = 1;
+            delta[axis] = 1.0 / dir[axis];
+            next[axis] = (cell[axis] + 1 - position[axis]) * delta[axis];
+        }
+        else if(dir[axis] < 0.0)
+        {
+            step[axis] = -1;
+            delta[axis] = -1.0 / dir[axis];
+            next[axis] = (position[axis] - cell[axis]) * delta[axis];
+        }
+        else
+        {
+            step[axis] = 0;
+            delta[axis] = next[axis] = HUGE_VAL;
+        }
+    }
+
+    double distance = 0.0;
+    while(distance <= max_distance)
+    {
+        if(get_block(cell.x, cell.y, cell.z) != BLOCK_AIR)
+        {
+            hit = cell;
+            return true;
+        }
+        before = cell;
+
+        int axis = 0;
+        if(next[1] < next[axis])
+            axis = 1;
+        if(next[2] < next[axis])
+            axis = 2;
+        distance = next[axis];
+        next[axis] += delta[axis];
+        cell[axis] += step[axis];
+    }
+    return false;
+}
+
+int VoxelWorld::get_surface(int x, int z) const
+{
+    for(int y = chunks_y * CHUNK_SIZE - 1; y >= 0; y--)
+        if(get_block(x, y, z) != BLOCK_AIR)
+            return y;
+    return -1;
+}
+
+bool VoxelWorld::is_loading() const
+{
+    return columns_ready < columns.size() || meshes_in_flight > 0 || !uploads.empty();
+}
+
+void VoxelWorld::print_report() const
+{
+    unsigned long long solid = 0;
+    unsigned long long faces = 0;
+    unsigned long long quads = 0;
+    size_t voxel_bytes = 0;
+    size_t vertex_bytes = 0;
+    unsigned int meshed = 0;
+    unsigned int uniform = 0;
+    for(size_t i = 0; i < slots.size(); i++)
+    {
+        const ChunkSlot &chunk = slots[i];
+        solid += chunk.chunk.get_solid_count();
+        voxel_bytes += chunk.chunk.get_memory_bytes();
+        if(chunk.chunk.is_uniform())
+            uniform++;
+        faces += chunk.faces;
+        quads += chunk.quads;
+        vertex_bytes += chunk.mesh.size;
+        if(chunk.quads > 0)
+            meshed++;
+    }
+
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    size_t dense_bytes = slots.size() * CHUNK_VOLUME * sizeof(BlockType);
+    printf("Voxel world: %dx%dx%d blocks in %u chunks, %u uniform, %u with a mesh, %u worker threads\n",
+        chunks_x * CHUNK_SIZE, chunks_y * CHUNK_SIZE, chunks_z * CHUNK_SIZE, (unsigned int)slots.size(), uniform, meshed, pool.get_thread_count());
+    printf("  blocks: %llu solid, %.1f MB with palettes vs %.1f MB dense\n", solid, voxel_bytes * mb, dense_bytes * mb);
+    printf("  meshes: %llu visible faces merged into %llu quads (%.1fx), %.1f MB of vertices; naive cubes would be %llu triangles\n",
+        faces, quads, quads ? (double)faces / quads : 0.0, vertex_bytes * mb, solid * 12);
+    printf("  last frame: %u chunks drawn, %u culled, %llu triangles, %u vertex array binds\n", chunks_drawn, chunks_culled, quads_drawn * 2, array_binds);
+    mesh_arena.print_report("  mesh arena");
+    printf("  meshing: %u meshes, %.2f ms average on the workers, %u in flight, %u waiting to upload, %.1f MB uploaded\n",
+        meshes_built, meshes_built ? mesh_ms_total / meshes_built : 0.0, meshes_in_flight, (unsigned int)uploads.size(), uploaded_bytes * mb);
+}
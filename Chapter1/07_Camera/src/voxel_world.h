@@ -0,0 +1,151 @@
+#ifndef VOXEL_WORLD_H
+#define VOXEL_WORLD_H
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "voxel_chunk.h"
+#include "shaders.h"
+#include "program_interface.h"
+#include "vertex_layout.h"
+#include "buffer_arena.h"
+#include "thread_pool.h"
+#include "camera.h"
+#include "texture_atlas.h"
+
+// Block world split into 32^3 chunks. Terrain is generated and chunks are
+// meshed on worker threads, the main thread only uploads finished meshes
+// (a bounded amount per frame) and draws each visible chunk from its range of
+// a shared mesh arena. Edits re-mesh just the chunks they touch.
+class VoxelWorld
+{
+private:
+    enum ColumnState { COLUMN_PENDING, COLUMN_GENERATED, COLUMN_READY };
+
+    struct ChunkSlot
+    {
+        ChunkSlot();
+
+        Chunk chunk;
+        unsigned int revision;          // Bumped on every edit
+        unsigned int uploaded_revision; // Revision of the mesh in the arena
+        bool mesh_queued;
+        GLuint vao;                     // The arena page's array
+        ArenaRange mesh;
+        unsigned int quads;
+        unsigned int faces;
+    };
+
+    struct MeshResult
+    {
+        int chunk;
+        unsigned int revision;
+        std::vector<uint32_t> vertices;
+        unsigned int faces;
+        unsigned int quads;
+        double mesh_ms;
+        bool urgent;
+    };
+
+    int chunks_x, chunks_y, chunks_z;
+    glm::dvec3 origin;
+    unsigned int seed;
+
+    std::vector<ChunkSlot> slots;
+    std::vector<ColumnState> columns;
+    unsigned int columns_ready;
+
+    ThreadPool pool;
+    // Held by mesh jobs while copying blocks out and by edits while writing
+    mutable std::mutex data_mutex;
+    // Worker output, collected by update()
+    std::mutex results_mutex;
+    std::vector<int> generated_columns;
+    std::vector<MeshResult*> finished_meshes;
+    // Finished meshes waiting for their turn to upload
+    std::deque<MeshResult*> uploads;
+    unsigned int meshes_in_flight;
+
+    Shader* shader;
+    ProgramInterface shader_interface;
+    VertexFormat vertex_format;
+    unsigned int shader_revision;   // Revision the locations below were looked up for
+    GLint chunk_offset_loc;
+    GLint detail_region_loc;
+    GLint detail_layer_loc;
+    GLuint quad_indices;
+    BufferArena mesh_arena;
+
+    // Stats
+    double load_start;
+    double load_seconds;
+    double mesh_ms_total;
+    unsigned int meshes_built;
+    unsigned int chunks_drawn;
+    unsigned int chunks_culled;
+    unsigned long long quads_drawn;
+    unsigned int array_binds;
+    size_t uploaded_bytes;
+
+    int column_index(int cx, int cz) const;
+    int chunk_slot(int cx, int cy, int cz) const;
+    int surface_height(int x, int z) const;
+    BlockType terrain_block(int y, int height) const;
+
+    void generate_column(int cx, int cz);
+    void mesh_job(int slot, unsigned int revision);
+    void copy_padded(int cx, int cy, int cz, BlockType* padded) const;
+    bool is_buried(int cx, int cy, int cz) const;
+    void queue_mesh(int slot, bool urgent);
+    void mark_column_generated(int column);
+    void upload(MeshResult* result);
+
+public:
+    // Quads share one index buffer, sized for the worst case chunk
+    static const unsigned int MAX_CHUNK_QUADS = CHUNK_VOLUME / 2 * 6;
+    // Mesh data uploaded per update() once loading, edits are never held back
+    static const size_t UPLOAD_BUDGET_BYTES = 2 * 1024 * 1024;
+    // Chunk meshes share buffers of this size, the largest mesh is 1.5 MB
+    static const GLsizeiptr MESH_PAGE_BYTES = 16 * 1024 * 1024;
+
+    VoxelWorld();
+    ~VoxelWorld();
+
+    // Size in blocks, rounded up to whole chunks. Starts generating right
+    // away on threads worker threads (0 picks from the core count). The
+    // shader's Matrices block goes where UniformBlockBindings has it.
+    bool init(int size_x, int size_y, int size_z, unsigned int threads, unsigned int seed);
+    void destroy();
+
+    // Image in the atlas bound to unit 0 that adds grain to the block colours
+    void set_detail_texture(const TextureAtlas &atlas, int image);
+
+    // World space position of block (0, 0, 0)
+    void set_origin(const glm::dvec3 &origin);
+    const glm::dvec3& get_origin() const;
+
+    // Picks up worker results: queues meshes for newly generated chunks and
+    // uploads finished meshes within the budget. Call once per frame.
+    void update();
+    // Draws every chunk with a mesh that intersects the camera frustum
+    void draw(const Camera &camera);
+
+    BlockType get_block(int x, int y, int z) const;
+    // Rebuilds the chunk's mesh, and a neighbour's when the block is on its border
+    void set_block(int x, int y, int z, BlockType block);
+    // Steps through blocks along the ray (DDA) until a solid one, also giving
+    // the empty block just before it. Positions are in world space.
+    bool raycast(const glm::dvec3 &start, const glm::vec3 &direction, float max_distance, glm::ivec3 &hit, glm::ivec3 &before) const;
+    // Height of the highest solid block in the column, -1 for none
+    int get_surface(int x, int z) const;
+
+    bool is_loading() const;
+    void print_report() const;
+};
+
+#endif // VOXEL_WORLD_H
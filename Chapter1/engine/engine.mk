@@ -0,0 +1,28 @@
+# Included by the chapter makefiles after setting ENGINE_DIR. Builds the
+# engine libraries when needed and gives their include paths and archives.
+
+ifeq ($(PROFILE),1)
+ENGINE_VARIANT=profile
+else
+ENGINE_VARIANT=release
+endif
+
+ENGINE_LIB=$(ENGINE_DIR)/lib/$(ENGINE_VARIANT)/libengine.a
+# Only for programs that want GL call interception, see intercept/gl_intercept.h
+ENGINE_INTERCEPT_LIB=$(ENGINE_DIR)/lib/$(ENGINE_VARIANT)/libgl_intercept.a
+# Linked as well to hook the GL 1.1 entry points, which then all go through a
+# pointer. Only for INTERCEPT=1 builds, see intercept/gl_interpose.h
+ENGINE_INTERPOSE_OBJ=$(ENGINE_DIR)/obj/$(ENGINE_VARIANT)/gl_interpose.o
+ENGINE_INCDIRS=-I$(ENGINE_DIR)/src -I$(ENGINE_DIR)/intercept -I$(ENGINE_DIR)
+
+# Always ask the engine makefile, which only touches an archive when one of
+# its sources changed, so dependents relink only then
+$(ENGINE_LIB): FORCE
+		$(MAKE) -C $(ENGINE_DIR) PROFILE=$(PROFILE)
+
+# Built by the same call, a second one could race it under -j
+$(ENGINE_INTERCEPT_LIB) $(ENGINE_INTERPOSE_OBJ): $(ENGINE_LIB)
+		@:
+
+.PHONY: FORCE
+FORCE:
@@ -0,0 +1,140 @@
+#include "gl_capture.h"
+#include "gl_intercept.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+    bool capturing = false;
+    const char* trace_path = NULL;
+    unsigned int frame = 0;
+    unsigned int target_frame = 0;
+
+    // The whole trace is kept in memory and written once the target frame ends
+    std::vector<unsigned char> stream;
+    TraceHeader header;
+    size_t frame_start = 0;
+    uint32_t frame_start_commands = 0;
+
+    bool write_trace()
+    {
+        memcpy(&stream[0], &header, sizeof(header));
+
+        FILE* file = fopen(trace_path, "wb");
+        if(!file)
+        {
+            printf("ERROR::GL_CAPTURE::FAILED_TO_OPEN %s\n", trace_path);
+            return false;
+        }
+        size_t written = fwrite(&stream[0], 1, stream.size(), file);
+        fclose(file);
+        if(written != stream.size())
+        {
+            printf("ERROR::GL_CAPTURE::FAILED_TO_WRITE %s\n", trace_path);
+            return false;
+        }
+
+        printf("GL capture: wrote %u commands (%u in frame %u), %zu bytes to %s\n",
+            header.command_count, header.frame_command_count, target_frame, stream.size(), trace_path);
+        return true;
+    }
+}
+
+bool GLCapture::start(const char* path, unsigned int frame_index, unsigned int width, unsigned int height)
+{
+    if(capturing)
+        return false;
+    // Without the GL 1.1 calls (textures, clears, draws) the trace could not be replayed
+    if(!GLIntercept::core_interposed())
+    {
+        printf("ERROR::GL_CAPTURE::CORE_NOT_INTERPOSED build with make INTERCEPT=1 to capture\n");
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = GL_TRACE_MAGIC;
+    header.version = GL_TRACE_VERSION;
+    header.width = width;
+    header.height = height;
+
+    stream.clear();
+    stream.reserve(1 << 20);
+    stream.resize(sizeof(TraceHeader));
+    frame_start = stream.size();
+    frame_start_commands = 0;
+
+    trace_path = path;
+    frame = 0;
+    target_frame = frame_index;
+    capturing = true;
+    GLIntercept::install_hooks();
+    return true;
+}
+
+bool GLCapture::active()
+{
+    return capturing;
+}
+
+void GLCapture::end_frame()
+{
+    if(!capturing)
+        return;
+
+    {
+        Command command(TRACE_FRAME_END);
+    }
+
+    if(frame < target_frame)
+    {
+        frame++;
+        frame_start = stream.size();
+        frame_start_commands = header.command_count;
+        return;
+    }
+
+    header.frame_offset = frame_start;
+    header.frame_end_offset = stream.size();
+    header.frame_command_count = header.command_count - frame_start_commands;
+    write_trace();
+
+    capturing = false;
+    GLIntercept::remove_hooks();
+    std::vector<unsigned char>().swap(stream);
+}
+
+GLCapture::Command::Command(uint16_t opcode)
+{
+    TraceCommand command = { opcode, 0, 0 };
+    start = stream.size();
+    put_bytes(&command, sizeof(command));
+    header.command_count++;
+}
+
+GLCapture::Command::~Command()
+{
+    // Pad the payload to 4 bytes and patch its size into the command
+    while(stream.size() % 4)
+        stream.push_back(0);
+    uint32_t size = (uint32_t)(stream.size() - start - sizeof(TraceCommand));
+    memcpy(&stream[start] + offsetof(TraceCommand, size), &size, sizeof(size));
+}
+
+void GLCapture::Command::put_bytes(const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    stream.insert(stream.end(), bytes, bytes + size);
+}
+
+void GLCapture::Command::put_blob(const void* data, size_t size)
+{
+    uint32_t length = (uint32_t)size;
+    put_bytes(&length, sizeof(length));
+    if(size)
+        put_bytes(data, size);
+    // Keep the fields after a blob aligned
+    while(stream.size() % 4)
+        stream.push_back(0);
+}
@@ -0,0 +1,40 @@
+#ifndef GL_CAPTURE_H
+#define GL_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gl_trace.h"
+
+// Records the GL command stream, with the resources it uploads, into a trace
+// file (see gl_trace.h) that tools/gl_replay can play back. Commands are
+// recorded by the GLIntercept hooks while a capture is running.
+namespace GLCapture
+{
+    // Starts recording. Everything up to the end of `frame` is kept, the last
+    // frame being the one the replayer loops. Must be called after glewInit().
+    bool start(const char* path, unsigned int frame, unsigned int width, unsigned int height);
+    bool active();
+
+    // Marks the end of a frame. Writes the trace once the target frame ends.
+    void end_frame();
+
+    // Appends one command. The payload is built with put* and closed by the destructor.
+    class Command
+    {
+    public:
+        explicit Command(uint16_t opcode);
+        ~Command();
+
+        template <typename T>
+        void put(const T &value) { put_bytes(&value, sizeof(T)); }
+        void put_bytes(const void* data, size_t size);
+        // Length-prefixed blob
+        void put_blob(const void* data, size_t size);
+
+    private:
+        size_t start;
+    };
+}
+
+#endif // GL_CAPTURE_H
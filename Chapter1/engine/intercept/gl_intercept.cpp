@@ -0,0 +1,1519 @@
+#include "gl_intercept.h"
+#include "gl_capture.h"
+#include "gl_interpose.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace GLIntercept;
+
+namespace
+{
+    struct GlewTable
+    {
+        PFNGLACTIVETEXTUREPROC ActiveTexture;
+        PFNGLTEXIMAGE3DPROC TexImage3D;
+        PFNGLTEXSUBIMAGE3DPROC TexSubImage3D;
+        PFNGLTEXSTORAGE2DPROC TexStorage2D;
+        PFNGLTEXSTORAGE3DPROC TexStorage3D;
+        PFNGLGENERATEMIPMAPPROC GenerateMipmap;
+        PFNGLCREATESHADERPROC CreateShader;
+        PFNGLSHADERSOURCEPROC ShaderSource;
+        PFNGLCOMPILESHADERPROC CompileShader;
+        PFNGLDELETESHADERPROC DeleteShader;
+        PFNGLCREATEPROGRAMPROC CreateProgram;
+        PFNGLATTACHSHADERPROC AttachShader;
+        PFNGLLINKPROGRAMPROC LinkProgram;
+        PFNGLDELETEPROGRAMPROC DeleteProgram;
+        PFNGLUSEPROGRAMPROC UseProgram;
+        PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation;
+        PFNGLUNIFORM1IPROC Uniform1i;
+        PFNGLUNIFORM1FPROC Uniform1f;
+        PFNGLUNIFORM3FPROC Uniform3f;
+        PFNGLUNIFORM4FPROC Uniform4f;
+        PFNGLUNIFORMMATRIX4FVPROC UniformMatrix4fv;
+        PFNGLUNIFORM1FVPROC Uniform1fv;
+        PFNGLUNIFORM2FVPROC Uniform2fv;
+        PFNGLUNIFORM3FVPROC Uniform3fv;
+        PFNGLUNIFORM4FVPROC Uniform4fv;
+        PFNGLUNIFORM1IVPROC Uniform1iv;
+        PFNGLUNIFORM2IVPROC Uniform2iv;
+        PFNGLUNIFORM3IVPROC Uniform3iv;
+        PFNGLUNIFORM4IVPROC Uniform4iv;
+        PFNGLUNIFORM1UIVPROC Uniform1uiv;
+        PFNGLUNIFORM2UIVPROC Uniform2uiv;
+        PFNGLUNIFORM3UIVPROC Uniform3uiv;
+        PFNGLUNIFORM4UIVPROC Uniform4uiv;
+        PFNGLUNIFORMMATRIX2FVPROC UniformMatrix2fv;
+        PFNGLUNIFORMMATRIX3FVPROC UniformMatrix3fv;
+        PFNGLUNIFORMMATRIX2X3FVPROC UniformMatrix2x3fv;
+        PFNGLUNIFORMMATRIX3X2FVPROC UniformMatrix3x2fv;
+        PFNGLUNIFORMMATRIX2X4FVPROC UniformMatrix2x4fv;
+        PFNGLUNIFORMMATRIX4X2FVPROC UniformMatrix4x2fv;
+        PFNGLUNIFORMMATRIX3X4FVPROC UniformMatrix3x4fv;
+        PFNGLUNIFORMMATRIX4X3FVPROC UniformMatrix4x3fv;
+        PFNGLGENVERTEXARRAYSPROC GenVertexArrays;
+        PFNGLDELETEVERTEXARRAYSPROC DeleteVertexArrays;
+        PFNGLBINDVERTEXARRAYPROC BindVertexArray;
+        PFNGLGENBUFFERSPROC GenBuffers;
+        PFNGLDELETEBUFFERSPROC DeleteBuffers;
+        PFNGLBINDBUFFERPROC BindBuffer;
+        PFNGLBUFFERDATAPROC BufferData;
+        PFNGLBUFFERSUBDATAPROC BufferSubData;
+        PFNGLBINDBUFFERBASEPROC BindBufferBase;
+        PFNGLGETUNIFORMBLOCKINDEXPROC GetUniformBlockIndex;
+        PFNGLUNIFORMBLOCKBINDINGPROC UniformBlockBinding;
+        PFNGLVERTEXATTRIBPOINTERPROC VertexAttribPointer;
+        PFNGLVERTEXATTRIBIPOINTERPROC VertexAttribIPointer;
+        PFNGLENABLEVERTEXATTRIBARRAYPROC EnableVertexAttribArray;
+        PFNGLGENFRAMEBUFFERSPROC GenFramebuffers;
+        PFNGLDELETEFRAMEBUFFERSPROC DeleteFramebuffers;
+        PFNGLBINDFRAMEBUFFERPROC BindFramebuffer;
+        PFNGLFRAMEBUFFERTEXTURE2DPROC FramebufferTexture2D;
+        PFNGLBLITFRAMEBUFFERPROC BlitFramebuffer;
+        PFNGLCLIPCONTROLPROC ClipControl;
+        PFNGLDRAWELEMENTSBASEVERTEXPROC DrawElementsBaseVertex;
+        PFNGLCREATEBUFFERSPROC CreateBuffers;
+        PFNGLNAMEDBUFFERSTORAGEPROC NamedBufferStorage;
+        PFNGLNAMEDBUFFERDATAPROC NamedBufferData;
+        PFNGLNAMEDBUFFERSUBDATAPROC NamedBufferSubData;
+        PFNGLCREATETEXTURESPROC CreateTextures;
+        PFNGLTEXTURESTORAGE2DPROC TextureStorage2D;
+        PFNGLTEXTURESTORAGE3DPROC TextureStorage3D;
+        PFNGLTEXTURESUBIMAGE2DPROC TextureSubImage2D;
+        PFNGLTEXTURESUBIMAGE3DPROC TextureSubImage3D;
+        PFNGLTEXTUREPARAMETERIPROC TextureParameteri;
+        PFNGLGENERATETEXTUREMIPMAPPROC GenerateTextureMipmap;
+        PFNGLBINDTEXTUREUNITPROC BindTextureUnit;
+        PFNGLCREATEVERTEXARRAYSPROC CreateVertexArrays;
+        PFNGLENABLEVERTEXARRAYATTRIBPROC EnableVertexArrayAttrib;
+        PFNGLVERTEXARRAYVERTEXBUFFERPROC VertexArrayVertexBuffer;
+        PFNGLVERTEXARRAYATTRIBFORMATPROC VertexArrayAttribFormat;
+        PFNGLVERTEXARRAYATTRIBIFORMATPROC VertexArrayAttribIFormat;
+        PFNGLVERTEXARRAYATTRIBBINDINGPROC VertexArrayAttribBinding;
+        PFNGLVERTEXARRAYELEMENTBUFFERPROC VertexArrayElementBuffer;
+    };
+
+    // Finds the driver's definition of an entry point the executable interposes
+    void* resolve_next(const char* name)
+    {
+        void* proc = dlsym(RTLD_NEXT, name);
+        if(!proc)
+        {
+            // libGL may not be loaded yet if the linker dropped it as unneeded
+            static void* libgl = dlopen("libGL.so.1", RTLD_LAZY | RTLD_GLOBAL);
+            if(libgl)
+                proc = dlsym(libgl, name);
+        }
+        if(!proc)
+            printf("ERROR::GL_INTERCEPT::UNRESOLVED_ENTRY_POINT %s\n", name);
+        return proc;
+    }
+
+    GLIntercept::CoreTable resolve_core()
+    {
+        GLIntercept::CoreTable table;
+        table.GenTextures = (GenTexturesProc)resolve_next("glGenTextures");
+        table.DeleteTextures = (DeleteTexturesProc)resolve_next("glDeleteTextures");
+        table.BindTexture = (BindTextureProc)resolve_next("glBindTexture");
+        table.TexParameteri = (TexParameteriProc)resolve_next("glTexParameteri");
+        table.TexImage2D = (TexImage2DProc)resolve_next("glTexImage2D");
+        table.TexSubImage2D = (TexSubImage2DProc)resolve_next("glTexSubImage2D");
+        table.Enable = (EnableProc)resolve_next("glEnable");
+        table.Disable = (EnableProc)resolve_next("glDisable");
+        table.Clear = (ClearProc)resolve_next("glClear");
+        table.ClearColor = (ClearColorProc)resolve_next("glClearColor");
+        table.ClearDepth = (ClearDepthProc)resolve_next("glClearDepth");
+        table.DepthFunc = (DepthFuncProc)resolve_next("glDepthFunc");
+        table.Viewport = (ViewportProc)resolve_next("glViewport");
+        table.DrawArrays = (DrawArraysProc)resolve_next("glDrawArrays");
+        table.DrawElements = (DrawElementsProc)resolve_next("glDrawElements");
+        return table;
+    }
+
+    // The driver's entry points
+    const GLIntercept::CoreTable driver_core = resolve_core();
+    GlewTable driver;
+    unsigned int hook_users = 0;
+
+    const GLuint UNKNOWN = 0xFFFFFFFF;
+    const unsigned int MAX_TEXTURE_UNITS = 32;
+
+    enum TextureTarget { TARGET_2D, TARGET_2D_ARRAY, TARGET_CUBE_MAP, TARGET_3D, TEXTURE_TARGET_COUNT };
+    enum BufferTarget { BUFFER_ARRAY, BUFFER_ELEMENT, BUFFER_UNIFORM, BUFFER_TARGET_COUNT };
+    enum Capability { CAP_DEPTH_TEST, CAP_BLEND, CAP_CULL_FACE, CAP_SCISSOR_TEST, CAP_STENCIL_TEST, CAP_COUNT };
+
+    // Last value set through the hooks, used to spot redundant state changes
+    struct Shadow
+    {
+        GLuint program;
+        GLuint vertex_array;
+        GLuint draw_framebuffer;
+        GLuint read_framebuffer;
+        GLuint buffers[BUFFER_TARGET_COUNT];
+        GLuint active_unit;
+        GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+        int caps[CAP_COUNT]; // 0 off, 1 on, -1 unknown
+        GLfloat clear_color[4];
+        bool clear_color_known;
+        GLint viewport[4];
+        bool viewport_known;
+        GLenum depth_func;
+    };
+
+    bool stats_active = false;
+    Shadow shadow;
+    FrameStats current, last, interval, total;
+    unsigned long long interval_frames = 0;
+    unsigned long long total_frames = 0;
+
+    // (program, location) -> hash of the last value uploaded
+    std::unordered_map<unsigned long long, unsigned long long> uniform_values;
+    // (program, name) pairs that have been looked up before
+    std::unordered_set<unsigned long long> uniform_lookups;
+
+    const char* entry_point_names[ENTRY_POINT_COUNT] = {
+#define GL_INTERCEPT_NAME(name) "gl" #name,
+        GL_INTERCEPT_ENTRY_POINTS(GL_INTERCEPT_NAME)
+#undef GL_INTERCEPT_NAME
+    };
+
+    void reset_shadow()
+    {
+        shadow.program = UNKNOWN;
+        shadow.vertex_array = UNKNOWN;
+        shadow.draw_framebuffer = UNKNOWN;
+        shadow.read_framebuffer = UNKNOWN;
+        for(unsigned int i = 0; i < BUFFER_TARGET_COUNT; i++)
+            shadow.buffers[i] = UNKNOWN;
+        shadow.active_unit = UNKNOWN;
+        for(unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+            for(unsigned int target = 0; target < TEXTURE_TARGET_COUNT; target++)
+                shadow.textures[unit][target] = UNKNOWN;
+        for(unsigned int i = 0; i < CAP_COUNT; i++)
+            shadow.caps[i] = -1;
+        shadow.clear_color_known = false;
+        shadow.viewport_known = false;
+        shadow.depth_func = UNKNOWN;
+        uniform_values.clear();
+        uniform_lookups.clear();
+    }
+
+    unsigned long long hash_bytes(const void* data, size_t size, unsigned long long hash = 14695981039346656037ULL)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for(size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        return hash;
+    }
+
+    inline void count(EntryPoint entry)
+    {
+        current.calls[entry]++;
+    }
+
+    // Stores value in slot and reports whether it was already set to it
+    template <typename T>
+    inline void update_shadow(EntryPoint entry, T &slot, T value)
+    {
+        if(slot == value)
+            current.redundant[entry]++;
+        slot = value;
+    }
+
+    GLuint* texture_slot(GLenum target)
+    {
+        if(shadow.active_unit >= MAX_TEXTURE_UNITS)
+            return NULL;
+        switch(target)
+        {
+            case(GL_TEXTURE_2D): return &shadow.textures[shadow.active_unit][TARGET_2D];
+            case(GL_TEXTURE_2D_ARRAY): return &shadow.textures[shadow.active_unit][TARGET_2D_ARRAY];
+            case(GL_TEXTURE_CUBE_MAP): return &shadow.textures[shadow.active_unit][TARGET_CUBE_MAP];
+            case(GL_TEXTURE_3D): return &shadow.textures[shadow.active_unit][TARGET_3D];
+        }
+        return NULL;
+    }
+
+    GLuint* buffer_slot(GLenum target)
+    {
+        switch(target)
+        {
+            case(GL_ARRAY_BUFFER): return &shadow.buffers[BUFFER_ARRAY];
+            case(GL_ELEMENT_ARRAY_BUFFER): return &shadow.buffers[BUFFER_ELEMENT];
+            case(GL_UNIFORM_BUFFER): return &shadow.buffers[BUFFER_UNIFORM];
+        }
+        return NULL;
+    }
+
+    int* capability_slot(GLenum cap)
+    {
+        switch(cap)
+        {
+            case(GL_DEPTH_TEST): return &shadow.caps[CAP_DEPTH_TEST];
+            case(GL_BLEND): return &shadow.caps[CAP_BLEND];
+            case(GL_CULL_FACE): return &shadow.caps[CAP_CULL_FACE];
+            case(GL_SCISSOR_TEST): return &shadow.caps[CAP_SCISSOR_TEST];
+            case(GL_STENCIL_TEST): return &shadow.caps[CAP_STENCIL_TEST];
+        }
+        return NULL;
+    }
+
+    // Size of a client image with the default GL_UNPACK_ALIGNMENT of 4
+    unsigned long long image_bytes(GLsizei width, GLsizei height, GLenum format, GLenum type)
+    {
+        unsigned int components = 4;
+        switch(format)
+        {
+            case(GL_RED): case(GL_DEPTH_COMPONENT): components = 1; break;
+            case(GL_RG): case(GL_DEPTH_STENCIL): components = 2; break;
+            case(GL_RGB): case(GL_BGR): components = 3; break;
+        }
+        unsigned int component_size = 1;
+        switch(type)
+        {
+            case(GL_UNSIGNED_SHORT): case(GL_SHORT): case(GL_HALF_FLOAT): component_size = 2; break;
+            case(GL_UNSIGNED_INT): case(GL_INT): case(GL_FLOAT): component_size = 4; break;
+            case(GL_UNSIGNED_INT_24_8): case(GL_UNSIGNED_INT_8_8_8_8): components = 1; component_size = 4; break;
+        }
+        if(width <= 0 || height <= 0)
+            return 0;
+        unsigned long long row = (unsigned long long)width * components * component_size;
+        unsigned long long stride = (row + 3) & ~3ULL;
+        return stride * (height - 1) + row;
+    }
+
+    // Records a uniform upload and counts it if the location already held the value
+    void upload_uniform(EntryPoint entry, GLint location, const void* data, size_t size)
+    {
+        current.uniform_bytes += size;
+        if(location < 0 || shadow.program == UNKNOWN)
+            return;
+
+        unsigned long long key = ((unsigned long long)shadow.program << 32) | (unsigned int)location;
+        unsigned long long hash = hash_bytes(data, size);
+        std::unordered_map<unsigned long long, unsigned long long>::iterator it = uniform_values.find(key);
+        if(it == uniform_values.end())
+            uniform_values[key] = hash;
+        else
+            update_shadow(entry, it->second, hash);
+    }
+
+    // Records commands that only carry 32-bit arguments
+    void capture(uint16_t opcode, uint32_t a)
+    {
+        GLCapture::Command command(opcode);
+        command.put(a);
+    }
+
+    void capture(uint16_t opcode, uint32_t a, uint32_t b)
+    {
+        GLCapture::Command command(opcode);
+        command.put(a);
+        command.put(b);
+    }
+
+    void capture(uint16_t opcode, uint32_t a, uint32_t b, uint32_t c)
+    {
+        GLCapture::Command command(opcode);
+        command.put(a);
+        command.put(b);
+        command.put(c);
+    }
+
+    void capture_names(uint16_t opcode, GLsizei n, const GLuint* names)
+    {
+        GLCapture::Command command(opcode);
+        command.put((uint32_t)n);
+        command.put_bytes(names, n * sizeof(GLuint));
+    }
+
+    // GL 1.1 hooks
+
+    void GLAPIENTRY hook_GenTextures(GLsizei n, GLuint* textures)
+    {
+        count(ENTRY_GenTextures);
+        driver_core.GenTextures(n, textures);
+        if(GLCapture::active())
+            capture_names(TRACE_GEN_TEXTURES, n, textures);
+    }
+
+    void GLAPIENTRY hook_DeleteTextures(GLsizei n, const GLuint* textures)
+    {
+        count(ENTRY_DeleteTextures);
+        if(GLCapture::active())
+            capture_names(TRACE_DELETE_TEXTURES, n, textures);
+        driver_core.DeleteTextures(n, textures);
+    }
+
+    void GLAPIENTRY hook_BindTexture(GLenum target, GLuint texture)
+    {
+        count(ENTRY_BindTexture);
+        GLuint* slot = texture_slot(target);
+        if(slot)
+            update_shadow(ENTRY_BindTexture, *slot, texture);
+        if(GLCapture::active())
+            capture(TRACE_BIND_TEXTURE, target, texture);
+        driver_core.BindTexture(target, texture);
+    }
+
+    void GLAPIENTRY hook_TexParameteri(GLenum target, GLenum name, GLint param)
+    {
+        count(ENTRY_TexParameteri);
+        if(GLCapture::active())
+            capture(TRACE_TEX_PARAMETERI, target, name, param);
+        driver_core.TexParameteri(target, name, param);
+    }
+
+    void GLAPIENTRY hook_TexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+    {
+        count(ENTRY_TexImage2D);
+        unsigned long long bytes = pixels ? image_bytes(width, height, format, type) : 0;
+        current.texture_bytes += bytes;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEX_IMAGE_2D);
+            command.put(target);
+            command.put(level);
+            command.put(internal_format);
+            command.put(width);
+            command.put(height);
+            command.put(border);
+            command.put(format);
+            command.put(type);
+            command.put_blob(pixels, bytes);
+        }
+        driver_core.TexImage2D(target, level, internal_format, width, height, border, format, type, pixels);
+    }
+
+    void GLAPIENTRY hook_TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+    {
+        count(ENTRY_TexSubImage2D);
+        unsigned long long bytes = pixels ? image_bytes(width, height, format, type) : 0;
+        current.texture_bytes += bytes;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEX_SUB_IMAGE_2D);
+            command.put(target);
+            command.put(level);
+            command.put(x);
+            command.put(y);
+            command.put(width);
+            command.put(height);
+            command.put(format);
+            command.put(type);
+            command.put_blob(pixels, bytes);
+        }
+        driver_core.TexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+    }
+
+    void GLAPIENTRY hook_Enable(GLenum cap)
+    {
+        count(ENTRY_Enable);
+        int* slot = capability_slot(cap);
+        if(slot)
+            update_shadow(ENTRY_Enable, *slot, 1);
+        if(GLCapture::active())
+            capture(TRACE_ENABLE, cap);
+        driver_core.Enable(cap);
+    }
+
+    void GLAPIENTRY hook_Disable(GLenum cap)
+    {
+        count(ENTRY_Disable);
+        int* slot = capability_slot(cap);
+        if(slot)
+            update_shadow(ENTRY_Disable, *slot, 0);
+        if(GLCapture::active())
+            capture(TRACE_DISABLE, cap);
+        driver_core.Disable(cap);
+    }
+
+    void GLAPIENTRY hook_Clear(GLbitfield mask)
+    {
+        count(ENTRY_Clear);
+        if(GLCapture::active())
+            capture(TRACE_CLEAR, mask);
+        driver_core.Clear(mask);
+    }
+
+    void GLAPIENTRY hook_ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+    {
+        count(ENTRY_ClearColor);
+        GLfloat color[4] = { red, green, blue, alpha };
+        if(shadow.clear_color_known && memcmp(color, shadow.clear_color, sizeof(color)) == 0)
+            current.redundant[ENTRY_ClearColor]++;
+        memcpy(shadow.clear_color, color, sizeof(color));
+        shadow.clear_color_known = true;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_CLEAR_COLOR);
+            command.put(color);
+        }
+        driver_core.ClearColor(red, green, blue, alpha);
+    }
+
+    void GLAPIENTRY hook_ClearDepth(GLdouble depth)
+    {
+        count(ENTRY_ClearDepth);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_CLEAR_DEPTH);
+            command.put((float)depth);
+        }
+        driver_core.ClearDepth(depth);
+    }
+
+    void GLAPIENTRY hook_DepthFunc(GLenum func)
+    {
+        count(ENTRY_DepthFunc);
+        update_shadow(ENTRY_DepthFunc, shadow.depth_func, func);
+        if(GLCapture::active())
+            capture(TRACE_DEPTH_FUNC, func);
+        driver_core.DepthFunc(func);
+    }
+
+    void GLAPIENTRY hook_Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        count(ENTRY_Viewport);
+        GLint viewport[4] = { x, y, width, height };
+        if(shadow.viewport_known && memcmp(viewport, shadow.viewport, sizeof(viewport)) == 0)
+            current.redundant[ENTRY_Viewport]++;
+        memcpy(shadow.viewport, viewport, sizeof(viewport));
+        shadow.viewport_known = true;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_VIEWPORT);
+            command.put(viewport);
+        }
+        driver_core.Viewport(x, y, width, height);
+    }
+
+    void GLAPIENTRY hook_DrawArrays(GLenum mode, GLint first, GLsizei count_)
+    {
+        count(ENTRY_DrawArrays);
+        if(GLCapture::active())
+            capture(TRACE_DRAW_ARRAYS, mode, first, count_);
+        driver_core.DrawArrays(mode, first, count_);
+    }
+
+    void GLAPIENTRY hook_DrawElements(GLenum mode, GLsizei count_, GLenum type, const void* indices)
+    {
+        count(ENTRY_DrawElements);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_DRAW_ELEMENTS);
+            command.put(mode);
+            command.put(count_);
+            command.put(type);
+            command.put((uint64_t)(uintptr_t)indices);
+        }
+        driver_core.DrawElements(mode, count_, type, indices);
+    }
+
+    // GLEW hooks
+
+    void GLAPIENTRY hook_ActiveTexture(GLenum texture)
+    {
+        count(ENTRY_ActiveTexture);
+        update_shadow(ENTRY_ActiveTexture, shadow.active_unit, (GLuint)(texture - GL_TEXTURE0));
+        if(GLCapture::active())
+            capture(TRACE_ACTIVE_TEXTURE, texture);
+        driver.ActiveTexture(texture);
+    }
+
+    void GLAPIENTRY hook_TexImage3D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels)
+    {
+        count(ENTRY_TexImage3D);
+        // Layers and slices are consecutive images, as many rows as all of them together
+        unsigned long long bytes = pixels ? image_bytes(width, height * depth, format, type) : 0;
+        current.texture_bytes += bytes;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEX_IMAGE_3D);
+            command.put(target);
+            command.put(level);
+            command.put(internal_format);
+            command.put(width);
+            command.put(height);
+            command.put(depth);
+            command.put(border);
+            command.put(format);
+            command.put(type);
+            command.put_blob(pixels, bytes);
+        }
+        driver.TexImage3D(target, level, internal_format, width, height, depth, border, format, type, pixels);
+    }
+
+    void GLAPIENTRY hook_TexSubImage3D(GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+    {
+        count(ENTRY_TexSubImage3D);
+        unsigned long long bytes = pixels ? image_bytes(width, height * depth, format, type) : 0;
+        current.texture_bytes += bytes;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEX_SUB_IMAGE_3D);
+            command.put(target);
+            command.put(level);
+            command.put(x);
+            command.put(y);
+            command.put(z);
+            command.put(width);
+            command.put(height);
+            command.put(depth);
+            command.put(format);
+            command.put(type);
+            command.put_blob(pixels, bytes);
+        }
+        driver.TexSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+    }
+
+    // Allocations only, nothing is uploaded
+    void GLAPIENTRY hook_TexStorage2D(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height)
+    {
+        count(ENTRY_TexStorage2D);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEX_STORAGE_2D);
+            command.put(target);
+            command.put(levels);
+            command.put(internal_format);
+            command.put(width);
+            command.put(height);
+        }
+        driver.TexStorage2D(target, levels, internal_format, width, height);
+    }
+
+    void GLAPIENTRY hook_TexStorage3D(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height, GLsizei depth)
+    {
+        count(ENTRY_TexStorage3D);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEX_STORAGE_3D);
+            command.put(target);
+            command.put(levels);
+            command.put(internal_format);
+            command.put(width);
+            command.put(height);
+            command.put(depth);
+        }
+        driver.TexStorage3D(target, levels, internal_format, width, height, depth);
+    }
+
+    void GLAPIENTRY hook_GenerateMipmap(GLenum target)
+    {
+        count(ENTRY_GenerateMipmap);
+        if(GLCapture::active())
+            capture(TRACE_GENERATE_MIPMAP, target);
+        driver.GenerateMipmap(target);
+    }
+
+    GLuint GLAPIENTRY hook_CreateShader(GLenum type)
+    {
+        count(ENTRY_CreateShader);
+        GLuint shader = driver.CreateShader(type);
+        if(GLCapture::active())
+            capture(TRACE_CREATE_SHADER, type, shader);
+        return shader;
+    }
+
+    void GLAPIENTRY hook_ShaderSource(GLuint shader, GLsizei count_, const GLchar* const* strings, const GLint* lengths)
+    {
+        count(ENTRY_ShaderSource);
+        if(GLCapture::active())
+        {
+            std::string source;
+            for(GLsizei i = 0; i < count_; i++)
+            {
+                if(lengths && lengths[i] >= 0)
+                    source.append(strings[i], lengths[i]);
+                else
+                    source.append(strings[i]);
+            }
+            GLCapture::Command command(TRACE_SHADER_SOURCE);
+            command.put(shader);
+            command.put_blob(source.c_str(), source.size());
+        }
+        driver.ShaderSource(shader, count_, strings, lengths);
+    }
+
+    void GLAPIENTRY hook_CompileShader(GLuint shader)
+    {
+        count(ENTRY_CompileShader);
+        if(GLCapture::active())
+            capture(TRACE_COMPILE_SHADER, shader);
+        driver.CompileShader(shader);
+    }
+
+    void GLAPIENTRY hook_DeleteShader(GLuint shader)
+    {
+        count(ENTRY_DeleteShader);
+        if(GLCapture::active())
+            capture(TRACE_DELETE_SHADER, shader);
+        driver.DeleteShader(shader);
+    }
+
+    GLuint GLAPIENTRY hook_CreateProgram()
+    {
+        count(ENTRY_CreateProgram);
+        GLuint program = driver.CreateProgram();
+        if(GLCapture::active())
+            capture(TRACE_CREATE_PROGRAM, program);
+        return program;
+    }
+
+    void GLAPIENTRY hook_AttachShader(GLuint program, GLuint shader)
+    {
+        count(ENTRY_AttachShader);
+        if(GLCapture::active())
+            capture(TRACE_ATTACH_SHADER, program, shader);
+        driver.AttachShader(program, shader);
+    }
+
+    void GLAPIENTRY hook_LinkProgram(GLuint program)
+    {
+        count(ENTRY_LinkProgram);
+        if(GLCapture::active())
+            capture(TRACE_LINK_PROGRAM, program);
+        driver.LinkProgram(program);
+    }
+
+    void GLAPIENTRY hook_DeleteProgram(GLuint program)
+    {
+        count(ENTRY_DeleteProgram);
+        if(GLCapture::active())
+            capture(TRACE_DELETE_PROGRAM, program);
+        driver.DeleteProgram(program);
+    }
+
+    void GLAPIENTRY hook_UseProgram(GLuint program)
+    {
+        count(ENTRY_UseProgram);
+        update_shadow(ENTRY_UseProgram, shadow.program, program);
+        if(GLCapture::active())
+            capture(TRACE_USE_PROGRAM, program);
+        driver.UseProgram(program);
+    }
+
+    GLint GLAPIENTRY hook_GetUniformLocation(GLuint program, const GLchar* name)
+    {
+        count(ENTRY_GetUniformLocation);
+        // Any repeat lookup could have been cached by the caller
+        unsigned long long key = hash_bytes(name, strlen(name), hash_bytes(&program, sizeof(program)));
+        if(!uniform_lookups.insert(key).second)
+            current.redundant[ENTRY_GetUniformLocation]++;
+        GLint location = driver.GetUniformLocation(program, name);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_GET_UNIFORM_LOCATION);
+            command.put(program);
+            command.put(location);
+            command.put_blob(name, strlen(name));
+        }
+        return location;
+    }
+
+    void GLAPIENTRY hook_Uniform1i(GLint location, GLint value)
+    {
+        count(ENTRY_Uniform1i);
+        upload_uniform(ENTRY_Uniform1i, location, &value, sizeof(value));
+        if(GLCapture::active())
+            capture(TRACE_UNIFORM_1I, location, value);
+        driver.Uniform1i(location, value);
+    }
+
+    void GLAPIENTRY hook_Uniform1f(GLint location, GLfloat value)
+    {
+        count(ENTRY_Uniform1f);
+        upload_uniform(ENTRY_Uniform1f, location, &value, sizeof(value));
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_UNIFORM_1F);
+            command.put(location);
+            command.put(value);
+        }
+        driver.Uniform1f(location, value);
+    }
+
+    void GLAPIENTRY hook_Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z)
+    {
+        count(ENTRY_Uniform3f);
+        GLfloat value[3] = { x, y, z };
+        upload_uniform(ENTRY_Uniform3f, location, value, sizeof(value));
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_UNIFORM_3F);
+            command.put(location);
+            command.put(value);
+        }
+        driver.Uniform3f(location, x, y, z);
+    }
+
+    void GLAPIENTRY hook_Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+    {
+        count(ENTRY_Uniform4f);
+        GLfloat value[4] = { x, y, z, w };
+        upload_uniform(ENTRY_Uniform4f, location, value, sizeof(value));
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_UNIFORM_4F);
+            command.put(location);
+            command.put(value);
+        }
+        driver.Uniform4f(location, x, y, z, w);
+    }
+
+    void GLAPIENTRY hook_UniformMatrix4fv(GLint location, GLsizei count_, GLboolean transpose, const GLfloat* value)
+    {
+        count(ENTRY_UniformMatrix4fv);
+        upload_uniform(ENTRY_UniformMatrix4fv, location, value, count_ * 16 * sizeof(GLfloat));
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_UNIFORM_MATRIX_4FV);
+            command.put(location);
+            command.put(count_);
+            command.put((uint32_t)transpose);
+            command.put_bytes(value, count_ * 16 * sizeof(GLfloat));
+        }
+        driver.UniformMatrix4fv(location, count_, transpose, value);
+    }
+
+    // The remaining array and matrix uploads, issued by copy_uniforms on hot reload
+#define GL_INTERCEPT_UNIFORM_VECTOR(name, type, components, opcode) \
+    void GLAPIENTRY hook_##name(GLint location, GLsizei count_, const type* value) \
+    { \
+        count(ENTRY_##name); \
+        size_t size = count_ > 0 ? count_ * components * sizeof(type) : 0; \
+        upload_uniform(ENTRY_##name, location, value, size); \
+        if(GLCapture::active()) \
+        { \
+            GLCapture::Command command(opcode); \
+            command.put(location); \
+            command.put(count_); \
+            command.put_bytes(value, size); \
+        } \
+        driver.name(location, count_, value); \
+    }
+
+#define GL_INTERCEPT_UNIFORM_MATRIX(name, components, opcode) \
+    void GLAPIENTRY hook_##name(GLint location, GLsizei count_, GLboolean transpose, const GLfloat* value) \
+    { \
+        count(ENTRY_##name); \
+        size_t size = count_ > 0 ? count_ * components * sizeof(GLfloat) : 0; \
+        upload_uniform(ENTRY_##name, location, value, size); \
+        if(GLCapture::active()) \
+        { \
+            GLCapture::Command command(opcode); \
+            command.put(location); \
+            command.put(count_); \
+            command.put((uint32_t)transpose); \
+            command.put_bytes(value, size); \
+        } \
+        driver.name(location, count_, transpose, value); \
+    }
+
+    GL_TRACE_UNIFORM_VECTORS(GL_INTERCEPT_UNIFORM_VECTOR)
+    GL_TRACE_UNIFORM_MATRICES(GL_INTERCEPT_UNIFORM_MATRIX)
+#undef GL_INTERCEPT_UNIFORM_VECTOR
+#undef GL_INTERCEPT_UNIFORM_MATRIX
+
+    void GLAPIENTRY hook_GenVertexArrays(GLsizei n, GLuint* arrays)
+    {
+        count(ENTRY_GenVertexArrays);
+        driver.GenVertexArrays(n, arrays);
+        if(GLCapture::active())
+            capture_names(TRACE_GEN_VERTEX_ARRAYS, n, arrays);
+    }
+
+    void GLAPIENTRY hook_DeleteVertexArrays(GLsizei n, const GLuint* arrays)
+    {
+        count(ENTRY_DeleteVertexArrays);
+        if(GLCapture::active())
+            capture_names(TRACE_DELETE_VERTEX_ARRAYS, n, arrays);
+        driver.DeleteVertexArrays(n, arrays);
+    }
+
+    void GLAPIENTRY hook_BindVertexArray(GLuint array)
+    {
+        count(ENTRY_BindVertexArray);
+        update_shadow(ENTRY_BindVertexArray, shadow.vertex_array, array);
+        // The element buffer binding belongs to the vertex array
+        shadow.buffers[BUFFER_ELEMENT] = UNKNOWN;
+        if(GLCapture::active())
+            capture(TRACE_BIND_VERTEX_ARRAY, array);
+        driver.BindVertexArray(array);
+    }
+
+    void GLAPIENTRY hook_GenBuffers(GLsizei n, GLuint* buffers)
+    {
+        count(ENTRY_GenBuffers);
+        driver.GenBuffers(n, buffers);
+        if(GLCapture::active())
+            capture_names(TRACE_GEN_BUFFERS, n, buffers);
+    }
+
+    void GLAPIENTRY hook_DeleteBuffers(GLsizei n, const GLuint* buffers)
+    {
+        count(ENTRY_DeleteBuffers);
+        if(GLCapture::active())
+            capture_names(TRACE_DELETE_BUFFERS, n, buffers);
+        driver.DeleteBuffers(n, buffers);
+    }
+
+    void GLAPIENTRY hook_BindBuffer(GLenum target, GLuint buffer)
+    {
+        count(ENTRY_BindBuffer);
+        GLuint* slot = buffer_slot(target);
+        if(slot)
+            update_shadow(ENTRY_BindBuffer, *slot, buffer);
+        if(GLCapture::active())
+            capture(TRACE_BIND_BUFFER, target, buffer);
+        driver.BindBuffer(target, buffer);
+    }
+
+    void GLAPIENTRY hook_BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+    {
+        count(ENTRY_BufferData);
+        if(data)
+            current.buffer_bytes += size;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_BUFFER_DATA);
+            command.put(target);
+            command.put(usage);
+            command.put((uint64_t)size);
+            command.put_blob(data, data ? size : 0);
+        }
+        driver.BufferData(target, size, data, usage);
+    }
+
+    void GLAPIENTRY hook_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        count(ENTRY_BufferSubData);
+        current.buffer_bytes += size;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_BUFFER_SUB_DATA);
+            command.put(target);
+            command.put((uint64_t)offset);
+            command.put_blob(data, size);
+        }
+        driver.BufferSubData(target, offset, size, data);
+    }
+
+    void GLAPIENTRY hook_BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+    {
+        count(ENTRY_BindBufferBase);
+        // Also binds the generic target
+        GLuint* slot = buffer_slot(target);
+        if(slot)
+            *slot = buffer;
+        if(GLCapture::active())
+            capture(TRACE_BIND_BUFFER_BASE, target, index, buffer);
+        driver.BindBufferBase(target, index, buffer);
+    }
+
+    GLuint GLAPIENTRY hook_GetUniformBlockIndex(GLuint program, const GLchar* name)
+    {
+        count(ENTRY_GetUniformBlockIndex);
+        GLuint index = driver.GetUniformBlockIndex(program, name);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_GET_UNIFORM_BLOCK_INDEX);
+            command.put(program);
+            command.put(index);
+            command.put_blob(name, strlen(name));
+        }
+        return index;
+    }
+
+    void GLAPIENTRY hook_UniformBlockBinding(GLuint program, GLuint index, GLuint binding)
+    {
+        count(ENTRY_UniformBlockBinding);
+        if(GLCapture::active())
+            capture(TRACE_UNIFORM_BLOCK_BINDING, program, index, binding);
+        driver.UniformBlockBinding(program, index, binding);
+    }
+
+    void GLAPIENTRY hook_VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+    {
+        count(ENTRY_VertexAttribPointer);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_VERTEX_ATTRIB_POINTER);
+            command.put(index);
+            command.put(size);
+            command.put(type);
+            command.put((uint32_t)normalized);
+            command.put(stride);
+            command.put((uint64_t)(uintptr_t)pointer);
+        }
+        driver.VertexAttribPointer(index, size, type, normalized, stride, pointer);
+    }
+
+    void GLAPIENTRY hook_VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer)
+    {
+        count(ENTRY_VertexAttribIPointer);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_VERTEX_ATTRIB_I_POINTER);
+            command.put(index);
+            command.put(size);
+            command.put(type);
+            command.put(stride);
+            command.put((uint64_t)(uintptr_t)pointer);
+        }
+        driver.VertexAttribIPointer(index, size, type, stride, pointer);
+    }
+
+    void GLAPIENTRY hook_EnableVertexAttribArray(GLuint index)
+    {
+        count(ENTRY_EnableVertexAttribArray);
+        if(GLCapture::active())
+            capture(TRACE_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+        driver.EnableVertexAttribArray(index);
+    }
+
+    void GLAPIENTRY hook_GenFramebuffers(GLsizei n, GLuint* framebuffers)
+    {
+        count(ENTRY_GenFramebuffers);
+        driver.GenFramebuffers(n, framebuffers);
+        if(GLCapture::active())
+            capture_names(TRACE_GEN_FRAMEBUFFERS, n, framebuffers);
+    }
+
+    void GLAPIENTRY hook_DeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+    {
+        count(ENTRY_DeleteFramebuffers);
+        if(GLCapture::active())
+            capture_names(TRACE_DELETE_FRAMEBUFFERS, n, framebuffers);
+        driver.DeleteFramebuffers(n, framebuffers);
+    }
+
+    void GLAPIENTRY hook_BindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        count(ENTRY_BindFramebuffer);
+        if(target == GL_FRAMEBUFFER)
+        {
+            if(shadow.draw_framebuffer == framebuffer && shadow.read_framebuffer == framebuffer)
+                current.redundant[ENTRY_BindFramebuffer]++;
+            shadow.draw_framebuffer = framebuffer;
+            shadow.read_framebuffer = framebuffer;
+        }
+        else if(target == GL_DRAW_FRAMEBUFFER)
+            update_shadow(ENTRY_BindFramebuffer, shadow.draw_framebuffer, framebuffer);
+        else if(target == GL_READ_FRAMEBUFFER)
+            update_shadow(ENTRY_BindFramebuffer, shadow.read_framebuffer, framebuffer);
+        if(GLCapture::active())
+            capture(TRACE_BIND_FRAMEBUFFER, target, framebuffer);
+        driver.BindFramebuffer(target, framebuffer);
+    }
+
+    void GLAPIENTRY hook_FramebufferTexture2D(GLenum target, GLenum attachment, GLenum texture_target, GLuint texture, GLint level)
+    {
+        count(ENTRY_FramebufferTexture2D);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_FRAMEBUFFER_TEXTURE_2D);
+            command.put(target);
+            command.put(attachment);
+            command.put(texture_target);
+            command.put(texture);
+            command.put(level);
+        }
+        driver.FramebufferTexture2D(target, attachment, texture_target, texture, level);
+    }
+
+    void GLAPIENTRY hook_BlitFramebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1,
+        GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1, GLbitfield mask, GLenum filter)
+    {
+        count(ENTRY_BlitFramebuffer);
+        if(GLCapture::active())
+        {
+            GLint rects[8] = { src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1 };
+            GLCapture::Command command(TRACE_BLIT_FRAMEBUFFER);
+            command.put(rects);
+            command.put(mask);
+            command.put(filter);
+        }
+        driver.BlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1, mask, filter);
+    }
+
+    void GLAPIENTRY hook_ClipControl(GLenum origin, GLenum depth)
+    {
+        count(ENTRY_ClipControl);
+        if(GLCapture::active())
+            capture(TRACE_CLIP_CONTROL, origin, depth);
+        driver.ClipControl(origin, depth);
+    }
+
+    void GLAPIENTRY hook_DrawElementsBaseVertex(GLenum mode, GLsizei count_, GLenum type, const void* indices, GLint base_vertex)
+    {
+        count(ENTRY_DrawElementsBaseVertex);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_DRAW_ELEMENTS_BASE_VERTEX);
+            command.put(mode);
+            command.put(count_);
+            command.put(type);
+            command.put((uint64_t)(uintptr_t)indices);
+            command.put(base_vertex);
+        }
+        driver.DrawElementsBaseVertex(mode, count_, type, indices, base_vertex);
+    }
+
+    // Direct state access hooks. Edits by name leave the bindings alone.
+
+    void GLAPIENTRY hook_CreateBuffers(GLsizei n, GLuint* buffers)
+    {
+        count(ENTRY_CreateBuffers);
+        driver.CreateBuffers(n, buffers);
+        if(GLCapture::active())
+            capture_names(TRACE_CREATE_BUFFERS, n, buffers);
+    }
+
+    void GLAPIENTRY hook_NamedBufferStorage(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags)
+    {
+        count(ENTRY_NamedBufferStorage);
+        if(data)
+            current.buffer_bytes += size;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_NAMED_BUFFER_STORAGE);
+            command.put(buffer);
+            command.put(flags);
+            command.put((uint64_t)size);
+            command.put_blob(data, data ? size : 0);
+        }
+        driver.NamedBufferStorage(buffer, size, data, flags);
+    }
+
+    void GLAPIENTRY hook_NamedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage)
+    {
+        count(ENTRY_NamedBufferData);
+        if(data)
+            current.buffer_bytes += size;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_NAMED_BUFFER_DATA);
+            command.put(buffer);
+            command.put(usage);
+            command.put((uint64_t)size);
+            command.put_blob(data, data ? size : 0);
+        }
+        driver.NamedBufferData(buffer, size, data, usage);
+    }
+
+    void GLAPIENTRY hook_NamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        count(ENTRY_NamedBufferSubData);
+        current.buffer_bytes += size;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_NAMED_BUFFER_SUB_DATA);
+            command.put(buffer);
+            command.put((uint64_t)offset);
+            command.put_blob(data, size);
+        }
+        driver.NamedBufferSubData(buffer, offset, size, data);
+    }
+
+    void GLAPIENTRY hook_CreateTextures(GLenum target, GLsizei n, GLuint* textures)
+    {
+        count(ENTRY_CreateTextures);
+        driver.CreateTextures(target, n, textures);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_CREATE_TEXTURES);
+            command.put(target);
+            command.put((uint32_t)n);
+            command.put_bytes(textures, n * sizeof(GLuint));
+        }
+    }
+
+    void GLAPIENTRY hook_TextureStorage2D(GLuint texture, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height)
+    {
+        count(ENTRY_TextureStorage2D);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEXTURE_STORAGE_2D);
+            command.put(texture);
+            command.put(levels);
+            command.put(internal_format);
+            command.put(width);
+            command.put(height);
+        }
+        driver.TextureStorage2D(texture, levels, internal_format, width, height);
+    }
+
+    void GLAPIENTRY hook_TextureStorage3D(GLuint texture, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height, GLsizei depth)
+    {
+        count(ENTRY_TextureStorage3D);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEXTURE_STORAGE_3D);
+            command.put(texture);
+            command.put(levels);
+            command.put(internal_format);
+            command.put(width);
+            command.put(height);
+            command.put(depth);
+        }
+        driver.TextureStorage3D(texture, levels, internal_format, width, height, depth);
+    }
+
+    void GLAPIENTRY hook_TextureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+    {
+        count(ENTRY_TextureSubImage2D);
+        unsigned long long bytes = pixels ? image_bytes(width, height, format, type) : 0;
+        current.texture_bytes += bytes;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEXTURE_SUB_IMAGE_2D);
+            command.put(texture);
+            command.put(level);
+            command.put(x);
+            command.put(y);
+            command.put(width);
+            command.put(height);
+            command.put(format);
+            command.put(type);
+            command.put_blob(pixels, bytes);
+        }
+        driver.TextureSubImage2D(texture, level, x, y, width, height, format, type, pixels);
+    }
+
+    void GLAPIENTRY hook_TextureSubImage3D(GLuint texture, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+    {
+        count(ENTRY_TextureSubImage3D);
+        unsigned long long bytes = pixels ? image_bytes(width, height * depth, format, type) : 0;
+        current.texture_bytes += bytes;
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_TEXTURE_SUB_IMAGE_3D);
+            command.put(texture);
+            command.put(level);
+            command.put(x);
+            command.put(y);
+            command.put(z);
+            command.put(width);
+            command.put(height);
+            command.put(depth);
+            command.put(format);
+            command.put(type);
+            command.put_blob(pixels, bytes);
+        }
+        driver.TextureSubImage3D(texture, level, x, y, z, width, height, depth, format, type, pixels);
+    }
+
+    void GLAPIENTRY hook_TextureParameteri(GLuint texture, GLenum name, GLint param)
+    {
+        count(ENTRY_TextureParameteri);
+        if(GLCapture::active())
+            capture(TRACE_TEXTURE_PARAMETERI, texture, name, param);
+        driver.TextureParameteri(texture, name, param);
+    }
+
+    void GLAPIENTRY hook_GenerateTextureMipmap(GLuint texture)
+    {
+        count(ENTRY_GenerateTextureMipmap);
+        if(GLCapture::active())
+            capture(TRACE_GENERATE_TEXTURE_MIPMAP, texture);
+        driver.GenerateTextureMipmap(texture);
+    }
+
+    void GLAPIENTRY hook_BindTextureUnit(GLuint unit, GLuint texture)
+    {
+        count(ENTRY_BindTextureUnit);
+        // Binds to the texture's own target, which isn't known here. Zero unbinds every target.
+        if(unit < MAX_TEXTURE_UNITS)
+            for(unsigned int target = 0; target < TEXTURE_TARGET_COUNT; target++)
+                shadow.textures[unit][target] = texture ? UNKNOWN : 0;
+        if(GLCapture::active())
+            capture(TRACE_BIND_TEXTURE_UNIT, unit, texture);
+        driver.BindTextureUnit(unit, texture);
+    }
+
+    void GLAPIENTRY hook_CreateVertexArrays(GLsizei n, GLuint* arrays)
+    {
+        count(ENTRY_CreateVertexArrays);
+        driver.CreateVertexArrays(n, arrays);
+        if(GLCapture::active())
+            capture_names(TRACE_CREATE_VERTEX_ARRAYS, n, arrays);
+    }
+
+    void GLAPIENTRY hook_EnableVertexArrayAttrib(GLuint vao, GLuint index)
+    {
+        count(ENTRY_EnableVertexArrayAttrib);
+        if(GLCapture::active())
+            capture(TRACE_ENABLE_VERTEX_ARRAY_ATTRIB, vao, index);
+        driver.EnableVertexArrayAttrib(vao, index);
+    }
+
+    void GLAPIENTRY hook_VertexArrayVertexBuffer(GLuint vao, GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride)
+    {
+        count(ENTRY_VertexArrayVertexBuffer);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_VERTEX_ARRAY_VERTEX_BUFFER);
+            command.put(vao);
+            command.put(binding);
+            command.put(buffer);
+            command.put((uint64_t)offset);
+            command.put(stride);
+        }
+        driver.VertexArrayVertexBuffer(vao, binding, buffer, offset, stride);
+    }
+
+    void GLAPIENTRY hook_VertexArrayAttribFormat(GLuint vao, GLuint index, GLint size, GLenum type, GLboolean normalized, GLuint relative_offset)
+    {
+        count(ENTRY_VertexArrayAttribFormat);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_VERTEX_ARRAY_ATTRIB_FORMAT);
+            command.put(vao);
+            command.put(index);
+            command.put(size);
+            command.put(type);
+            command.put((uint32_t)normalized);
+            command.put(relative_offset);
+        }
+        driver.VertexArrayAttribFormat(vao, index, size, type, normalized, relative_offset);
+    }
+
+    void GLAPIENTRY hook_VertexArrayAttribIFormat(GLuint vao, GLuint index, GLint size, GLenum type, GLuint relative_offset)
+    {
+        count(ENTRY_VertexArrayAttribIFormat);
+        if(GLCapture::active())
+        {
+            GLCapture::Command command(TRACE_VERTEX_ARRAY_ATTRIB_I_FORMAT);
+            command.put(vao);
+            command.put(index);
+            command.put(size);
+            command.put(type);
+            command.put(relative_offset);
+        }
+        driver.VertexArrayAttribIFormat(vao, index, size, type, relative_offset);
+    }
+
+    void GLAPIENTRY hook_VertexArrayAttribBinding(GLuint vao, GLuint index, GLuint binding)
+    {
+        count(ENTRY_VertexArrayAttribBinding);
+        if(GLCapture::active())
+            capture(TRACE_VERTEX_ARRAY_ATTRIB_BINDING, vao, index, binding);
+        driver.VertexArrayAttribBinding(vao, index, binding);
+    }
+
+    void GLAPIENTRY hook_VertexArrayElementBuffer(GLuint vao, GLuint buffer)
+    {
+        count(ENTRY_VertexArrayElementBuffer);
+        // Changes the element binding too if vao is the bound array
+        if(vao == shadow.vertex_array)
+            shadow.buffers[BUFFER_ELEMENT] = buffer;
+        if(GLCapture::active())
+            capture(TRACE_VERTEX_ARRAY_ELEMENT_BUFFER, vao, buffer);
+        driver.VertexArrayElementBuffer(vao, buffer);
+    }
+
+#define GL_INTERCEPT_SWAP_GLEW(name) driver.name = __glew##name; __glew##name = hook_##name;
+#define GL_INTERCEPT_RESTORE_GLEW(name) __glew##name = driver.name;
+#define GL_INTERCEPT_GLEW_HOOKS(X) \
+    X(ActiveTexture) X(TexImage3D) X(TexSubImage3D) X(TexStorage2D) X(TexStorage3D) X(GenerateMipmap) \
+    X(CreateShader) X(ShaderSource) X(CompileShader) X(DeleteShader) \
+    X(CreateProgram) X(AttachShader) X(LinkProgram) X(DeleteProgram) \
+    X(UseProgram) X(GetUniformLocation) \
+    X(Uniform1i) X(Uniform1f) X(Uniform3f) X(Uniform4f) X(UniformMatrix4fv) \
+    X(Uniform1fv) X(Uniform2fv) X(Uniform3fv) X(Uniform4fv) \
+    X(Uniform1iv) X(Uniform2iv) X(Uniform3iv) X(Uniform4iv) \
+    X(Uniform1uiv) X(Uniform2uiv) X(Uniform3uiv) X(Uniform4uiv) \
+    X(UniformMatrix2fv) X(UniformMatrix3fv) X(UniformMatrix2x3fv) X(UniformMatrix3x2fv) \
+    X(UniformMatrix2x4fv) X(UniformMatrix4x2fv) X(UniformMatrix3x4fv) X(UniformMatrix4x3fv) \
+    X(GenVertexArrays) X(DeleteVertexArrays) X(BindVertexArray) \
+    X(GenBuffers) X(DeleteBuffers) X(BindBuffer) X(BufferData) X(BufferSubData) \
+    X(BindBufferBase) X(GetUniformBlockIndex) X(UniformBlockBinding) \
+    X(VertexAttribPointer) X(VertexAttribIPointer) X(EnableVertexAttribArray) \
+    X(GenFramebuffers) X(DeleteFramebuffers) X(BindFramebuffer) X(FramebufferTexture2D) \
+    X(BlitFramebuffer) X(ClipControl) X(DrawElementsBaseVertex) \
+    X(CreateBuffers) X(NamedBufferStorage) X(NamedBufferData) X(NamedBufferSubData) \
+    X(CreateTextures) X(TextureStorage2D) X(TextureStorage3D) X(TextureSubImage2D) X(TextureSubImage3D) \
+    X(TextureParameteri) X(GenerateTextureMipmap) X(BindTextureUnit) \
+    X(CreateVertexArrays) X(EnableVertexArrayAttrib) X(VertexArrayVertexBuffer) \
+    X(VertexArrayAttribFormat) X(VertexArrayAttribIFormat) X(VertexArrayAttribBinding) X(VertexArrayElementBuffer)
+
+    void accumulate(FrameStats &into, const FrameStats &frame)
+    {
+        for(unsigned int i = 0; i < ENTRY_POINT_COUNT; i++)
+        {
+            into.calls[i] += frame.calls[i];
+            into.redundant[i] += frame.redundant[i];
+        }
+        into.buffer_bytes += frame.buffer_bytes;
+        into.texture_bytes += frame.texture_bytes;
+        into.uniform_bytes += frame.uniform_bytes;
+    }
+
+    // Entry points ordered by call count, most called first
+    void sort_entry_points(const FrameStats &stats, unsigned int* order)
+    {
+        for(unsigned int i = 0; i < ENTRY_POINT_COUNT; i++)
+            order[i] = i;
+        std::stable_sort(order, order + ENTRY_POINT_COUNT, [&stats](unsigned int a, unsigned int b)
+        {
+            return stats.calls[a] > stats.calls[b];
+        });
+    }
+}
+
+// What the interposers in gl_interpose.cpp call, the hooks while installed
+GLIntercept::CoreTable GLIntercept::core = driver_core;
+
+void GLIntercept::install_hooks()
+{
+    if(hook_users++ > 0)
+        return;
+    GL_INTERCEPT_GLEW_HOOKS(GL_INTERCEPT_SWAP_GLEW)
+
+    core.GenTextures = hook_GenTextures;
+    core.DeleteTextures = hook_DeleteTextures;
+    core.BindTexture = hook_BindTexture;
+    core.TexParameteri = hook_TexParameteri;
+    core.TexImage2D = hook_TexImage2D;
+    core.TexSubImage2D = hook_TexSubImage2D;
+    core.Enable = hook_Enable;
+    core.Disable = hook_Disable;
+    core.Clear = hook_Clear;
+    core.ClearColor = hook_ClearColor;
+    core.ClearDepth = hook_ClearDepth;
+    core.DepthFunc = hook_DepthFunc;
+    core.Viewport = hook_Viewport;
+    core.DrawArrays = hook_DrawArrays;
+    core.DrawElements = hook_DrawElements;
+}
+
+void GLIntercept::remove_hooks()
+{
+    if(hook_users == 0 || --hook_users > 0)
+        return;
+    GL_INTERCEPT_GLEW_HOOKS(GL_INTERCEPT_RESTORE_GLEW)
+    core = driver_core;
+}
+
+void GLIntercept::enable_stats()
+{
+    if(stats_active)
+        return;
+    reset_shadow();
+    memset(&current, 0, sizeof(current));
+    memset(&last, 0, sizeof(last));
+    memset(&interval, 0, sizeof(interval));
+    memset(&total, 0, sizeof(total));
+    interval_frames = 0;
+    total_frames = 0;
+    stats_active = true;
+    if(!core_interposed())
+        printf("WARNING::GL_INTERCEPT::CORE_NOT_INTERPOSED GL 1.1 calls are not counted, build with make INTERCEPT=1\n");
+    install_hooks();
+}
+
+void GLIntercept::disable_stats()
+{
+    if(!stats_active)
+        return;
+    stats_active = false;
+    remove_hooks();
+}
+
+bool GLIntercept::stats_enabled()
+{
+    return stats_active;
+}
+
+void GLIntercept::end_frame()
+{
+    if(!stats_active)
+        return;
+    accumulate(interval, current);
+    accumulate(total, current);
+    interval_frames++;
+    total_frames++;
+    last = current;
+    memset(&current, 0, sizeof(current));
+}
+
+const FrameStats& GLIntercept::last_frame()
+{
+    return last;
+}
+
+void GLIntercept::print_report(unsigned int top_n)
+{
+    if(interval_frames == 0)
+        return;
+
+    unsigned int order[ENTRY_POINT_COUNT];
+    sort_entry_points(interval, order);
+
+    double frames = (double)interval_frames;
+    printf("GL calls per frame over %llu frames:\n", interval_frames);
+    for(unsigned int i = 0; i < top_n && i < ENTRY_POINT_COUNT; i++)
+    {
+        unsigned int entry = order[i];
+        if(interval.calls[entry] == 0)
+            break;
+        printf("  %-28s %10.1f calls %10.1f redundant\n", entry_point_names[entry],
+            interval.calls[entry] / frames, interval.redundant[entry] / frames);
+    }
+    printf("  uploaded per frame: buffers %.0f B, textures %.0f B, uniforms %.0f B\n",
+        interval.buffer_bytes / frames, interval.texture_bytes / frames, interval.uniform_bytes / frames);
+
+    memset(&interval, 0, sizeof(interval));
+    interval_frames = 0;
+}
+
+bool GLIntercept::write_json(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if(!file)
+    {
+        printf("ERROR::GL_INTERCEPT::FAILED_TO_OPEN %s\n", path);
+        return false;
+    }
+
+    unsigned int order[ENTRY_POINT_COUNT];
+    sort_entry_points(total, order);
+    double frames = total_frames ? (double)total_frames : 1.0;
+
+    fprintf(file, "{\n  \"frames\": %llu,\n  \"entry_points\": [", total_frames);
+    bool first = true;
+    for(unsigned int i = 0; i < ENTRY_POINT_COUNT; i++)
+    {
+        unsigned int entry = order[i];
+        if(total.calls[entry] == 0)
+            break;
+        fprintf(file, "%s\n    { \"name\": \"%s\", \"calls\": %llu, \"calls_per_frame\": %.3f, \"redundant_per_frame\": %.3f }",
+            first ? "" : ",", entry_point_names[entry], total.calls[entry],
+            total.calls[entry] / frames, total.redundant[entry] / frames);
+        first = false;
+    }
+    fprintf(file, "\n  ],\n");
+    fprintf(file, "  \"buffer_bytes_per_frame\": %.1f,\n", total.buffer_bytes / frames);
+    fprintf(file, "  \"texture_bytes_per_frame\": %.1f,\n", total.texture_bytes / frames);
+    fprintf(file, "  \"uniform_bytes_per_frame\": %.1f\n}\n", total.uniform_bytes / frames);
+    fclose(file);
+    return true;
+}
+
+bool GLIntercept::core_interposed()
+{
+    return &interposer_linked != NULL;
+}
+
+const char* GLIntercept::entry_point_name(EntryPoint entry)
+{
+    return entry_point_names[entry];
+}
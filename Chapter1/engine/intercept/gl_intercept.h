@@ -0,0 +1,155 @@
+#ifndef GL_INTERCEPT_H
+#define GL_INTERCEPT_H
+
+#include <GL/glew.h>
+
+// Thin interception layer over the GL entry points the renderer issues.
+//
+// Hooks are installed at runtime by swapping GLEW's function pointers, so while
+// the layer is disabled every call goes straight to the driver. The GL 1.1
+// entry points GLEW links directly (glBindTexture, glDrawArrays, ...) can only
+// be hooked by programs linking gl_interpose.o as well (make INTERCEPT=1),
+// which then forward them through a pointer. Other builds call libGL for
+// them directly and the hooks never see them.
+
+#define GL_INTERCEPT_ENTRY_POINTS(X) \
+    X(ActiveTexture) \
+    X(GenTextures) \
+    X(DeleteTextures) \
+    X(BindTexture) \
+    X(TexParameteri) \
+    X(TexImage2D) \
+    X(TexSubImage2D) \
+    X(TexImage3D) \
+    X(TexSubImage3D) \
+    X(TexStorage2D) \
+    X(TexStorage3D) \
+    X(GenerateMipmap) \
+    X(CreateShader) \
+    X(ShaderSource) \
+    X(CompileShader) \
+    X(DeleteShader) \
+    X(CreateProgram) \
+    X(AttachShader) \
+    X(LinkProgram) \
+    X(DeleteProgram) \
+    X(UseProgram) \
+    X(GetUniformLocation) \
+    X(Uniform1i) \
+    X(Uniform1f) \
+    X(Uniform3f) \
+    X(Uniform4f) \
+    X(UniformMatrix4fv) \
+    X(Uniform1fv) \
+    X(Uniform2fv) \
+    X(Uniform3fv) \
+    X(Uniform4fv) \
+    X(Uniform1iv) \
+    X(Uniform2iv) \
+    X(Uniform3iv) \
+    X(Uniform4iv) \
+    X(Uniform1uiv) \
+    X(Uniform2uiv) \
+    X(Uniform3uiv) \
+    X(Uniform4uiv) \
+    X(UniformMatrix2fv) \
+    X(UniformMatrix3fv) \
+    X(UniformMatrix2x3fv) \
+    X(UniformMatrix3x2fv) \
+    X(UniformMatrix2x4fv) \
+    X(UniformMatrix4x2fv) \
+    X(UniformMatrix3x4fv) \
+    X(UniformMatrix4x3fv) \
+    X(GenVertexArrays) \
+    X(DeleteVertexArrays) \
+    X(BindVertexArray) \
+    X(GenBuffers) \
+    X(DeleteBuffers) \
+    X(BindBuffer) \
+    X(BufferData) \
+    X(BufferSubData) \
+    X(BindBufferBase) \
+    X(GetUniformBlockIndex) \
+    X(UniformBlockBinding) \
+    X(VertexAttribPointer) \
+    X(VertexAttribIPointer) \
+    X(EnableVertexAttribArray) \
+    X(GenFramebuffers) \
+    X(DeleteFramebuffers) \
+    X(BindFramebuffer) \
+    X(FramebufferTexture2D) \
+    X(BlitFramebuffer) \
+    X(ClipControl) \
+    X(DepthFunc) \
+    X(ClearDepth) \
+    X(Enable) \
+    X(Disable) \
+    X(Clear) \
+    X(ClearColor) \
+    X(Viewport) \
+    X(DrawArrays) \
+    X(DrawElements) \
+    X(DrawElementsBaseVertex) \
+    X(CreateBuffers) \
+    X(NamedBufferStorage) \
+    X(NamedBufferData) \
+    X(NamedBufferSubData) \
+    X(CreateTextures) \
+    X(TextureStorage2D) \
+    X(TextureStorage3D) \
+    X(TextureSubImage2D) \
+    X(TextureSubImage3D) \
+    X(TextureParameteri) \
+    X(GenerateTextureMipmap) \
+    X(BindTextureUnit) \
+    X(CreateVertexArrays) \
+    X(EnableVertexArrayAttrib) \
+    X(VertexArrayVertexBuffer) \
+    X(VertexArrayAttribFormat) \
+    X(VertexArrayAttribIFormat) \
+    X(VertexArrayAttribBinding) \
+    X(VertexArrayElementBuffer)
+
+namespace GLIntercept
+{
+#define GL_INTERCEPT_ENUM(name) ENTRY_##name,
+    enum EntryPoint
+    {
+        GL_INTERCEPT_ENTRY_POINTS(GL_INTERCEPT_ENUM)
+        ENTRY_POINT_COUNT
+    };
+#undef GL_INTERCEPT_ENUM
+
+    struct FrameStats
+    {
+        unsigned long long calls[ENTRY_POINT_COUNT];
+        unsigned long long redundant[ENTRY_POINT_COUNT]; // State set to the value it already had
+        unsigned long long buffer_bytes;
+        unsigned long long texture_bytes;
+        unsigned long long uniform_bytes;
+    };
+
+    // Hooks stay installed while any user (stats, GLCapture) holds them.
+    // Must be called after glewInit().
+    void install_hooks();
+    void remove_hooks();
+    // Whether the GL 1.1 entry points reach the hooks, see above
+    bool core_interposed();
+
+    void enable_stats();
+    void disable_stats();
+    bool stats_enabled();
+
+    // Closes the current frame's counters
+    void end_frame();
+    const FrameStats& last_frame();
+
+    // Prints the top_n entry points by calls per frame since the previous report
+    void print_report(unsigned int top_n);
+    // Writes per-frame averages over the whole run as JSON
+    bool write_json(const char* path);
+
+    const char* entry_point_name(EntryPoint entry);
+}
+
+#endif // GL_INTERCEPT_H
@@ -0,0 +1,33 @@
+#include "gl_interpose.h"
+
+using namespace GLIntercept;
+
+const bool GLIntercept::interposer_linked = true;
+
+// Interposed GL 1.1 entry points. The executable's definitions take precedence
+// over libGL's, the driver is reached through GLIntercept::core.
+
+extern "C"
+{
+    void GLAPIENTRY glGenTextures(GLsizei n, GLuint* textures) { core.GenTextures(n, textures); }
+    void GLAPIENTRY glDeleteTextures(GLsizei n, const GLuint* textures) { core.DeleteTextures(n, textures); }
+    void GLAPIENTRY glBindTexture(GLenum target, GLuint texture) { core.BindTexture(target, texture); }
+    void GLAPIENTRY glTexParameteri(GLenum target, GLenum name, GLint param) { core.TexParameteri(target, name, param); }
+    void GLAPIENTRY glTexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+    {
+        core.TexImage2D(target, level, internal_format, width, height, border, format, type, pixels);
+    }
+    void GLAPIENTRY glTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+    {
+        core.TexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+    }
+    void GLAPIENTRY glEnable(GLenum cap) { core.Enable(cap); }
+    void GLAPIENTRY glDisable(GLenum cap) { core.Disable(cap); }
+    void GLAPIENTRY glClear(GLbitfield mask) { core.Clear(mask); }
+    void GLAPIENTRY glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) { core.ClearColor(red, green, blue, alpha); }
+    void GLAPIENTRY glClearDepth(GLdouble depth) { core.ClearDepth(depth); }
+    void GLAPIENTRY glDepthFunc(GLenum func) { core.DepthFunc(func); }
+    void GLAPIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height) { core.Viewport(x, y, width, height); }
+    void GLAPIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) { core.DrawArrays(mode, first, count); }
+    void GLAPIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) { core.DrawElements(mode, count, type, indices); }
+}
@@ -0,0 +1,58 @@
+#ifndef GL_INTERPOSE_H
+#define GL_INTERPOSE_H
+
+#include <GL/glew.h>
+
+// Shared by gl_intercept.cpp and gl_interpose.cpp, not for programs.
+//
+// GLEW links the GL 1.1 entry points straight to libGL, so the only way to
+// hook them is for the program to define them itself. gl_interpose.cpp does
+// that, and is a separate object rather than part of libgl_intercept.a: from
+// the archive the linker would pull it into every program calling glClear.
+// Programs link it only when built for interception (make INTERCEPT=1), the
+// rest call libGL directly.
+namespace GLIntercept
+{
+    // GL 1.1 entry points are exported by libGL and not loaded by GLEW
+    typedef void (GLAPIENTRY *GenTexturesProc)(GLsizei, GLuint*);
+    typedef void (GLAPIENTRY *DeleteTexturesProc)(GLsizei, const GLuint*);
+    typedef void (GLAPIENTRY *BindTextureProc)(GLenum, GLuint);
+    typedef void (GLAPIENTRY *TexParameteriProc)(GLenum, GLenum, GLint);
+    typedef void (GLAPIENTRY *TexImage2DProc)(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*);
+    typedef void (GLAPIENTRY *TexSubImage2DProc)(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*);
+    typedef void (GLAPIENTRY *EnableProc)(GLenum);
+    typedef void (GLAPIENTRY *ClearProc)(GLbitfield);
+    typedef void (GLAPIENTRY *ClearColorProc)(GLfloat, GLfloat, GLfloat, GLfloat);
+    typedef void (GLAPIENTRY *ClearDepthProc)(GLdouble);
+    typedef void (GLAPIENTRY *DepthFuncProc)(GLenum);
+    typedef void (GLAPIENTRY *ViewportProc)(GLint, GLint, GLsizei, GLsizei);
+    typedef void (GLAPIENTRY *DrawArraysProc)(GLenum, GLint, GLsizei);
+    typedef void (GLAPIENTRY *DrawElementsProc)(GLenum, GLsizei, GLenum, const void*);
+
+    struct CoreTable
+    {
+        GenTexturesProc GenTextures;
+        DeleteTexturesProc DeleteTextures;
+        BindTextureProc BindTexture;
+        TexParameteriProc TexParameteri;
+        TexImage2DProc TexImage2D;
+        TexSubImage2DProc TexSubImage2D;
+        EnableProc Enable;
+        EnableProc Disable;
+        ClearProc Clear;
+        ClearColorProc ClearColor;
+        ClearDepthProc ClearDepth;
+        DepthFuncProc DepthFunc;
+        ViewportProc Viewport;
+        DrawArraysProc DrawArrays;
+        DrawElementsProc DrawElements;
+    };
+
+    // What the interposers call: the driver, or the hooks while installed
+    extern CoreTable core;
+
+    // Defined by gl_interpose.cpp, so its address is null without it
+    extern const bool interposer_linked __attribute__((weak));
+}
+
+#endif // GL_INTERPOSE_H
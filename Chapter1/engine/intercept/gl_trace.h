@@ -0,0 +1,157 @@
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+#include <stdint.h>
+
+// Binary GL command trace written by GLCapture and replayed by tools/gl_replay.
+//
+// The file is a TraceHeader followed by commands. Each command is a
+// TraceCommand followed by `size` payload bytes, padded to a multiple of 4.
+// Payload fields are 32-bit unless noted, in the order the GL call takes them.
+// Blobs (buffer data, pixels, strings) are stored inline as a uint32_t length
+// followed by the bytes. Object names, uniform locations and block indices are the values the
+// application saw and are remapped by the replayer.
+//
+// Everything before header.frame_offset sets up state and resources; the
+// commands from frame_offset to frame_end_offset are the captured frame.
+
+// glUniform*v and glUniformMatrix*fv other than glUniformMatrix4fv share one
+// payload: location, count, transpose (matrices only), values[components * count].
+// X(name, value type, components, opcode)
+#define GL_TRACE_UNIFORM_VECTORS(X) \
+    X(Uniform1fv, GLfloat, 1, TRACE_UNIFORM_1FV) \
+    X(Uniform2fv, GLfloat, 2, TRACE_UNIFORM_2FV) \
+    X(Uniform3fv, GLfloat, 3, TRACE_UNIFORM_3FV) \
+    X(Uniform4fv, GLfloat, 4, TRACE_UNIFORM_4FV) \
+    X(Uniform1iv, GLint, 1, TRACE_UNIFORM_1IV) \
+    X(Uniform2iv, GLint, 2, TRACE_UNIFORM_2IV) \
+    X(Uniform3iv, GLint, 3, TRACE_UNIFORM_3IV) \
+    X(Uniform4iv, GLint, 4, TRACE_UNIFORM_4IV) \
+    X(Uniform1uiv, GLuint, 1, TRACE_UNIFORM_1UIV) \
+    X(Uniform2uiv, GLuint, 2, TRACE_UNIFORM_2UIV) \
+    X(Uniform3uiv, GLuint, 3, TRACE_UNIFORM_3UIV) \
+    X(Uniform4uiv, GLuint, 4, TRACE_UNIFORM_4UIV)
+
+// X(name, components, opcode)
+#define GL_TRACE_UNIFORM_MATRICES(X) \
+    X(UniformMatrix2fv, 4, TRACE_UNIFORM_MATRIX_2FV) \
+    X(UniformMatrix3fv, 9, TRACE_UNIFORM_MATRIX_3FV) \
+    X(UniformMatrix2x3fv, 6, TRACE_UNIFORM_MATRIX_2X3FV) \
+    X(UniformMatrix3x2fv, 6, TRACE_UNIFORM_MATRIX_3X2FV) \
+    X(UniformMatrix2x4fv, 8, TRACE_UNIFORM_MATRIX_2X4FV) \
+    X(UniformMatrix4x2fv, 8, TRACE_UNIFORM_MATRIX_4X2FV) \
+    X(UniformMatrix3x4fv, 12, TRACE_UNIFORM_MATRIX_3X4FV) \
+    X(UniformMatrix4x3fv, 12, TRACE_UNIFORM_MATRIX_4X3FV)
+
+const uint32_t GL_TRACE_MAGIC = 0x52544C47; // "GLTR"
+const uint32_t GL_TRACE_VERSION = 1;
+
+struct TraceHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;               // Drawable size at capture time
+    uint32_t height;
+    uint64_t frame_offset;        // Byte offsets from the start of the file
+    uint64_t frame_end_offset;
+    uint32_t command_count;
+    uint32_t frame_command_count;
+};
+
+struct TraceCommand
+{
+    uint16_t opcode;
+    uint16_t reserved;
+    uint32_t size;
+};
+
+enum TraceOpcode
+{
+    TRACE_FRAME_END,
+    TRACE_ACTIVE_TEXTURE,
+    TRACE_GEN_TEXTURES,           // n, names[n]
+    TRACE_DELETE_TEXTURES,        // n, names[n]
+    TRACE_BIND_TEXTURE,
+    TRACE_TEX_PARAMETERI,
+    TRACE_TEX_IMAGE_2D,           // ..., pixel blob (length 0 for NULL)
+    TRACE_TEX_SUB_IMAGE_2D,
+    TRACE_GENERATE_MIPMAP,
+    TRACE_CREATE_SHADER,          // type, name
+    TRACE_SHADER_SOURCE,          // shader, source blob
+    TRACE_COMPILE_SHADER,
+    TRACE_DELETE_SHADER,
+    TRACE_CREATE_PROGRAM,         // name
+    TRACE_ATTACH_SHADER,
+    TRACE_LINK_PROGRAM,
+    TRACE_DELETE_PROGRAM,
+    TRACE_USE_PROGRAM,
+    TRACE_GET_UNIFORM_LOCATION,   // program, location, name blob
+    TRACE_UNIFORM_1I,
+    TRACE_UNIFORM_1F,
+    TRACE_UNIFORM_4F,
+    TRACE_UNIFORM_MATRIX_4FV,     // location, count, transpose, float[16 * count]
+    TRACE_GEN_VERTEX_ARRAYS,
+    TRACE_DELETE_VERTEX_ARRAYS,
+    TRACE_BIND_VERTEX_ARRAY,
+    TRACE_GEN_BUFFERS,
+    TRACE_DELETE_BUFFERS,
+    TRACE_BIND_BUFFER,
+    TRACE_BUFFER_DATA,            // target, usage, size (uint64), data blob (length 0 for NULL)
+    TRACE_BUFFER_SUB_DATA,        // target, offset (uint64), data blob
+    TRACE_VERTEX_ATTRIB_POINTER,  // index, size, type, normalized, stride, offset (uint64)
+    TRACE_ENABLE_VERTEX_ATTRIB_ARRAY,
+    TRACE_ENABLE,
+    TRACE_DISABLE,
+    TRACE_CLEAR,
+    TRACE_CLEAR_COLOR,
+    TRACE_VIEWPORT,
+    TRACE_DRAW_ARRAYS,
+    TRACE_DRAW_ELEMENTS,          // mode, count, type, offset (uint64)
+    TRACE_BIND_BUFFER_BASE,       // target, index, buffer
+    TRACE_GET_UNIFORM_BLOCK_INDEX, // program, block index, name blob
+    TRACE_UNIFORM_BLOCK_BINDING,  // program, block index, binding
+    TRACE_GEN_FRAMEBUFFERS,
+    TRACE_DELETE_FRAMEBUFFERS,
+    TRACE_BIND_FRAMEBUFFER,
+    TRACE_FRAMEBUFFER_TEXTURE_2D, // target, attachment, texture target, texture, level
+    TRACE_BLIT_FRAMEBUFFER,       // src rect, dst rect (x0, y0, x1, y1), mask, filter
+    TRACE_CLIP_CONTROL,
+    TRACE_DEPTH_FUNC,
+    TRACE_CLEAR_DEPTH,            // depth (float)
+    TRACE_UNIFORM_3F,
+    TRACE_VERTEX_ATTRIB_I_POINTER, // index, size, type, stride, offset (uint64)
+    TRACE_TEX_IMAGE_3D,           // ..., pixel blob (length 0 for NULL)
+    TRACE_TEX_SUB_IMAGE_3D,
+    TRACE_DRAW_ELEMENTS_BASE_VERTEX, // mode, count, type, offset (uint64), base vertex
+    TRACE_TEX_STORAGE_2D,         // target, levels, internal format, width, height
+    TRACE_TEX_STORAGE_3D,         // target, levels, internal format, width, height, depth
+#define GL_TRACE_VECTOR_OPCODE(name, type, components, opcode) opcode,
+#define GL_TRACE_MATRIX_OPCODE(name, components, opcode) opcode,
+    GL_TRACE_UNIFORM_VECTORS(GL_TRACE_VECTOR_OPCODE)
+    GL_TRACE_UNIFORM_MATRICES(GL_TRACE_MATRIX_OPCODE)
+#undef GL_TRACE_VECTOR_OPCODE
+#undef GL_TRACE_MATRIX_OPCODE
+    // Direct state access, kept together so the replayer can skip them as one range
+    TRACE_CREATE_BUFFERS,         // n, names[n]
+    TRACE_NAMED_BUFFER_STORAGE,   // buffer, flags, size (uint64), data blob (length 0 for NULL)
+    TRACE_NAMED_BUFFER_DATA,      // buffer, usage, size (uint64), data blob (length 0 for NULL)
+    TRACE_NAMED_BUFFER_SUB_DATA,  // buffer, offset (uint64), data blob
+    TRACE_CREATE_TEXTURES,        // target, n, names[n]
+    TRACE_TEXTURE_STORAGE_2D,     // texture, levels, internal format, width, height
+    TRACE_TEXTURE_STORAGE_3D,     // texture, levels, internal format, width, height, depth
+    TRACE_TEXTURE_SUB_IMAGE_2D,   // texture, ..., pixel blob
+    TRACE_TEXTURE_SUB_IMAGE_3D,   // texture, ..., pixel blob
+    TRACE_TEXTURE_PARAMETERI,     // texture, name, param
+    TRACE_GENERATE_TEXTURE_MIPMAP,
+    TRACE_BIND_TEXTURE_UNIT,      // unit, texture
+    TRACE_CREATE_VERTEX_ARRAYS,   // n, names[n]
+    TRACE_ENABLE_VERTEX_ARRAY_ATTRIB, // vao, index
+    TRACE_VERTEX_ARRAY_VERTEX_BUFFER, // vao, binding, buffer, offset (uint64), stride
+    TRACE_VERTEX_ARRAY_ATTRIB_FORMAT, // vao, index, size, type, normalized, relative offset
+    TRACE_VERTEX_ARRAY_ATTRIB_I_FORMAT, // vao, index, size, type, relative offset
+    TRACE_VERTEX_ARRAY_ATTRIB_BINDING, // vao, index, binding
+    TRACE_VERTEX_ARRAY_ELEMENT_BUFFER, // vao, buffer
+    TRACE_OPCODE_COUNT
+};
+
+#endif // GL_TRACE_H
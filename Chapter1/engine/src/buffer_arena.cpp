@@ -0,0 +1,344 @@
+#include "buffer_arena.h"
+#include "gl_resources.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+namespace
+{
+    inline int floor_log2(uint32_t value)
+    {
+        return 31 - __builtin_clz(value);
+    }
+
+    inline int lowest_bit(uint32_t value)
+    {
+        return __builtin_ctz(value);
+    }
+}
+
+TlsfAllocator::TlsfAllocator()
+{
+    init(0);
+}
+
+void TlsfAllocator::mapping(uint32_t size, int &fl, int &sl)
+{
+    // Sizes below SL_COUNT get exact lists in the first level
+    if(size < (uint32_t)SL_COUNT)
+    {
+        fl = 0;
+        sl = (int)size;
+        return;
+    }
+    int log2 = floor_log2(size);
+    fl = log2 - SL_BITS + 1;
+    sl = (int)(size >> (log2 - SL_BITS)) - SL_COUNT;
+}
+
+uint32_t TlsfAllocator::new_block()
+{
+    if(!unused_blocks.empty())
+    {
+        uint32_t block = unused_blocks.back();
+        unused_blocks.pop_back();
+        return block;
+    }
+    blocks.push_back(Block());
+    return (uint32_t)blocks.size() - 1;
+}
+
+void TlsfAllocator::insert_free(uint32_t block)
+{
+    int fl, sl;
+    mapping(blocks[block].size, fl, sl);
+    Block &inserted = blocks[block];
+    inserted.free = true;
+    inserted.prev_free = NONE;
+    inserted.next_free = heads[fl][sl];
+    if(inserted.next_free != NONE)
+        blocks[inserted.next_free].prev_free = block;
+    heads[fl][sl] = block;
+    fl_bitmap |= 1u << fl;
+    sl_bitmap[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::remove_free(uint32_t block)
+{
+    Block &removed = blocks[block];
+    if(removed.prev_free != NONE)
+        blocks[removed.prev_free].next_free = removed.next_free;
+    if(removed.next_free != NONE)
+        blocks[removed.next_free].prev_free = removed.prev_free;
+    removed.free = false;
+
+    int fl, sl;
+    mapping(removed.size, fl, sl);
+    if(heads[fl][sl] != block)
+        return;
+    heads[fl][sl] = removed.next_free;
+    if(heads[fl][sl] == NONE)
+    {
+        sl_bitmap[fl] &= ~(1u << sl);
+        if(!sl_bitmap[fl])
+            fl_bitmap &= ~(1u << fl);
+    }
+}
+
+void TlsfAllocator::init(uint32_t size)
+{
+    blocks.clear();
+    unused_blocks.clear();
+    fl_bitmap = 0;
+    for(int fl = 0; fl < FL_COUNT; fl++)
+    {
+        sl_bitmap[fl] = 0;
+        for(int sl = 0; sl < SL_COUNT; sl++)
+            heads[fl][sl] = NONE;
+    }
+    capacity = size;
+    used = 0;
+    allocations = 0;
+    if(size == 0)
+        return;
+
+    uint32_t block = new_block();
+    blocks[block].offset = 0;
+    blocks[block].size = size;
+    blocks[block].prev_physical = NONE;
+    blocks[block].next_physical = NONE;
+    insert_free(block);
+}
+
+bool TlsfAllocator::allocate(uint32_t size, uint32_t &offset, uint32_t &handle)
+{
+    size = std::max(size, 1u);
+    if(size > capacity - used)
+        return false;
+
+    // Rounding up to the next list means any block found in it is big enough
+    uint32_t search = size;
+    if(search >= (uint32_t)SL_COUNT)
+    {
+        uint32_t step = (1u << (floor_log2(search) - SL_BITS)) - 1;
+        if(search > 0xFFFFFFFF - step)
+            return false;
+        search += step;
+    }
+    int fl, sl;
+    mapping(search, fl, sl);
+
+    uint32_t sl_map = sl_bitmap[fl] & (~0u << sl);
+    if(!sl_map)
+    {
+        // Any list in a larger first level fits
+        uint32_t fl_map = fl + 1 < 32 ? fl_bitmap & (~0u << (fl + 1)) : 0;
+        if(!fl_map)
+            return false;
+        fl = lowest_bit(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    sl = lowest_bit(sl_map);
+
+    uint32_t block = heads[fl][sl];
+    remove_free(block);
+    if(blocks[block].size > size)
+    {
+        // The rest goes back as a free block after this one
+        uint32_t rest = new_block();
+        Block &split = blocks[block];
+        Block &remainder = blocks[rest];
+        remainder.offset = split.offset + size;
+        remainder.size = split.size - size;
+        remainder.prev_physical = block;
+        remainder.next_physical = split.next_physical;
+        if(split.next_physical != NONE)
+            blocks[split.next_physical].prev_physical = rest;
+        split.next_physical = rest;
+        split.size = size;
+        insert_free(rest);
+    }
+
+    used += size;
+    allocations++;
+    offset = blocks[block].offset;
+    handle = block;
+    return true;
+}
+
+void TlsfAllocator::free(uint32_t handle)
+{
+    if(handle >= blocks.size() || blocks[handle].free)
+        return;
+    used -= blocks[handle].size;
+    allocations--;
+
+    // Merge with free neighbours, so free space never sits in adjacent blocks
+    uint32_t block = handle;
+    uint32_t prev = blocks[block].prev_physical;
+    if(prev != NONE && blocks[prev].free)
+    {
+        remove_free(prev);
+        blocks[prev].size += blocks[block].size;
+        blocks[prev].next_physical = blocks[block].next_physical;
+        if(blocks[block].next_physical != NONE)
+            blocks[blocks[block].next_physical].prev_physical = prev;
+        unused_blocks.push_back(block);
+        block = prev;
+    }
+    uint32_t next = blocks[block].next_physical;
+    if(next != NONE && blocks[next].free)
+    {
+        remove_free(next);
+        blocks[block].size += blocks[next].size;
+        blocks[block].next_physical = blocks[next].next_physical;
+        if(blocks[next].next_physical != NONE)
+            blocks[blocks[next].next_physical].prev_physical = block;
+        unused_blocks.push_back(next);
+    }
+    insert_free(block);
+}
+
+uint32_t TlsfAllocator::get_capacity() const
+{
+    return capacity;
+}
+
+uint32_t TlsfAllocator::get_used() const
+{
+    return used;
+}
+
+uint32_t TlsfAllocator::get_allocation_count() const
+{
+    return allocations;
+}
+
+uint32_t TlsfAllocator::get_free_block_count() const
+{
+    uint32_t count = 0;
+    for(int fl = 0; fl < FL_COUNT; fl++)
+        for(int sl = 0; sl < SL_COUNT; sl++)
+            for(uint32_t block = heads[fl][sl]; block != NONE; block = blocks[block].next_free)
+                count++;
+    return count;
+}
+
+uint32_t TlsfAllocator::get_largest_free() const
+{
+    if(!fl_bitmap)
+        return 0;
+    // The largest block is in the highest non-empty list, which isn't sorted
+    int fl = floor_log2(fl_bitmap);
+    int sl = floor_log2(sl_bitmap[fl]);
+    uint32_t largest = 0;
+    for(uint32_t block = heads[fl][sl]; block != NONE; block = blocks[block].next_free)
+        largest = std::max(largest, blocks[block].size);
+    return largest;
+}
+
+ArenaRange::ArenaRange()
+{
+    page = -1;
+    buffer = 0;
+    offset = 0;
+    size = 0;
+    handle = 0;
+}
+
+BufferArena::BufferArena()
+{
+    page_size = 0;
+    granularity = DEFAULT_GRANULARITY;
+}
+
+void BufferArena::init(GLsizeiptr page_size, GLsizeiptr granularity)
+{
+    this->page_size = page_size;
+    this->granularity = granularity;
+}
+
+void BufferArena::destroy()
+{
+    for(size_t i = 0; i < pages.size(); i++)
+        glDeleteBuffers(1, &pages[i].buffer);
+    pages.clear();
+}
+
+bool BufferArena::allocate(GLsizeiptr bytes, GLsizei stride, ArenaRange &range)
+{
+    // Offsets come in granularity steps, a stride that doesn't divide it needs
+    // room to move the start up to the next whole vertex
+    GLsizeiptr padded = bytes + (granularity % stride ? stride - 1 : 0);
+    uint32_t units = (uint32_t)((padded + granularity - 1) / granularity);
+
+    uint32_t offset = 0, handle = 0;
+    size_t page = 0;
+    while(page < pages.size() && !pages[page].allocator.allocate(units, offset, handle))
+        page++;
+    if(page == pages.size())
+    {
+        Page added;
+        added.size = std::max(page_size, (GLsizeiptr)units * granularity);
+        added.buffer = GLResources::create_buffer();
+        GLResources::buffer_storage(added.buffer, added.size, NULL, true);
+        added.allocator.init((uint32_t)(added.size / granularity));
+        pages.push_back(added);
+        if(!pages.back().allocator.allocate(units, offset, handle))
+        {
+            printf("ERROR::BUFFER_ARENA::ALLOCATION_FAILED %lld bytes\n", (long long)bytes);
+            return false;
+        }
+    }
+
+    range.page = (int)page;
+    range.buffer = pages[page].buffer;
+    range.offset = ((GLintptr)offset * granularity + stride - 1) / stride * stride;
+    range.size = bytes;
+    range.handle = handle;
+    return true;
+}
+
+void BufferArena::upload(const ArenaRange &range, const void* data, GLsizeiptr bytes)
+{
+    GLResources::buffer_sub_data(range.buffer, range.offset, std::min(bytes, range.size), data);
+}
+
+void BufferArena::free(ArenaRange &range)
+{
+    if(range.page >= 0 && range.page < (int)pages.size())
+        pages[range.page].allocator.free(range.handle);
+    range = ArenaRange();
+}
+
+size_t BufferArena::get_page_count() const
+{
+    return pages.size();
+}
+
+GLuint BufferArena::get_buffer(size_t page) const
+{
+    return pages[page].buffer;
+}
+
+void BufferArena::print_report(const char* label) const
+{
+    unsigned long long capacity = 0, used = 0, largest = 0;
+    unsigned int ranges = 0, free_blocks = 0;
+    for(size_t i = 0; i < pages.size(); i++)
+    {
+        const TlsfAllocator &allocator = pages[i].allocator;
+        capacity += (unsigned long long)allocator.get_capacity() * granularity;
+        used += (unsigned long long)allocator.get_used() * granularity;
+        largest = std::max(largest, (unsigned long long)allocator.get_largest_free() * granularity);
+        ranges += allocator.get_allocation_count();
+        free_blocks += allocator.get_free_block_count();
+    }
+
+    // Share of the free space that can't be handed out as one range
+    unsigned long long free_bytes = capacity - used;
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    printf("%s: %zu pages, %.1f of %.1f MB used by %u ranges, %.1f MB free in %u blocks, largest %.1f MB, %.0f%% fragmented\n",
+        label, pages.size(), used * mb, capacity * mb, ranges, free_bytes * mb, free_blocks, largest * mb,
+        free_bytes ? 100.0 * (1.0 - (double)largest / free_bytes) : 0.0);
+}
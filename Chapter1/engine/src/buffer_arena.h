@@ -0,0 +1,122 @@
+#ifndef BUFFER_ARENA_H
+#define BUFFER_ARENA_H
+
+#include <GL/glew.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Two-level segregated fit allocator over a range of units. It only hands out
+// offsets, the memory itself lives elsewhere (a GL buffer here).
+//
+// Free blocks are kept in lists by size class: the first level is the power
+// of two, the second splits each power into 16 steps. Allocation and free are
+// O(1): a bitmap lookup finds a list whose blocks are all big enough, the
+// block is split and the rest goes back. Freed blocks merge with free
+// neighbours right away, so fragmentation only comes from live allocations.
+class TlsfAllocator
+{
+private:
+    static const int SL_BITS = 4;
+    static const int SL_COUNT = 1 << SL_BITS;
+    static const int FL_COUNT = 32 - SL_BITS + 1;
+    static const uint32_t NONE = 0xFFFFFFFF;
+
+    struct Block
+    {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t prev_physical;     // Neighbours in memory
+        uint32_t next_physical;
+        uint32_t prev_free;         // Neighbours in the size class's free list
+        uint32_t next_free;
+        bool free;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> unused_blocks;
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[FL_COUNT];
+    uint32_t heads[FL_COUNT][SL_COUNT];
+
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t allocations;
+
+    static void mapping(uint32_t size, int &fl, int &sl);
+    uint32_t new_block();
+    void insert_free(uint32_t block);
+    void remove_free(uint32_t block);
+
+public:
+    TlsfAllocator();
+
+    // Forgets every allocation, one free block covers size units
+    void init(uint32_t size);
+
+    // False when no free block can hold size units. handle is what free() takes.
+    bool allocate(uint32_t size, uint32_t &offset, uint32_t &handle);
+    void free(uint32_t handle);
+
+    uint32_t get_capacity() const;
+    uint32_t get_used() const;
+    uint32_t get_allocation_count() const;
+    uint32_t get_free_block_count() const;
+    uint32_t get_largest_free() const;
+};
+
+// A range of a BufferArena page, page is -1 for none
+struct ArenaRange
+{
+    ArenaRange();
+
+    int page;
+    GLuint buffer;
+    GLintptr offset;        // A multiple of the stride allocated with
+    GLsizeiptr size;
+    uint32_t handle;
+};
+
+// Many meshes in a few large GL buffers instead of one buffer each.
+//
+// Pages are fixed size buffers, each managed by a TlsfAllocator, and a new
+// page is added when none has room. Ranges are aligned to the vertex stride,
+// so offset / stride is the base vertex for glDrawElementsBaseVertex and
+// every mesh in a page can share the page's vertex array.
+class BufferArena
+{
+private:
+    struct Page
+    {
+        GLuint buffer;
+        GLsizeiptr size;
+        TlsfAllocator allocator;
+    };
+
+    std::vector<Page> pages;
+    GLsizeiptr page_size;
+    GLsizeiptr granularity;
+
+public:
+    // Allocations are rounded up to granularity bytes, a power of two
+    static const GLsizeiptr DEFAULT_GRANULARITY = 16;
+
+    BufferArena();
+
+    void init(GLsizeiptr page_size, GLsizeiptr granularity = DEFAULT_GRANULARITY);
+    // Deletes the page buffers, release their vertex arrays first
+    void destroy();
+
+    bool allocate(GLsizeiptr bytes, GLsizei stride, ArenaRange &range);
+    void upload(const ArenaRange &range, const void* data, GLsizeiptr bytes);
+    void free(ArenaRange &range);
+
+    size_t get_page_count() const;
+    GLuint get_buffer(size_t page) const;
+
+    // Bytes and ranges in use, free space and how scattered it is. label
+    // starts the line.
+    void print_report(const char* label) const;
+};
+
+#endif // BUFFER_ARENA_H
@@ -0,0 +1,65 @@
+#include "clock.h"
+
+#include <SDL2/SDL.h>
+
+const double Clock::MAX_DELTA_TIME = 0.25;
+
+Clock::Clock()
+{
+    frequency = SDL_GetPerformanceFrequency();
+    start_ticks = SDL_GetPerformanceCounter();
+    frame_ticks = start_ticks;
+    frame_index = 0;
+    delta_time = 0.0;
+}
+
+double Clock::to_seconds(uint64_t ticks) const
+{
+    // Split into whole seconds and remainder so the division never loses the low bits
+    return (double)(ticks / frequency) + (double)(ticks % frequency) / (double)frequency;
+}
+
+void Clock::tick()
+{
+    uint64_t ticks = SDL_GetPerformanceCounter();
+    delta_time = to_seconds(ticks - frame_ticks);
+    if(delta_time > MAX_DELTA_TIME)
+        delta_time = MAX_DELTA_TIME;
+    frame_ticks = ticks;
+    frame_index++;
+}
+
+void Clock::resume()
+{
+    frame_ticks = SDL_GetPerformanceCounter() - (uint64_t)(delta_time * frequency);
+}
+
+double Clock::get_time() const
+{
+    return to_seconds(frame_ticks - start_ticks);
+}
+
+double Clock::get_delta_time() const
+{
+    return delta_time;
+}
+
+uint64_t Clock::get_ticks() const
+{
+    return frame_ticks;
+}
+
+uint64_t Clock::get_frequency() const
+{
+    return frequency;
+}
+
+uint64_t Clock::get_frame() const
+{
+    return frame_index;
+}
+
+double Clock::now() const
+{
+    return to_seconds(SDL_GetPerformanceCounter() - start_ticks);
+}
@@ -0,0 +1,43 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+// Frame clock on SDL's performance counter. Time is kept as 64-bit integer
+// ticks and only converted to double seconds when asked for, so it stays
+// precise to well under a microsecond after weeks of uptime.
+class Clock
+{
+private:
+    uint64_t frequency;
+    uint64_t start_ticks;
+    uint64_t frame_ticks;
+    uint64_t frame_index;
+    double delta_time;
+
+    double to_seconds(uint64_t ticks) const;
+
+public:
+    // Longest step tick() reports, so a stall (debugger, dragged window)
+    // doesn't make everything jump
+    static const double MAX_DELTA_TIME;
+
+    Clock();
+
+    // Call once per frame
+    void tick();
+    // Call after the loop slept: the next tick() reports the last frame's
+    // delta again instead of the time spent idle
+    void resume();
+
+    double get_time() const;        // Seconds from construction to the last tick
+    double get_delta_time() const;  // Seconds between the last two ticks, clamped
+    uint64_t get_ticks() const;     // Raw counter value at the last tick
+    uint64_t get_frequency() const; // Counter ticks per second
+    uint64_t get_frame() const;     // Number of ticks so far
+
+    // Seconds since construction right now, independent of tick()
+    double now() const;
+};
+
+#endif // CLOCK_H
@@ -0,0 +1,182 @@
+#include "frame_pacer.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+// Slack left before the refresh when sampling input late, covers GPU time and wake-up jitter
+static const double INPUT_DEADLINE_MARGIN = 0.002;
+
+FramePacer::FramePacer(const Clock &clock) : clock(clock)
+{
+    swap_mode = SWAP_VSYNC;
+    max_frames_in_flight = 0;
+    late_input = false;
+    refresh_period = 1.0 / 60.0;
+    oldest = 0;
+    in_flight = 0;
+    input_time = 0.0;
+    swap_time = 0.0;
+    work_estimate = 0.0;
+    fence_wait_seconds = 0.0;
+    input_wait_seconds = 0.0;
+    frame_count = 0;
+}
+
+void FramePacer::init(SDL_Window* window, SwapMode mode, unsigned int max_frames_in_flight, bool late_input)
+{
+    swap_mode = mode;
+    if(SDL_GL_SetSwapInterval(mode) != 0)
+    {
+        if(mode == SWAP_ADAPTIVE)
+        {
+            printf("Adaptive vsync not supported, using vsync\n");
+            swap_mode = SWAP_VSYNC;
+            SDL_GL_SetSwapInterval(SWAP_VSYNC);
+        }
+        else
+            printf("ERROR::FRAME_PACER::SWAP_INTERVAL_FAILED %s\n", SDL_GetError());
+    }
+
+    SDL_DisplayMode display;
+    if(SDL_GetWindowDisplayMode(window, &display) == 0 && display.refresh_rate > 0)
+        refresh_period = 1.0 / display.refresh_rate;
+
+    this->max_frames_in_flight = std::min(max_frames_in_flight, MAX_FRAMES_IN_FLIGHT);
+    this->late_input = late_input;
+}
+
+void FramePacer::destroy()
+{
+    while(in_flight > 0)
+    {
+        glDeleteSync(frames[oldest].fence);
+        oldest = (oldest + 1) % MAX_FRAMES_IN_FLIGHT;
+        in_flight--;
+    }
+}
+
+void FramePacer::retire_oldest(double completed_time)
+{
+    FrameFence &frame = frames[oldest];
+    latencies.push_back((float)((completed_time - frame.input_time) * 1000.0));
+    glDeleteSync(frame.fence);
+    oldest = (oldest + 1) % MAX_FRAMES_IN_FLIGHT;
+    in_flight--;
+}
+
+void FramePacer::poll_fences()
+{
+    while(in_flight > 0)
+    {
+        GLenum result = glClientWaitSync(frames[oldest].fence, 0, 0);
+        if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            break;
+        retire_oldest(clock.now());
+    }
+}
+
+void FramePacer::wait_for_frame_slot()
+{
+    poll_fences();
+
+    // Without a limit, only wait when there is no fence left to track the frame with
+    unsigned int limit = max_frames_in_flight ? max_frames_in_flight : MAX_FRAMES_IN_FLIGHT;
+    while(in_flight >= limit)
+    {
+        double start = clock.now();
+        GLenum result = glClientWaitSync(frames[oldest].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+        double end = clock.now();
+        if(result == GL_WAIT_FAILED || result == GL_TIMEOUT_EXPIRED)
+            printf("ERROR::FRAME_PACER::FENCE_WAIT_FAILED 0x%x\n", result);
+        fence_wait_seconds += end - start;
+        retire_oldest(end);
+    }
+}
+
+void FramePacer::wait_for_input_deadline()
+{
+    // Only worth it when the swap is tied to the refresh
+    if(!late_input || swap_mode == SWAP_IMMEDIATE || swap_time <= 0.0)
+        return;
+
+    double deadline = swap_time + refresh_period - work_estimate - INPUT_DEADLINE_MARGIN;
+    double start = clock.now();
+    double now = start;
+    // SDL_Delay is only good to a millisecond or so, sleep most of the way and spin the rest
+    while(deadline - now > 0.002)
+    {
+        SDL_Delay((Uint32)((deadline - now) * 1000.0) - 1);
+        now = clock.now();
+    }
+    while(now < deadline)
+        now = clock.now();
+    input_wait_seconds += now - start;
+}
+
+void FramePacer::mark_input_sampled()
+{
+    input_time = clock.now();
+}
+
+void FramePacer::present(SDL_Window* window)
+{
+    double submit_time = clock.now();
+    double work = submit_time - input_time;
+    work_estimate = work_estimate == 0.0 ? work : work_estimate + 0.1 * (work - work_estimate);
+
+    SDL_GL_SwapWindow(window);
+    swap_time = clock.now();
+
+    // wait_for_frame_slot() keeps a slot free, except when the limiter is off and the ring is full
+    if(in_flight == MAX_FRAMES_IN_FLIGHT)
+    {
+        glClientWaitSync(frames[oldest].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+        retire_oldest(clock.now());
+    }
+    FrameFence &frame = frames[(oldest + in_flight) % MAX_FRAMES_IN_FLIGHT];
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.input_time = input_time;
+    in_flight++;
+    frame_count++;
+
+    poll_fences();
+}
+
+SwapMode FramePacer::get_swap_mode() const
+{
+    return swap_mode;
+}
+
+void FramePacer::print_report()
+{
+    if(latencies.empty() || frame_count == 0)
+        return;
+
+    const char* mode_names[] = { "adaptive vsync", "no vsync", "vsync" };
+    printf("Frame pacing: %s, %u frames in flight%s, late input %s\n", mode_names[swap_mode + 1],
+        max_frames_in_flight, max_frames_in_flight ? "" : " (unlimited)", late_input ? "on" : "off");
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t count = latencies.size();
+    printf("  input to GPU done over %zu frames: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", count,
+        latencies[count / 2], latencies[count * 9 / 10], latencies[count * 99 / 100], latencies[count - 1]);
+
+    const float bucket_limits[] = { 8.0f, 16.7f, 33.3f, 50.0f };
+    unsigned int buckets[5] = { 0, 0, 0, 0, 0 };
+    for(size_t i = 0; i < count; i++)
+    {
+        unsigned int bucket = 0;
+        while(bucket < 4 && latencies[i] >= bucket_limits[bucket])
+            bucket++;
+        buckets[bucket]++;
+    }
+    printf("  <8 ms %u, 8-16.7 ms %u, 16.7-33.3 ms %u, 33.3-50 ms %u, >=50 ms %u\n",
+        buckets[0], buckets[1], buckets[2], buckets[3], buckets[4]);
+    printf("  waited per frame: %.2f ms on fences, %.2f ms for the input deadline\n",
+        fence_wait_seconds * 1000.0 / frame_count, input_wait_seconds * 1000.0 / frame_count);
+
+    latencies.clear();
+    fence_wait_seconds = 0.0;
+    input_wait_seconds = 0.0;
+    frame_count = 0;
+}
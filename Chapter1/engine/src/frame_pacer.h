@@ -0,0 +1,73 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "clock.h"
+
+// Values are what SDL_GL_SetSwapInterval takes
+enum SwapMode { SWAP_ADAPTIVE = -1, SWAP_IMMEDIATE = 0, SWAP_VSYNC = 1 };
+
+// Controls when frames start and how many the GPU may queue.
+//
+// wait_for_frame_slot() blocks on a fence until fewer than max_frames_in_flight
+// frames are still being processed, so the driver can't buffer several frames
+// of latency ahead of the display. wait_for_input_deadline() then, with vsync
+// and late input on, sleeps until just enough time is left before the next
+// refresh to build the frame, so the input read afterwards is as fresh as it
+// can be. Latency is measured from mark_input_sampled() to the GPU finishing
+// the frame, which is when the fence placed after the swap is seen signalled.
+class FramePacer
+{
+private:
+    static const unsigned int MAX_FRAMES_IN_FLIGHT = 8;
+
+    struct FrameFence
+    {
+        GLsync fence;
+        double input_time;
+    };
+
+    const Clock &clock;
+    SwapMode swap_mode;
+    unsigned int max_frames_in_flight;
+    bool late_input;
+    double refresh_period;
+
+    FrameFence frames[MAX_FRAMES_IN_FLIGHT];
+    unsigned int oldest;
+    unsigned int in_flight;
+
+    double input_time;
+    double swap_time;        // When the last swap returned
+    double work_estimate;    // Smoothed CPU time from input sampling to the swap call
+
+    std::vector<float> latencies; // ms, since the last report
+    double fence_wait_seconds;
+    double input_wait_seconds;
+    unsigned int frame_count;
+
+    void retire_oldest(double completed_time);
+    void poll_fences();
+
+public:
+    FramePacer(const Clock &clock);
+
+    // Sets the swap interval, adaptive falls back to vsync where unsupported.
+    // max_frames_in_flight of 0 turns the fence limiter off.
+    void init(SDL_Window* window, SwapMode mode, unsigned int max_frames_in_flight, bool late_input);
+    void destroy();
+
+    void wait_for_frame_slot();
+    void wait_for_input_deadline();
+    void mark_input_sampled();
+    // Swaps and fences the frame
+    void present(SDL_Window* window);
+
+    SwapMode get_swap_mode() const;
+    void print_report();
+};
+
+#endif // FRAME_PACER_H
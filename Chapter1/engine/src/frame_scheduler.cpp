@@ -0,0 +1,126 @@
+#include "frame_scheduler.h"
+
+#include <math.h>
+#include <stdio.h>
+
+FrameScheduler::FrameScheduler(const Clock &clock) : clock(clock)
+{
+    redraw = true;
+    animations = 0;
+    async_jobs = 0;
+    slept = false;
+    frames = 0;
+    sleeps = 0;
+    sleep_seconds = 0.0;
+    report_start = clock.now();
+}
+
+void FrameScheduler::request_redraw()
+{
+    redraw = true;
+}
+
+void FrameScheduler::begin_animation()
+{
+    animations++;
+}
+
+void FrameScheduler::end_animation()
+{
+    if(animations > 0)
+        animations--;
+}
+
+void FrameScheduler::begin_async()
+{
+    async_jobs++;
+}
+
+void FrameScheduler::end_async()
+{
+    if(async_jobs > 0)
+        async_jobs--;
+}
+
+void FrameScheduler::wake_at(double time)
+{
+    wake_times.push(time);
+}
+
+void FrameScheduler::wake_in(double seconds)
+{
+    wake_times.push(clock.now() + seconds);
+}
+
+void FrameScheduler::poll_at(double time)
+{
+    poll_times.push(time);
+}
+
+bool FrameScheduler::frame_needed() const
+{
+    return redraw || animations > 0 || async_jobs > 0;
+}
+
+bool FrameScheduler::wait_event(SDL_Event* event)
+{
+    slept = false;
+    if(frame_needed())
+        return SDL_PollEvent(event) != 0;
+
+    double start = clock.now();
+    int got;
+    if(wake_times.empty() && poll_times.empty())
+        got = SDL_WaitEvent(event);
+    else
+    {
+        double next = wake_times.empty() ? poll_times.top() : wake_times.top();
+        if(!poll_times.empty() && poll_times.top() < next)
+            next = poll_times.top();
+        double wait = next - start;
+        if(wait <= 0.0)
+            return SDL_PollEvent(event) != 0;
+        got = SDL_WaitEventTimeout(event, (int)ceil(wait * 1000.0));
+    }
+
+    slept = true;
+    sleeps++;
+    sleep_seconds += clock.now() - start;
+    return got != 0;
+}
+
+bool FrameScheduler::has_slept() const
+{
+    return slept;
+}
+
+bool FrameScheduler::frame_due()
+{
+    bool due = frame_needed();
+    double now = clock.now();
+    while(!wake_times.empty() && wake_times.top() <= now)
+    {
+        wake_times.pop();
+        due = true;
+    }
+    while(!poll_times.empty() && poll_times.top() <= now)
+        poll_times.pop();
+    redraw = false;
+    if(due)
+        frames++;
+    return due;
+}
+
+void FrameScheduler::print_report()
+{
+    double now = clock.now();
+    double elapsed = now - report_start;
+    if(elapsed <= 0.0)
+        return;
+    printf("Render on demand: %u frames in %.1f s, slept %u times for %.1f%% of the time\n",
+        frames, elapsed, sleeps, 100.0 * sleep_seconds / elapsed);
+    frames = 0;
+    sleeps = 0;
+    sleep_seconds = 0.0;
+    report_start = now;
+}
@@ -0,0 +1,63 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <SDL2/SDL.h>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "clock.h"
+
+// Render-on-demand bookkeeping. The loop asks wait_event() for its first
+// event each iteration: while anything needs frames (a redraw request, a
+// running animation, async work that only progresses with frames) it returns
+// straight away, otherwise it blocks in SDL until an event arrives or the
+// earliest scheduled wake time is reached, so an idle window uses no CPU.
+class FrameScheduler
+{
+private:
+    const Clock &clock;
+    bool redraw;
+    unsigned int animations;
+    unsigned int async_jobs;
+    // Earliest wake time on top, in Clock seconds
+    std::priority_queue<double, std::vector<double>, std::greater<double> > wake_times;
+    std::priority_queue<double, std::vector<double>, std::greater<double> > poll_times;
+
+    bool slept;
+    unsigned int frames;
+    unsigned int sleeps;
+    double sleep_seconds;
+    double report_start;
+
+    bool frame_needed() const;
+
+public:
+    FrameScheduler(const Clock &clock);
+
+    // Something visible changed, draw one more frame
+    void request_redraw();
+    // Continuous animation, frames are drawn every iteration while any is running
+    void begin_animation();
+    void end_animation();
+    // Work that needs the loop to keep turning, such as a capture waiting for its frame
+    void begin_async();
+    void end_async();
+    // Timed animation step: draw a frame once this time (Clock seconds) is reached
+    void wake_at(double time);
+    void wake_in(double seconds);
+    // Only wakes an idle loop at this time, without drawing. For checks that
+    // request_redraw() themselves when they find something.
+    void poll_at(double time);
+
+    // Fills event and returns true if there is one. Blocks only while idle.
+    bool wait_event(SDL_Event* event);
+    // Whether the last wait_event() call went to sleep
+    bool has_slept() const;
+    // True if a frame should be drawn now. Clears the redraw request and any due wake and poll times.
+    bool frame_due();
+
+    void print_report();
+};
+
+#endif // FRAME_SCHEDULER_H
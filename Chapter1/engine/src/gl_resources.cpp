@@ -0,0 +1,280 @@
+#include "gl_resources.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <utility>
+
+namespace
+{
+    bool dsa = false;
+
+    struct VertexBinding
+    {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizei stride;
+    };
+
+    // The fallback's glVertexAttribPointer needs the buffer and stride that
+    // DSA keeps in the vertex array's binding slots
+    std::map<std::pair<GLuint, GLuint>, VertexBinding> vertex_bindings;
+
+    // Pixel format and type glTexImage needs to allocate a level, only
+    // used without glTexStorage
+    void upload_format(GLenum internal_format, GLenum &format, GLenum &type)
+    {
+        switch(internal_format)
+        {
+        case GL_DEPTH_COMPONENT32F: format = GL_DEPTH_COMPONENT; type = GL_FLOAT;        break;
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32:  format = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; break;
+        case GL_DEPTH24_STENCIL8:   format = GL_DEPTH_STENCIL;   type = GL_UNSIGNED_INT_24_8; break;
+        default:                    format = GL_RGBA;            type = GL_UNSIGNED_BYTE; break;
+        }
+    }
+
+    GLsizei level_size(GLsizei size, GLsizei level)
+    {
+        size >>= level;
+        return size > 0 ? size : 1;
+    }
+}
+
+void GLResources::init(bool allow_dsa)
+{
+    dsa = allow_dsa && (GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access);
+}
+
+bool GLResources::has_dsa()
+{
+    return dsa;
+}
+
+GLuint GLResources::create_buffer()
+{
+    GLuint buffer;
+    if(dsa)
+        glCreateBuffers(1, &buffer);
+    else
+        glGenBuffers(1, &buffer);
+    return buffer;
+}
+
+void GLResources::buffer_storage(GLuint buffer, GLsizeiptr size, const void* data, bool dynamic)
+{
+    if(dsa)
+    {
+        glNamedBufferStorage(buffer, size, data, dynamic ? GL_DYNAMIC_STORAGE_BIT : 0);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, data, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+}
+
+void GLResources::buffer_data(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage)
+{
+    if(dsa)
+    {
+        glNamedBufferData(buffer, size, data, usage);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+}
+
+void GLResources::buffer_sub_data(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    if(dsa)
+    {
+        glNamedBufferSubData(buffer, offset, size, data);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+
+GLuint GLResources::create_texture(GLenum target)
+{
+    GLuint texture;
+    if(dsa)
+        glCreateTextures(target, 1, &texture);
+    else
+    {
+        // The first bind is what makes it a texture of that target
+        glGenTextures(1, &texture);
+        glBindTexture(target, texture);
+    }
+    return texture;
+}
+
+void GLResources::texture_storage_2d(GLuint texture, GLenum target, GLsizei levels, GLenum internal_format,
+                                     GLsizei width, GLsizei height)
+{
+    if(dsa)
+    {
+        glTextureStorage2D(texture, levels, internal_format, width, height);
+        return;
+    }
+    glBindTexture(target, texture);
+    if(GLEW_ARB_texture_storage)
+    {
+        glTexStorage2D(target, levels, internal_format, width, height);
+        return;
+    }
+    GLenum format, type;
+    upload_format(internal_format, format, type);
+    for(GLsizei level = 0; level < levels; level++)
+        glTexImage2D(target, level, internal_format, level_size(width, level), level_size(height, level), 0, format, type, NULL);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+void GLResources::texture_storage_3d(GLuint texture, GLenum target, GLsizei levels, GLenum internal_format,
+                                     GLsizei width, GLsizei height, GLsizei depth)
+{
+    if(dsa)
+    {
+        glTextureStorage3D(texture, levels, internal_format, width, height, depth);
+        return;
+    }
+    glBindTexture(target, texture);
+    if(GLEW_ARB_texture_storage)
+    {
+        glTexStorage3D(target, levels, internal_format, width, height, depth);
+        return;
+    }
+    GLenum format, type;
+    upload_format(internal_format, format, type);
+    // Array layers don't shrink with the levels, 3D depth does
+    for(GLsizei level = 0; level < levels; level++)
+        glTexImage3D(target, level, internal_format, level_size(width, level), level_size(height, level),
+            target == GL_TEXTURE_3D ? level_size(depth, level) : depth, 0, format, type, NULL);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+void GLResources::texture_sub_image_2d(GLuint texture, GLenum target, GLint level, GLint x, GLint y,
+                                       GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+    if(dsa)
+    {
+        glTextureSubImage2D(texture, level, x, y, width, height, format, type, pixels);
+        return;
+    }
+    glBindTexture(target, texture);
+    glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+void GLResources::texture_sub_image_3d(GLuint texture, GLenum target, GLint level, GLint x, GLint y, GLint z,
+                                       GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+{
+    if(dsa)
+    {
+        glTextureSubImage3D(texture, level, x, y, z, width, height, depth, format, type, pixels);
+        return;
+    }
+    glBindTexture(target, texture);
+    glTexSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+}
+
+void GLResources::texture_parameter(GLuint texture, GLenum target, GLenum name, GLint value)
+{
+    if(dsa)
+    {
+        glTextureParameteri(texture, name, value);
+        return;
+    }
+    glBindTexture(target, texture);
+    glTexParameteri(target, name, value);
+}
+
+void GLResources::generate_mipmap(GLuint texture, GLenum target)
+{
+    if(dsa)
+    {
+        glGenerateTextureMipmap(texture);
+        return;
+    }
+    glBindTexture(target, texture);
+    glGenerateMipmap(target);
+}
+
+void GLResources::bind_texture_unit(GLuint unit, GLenum target, GLuint texture)
+{
+    if(dsa)
+    {
+        glBindTextureUnit(unit, texture);
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+}
+
+GLuint GLResources::create_vertex_array()
+{
+    GLuint vao;
+    if(dsa)
+        glCreateVertexArrays(1, &vao);
+    else
+        glGenVertexArrays(1, &vao);
+    return vao;
+}
+
+void GLResources::delete_vertex_array(GLuint vao)
+{
+    std::map<std::pair<GLuint, GLuint>, VertexBinding>::iterator it = vertex_bindings.lower_bound(std::make_pair(vao, 0u));
+    while(it != vertex_bindings.end() && it->first.first == vao)
+        vertex_bindings.erase(it++);
+    glDeleteVertexArrays(1, &vao);
+}
+
+void GLResources::vertex_array_buffer(GLuint vao, GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride)
+{
+    if(dsa)
+    {
+        glVertexArrayVertexBuffer(vao, binding, buffer, offset, stride);
+        return;
+    }
+    VertexBinding &slot = vertex_bindings[std::make_pair(vao, binding)];
+    slot.buffer = buffer;
+    slot.offset = offset;
+    slot.stride = stride;
+}
+
+void GLResources::vertex_array_attribute(GLuint vao, GLuint location, GLuint binding, GLint components, GLenum type,
+                                         bool normalized, bool integer, GLuint relative_offset)
+{
+    if(dsa)
+    {
+        if(integer)
+            glVertexArrayAttribIFormat(vao, location, components, type, relative_offset);
+        else
+            glVertexArrayAttribFormat(vao, location, components, type, normalized ? GL_TRUE : GL_FALSE, relative_offset);
+        glVertexArrayAttribBinding(vao, location, binding);
+        glEnableVertexArrayAttrib(vao, location);
+        return;
+    }
+
+    const VertexBinding &slot = vertex_bindings[std::make_pair(vao, binding)];
+    const void* offset = (const void*)(uintptr_t)(slot.offset + relative_offset);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, slot.buffer);
+    if(integer)
+        glVertexAttribIPointer(location, components, type, slot.stride, offset);
+    else
+        glVertexAttribPointer(location, components, type, normalized ? GL_TRUE : GL_FALSE, slot.stride, offset);
+    glEnableVertexAttribArray(location);
+    glBindVertexArray(0);
+}
+
+void GLResources::vertex_array_element_buffer(GLuint vao, GLuint buffer)
+{
+    if(dsa)
+    {
+        glVertexArrayElementBuffer(vao, buffer);
+        return;
+    }
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    glBindVertexArray(0);
+}
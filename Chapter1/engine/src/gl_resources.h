@@ -0,0 +1,57 @@
+#ifndef GL_RESOURCES_H
+#define GL_RESOURCES_H
+
+#include <GL/glew.h>
+
+// Creates and edits buffers, textures and vertex arrays by name.
+//
+// With GL 4.5 or ARB_direct_state_access every call goes straight to the
+// object (glNamedBufferStorage, glTextureStorage2D, glVertexArrayAttribFormat
+// ...) and no binding changes. Otherwise the same calls fall back to
+// bind-to-edit: buffers are edited through GL_COPY_WRITE_BUFFER so no vertex
+// array or draw binding is disturbed, textures are bound to their target on
+// the active unit and left there, and vertex arrays are unbound again after
+// each edit.
+//
+// Storage from buffer_storage() and texture_storage_*() has a fixed size,
+// recreate the object to resize it. Replaying a capture made with DSA needs a
+// context that has it as well.
+namespace GLResources
+{
+    // Must be called after glewInit(). Until then, or without allow_dsa, the fallback is used.
+    void init(bool allow_dsa = true);
+    bool has_dsa();
+
+    GLuint create_buffer();
+    // Fixed size, buffer_sub_data() only works on dynamic storage
+    void buffer_storage(GLuint buffer, GLsizeiptr size, const void* data, bool dynamic);
+    // Resizable, for contents that are replaced whole
+    void buffer_data(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage);
+    void buffer_sub_data(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+
+    GLuint create_texture(GLenum target);
+    // All levels allocated up front, GL_TEXTURE_MAX_LEVEL follows from levels
+    void texture_storage_2d(GLuint texture, GLenum target, GLsizei levels, GLenum internal_format,
+                            GLsizei width, GLsizei height);
+    void texture_storage_3d(GLuint texture, GLenum target, GLsizei levels, GLenum internal_format,
+                            GLsizei width, GLsizei height, GLsizei depth);
+    void texture_sub_image_2d(GLuint texture, GLenum target, GLint level, GLint x, GLint y,
+                              GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+    void texture_sub_image_3d(GLuint texture, GLenum target, GLint level, GLint x, GLint y, GLint z,
+                              GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels);
+    void texture_parameter(GLuint texture, GLenum target, GLenum name, GLint value);
+    void generate_mipmap(GLuint texture, GLenum target);
+    void bind_texture_unit(GLuint unit, GLenum target, GLuint texture);
+
+    GLuint create_vertex_array();
+    void delete_vertex_array(GLuint vao);
+    // Vertex buffer binding slot binding reads buffer from offset, stride bytes per vertex
+    void vertex_array_buffer(GLuint vao, GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride);
+    // Attribute location reads its data from binding, relative_offset into each vertex.
+    // The binding's buffer must be set first.
+    void vertex_array_attribute(GLuint vao, GLuint location, GLuint binding, GLint components, GLenum type,
+                                bool normalized, bool integer, GLuint relative_offset);
+    void vertex_array_element_buffer(GLuint vao, GLuint buffer);
+}
+
+#endif // GL_RESOURCES_H
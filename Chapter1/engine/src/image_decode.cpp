@@ -0,0 +1,430 @@
+#include "image_decode.h"
+#include "mapped_file.h"
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "stb/stb_image.h"
+
+namespace
+{
+    // Every allocation is preceded by its size, kept 16 byte aligned for SSE loads
+    const size_t HEADER = 16;
+
+    size_t align16(size_t size)
+    {
+        return (size + 15) & ~(size_t)15;
+    }
+
+    size_t& size_of(void* pointer)
+    {
+        return *(size_t*)((unsigned char*)pointer - HEADER);
+    }
+}
+
+DecodeArena::DecodeArena()
+{
+    last = NULL;
+    output = NULL;
+    output_bytes = 0;
+    output_taken = false;
+    depth = 0;
+    used = 0;
+    decode_peak = 0;
+    peak = 0;
+}
+
+DecodeArena::~DecodeArena()
+{
+    for(size_t i = 0; i < blocks.size(); i++)
+        free(blocks[i].memory);
+}
+
+DecodeArena& DecodeArena::current()
+{
+    static thread_local DecodeArena arena;
+    return arena;
+}
+
+void DecodeArena::begin()
+{
+    depth++;
+}
+
+void DecodeArena::end()
+{
+    if(depth > 0 && --depth == 0)
+        reset();
+}
+
+bool DecodeArena::is_active() const
+{
+    return depth > 0;
+}
+
+bool DecodeArena::owns(const void* pointer) const
+{
+    const unsigned char* p = (const unsigned char*)pointer;
+    if(p && p == output)
+        return true;
+    for(size_t i = 0; i < blocks.size(); i++)
+        if(p >= blocks[i].memory && p < blocks[i].memory + blocks[i].size)
+            return true;
+    return false;
+}
+
+void* DecodeArena::bump(size_t size)
+{
+    size_t need = HEADER + align16(size);
+    if(blocks.empty() || blocks.back().used + need > blocks.back().size)
+    {
+        // Doubling keeps a decode to a few blocks, reset() merges them for the next one
+        Block block;
+        block.size = std::max(MIN_BLOCK, need);
+        if(!blocks.empty())
+            block.size = std::max(block.size, blocks.back().size * 2);
+        block.memory = (unsigned char*)malloc(block.size);
+        block.used = 0;
+        if(!block.memory)
+            return NULL;
+        blocks.push_back(block);
+    }
+
+    Block &block = blocks.back();
+    unsigned char* pointer = block.memory + block.used + HEADER;
+    block.used += need;
+    used += need;
+    decode_peak = std::max(decode_peak, used);
+    size_of(pointer) = size;
+    last = pointer;
+    return pointer;
+}
+
+void DecodeArena::set_output(unsigned char* buffer, size_t bytes)
+{
+    output = buffer;
+    output_bytes = bytes;
+    output_taken = false;
+}
+
+bool DecodeArena::is_output_taken() const
+{
+    return output_taken;
+}
+
+void* DecodeArena::allocate(size_t size)
+{
+    // stb's JPEG path asks for one byte more than the image
+    if(output && !output_taken && (size == output_bytes || size == output_bytes + 1))
+    {
+        output_taken = true;
+        return output;
+    }
+    return bump(size);
+}
+
+void* DecodeArena::reallocate(void* pointer, size_t size)
+{
+    if(!pointer)
+        return allocate(size);
+    if(pointer == output)
+    {
+        if(size <= output_bytes + 1)
+            return pointer;
+        // Outgrew the buffer, it wasn't the image after all
+        void* moved = bump(size);
+        if(moved)
+        {
+            memcpy(moved, output, output_bytes + 1);
+            output_taken = false;
+        }
+        return moved;
+    }
+
+    size_t old_size = size_of(pointer);
+    if(pointer == last)
+    {
+        Block &block = blocks.back();
+        size_t start = (unsigned char*)pointer - block.memory;
+        if(start + align16(size) <= block.size)
+        {
+            used = used - align16(old_size) + align16(size);
+            decode_peak = std::max(decode_peak, used);
+            block.used = start + align16(size);
+            size_of(pointer) = size;
+            return pointer;
+        }
+    }
+    if(size <= old_size)
+        return pointer;
+
+    void* moved = bump(size);
+    if(moved)
+        memcpy(moved, pointer, old_size);
+    return moved;
+}
+
+void DecodeArena::release(void* pointer)
+{
+    if(pointer && pointer == output)
+        output_taken = false;
+    if(!pointer || pointer != last)
+        return;
+    Block &block = blocks.back();
+    size_t start = (unsigned char*)pointer - HEADER - block.memory;
+    used -= block.used - start;
+    block.used = start;
+    last = NULL;
+}
+
+void DecodeArena::reset()
+{
+    peak = std::max(peak, decode_peak);
+    if(blocks.size() > 1 || decode_peak > MAX_RETAINED)
+    {
+        for(size_t i = 0; i < blocks.size(); i++)
+            free(blocks[i].memory);
+        blocks.clear();
+        // One block holding what this decode needed at most, so the next like it fits without growing
+        if(decode_peak <= MAX_RETAINED)
+        {
+            Block block;
+            block.size = std::max(MIN_BLOCK, (decode_peak + MIN_BLOCK - 1) & ~(MIN_BLOCK - 1));
+            block.memory = (unsigned char*)malloc(block.size);
+            block.used = 0;
+            if(block.memory)
+                blocks.push_back(block);
+        }
+    }
+    else if(!blocks.empty())
+        blocks[0].used = 0;
+    last = NULL;
+    output = NULL;
+    output_bytes = 0;
+    output_taken = false;
+    used = 0;
+    decode_peak = 0;
+}
+
+size_t DecodeArena::get_capacity() const
+{
+    size_t capacity = 0;
+    for(size_t i = 0; i < blocks.size(); i++)
+        capacity += blocks[i].size;
+    return capacity;
+}
+
+size_t DecodeArena::get_peak() const
+{
+    return peak;
+}
+
+ImageBufferPool::ImageBufferPool()
+{
+    max_cached = 128 << 20;
+    memset(&stats, 0, sizeof(stats));
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+    trim();
+}
+
+ImageBufferPool& ImageBufferPool::get()
+{
+    static ImageBufferPool pool;
+    return pool;
+}
+
+unsigned char* ImageBufferPool::acquire(size_t bytes)
+{
+    unsigned char* pixels = NULL;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.acquires++;
+        // Smallest cached buffer that fits, as long as it isn't twice the size
+        std::multimap<size_t, unsigned char*>::iterator it = cached.lower_bound(bytes);
+        if(it != cached.end() && it->first / 2 <= bytes)
+        {
+            pixels = it->second;
+            stats.reuses++;
+            stats.cached_bytes -= it->first;
+            cached.erase(it);
+        }
+    }
+
+    if(!pixels)
+    {
+        unsigned char* memory = (unsigned char*)malloc(HEADER + bytes);
+        if(!memory)
+            return NULL;
+        pixels = memory + HEADER;
+        size_of(pixels) = bytes;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.outstanding_bytes += size_of(pixels);
+    stats.peak_outstanding_bytes = std::max(stats.peak_outstanding_bytes, stats.outstanding_bytes);
+    return pixels;
+}
+
+void ImageBufferPool::release(unsigned char* pixels)
+{
+    if(!pixels)
+        return;
+    size_t capacity = size_of(pixels);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.outstanding_bytes -= capacity;
+        if(stats.cached_bytes + capacity <= max_cached)
+        {
+            cached.insert(std::make_pair(capacity, pixels));
+            stats.cached_bytes += capacity;
+            return;
+        }
+    }
+    free(pixels - HEADER);
+}
+
+void ImageBufferPool::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for(std::multimap<size_t, unsigned char*>::iterator it = cached.begin(); it != cached.end(); ++it)
+        free(it->second - HEADER);
+    cached.clear();
+    stats.cached_bytes = 0;
+}
+
+void ImageBufferPool::set_max_cached(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    max_cached = bytes;
+}
+
+ImagePoolStats ImageBufferPool::get_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+namespace
+{
+    // probe fills in the header, load decodes; both wrap one stb entry point
+    template<typename Probe, typename Load>
+    unsigned char* decode_pooled(Probe probe, Load load, int* width, int* height, int* channels, int desired_channels)
+    {
+        int components;
+        if(!channels)
+            channels = &components;
+        ImageBufferPool &pool = ImageBufferPool::get();
+
+        // The header gives the output size, so stb can write the image straight
+        // into a pooled buffer rather than into the arena and be copied out
+        unsigned char* output = NULL;
+        size_t output_bytes = 0;
+        int info_width, info_height, info_channels;
+        if(probe(&info_width, &info_height, &info_channels))
+        {
+            output_bytes = (size_t)info_width * info_height * (desired_channels ? desired_channels : info_channels);
+            output = pool.acquire(output_bytes + 1);
+        }
+
+        DecodeArena &arena = DecodeArena::current();
+        arena.begin();
+        arena.set_output(output, output_bytes);
+        unsigned char* pixels = NULL;
+        unsigned char* data = load(width, height, channels, desired_channels);
+        if(data && data == output)
+        {
+            pixels = output;
+            output = NULL;
+        }
+        else if(data)
+        {
+            // Went through a different route, copy it out before the arena resets
+            size_t bytes = (size_t)*width * *height * (desired_channels ? desired_channels : *channels);
+            pixels = bytes <= output_bytes ? output : pool.acquire(bytes);
+            if(pixels == output)
+                output = NULL;
+            if(pixels)
+                memcpy(pixels, data, bytes);
+            stbi_image_free(data);
+        }
+        arena.end();
+        pool.release(output);
+        return pixels;
+    }
+}
+
+unsigned char* decode_image(const char* path, int* width, int* height, int* channels, int desired_channels, ImageIO io)
+{
+    PROFILE_ZONE("Decode Image");
+    MappedFile file;
+    if(io == IMAGE_IO_MMAP && file.open(path) && file.get_data())
+        return decode_image_from_memory(file.get_data(), file.get_size(), width, height, channels, desired_channels);
+
+    return decode_pooled([path](int* x, int* y, int* components)
+    {
+        return stbi_info(path, x, y, components) != 0;
+    },
+    [path](int* x, int* y, int* components, int desired)
+    {
+        return stbi_load(path, x, y, components, desired);
+    }, width, height, channels, desired_channels);
+}
+
+unsigned char* decode_image_from_memory(const unsigned char* data, size_t size, int* width, int* height, int* channels, int desired_channels)
+{
+    // stb takes the length as an int
+    if(size > 0x7fffffff)
+        return NULL;
+    int length = (int)size;
+    return decode_pooled([data, length](int* x, int* y, int* components)
+    {
+        return stbi_info_from_memory(data, length, x, y, components) != 0;
+    },
+    [data, length](int* x, int* y, int* components, int desired)
+    {
+        return stbi_load_from_memory(data, length, x, y, components, desired);
+    }, width, height, channels, desired_channels);
+}
+
+bool probe_image(const char* path, int* width, int* height, int* channels)
+{
+    // Only the pages holding the header are read in
+    MappedFile file;
+    if(file.open(path, false) && file.get_data() && file.get_size() <= 0x7fffffff)
+        return stbi_info_from_memory(file.get_data(), (int)file.get_size(), width, height, channels) != 0;
+    return stbi_info(path, width, height, channels) != 0;
+}
+
+void release_image(unsigned char* pixels)
+{
+    ImageBufferPool::get().release(pixels);
+}
+
+void* image_decode_malloc(size_t size)
+{
+    DecodeArena &arena = DecodeArena::current();
+    return arena.is_active() ? arena.allocate(size) : malloc(size);
+}
+
+void* image_decode_realloc(void* pointer, size_t size)
+{
+    DecodeArena &arena = DecodeArena::current();
+    // Heap pointers stay on the heap, a decode may free what was loaded outside one
+    if(arena.owns(pointer) || (!pointer && arena.is_active()))
+        return arena.reallocate(pointer, size);
+    return realloc(pointer, size);
+}
+
+void image_decode_free(void* pointer)
+{
+    DecodeArena &arena = DecodeArena::current();
+    if(arena.owns(pointer))
+        arena.release(pointer);
+    else
+        free(pointer);
+}
@@ -0,0 +1,130 @@
+#ifndef IMAGE_DECODE_H
+#define IMAGE_DECODE_H
+
+#include <stddef.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Bump allocator for the scratch memory of one image decode.
+//
+// stb_image allocates through it (see stb.cpp) while a decode is running on
+// the thread: zlib windows, JPEG component buffers, the output before
+// conversion. Freeing only gives memory back when it was the last allocation,
+// realloc grows the last allocation in place. Everything goes at once when
+// the decode ends. Each thread has its own, found through current().
+//
+// A decode whose output size is known up front can hand in the buffer the
+// pixels should end up in: the first allocation of exactly that size gets it
+// instead of arena memory, which for stb_image is the final image.
+class DecodeArena
+{
+private:
+    struct Block
+    {
+        unsigned char* memory;
+        size_t size;
+        size_t used;
+    };
+
+    std::vector<Block> blocks; // Only the last one is bumped
+    unsigned char* last;       // Most recent allocation
+    unsigned char* output;     // See set_output()
+    size_t output_bytes;
+    bool output_taken;
+    int depth;                 // Nested begin() calls
+    size_t used;               // Bytes handed out this decode, headers included
+    size_t decode_peak;        // Most used at once during this decode
+    size_t peak;               // Most one decode has used
+
+    void* bump(size_t size);
+    void reset();
+
+public:
+    // A block holds at least this, one that grows past MAX_RETAINED is freed after the decode
+    static const size_t MIN_BLOCK = 1 << 20;
+    static const size_t MAX_RETAINED = 64 << 20;
+
+    DecodeArena();
+    ~DecodeArena();
+
+    static DecodeArena& current();
+
+    // Allocations between begin() and the matching end() come from the arena,
+    // end() frees them all
+    void begin();
+    void end();
+    bool is_active() const;
+    bool owns(const void* pointer) const;
+    // Until end(), the first allocation of bytes (or bytes + 1) returns buffer,
+    // which must hold bytes + 1. The caller keeps ownership.
+    void set_output(unsigned char* buffer, size_t bytes);
+    bool is_output_taken() const;
+
+    void* allocate(size_t size);
+    void* reallocate(void* pointer, size_t size);
+    void release(void* pointer);
+
+    size_t get_capacity() const;
+    size_t get_peak() const;
+};
+
+struct ImagePoolStats
+{
+    unsigned long long acquires;
+    unsigned long long reuses;    // Acquires served from a cached buffer
+    size_t cached_bytes;          // Released buffers kept for reuse
+    size_t outstanding_bytes;     // Acquired and not yet released
+    size_t peak_outstanding_bytes;
+};
+
+// Recycles decoded pixel buffers. Textures are mostly a handful of sizes, so a
+// buffer released after upload usually fits the next decode as is. A cached
+// buffer is reused for requests down to half its size; past max_cached bytes
+// released buffers are freed instead.
+class ImageBufferPool
+{
+private:
+    std::mutex mutex;
+    std::multimap<size_t, unsigned char*> cached; // Capacity to buffer
+    size_t max_cached;
+    ImagePoolStats stats;
+
+    ImageBufferPool();
+
+public:
+    ~ImageBufferPool();
+
+    static ImageBufferPool& get();
+
+    unsigned char* acquire(size_t bytes);
+    void release(unsigned char* pixels);
+    // Frees every cached buffer
+    void trim();
+
+    void set_max_cached(size_t bytes);
+    ImagePoolStats get_stats();
+};
+
+// Where decode_image() reads the file from: a memory mapping decoded with
+// stbi_load_from_memory, or stb's own buffered stdio reads (stbi_load)
+enum ImageIO { IMAGE_IO_MMAP, IMAGE_IO_STDIO };
+
+// Decodes an image with its scratch memory in the calling thread's
+// DecodeArena. The header is probed first so the pixels land directly in an
+// ImageBufferPool buffer of the right size; give them back with
+// release_image() once uploaded. Returns NULL on failure, stbi_failure_reason()
+// says why. A file that can't be mapped is read through stdio instead.
+unsigned char* decode_image(const char* path, int* width, int* height, int* channels, int desired_channels, ImageIO io = IMAGE_IO_MMAP);
+unsigned char* decode_image_from_memory(const unsigned char* data, size_t size, int* width, int* height, int* channels, int desired_channels);
+// Reads only the header, for sizing storage before the decode
+bool probe_image(const char* path, int* width, int* height, int* channels);
+void release_image(unsigned char* pixels);
+
+// STBI_MALLOC, STBI_REALLOC and STBI_FREE for stb.cpp: the arena while a
+// decode is running on the thread, the C heap otherwise
+void* image_decode_malloc(size_t size);
+void* image_decode_realloc(void* pointer, size_t size);
+void image_decode_free(void* pointer);
+
+#endif // IMAGE_DECODE_H
@@ -0,0 +1,189 @@
+#include "input.h"
+
+#include <stdio.h>
+
+Input::Input()
+{
+    ring_start = 0;
+    ring_count = 0;
+    motion_x = 0;
+    motion_y = 0;
+    wheel = 0;
+    quit = false;
+    frame_events = 0;
+    total_events = 0;
+    coalesced_events = 0;
+    dropped_events = 0;
+}
+
+void Input::begin_frame()
+{
+    ring_start = 0;
+    ring_count = 0;
+    keys_pressed.reset();
+    keys_released.reset();
+    buttons_pressed.reset();
+    buttons_released.reset();
+    motion_x = 0;
+    motion_y = 0;
+    wheel = 0;
+    quit = false;
+    frame_events = 0;
+}
+
+void Input::push(const SDL_Event &event)
+{
+    frame_events++;
+    total_events++;
+
+    switch(event.type)
+    {
+        case(SDL_MOUSEMOTION):
+            motion_x += event.motion.xrel;
+            motion_y += event.motion.yrel;
+            coalesced_events++;
+            return;
+        case(SDL_MOUSEWHEEL):
+            wheel += event.wheel.y;
+            coalesced_events++;
+            return;
+        case(SDL_KEYDOWN):
+        case(SDL_KEYUP):
+        {
+            unsigned int key = (unsigned int)event.key.keysym.scancode;
+            coalesced_events++;
+            // Held state is what drives movement, OS key repeat adds nothing
+            if(event.key.repeat || key >= SDL_NUM_SCANCODES)
+                return;
+            bool down = event.type == SDL_KEYDOWN;
+            keys_held[key] = down;
+            if(down)
+                keys_pressed[key] = true;
+            else
+                keys_released[key] = true;
+            return;
+        }
+        case(SDL_MOUSEBUTTONDOWN):
+        case(SDL_MOUSEBUTTONUP):
+        {
+            unsigned int button = event.button.button;
+            coalesced_events++;
+            if(button >= BUTTON_COUNT)
+                return;
+            bool down = event.type == SDL_MOUSEBUTTONDOWN;
+            buttons_held[button] = down;
+            if(down)
+                buttons_pressed[button] = true;
+            else
+                buttons_released[button] = true;
+            return;
+        }
+        case(SDL_QUIT):
+            quit = true;
+            break;
+        case(SDL_WINDOWEVENT):
+            if(event.window.event == SDL_WINDOWEVENT_CLOSE)
+                quit = true;
+            break;
+    }
+
+    // Everything else is kept for the application, overwriting the oldest when full
+    if(ring_count == EVENT_CAPACITY)
+    {
+        ring_start = (ring_start + 1) % EVENT_CAPACITY;
+        ring_count--;
+        dropped_events++;
+    }
+    ring[(ring_start + ring_count) % EVENT_CAPACITY] = event;
+    ring_count++;
+}
+
+void Input::drain()
+{
+    // One pump and a few large copies instead of an SDL_PollEvent call per event
+    SDL_PumpEvents();
+    SDL_Event batch[BATCH_SIZE];
+    int count;
+    do
+    {
+        count = SDL_PeepEvents(batch, BATCH_SIZE, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+        for(int i = 0; i < count; i++)
+            push(batch[i]);
+    } while(count == (int)BATCH_SIZE);
+}
+
+bool Input::key_held(SDL_Scancode key) const
+{
+    return keys_held[key];
+}
+
+bool Input::key_pressed(SDL_Scancode key) const
+{
+    return keys_pressed[key];
+}
+
+bool Input::key_released(SDL_Scancode key) const
+{
+    return keys_released[key];
+}
+
+bool Input::any_key_held() const
+{
+    return keys_held.any();
+}
+
+bool Input::button_held(unsigned int button) const
+{
+    return button < BUTTON_COUNT && buttons_held[button];
+}
+
+bool Input::any_button_pressed() const
+{
+    return buttons_pressed.any();
+}
+
+bool Input::any_button_released() const
+{
+    return buttons_released.any();
+}
+
+int Input::get_motion_x() const
+{
+    return motion_x;
+}
+
+int Input::get_motion_y() const
+{
+    return motion_y;
+}
+
+int Input::get_wheel() const
+{
+    return wheel;
+}
+
+bool Input::quit_requested() const
+{
+    return quit;
+}
+
+unsigned int Input::get_event_count() const
+{
+    return ring_count;
+}
+
+const SDL_Event& Input::get_event(unsigned int index) const
+{
+    return ring[(ring_start + index) % EVENT_CAPACITY];
+}
+
+bool Input::has_input() const
+{
+    return frame_events > 0;
+}
+
+void Input::print_report() const
+{
+    printf("Input: %llu events, %llu folded into state, %llu dropped from the event ring\n",
+        total_events, coalesced_events, dropped_events);
+}
@@ -0,0 +1,75 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SDL2/SDL.h>
+#include <bitset>
+
+// Input gathered once per frame. drain() pulls SDL's queue in batches and
+// folds it into state: mouse motion and wheel deltas are summed, keys and
+// buttons become bitsets. Events the application still has to look at one by
+// one (quit, window changes) are kept in a fixed-capacity ring; if more than
+// EVENT_CAPACITY of those arrive in one frame the oldest are dropped. A quit
+// or window close is also noted in state, so dropping it never loses it.
+class Input
+{
+private:
+    static const unsigned int EVENT_CAPACITY = 64;
+    static const unsigned int BATCH_SIZE = 128;
+    static const unsigned int BUTTON_COUNT = 8;
+
+    SDL_Event ring[EVENT_CAPACITY];
+    unsigned int ring_start;
+    unsigned int ring_count;
+
+    std::bitset<SDL_NUM_SCANCODES> keys_held;
+    std::bitset<SDL_NUM_SCANCODES> keys_pressed;
+    std::bitset<SDL_NUM_SCANCODES> keys_released;
+    std::bitset<BUTTON_COUNT> buttons_held;
+    std::bitset<BUTTON_COUNT> buttons_pressed;
+    std::bitset<BUTTON_COUNT> buttons_released;
+
+    int motion_x;
+    int motion_y;
+    int wheel;
+    bool quit;
+
+    unsigned int frame_events;
+    unsigned long long total_events;
+    unsigned long long coalesced_events;
+    unsigned long long dropped_events;
+
+public:
+    Input();
+
+    // Clears the per-frame state: deltas, pressed/released sets, kept events
+    void begin_frame();
+    // Folds in one event, for events taken off the queue elsewhere
+    void push(const SDL_Event &event);
+    // Takes everything queued in SDL
+    void drain();
+
+    bool key_held(SDL_Scancode key) const;
+    bool key_pressed(SDL_Scancode key) const;   // Went down this frame, repeats excluded
+    bool key_released(SDL_Scancode key) const;
+    bool any_key_held() const;
+    bool button_held(unsigned int button) const;
+    bool any_button_pressed() const;
+    bool any_button_released() const;
+
+    // Summed over the frame
+    int get_motion_x() const;
+    int get_motion_y() const;
+    int get_wheel() const;
+    // SDL_QUIT or a window close arrived this frame
+    bool quit_requested() const;
+
+    // Events kept for the application this frame, oldest first
+    unsigned int get_event_count() const;
+    const SDL_Event& get_event(unsigned int index) const;
+    // Anything at all arrived this frame
+    bool has_input() const;
+
+    void print_report() const;
+};
+
+#endif // INPUT_H
@@ -0,0 +1,80 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile()
+{
+    data = NULL;
+    size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char* path, bool whole_file)
+{
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    if(info.st_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+
+    // The mapping keeps the file alive, the descriptor isn't needed past here
+    void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED)
+        return false;
+
+    if(whole_file)
+    {
+        madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+        madvise(mapping, (size_t)info.st_size, MADV_WILLNEED);
+    }
+    data = (const unsigned char*)mapping;
+    size = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(data)
+        munmap((void*)data, size);
+    data = NULL;
+    size = 0;
+}
+
+const unsigned char* MappedFile::get_data() const
+{
+    return data;
+}
+
+size_t MappedFile::get_size() const
+{
+    return size;
+}
+
+bool MappedFile::drop_cached(const char* path)
+{
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    ::close(fd);
+    return dropped;
+}
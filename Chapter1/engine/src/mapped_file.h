@@ -0,0 +1,33 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+
+// Read only memory mapping of a whole file. Pages are read in by the kernel
+// as they are touched, with read-ahead told the file is read front to back
+// (MADV_SEQUENTIAL) and wanted now (MADV_WILLNEED), so decoding from it needs
+// no read() calls or copies into a user buffer.
+class MappedFile
+{
+private:
+    const unsigned char* data;
+    size_t size;
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // False if the file can't be opened or mapped. Empty files map to NULL with
+    // size 0. Without whole_file there are no read-ahead hints, for reading a header.
+    bool open(const char* path, bool whole_file = true);
+    void close();
+
+    const unsigned char* get_data() const;
+    size_t get_size() const;
+
+    // Asks the kernel to drop the file's pages from the page cache, for cold
+    // cache measurements. Pages still mapped somewhere stay.
+    static bool drop_cached(const char* path);
+};
+
+#endif // MAPPED_FILE_H
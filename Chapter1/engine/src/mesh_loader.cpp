@@ -0,0 +1,1272 @@
+#include "mesh_loader.h"
+#include "mapped_file.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+
+#include <emmintrin.h>
+
+namespace
+{
+    // Packing
+
+    uint16_t float_to_half(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t float_exponent = (bits >> 23) & 0xFF;
+        uint32_t mantissa = bits & 0x7FFFFF;
+        if(float_exponent == 0xFF)
+            return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+        int exponent = (int)float_exponent - 127 + 15;
+        if(exponent >= 31)
+            return (uint16_t)(sign | 0x7C00);
+        if(exponent <= 0)
+        {
+            // Subnormal half, or too small for one
+            if(exponent < -10)
+                return (uint16_t)sign;
+            mantissa |= 0x800000;
+            int shift = 14 - exponent;
+            uint32_t half = mantissa >> shift;
+            if((mantissa >> (shift - 1)) & 1)
+                half++;
+            return (uint16_t)(sign | half);
+        }
+        // Rounding can carry into the exponent, which is still the right value
+        uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+        if(mantissa & 0x1000)
+            half++;
+        return (uint16_t)half;
+    }
+
+    uint32_t pack_snorm10(float value)
+    {
+        value = std::max(-1.0f, std::min(1.0f, value));
+        return (uint32_t)(int)lroundf(value * 511.0f) & 0x3FF;
+    }
+
+    uint32_t pack_normal(float x, float y, float z)
+    {
+        float length = sqrtf(x * x + y * y + z * z);
+        if(length > 0.0f)
+        {
+            x /= length;
+            y /= length;
+            z /= length;
+        }
+        return pack_snorm10(x) | (pack_snorm10(y) << 10) | (pack_snorm10(z) << 20);
+    }
+
+    void add_to_bounds(MeshData &mesh, const float* position)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            mesh.bounds_min[i] = std::min(mesh.bounds_min[i], position[i]);
+            mesh.bounds_max[i] = std::max(mesh.bounds_max[i], position[i]);
+        }
+    }
+
+    // Area weighted smooth normals for the vertices from first_vertex on, from
+    // the triangles from first_index on
+    void generate_normals(MeshData &mesh, size_t first_vertex, size_t first_index, std::vector<float> &sums)
+    {
+        size_t count = mesh.vertices.size() - first_vertex;
+        sums.assign(count * 3, 0.0f);
+        for(size_t i = first_index; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const float* a = mesh.vertices[mesh.indices[i]].position;
+            const float* b = mesh.vertices[mesh.indices[i + 1]].position;
+            const float* c = mesh.vertices[mesh.indices[i + 2]].position;
+            float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            // Not normalised, so bigger triangles count for more
+            float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+            for(int corner = 0; corner < 3; corner++)
+            {
+                float* sum = &sums[(mesh.indices[i + corner] - first_vertex) * 3];
+                sum[0] += normal[0];
+                sum[1] += normal[1];
+                sum[2] += normal[2];
+            }
+        }
+        for(size_t i = 0; i < count; i++)
+            mesh.vertices[first_vertex + i].normal = pack_normal(sums[i * 3], sums[i * 3 + 1], sums[i * 3 + 2]);
+    }
+
+    // Number parsing. Digit runs are found 16 bytes at a time with SSE2 and
+    // converted 8 digits at a time inside a 64 bit register, so a typical
+    // "-0.123456" costs a handful of instructions instead of one per character.
+
+    const double POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    inline size_t digit_run(const char* p, const char* end, bool simd)
+    {
+        size_t run = 0;
+        if(simd)
+        {
+            const __m128i zero = _mm_set1_epi8('0');
+            const __m128i nine = _mm_set1_epi8(9);
+            while(end - (p + run) >= 16)
+            {
+                // Digits are 0-9 after subtracting '0', everything else wraps above 9
+                __m128i chunk = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(p + run)), zero);
+                __m128i digits = _mm_cmpeq_epi8(_mm_min_epu8(chunk, nine), chunk);
+                unsigned int others = ~(unsigned int)_mm_movemask_epi8(digits) & 0xFFFF;
+                if(others)
+                    return run + __builtin_ctz(others);
+                run += 16;
+            }
+        }
+        while(p + run < end && (unsigned char)(p[run] - '0') < 10)
+            run++;
+        return run;
+    }
+
+    // Eight ASCII digits to their value, the first digit in the lowest byte
+    inline uint32_t parse_eight_digits(const char* p)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        value -= 0x3030303030303030ULL;
+        value = (value * 10 + (value >> 8)) & 0x00FF00FF00FF00FFULL;
+        value = (value * 100 + (value >> 16)) & 0x0000FFFF0000FFFFULL;
+        value = (value * 10000 + (value >> 32)) & 0xFFFFFFFFULL;
+        return (uint32_t)value;
+    }
+
+    // Adds a run of digits to mantissa. Fraction digits lower the exponent,
+    // integer digits past what 64 bits hold raise it instead.
+    inline void take_digits(const char* p, size_t run, bool fraction, uint64_t &mantissa, int &exponent)
+    {
+        size_t i = 0;
+        while(run - i >= 8 && mantissa < 100000000000ULL)
+        {
+            mantissa = mantissa * 100000000ULL + parse_eight_digits(p + i);
+            if(fraction)
+                exponent -= 8;
+            i += 8;
+        }
+        for(; i < run; i++)
+        {
+            if(mantissa < 1000000000000000000ULL)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(p[i] - '0');
+                if(fraction)
+                    exponent--;
+            }
+            else if(!fraction)
+                exponent++;
+        }
+    }
+
+    bool parse_float(const char* &p, const char* end, bool simd, float &value)
+    {
+        const char* start = p;
+        bool negative = false;
+        if(p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            p++;
+        }
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        size_t run = digit_run(p, end, simd);
+        take_digits(p, run, false, mantissa, exponent);
+        p += run;
+        size_t digits = run;
+        if(p < end && *p == '.')
+        {
+            p++;
+            run = digit_run(p, end, simd);
+            take_digits(p, run, true, mantissa, exponent);
+            p += run;
+            digits += run;
+        }
+        if(digits == 0)
+        {
+            p = start;
+            return false;
+        }
+        if(p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char* e = p + 1;
+            bool negative_exponent = false;
+            if(e < end && (*e == '-' || *e == '+'))
+            {
+                negative_exponent = *e == '-';
+                e++;
+            }
+            size_t exponent_run = digit_run(e, end, false);
+            if(exponent_run > 0)
+            {
+                int written = 0;
+                for(size_t i = 0; i < exponent_run && written < 10000; i++)
+                    written = written * 10 + (e[i] - '0');
+                exponent += negative_exponent ? -written : written;
+                p = e + exponent_run;
+            }
+        }
+
+        // Exact while the mantissa has 53 bits or less and the power is in the table
+        double result = (double)mantissa;
+        exponent = std::max(-400, std::min(400, exponent));
+        if(mantissa == 0)
+            exponent = 0;
+        for(; exponent < -22; exponent += 22)
+            result /= 1e22;
+        for(; exponent > 22; exponent -= 22)
+            result *= 1e22;
+        result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+        value = (float)(negative ? -result : result);
+        return true;
+    }
+
+    bool parse_int(const char* &p, const char* end, bool simd, int &value)
+    {
+        bool negative = false;
+        if(p < end && *p == '-')
+        {
+            negative = true;
+            p++;
+        }
+        size_t run = digit_run(p, end, simd);
+        if(run == 0 || run > 10)
+            return false;
+        uint64_t result = 0;
+        size_t i = 0;
+        if(run >= 8)
+        {
+            result = parse_eight_digits(p);
+            i = 8;
+        }
+        for(; i < run; i++)
+            result = result * 10 + (uint64_t)(p[i] - '0');
+        if(result > 0x7FFFFFFF)
+            return false;
+        p += run;
+        value = negative ? -(int)result : (int)result;
+        return true;
+    }
+
+    inline void skip_spaces(const char* &p, const char* end)
+    {
+        while(p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+    }
+
+    // OBJ
+
+    // A face corner's v/vt/vn, and the vertex made for it
+    struct CornerSlot
+    {
+        int position;   // -1 for an empty slot
+        int texcoord;   // -1 when the corner has none
+        int normal;
+        uint32_t vertex;
+    };
+
+    struct ObjScratch
+    {
+        std::vector<float> positions;
+        std::vector<float> texcoords;
+        std::vector<float> normals;
+        std::vector<CornerSlot> table;
+        size_t table_used;
+        std::vector<float> normal_sums;
+    };
+
+    ObjScratch& obj_scratch()
+    {
+        static thread_local ObjScratch scratch;
+        return scratch;
+    }
+
+    inline uint32_t hash_corner(int position, int texcoord, int normal)
+    {
+        uint32_t hash = (uint32_t)position * 0x9E3779B1u ^ (uint32_t)texcoord * 0x85EBCA77u ^ (uint32_t)normal * 0xC2B2AE3Du;
+        return hash ^ (hash >> 15);
+    }
+
+    void reset_table(ObjScratch &scratch, size_t capacity)
+    {
+        CornerSlot empty = { -1, -1, -1, 0 };
+        scratch.table.assign(capacity, empty);
+        scratch.table_used = 0;
+    }
+
+    void grow_table(ObjScratch &scratch)
+    {
+        std::vector<CornerSlot> old;
+        old.swap(scratch.table);
+        reset_table(scratch, old.size() * 2);
+        size_t mask = scratch.table.size() - 1;
+        for(size_t i = 0; i < old.size(); i++)
+        {
+            if(old[i].position < 0)
+                continue;
+            size_t slot = hash_corner(old[i].position, old[i].texcoord, old[i].normal) & mask;
+            while(scratch.table[slot].position >= 0)
+                slot = (slot + 1) & mask;
+            scratch.table[slot] = old[i];
+            scratch.table_used++;
+        }
+    }
+
+    // The vertex for a corner, made the first time the combination is seen
+    uint32_t corner_vertex(ObjScratch &scratch, MeshData &mesh, int position, int texcoord, int normal)
+    {
+        if((scratch.table_used + 1) * 2 > scratch.table.size())
+            grow_table(scratch);
+        size_t mask = scratch.table.size() - 1;
+        size_t slot = hash_corner(position, texcoord, normal) & mask;
+        while(scratch.table[slot].position >= 0)
+        {
+            const CornerSlot &existing = scratch.table[slot];
+            if(existing.position == position && existing.texcoord == texcoord && existing.normal == normal)
+                return existing.vertex;
+            slot = (slot + 1) & mask;
+        }
+
+        MeshVertex vertex;
+        memcpy(vertex.position, &scratch.positions[(size_t)position * 3], sizeof(vertex.position));
+        add_to_bounds(mesh, vertex.position);
+        if(normal >= 0)
+        {
+            const float* n = &scratch.normals[(size_t)normal * 3];
+            vertex.normal = pack_normal(n[0], n[1], n[2]);
+        }
+        else
+            vertex.normal = 0;
+        if(texcoord >= 0)
+        {
+            vertex.texcoord[0] = float_to_half(scratch.texcoords[(size_t)texcoord * 2]);
+            vertex.texcoord[1] = float_to_half(scratch.texcoords[(size_t)texcoord * 2 + 1]);
+        }
+        else
+            vertex.texcoord[0] = vertex.texcoord[1] = 0;
+        mesh.vertices.push_back(vertex);
+
+        CornerSlot &added = scratch.table[slot];
+        added.position = position;
+        added.texcoord = texcoord;
+        added.normal = normal;
+        added.vertex = (uint32_t)mesh.vertices.size() - 1;
+        scratch.table_used++;
+        return added.vertex;
+    }
+
+    // OBJ indices start at 1, negative ones count back from the last element
+    inline bool resolve_index(int index, size_t count, int &resolved)
+    {
+        resolved = index > 0 ? index - 1 : (int)count + index;
+        return index != 0 && resolved >= 0 && (size_t)resolved < count;
+    }
+
+    bool read_floats(const char* &p, const char* end, bool simd, float* values, int required, int optional)
+    {
+        for(int i = 0; i < required + optional; i++)
+        {
+            skip_spaces(p, end);
+            if(p >= end || *p == '#')
+            {
+                if(i < required)
+                    return false;
+                values[i] = 0.0f;
+                continue;
+            }
+            if(!parse_float(p, end, simd, values[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // glTF
+
+    struct JsonValue
+    {
+        enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+        JsonValue() : type(JSON_NULL), number(0.0) {}
+
+        Type type;
+        double number;
+        std::string string;
+        std::vector<JsonValue> items;   // Array elements, or object values
+        std::vector<std::string> keys;  // Object keys, one per item
+
+        const JsonValue* find(const char* key) const
+        {
+            for(size_t i = 0; i < keys.size(); i++)
+                if(keys[i] == key)
+                    return &items[i];
+            return NULL;
+        }
+
+        const JsonValue* at(size_t index) const
+        {
+            return type == JSON_ARRAY && index < items.size() ? &items[index] : NULL;
+        }
+
+        double get_number(const char* key, double fallback) const
+        {
+            const JsonValue* value = find(key);
+            return value && value->type == JSON_NUMBER ? value->number : fallback;
+        }
+
+        // Out of range or NaN would be undefined to cast, fallback instead
+        int as_int(int fallback) const
+        {
+            return type == JSON_NUMBER && number >= -2147483648.0 && number <= 2147483647.0 ? (int)number : fallback;
+        }
+
+        int get_int(const char* key, int fallback) const
+        {
+            const JsonValue* value = find(key);
+            return value ? value->as_int(fallback) : fallback;
+        }
+
+        // A count, offset or length: false unless missing (fallback) or a
+        // whole number from 0 to 2^53, the integers a double holds exactly
+        bool get_size(const char* key, size_t fallback, size_t &size) const
+        {
+            const JsonValue* value = find(key);
+            if(!value)
+            {
+                size = fallback;
+                return true;
+            }
+            double number = value->number;
+            if(value->type != JSON_NUMBER || !(number >= 0.0 && number <= 9007199254740992.0) || number != floor(number))
+                return false;
+            size = (size_t)number;
+            return true;
+        }
+    };
+
+    // Just enough JSON for a glTF header, which is small next to its BIN chunk
+    class JsonParser
+    {
+    private:
+        const char* p;
+        const char* end;
+
+        void skip_whitespace()
+        {
+            while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+                p++;
+        }
+
+        bool parse_string(std::string &out)
+        {
+            if(p >= end || *p != '"')
+                return false;
+            p++;
+            out.clear();
+            while(p < end && *p != '"')
+            {
+                char c = *p++;
+                if(c != '\\')
+                {
+                    out += c;
+                    continue;
+                }
+                if(p >= end)
+                    return false;
+                c = *p++;
+                switch(c)
+                {
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u':
+                {
+                    if(end - p < 4)
+                        return false;
+                    char hex[5] = { p[0], p[1], p[2], p[3], 0 };
+                    unsigned int code = (unsigned int)strtoul(hex, NULL, 16);
+                    p += 4;
+                    // UTF-8, surrogate pairs are left as two code units
+                    if(code < 0x80)
+                        out += (char)code;
+                    else if(code < 0x800)
+                    {
+                        out += (char)(0xC0 | (code >> 6));
+                        out += (char)(0x80 | (code & 0x3F));
+                    }
+                    else
+                    {
+                        out += (char)(0xE0 | (code >> 12));
+                        out += (char)(0x80 | ((code >> 6) & 0x3F));
+                        out += (char)(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: out += c; break;
+                }
+            }
+            if(p >= end)
+                return false;
+            p++;
+            return true;
+        }
+
+        bool parse_value(JsonValue &value, int depth)
+        {
+            skip_whitespace();
+            if(p >= end || depth > 64)
+                return false;
+            if(*p == '{' || *p == '[')
+            {
+                bool object = *p == '{';
+                char close = object ? '}' : ']';
+                value.type = object ? JsonValue::JSON_OBJECT : JsonValue::JSON_ARRAY;
+                p++;
+                skip_whitespace();
+                if(p < end && *p == close)
+                {
+                    p++;
+                    return true;
+                }
+                while(true)
+                {
+                    if(object)
+                    {
+                        skip_whitespace();
+                        value.keys.push_back(std::string());
+                        if(!parse_string(value.keys.back()))
+                            return false;
+                        skip_whitespace();
+                        if(p >= end || *p != ':')
+                            return false;
+                        p++;
+                    }
+                    value.items.push_back(JsonValue());
+                    if(!parse_value(value.items.back(), depth + 1))
+                        return false;
+                    skip_whitespace();
+                    if(p < end && *p == ',')
+                    {
+                        p++;
+                        continue;
+                    }
+                    if(p < end && *p == close)
+                    {
+                        p++;
+                        return true;
+                    }
+                    return false;
+                }
+            }
+            if(*p == '"')
+            {
+                value.type = JsonValue::JSON_STRING;
+                return parse_string(value.string);
+            }
+            if(end - p >= 4 && strncmp(p, "true", 4) == 0)
+            {
+                value.type = JsonValue::JSON_BOOL;
+                value.number = 1.0;
+                p += 4;
+                return true;
+            }
+            if(end - p >= 5 && strncmp(p, "false", 5) == 0)
+            {
+                value.type = JsonValue::JSON_BOOL;
+                p += 5;
+                return true;
+            }
+            if(end - p >= 4 && strncmp(p, "null", 4) == 0)
+            {
+                p += 4;
+                return true;
+            }
+
+            // The chunk isn't null terminated, strtod gets a copy
+            char number[64];
+            size_t length = 0;
+            while(p + length < end && length < sizeof(number) - 1 && strchr("+-.eE0123456789", p[length]))
+                length++;
+            if(length == 0)
+                return false;
+            memcpy(number, p, length);
+            number[length] = 0;
+            value.type = JsonValue::JSON_NUMBER;
+            value.number = strtod(number, NULL);
+            p += length;
+            return true;
+        }
+
+    public:
+        bool parse(const char* data, size_t size, JsonValue &root)
+        {
+            p = data;
+            end = data + size;
+            return parse_value(root, 0);
+        }
+    };
+
+    // Column major like GL
+    struct Matrix
+    {
+        float m[16];
+    };
+
+    Matrix identity()
+    {
+        Matrix result;
+        for(int i = 0; i < 16; i++)
+            result.m[i] = i % 5 == 0 ? 1.0f : 0.0f;
+        return result;
+    }
+
+    Matrix multiply(const Matrix &a, const Matrix &b)
+    {
+        Matrix result;
+        for(int column = 0; column < 4; column++)
+            for(int row = 0; row < 4; row++)
+            {
+                float sum = 0.0f;
+                for(int k = 0; k < 4; k++)
+                    sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+                result.m[column * 4 + row] = sum;
+            }
+        return result;
+    }
+
+    // A node's matrix, or its translation * rotation * scale
+    Matrix node_matrix(const JsonValue &node)
+    {
+        Matrix result = identity();
+        const JsonValue* matrix = node.find("matrix");
+        if(matrix && matrix->items.size() == 16)
+        {
+            for(int i = 0; i < 16; i++)
+                result.m[i] = (float)matrix->items[i].number;
+            return result;
+        }
+
+        float t[3] = { 0.0f, 0.0f, 0.0f };
+        float r[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        float s[3] = { 1.0f, 1.0f, 1.0f };
+        const JsonValue* translation = node.find("translation");
+        const JsonValue* rotation = node.find("rotation");
+        const JsonValue* scale = node.find("scale");
+        for(int i = 0; i < 3; i++)
+        {
+            if(translation && translation->items.size() == 3)
+                t[i] = (float)translation->items[i].number;
+            if(scale && scale->items.size() == 3)
+                s[i] = (float)scale->items[i].number;
+        }
+        if(rotation && rotation->items.size() == 4)
+            for(int i = 0; i < 4; i++)
+                r[i] = (float)rotation->items[i].number;
+
+        float x = r[0], y = r[1], z = r[2], w = r[3];
+        float rotate[9] = {
+            1 - 2 * (y * y + z * z), 2 * (x * y + z * w),     2 * (x * z - y * w),
+            2 * (x * y - z * w),     1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+            2 * (x * z + y * w),     2 * (y * z - x * w),     1 - 2 * (x * x + y * y)
+        };
+        for(int column = 0; column < 3; column++)
+            for(int row = 0; row < 3; row++)
+                result.m[column * 4 + row] = rotate[column * 3 + row] * s[column];
+        result.m[12] = t[0];
+        result.m[13] = t[1];
+        result.m[14] = t[2];
+        return result;
+    }
+
+    struct Accessor
+    {
+        const unsigned char* data;
+        size_t count;
+        size_t stride;
+        int component_type;
+        int components;
+        bool normalized;
+    };
+
+    int component_size(int component_type)
+    {
+        switch(component_type)
+        {
+        case 5120:  // BYTE
+        case 5121:  return 1;  // UNSIGNED_BYTE
+        case 5122:  // SHORT
+        case 5123:  return 2;  // UNSIGNED_SHORT
+        case 5125:  // UNSIGNED_INT
+        case 5126:  return 4;  // FLOAT
+        default:    return 0;
+        }
+    }
+
+    int type_components(const std::string &type)
+    {
+        if(type == "SCALAR") return 1;
+        if(type == "VEC2") return 2;
+        if(type == "VEC3") return 3;
+        if(type == "VEC4") return 4;
+        return 0;
+    }
+
+    float read_component(const unsigned char* p, int component_type, bool normalized)
+    {
+        switch(component_type)
+        {
+        case 5120: { int8_t v; memcpy(&v, p, 1); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+        case 5121: return normalized ? p[0] / 255.0f : p[0];
+        case 5122: { int16_t v; memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+        case 5123: { uint16_t v; memcpy(&v, p, 2); return normalized ? v / 65535.0f : v; }
+        case 5125: { uint32_t v; memcpy(&v, p, 4); return (float)v; }
+        default:   { float v; memcpy(&v, p, 4); return v; }
+        }
+    }
+
+    uint32_t read_index(const unsigned char* p, int component_type)
+    {
+        if(component_type == 5121)
+            return p[0];
+        if(component_type == 5123)
+        {
+            uint16_t v;
+            memcpy(&v, p, 2);
+            return v;
+        }
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+
+    struct GlbContext
+    {
+        JsonValue root;
+        const unsigned char* bin;
+        size_t bin_size;
+        const MeshLoadOptions* options;
+        MeshData* mesh;
+        std::string error;
+        std::vector<float> normal_sums;
+    };
+
+    bool get_accessor(GlbContext &context, int index, int components, Accessor &accessor)
+    {
+        const JsonValue* accessors = context.root.find("accessors");
+        const JsonValue* json = accessors ? accessors->at(index) : NULL;
+        if(!json)
+        {
+            context.error = "missing accessor " + std::to_string(index);
+            return false;
+        }
+        if(json->find("sparse"))
+        {
+            context.error = "sparse accessors aren't supported";
+            return false;
+        }
+        const JsonValue* views = context.root.find("bufferViews");
+        const JsonValue* view = views ? views->at(json->get_int("bufferView", -1)) : NULL;
+        if(!view || view->get_int("buffer", 0) != 0)
+        {
+            context.error = "accessor " + std::to_string(index) + " has no data in the BIN chunk";
+            return false;
+        }
+
+        const JsonValue* type = json->find("type");
+        accessor.component_type = json->get_int("componentType", 0);
+        accessor.components = type ? type_components(type->string) : 0;
+        accessor.normalized = json->get_number("normalized", 0.0) != 0.0;
+        size_t element = (size_t)component_size(accessor.component_type) * accessor.components;
+        if(element == 0 || accessor.components < components)
+        {
+            context.error = "accessor " + std::to_string(index) + " has an unsupported type";
+            return false;
+        }
+
+        size_t view_offset, view_length, offset;
+        if(!json->get_size("count", 0, accessor.count) || !json->get_size("byteOffset", 0, offset)
+            || !view->get_size("byteOffset", 0, view_offset) || !view->get_size("byteLength", 0, view_length)
+            || !view->get_size("byteStride", 0, accessor.stride))
+        {
+            context.error = "accessor " + std::to_string(index) + " has a count, offset or length that isn't a size";
+            return false;
+        }
+        // The spec's limit, and at least one element apart
+        if(accessor.stride == 0)
+            accessor.stride = element;
+        if(accessor.stride < element || accessor.stride > 252)
+        {
+            context.error = "accessor " + std::to_string(index) + " has a byteStride of " + std::to_string(accessor.stride);
+            return false;
+        }
+
+        // Every term is checked against what is left, so nothing can wrap
+        if(view_offset > context.bin_size || view_length > context.bin_size - view_offset
+            || (accessor.count > 0 && (offset > view_length || element > view_length - offset
+                || accessor.count - 1 > (view_length - offset - element) / accessor.stride)))
+        {
+            context.error = "accessor " + std::to_string(index) + " reads past its buffer view";
+            return false;
+        }
+        accessor.data = context.bin + view_offset + offset;
+        return true;
+    }
+
+    bool add_primitive(GlbContext &context, const JsonValue &primitive, const Matrix &world)
+    {
+        // Points and lines are skipped
+        if(primitive.get_int("mode", 4) != 4)
+            return true;
+        const JsonValue* attributes = primitive.find("attributes");
+        if(!attributes || !attributes->find("POSITION"))
+        {
+            context.error = "primitive without POSITION";
+            return false;
+        }
+
+        Accessor positions, normals, texcoords, indices;
+        if(!get_accessor(context, attributes->get_int("POSITION", -1), 3, positions))
+            return false;
+        bool has_normals = attributes->find("NORMAL") != NULL;
+        bool has_texcoords = attributes->find("TEXCOORD_0") != NULL;
+        bool indexed = primitive.find("indices") != NULL;
+        if((has_normals && !get_accessor(context, attributes->get_int("NORMAL", -1), 3, normals))
+            || (has_texcoords && !get_accessor(context, attributes->get_int("TEXCOORD_0", -1), 2, texcoords))
+            || (indexed && !get_accessor(context, primitive.get_int("indices", -1), 1, indices)))
+            return false;
+        // The spec only allows unsigned SCALAR indices, read_index reads nothing else
+        if(indexed && (indices.components != 1
+            || (indices.component_type != 5121 && indices.component_type != 5123 && indices.component_type != 5125)))
+        {
+            context.error = "index accessor isn't an unsigned byte, short or int SCALAR";
+            return false;
+        }
+        if((has_normals && normals.count < positions.count) || (has_texcoords && texcoords.count < positions.count))
+        {
+            context.error = "primitive attributes have fewer elements than POSITION";
+            return false;
+        }
+
+        // Normals go through the cofactor matrix, the inverse transpose up to
+        // scale. A mirroring transform also flips the winding.
+        const float* m = world.m;
+        float cofactor[9] = {
+            m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+            m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+            m[1] * m[6] - m[2] * m[5],  m[2] * m[4] - m[0] * m[6],  m[0] * m[5] - m[1] * m[4]
+        };
+        float determinant = m[0] * cofactor[0] + m[1] * cofactor[1] + m[2] * cofactor[2];
+        bool mirrored = determinant < 0.0f;
+
+        MeshData &mesh = *context.mesh;
+        size_t first_vertex = mesh.vertices.size();
+        size_t first_index = mesh.indices.size();
+        for(size_t i = 0; i < positions.count; i++)
+        {
+            MeshVertex vertex;
+            const unsigned char* p = positions.data + i * positions.stride;
+            size_t size = (size_t)component_size(positions.component_type);
+            float x = read_component(p, positions.component_type, positions.normalized);
+            float y = read_component(p + size, positions.component_type, positions.normalized);
+            float z = read_component(p + size * 2, positions.component_type, positions.normalized);
+            for(int row = 0; row < 3; row++)
+                vertex.position[row] = m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row];
+            add_to_bounds(mesh, vertex.position);
+
+            vertex.normal = 0;
+            if(has_normals)
+            {
+                p = normals.data + i * normals.stride;
+                size = (size_t)component_size(normals.component_type);
+                float n[3];
+                for(int c = 0; c < 3; c++)
+                    n[c] = read_component(p + size * c, normals.component_type, normals.normalized);
+                float sign = mirrored ? -1.0f : 1.0f;
+                vertex.normal = pack_normal(
+                    sign * (cofactor[0] * n[0] + cofactor[3] * n[1] + cofactor[6] * n[2]),
+                    sign * (cofactor[1] * n[0] + cofactor[4] * n[1] + cofactor[7] * n[2]),
+                    sign * (cofactor[2] * n[0] + cofactor[5] * n[1] + cofactor[8] * n[2]));
+            }
+
+            vertex.texcoord[0] = vertex.texcoord[1] = 0;
+            if(has_texcoords)
+            {
+                // glTF's origin is the top left
+                p = texcoords.data + i * texcoords.stride;
+                size = (size_t)component_size(texcoords.component_type);
+                vertex.texcoord[0] = float_to_half(read_component(p, texcoords.component_type, texcoords.normalized));
+                vertex.texcoord[1] = float_to_half(1.0f - read_component(p + size, texcoords.component_type, texcoords.normalized));
+            }
+            mesh.vertices.push_back(vertex);
+        }
+
+        size_t count = indexed ? indices.count : positions.count;
+        count -= count % 3;
+        for(size_t i = 0; i < count; i += 3)
+        {
+            uint32_t corners[3];
+            for(int c = 0; c < 3; c++)
+            {
+                corners[c] = indexed ? read_index(indices.data + (i + c) * indices.stride, indices.component_type) : (uint32_t)(i + c);
+                if(corners[c] >= positions.count)
+                {
+                    context.error = "index out of range";
+                    return false;
+                }
+            }
+            mesh.indices.push_back((uint32_t)first_vertex + corners[0]);
+            mesh.indices.push_back((uint32_t)first_vertex + corners[mirrored ? 2 : 1]);
+            mesh.indices.push_back((uint32_t)first_vertex + corners[mirrored ? 1 : 2]);
+        }
+
+        if(!has_normals)
+        {
+            mesh.has_normals = false;
+            if(context.options->generate_normals)
+                generate_normals(mesh, first_vertex, first_index, context.normal_sums);
+        }
+        if(has_texcoords)
+            mesh.has_texcoords = true;
+        return true;
+    }
+
+    bool add_node(GlbContext &context, int index, const Matrix &parent, int depth)
+    {
+        const JsonValue* nodes = context.root.find("nodes");
+        const JsonValue* node = nodes ? nodes->at(index) : NULL;
+        if(!node || depth > 64)
+        {
+            context.error = node ? "node hierarchy too deep or cyclic" : "missing node " + std::to_string(index);
+            return false;
+        }
+        Matrix world = multiply(parent, node_matrix(*node));
+
+        const JsonValue* meshes = context.root.find("meshes");
+        if(node->find("mesh"))
+        {
+            const JsonValue* mesh = meshes ? meshes->at(node->get_int("mesh", -1)) : NULL;
+            const JsonValue* primitives = mesh ? mesh->find("primitives") : NULL;
+            if(!primitives)
+            {
+                context.error = "node " + std::to_string(index) + " has a missing mesh";
+                return false;
+            }
+            for(size_t i = 0; i < primitives->items.size(); i++)
+                if(!add_primitive(context, primitives->items[i], world))
+                    return false;
+        }
+
+        const JsonValue* children = node->find("children");
+        if(children)
+            for(size_t i = 0; i < children->items.size(); i++)
+                if(!add_node(context, children->items[i].as_int(-1), world, depth + 1))
+                    return false;
+        return true;
+    }
+
+    uint32_t read_u32(const unsigned char* p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    void finish(MeshData &mesh)
+    {
+        if(mesh.vertices.empty())
+            for(int i = 0; i < 3; i++)
+                mesh.bounds_min[i] = mesh.bounds_max[i] = 0.0f;
+    }
+}
+
+MeshData::MeshData()
+{
+    clear();
+}
+
+size_t MeshData::get_triangle_count() const
+{
+    return indices.size() / 3;
+}
+
+void MeshData::clear()
+{
+    // Keeps the capacity, so a reused MeshData doesn't allocate again
+    vertices.clear();
+    indices.clear();
+    for(int i = 0; i < 3; i++)
+    {
+        bounds_min[i] = HUGE_VALF;
+        bounds_max[i] = -HUGE_VALF;
+    }
+    has_normals = true;
+    has_texcoords = false;
+}
+
+MeshLoadOptions::MeshLoadOptions()
+{
+    simd = true;
+    generate_normals = true;
+}
+
+bool load_obj_from_memory(const char* data, size_t size, MeshData &mesh, std::string &error, const MeshLoadOptions &options)
+{
+    mesh.clear();
+    ObjScratch &scratch = obj_scratch();
+    scratch.positions.clear();
+    scratch.texcoords.clear();
+    scratch.normals.clear();
+    // Room for one unique corner per 64 bytes of file at half load, so the
+    // table rarely has to grow
+    size_t capacity = 1024;
+    while(capacity < size / 32)
+        capacity *= 2;
+    reset_table(scratch, capacity);
+    bool missing_normals = false;
+
+    const char* p = data;
+    const char* end = data + size;
+    size_t line = 1;
+    for(; p < end; line++)
+    {
+        skip_spaces(p, end);
+        const char* line_end = (const char*)memchr(p, '\n', end - p);
+        if(!line_end)
+            line_end = end;
+
+        bool ok = true;
+        if(line_end - p >= 2 && p[0] == 'v')
+        {
+            float values[3];
+            const char* q = p + 2;
+            if(p[1] == ' ' || p[1] == '\t')
+            {
+                ok = read_floats(q, line_end, options.simd, values, 3, 0);
+                scratch.positions.insert(scratch.positions.end(), values, values + 3);
+            }
+            else if(p[1] == 't')
+            {
+                ok = read_floats(q, line_end, options.simd, values, 1, 1);
+                scratch.texcoords.insert(scratch.texcoords.end(), values, values + 2);
+            }
+            else if(p[1] == 'n')
+            {
+                ok = read_floats(q, line_end, options.simd, values, 3, 0);
+                scratch.normals.insert(scratch.normals.end(), values, values + 3);
+            }
+        }
+        else if(line_end - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            // Polygons become a fan around their first corner
+            const char* q = p + 2;
+            int corners = 0;
+            uint32_t first = 0, previous = 0;
+            while(ok)
+            {
+                skip_spaces(q, line_end);
+                if(q >= line_end || *q == '#')
+                    break;
+                int v, vt = 0, vn = 0;
+                ok = parse_int(q, line_end, options.simd, v);
+                if(ok && q < line_end && *q == '/')
+                {
+                    q++;
+                    if(q < line_end && *q != '/')
+                        ok = parse_int(q, line_end, options.simd, vt);
+                    if(ok && q < line_end && *q == '/')
+                    {
+                        q++;
+                        ok = parse_int(q, line_end, options.simd, vn);
+                    }
+                }
+                int position, texcoord = -1, normal = -1;
+                if(ok && (!resolve_index(v, scratch.positions.size() / 3, position)
+                    || (vt && !resolve_index(vt, scratch.texcoords.size() / 2, texcoord))
+                    || (vn && !resolve_index(vn, scratch.normals.size() / 3, normal))))
+                {
+                    error = "line " + std::to_string(line) + ": face index out of range";
+                    return false;
+                }
+                if(!ok)
+                    break;
+                missing_normals |= normal < 0;
+
+                uint32_t vertex = corner_vertex(scratch, mesh, position, texcoord, normal);
+                if(corners == 0)
+                    first = vertex;
+                else if(corners >= 2)
+                {
+                    mesh.indices.push_back(first);
+                    mesh.indices.push_back(previous);
+                    mesh.indices.push_back(vertex);
+                }
+                previous = vertex;
+                corners++;
+            }
+        }
+        if(!ok)
+        {
+            error = "line " + std::to_string(line) + ": can't parse \"" + std::string(p, std::min<size_t>(line_end - p, 40)) + "\"";
+            return false;
+        }
+        p = line_end + 1;
+    }
+
+    mesh.has_texcoords = !scratch.texcoords.empty();
+    mesh.has_normals = !missing_normals;
+    // Corners without one keep a zero normal unless the file has none at all
+    if(scratch.normals.empty() && options.generate_normals)
+        generate_normals(mesh, 0, 0, scratch.normal_sums);
+    finish(mesh);
+    return true;
+}
+
+bool load_obj(const char* path, MeshData &mesh, std::string &error, const MeshLoadOptions &options)
+{
+    MappedFile file;
+    if(!file.open(path))
+    {
+        error = std::string("can't open ") + path;
+        return false;
+    }
+    if(!load_obj_from_memory((const char*)file.get_data(), file.get_size(), mesh, error, options))
+    {
+        error = std::string(path) + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool load_glb_from_memory(const unsigned char* data, size_t size, MeshData &mesh, std::string &error, const MeshLoadOptions &options)
+{
+    mesh.clear();
+    // 12 byte header, then chunks of length, type and data
+    if(size < 20 || read_u32(data) != 0x46546C67 || read_u32(data + 4) != 2)
+    {
+        error = "not a glTF 2.0 binary";
+        return false;
+    }
+    size_t length = std::min((size_t)read_u32(data + 8), size);
+    if(length < 20)
+    {
+        error = "glTF binary shorter than its header";
+        return false;
+    }
+    size_t json_length = read_u32(data + 12);
+    if(read_u32(data + 16) != 0x4E4F534A || json_length > length - 20)
+    {
+        error = "the first chunk isn't JSON";
+        return false;
+    }
+
+    static thread_local GlbContext context;
+    context.root = JsonValue();
+    context.bin = NULL;
+    context.bin_size = 0;
+    context.options = &options;
+    context.mesh = &mesh;
+    context.error.clear();
+
+    size_t bin_chunk = 20 + ((json_length + 3) & ~(size_t)3);
+    if(bin_chunk + 8 <= length && read_u32(data + bin_chunk + 4) == 0x004E4942)
+    {
+        context.bin = data + bin_chunk + 8;
+        context.bin_size = std::min((size_t)read_u32(data + bin_chunk), length - bin_chunk - 8);
+    }
+
+    JsonParser parser;
+    if(!parser.parse((const char*)data + 20, json_length, context.root) || context.root.type != JsonValue::JSON_OBJECT)
+    {
+        error = "malformed JSON chunk";
+        return false;
+    }
+    const JsonValue* required = context.root.find("extensionsRequired");
+    if(required && !required->items.empty())
+    {
+        error = "requires " + required->items[0].string;
+        return false;
+    }
+    const JsonValue* buffers = context.root.find("buffers");
+    const JsonValue* buffer = buffers ? buffers->at(0) : NULL;
+    if(buffer && buffer->find("uri"))
+    {
+        error = "external buffers aren't supported";
+        return false;
+    }
+
+    bool ok = true;
+    const JsonValue* scenes = context.root.find("scenes");
+    const JsonValue* scene = scenes ? scenes->at(context.root.get_int("scene", 0)) : NULL;
+    if(scene)
+    {
+        const JsonValue* nodes = scene->find("nodes");
+        for(size_t i = 0; ok && nodes && i < nodes->items.size(); i++)
+            ok = add_node(context, nodes->items[i].as_int(-1), identity(), 0);
+    }
+    else
+    {
+        // No scene to place them, every mesh as it is
+        const JsonValue* meshes = context.root.find("meshes");
+        for(size_t i = 0; ok && meshes && i < meshes->items.size(); i++)
+        {
+            const JsonValue* primitives = meshes->items[i].find("primitives");
+            for(size_t j = 0; ok && primitives && j < primitives->items.size(); j++)
+                ok = add_primitive(context, primitives->items[j], identity());
+        }
+    }
+    if(!ok)
+    {
+        error = context.error;
+        return false;
+    }
+    finish(mesh);
+    return true;
+}
+
+bool load_glb(const char* path, MeshData &mesh, std::string &error, const MeshLoadOptions &options)
+{
+    MappedFile file;
+    if(!file.open(path))
+    {
+        error = std::string("can't open ") + path;
+        return false;
+    }
+    if(!load_glb_from_memory(file.get_data(), file.get_size(), mesh, error, options))
+    {
+        error = std::string(path) + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool load_mesh(const char* path, MeshData &mesh, std::string &error, const MeshLoadOptions &options)
+{
+    size_t length = strlen(path);
+    if(length > 4 && strcasecmp(path + length - 4, ".obj") == 0)
+        return load_obj(path, mesh, error, options);
+    if(length > 4 && strcasecmp(path + length - 4, ".glb") == 0)
+        return load_glb(path, mesh, error, options);
+    error = std::string(path) + ": not a .obj or .glb file";
+    return false;
+}
+
+const VertexFormat& get_mesh_vertex_format()
+{
+    static VertexFormat format = VertexFormat()
+        .add("aPos", 3)
+        .add("aNormal", 4, GL_INT_2_10_10_10_REV, true)
+        .add("aTexCoord", 2, GL_HALF_FLOAT);
+    return format;
+}
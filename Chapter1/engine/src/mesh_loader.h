@@ -0,0 +1,71 @@
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "vertex_layout.h"
+
+// The vertex every loaded mesh is packed into, 20 bytes:
+//     aPos      3 floats
+//     aNormal   GL_INT_2_10_10_10_REV, normalized
+//     aTexCoord 2 half floats
+// Texture coordinates have their origin at the bottom left like OBJ, glTF's
+// are flipped to match.
+struct MeshVertex
+{
+    float position[3];
+    uint32_t normal;
+    uint16_t texcoord[2];
+};
+
+struct MeshData
+{
+    MeshData();
+
+    // Indexed triangles, ready for glBufferData / BufferArena
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    float bounds_min[3];
+    float bounds_max[3];
+    bool has_normals;       // False when they were generated from the faces
+    bool has_texcoords;
+
+    size_t get_triangle_count() const;
+    void clear();
+};
+
+struct MeshLoadOptions
+{
+    MeshLoadOptions();
+
+    bool simd;              // SSE2 to find digit runs in OBJ numbers
+    bool generate_normals;  // Smooth normals for meshes without any
+};
+
+// Wavefront OBJ: v, vt, vn and f (polygons are fanned into triangles,
+// negative indices count back from the end). Everything else is skipped.
+// Corners with the same v/vt/vn share a vertex. The file is memory mapped
+// and parsed in one pass; scratch memory belongs to the thread and is kept
+// between loads, so loading into a reused MeshData allocates nothing once
+// the buffers have grown.
+bool load_obj(const char* path, MeshData &mesh, std::string &error, const MeshLoadOptions &options = MeshLoadOptions());
+bool load_obj_from_memory(const char* data, size_t size, MeshData &mesh, std::string &error,
+                          const MeshLoadOptions &options = MeshLoadOptions());
+
+// Binary glTF 2.0: the triangle primitives of every mesh the default scene
+// reaches, with the node transforms applied. Only the embedded BIN chunk is
+// read, no external buffers, sparse accessors or compression extensions.
+bool load_glb(const char* path, MeshData &mesh, std::string &error, const MeshLoadOptions &options = MeshLoadOptions());
+bool load_glb_from_memory(const unsigned char* data, size_t size, MeshData &mesh, std::string &error,
+                          const MeshLoadOptions &options = MeshLoadOptions());
+
+// Picks the loader from the extension, .obj or .glb
+bool load_mesh(const char* path, MeshData &mesh, std::string &error, const MeshLoadOptions &options = MeshLoadOptions());
+
+// VertexFormat of MeshVertex for VertexArrayCache
+const VertexFormat& get_mesh_vertex_format();
+
+#endif // MESH_LOADER_H
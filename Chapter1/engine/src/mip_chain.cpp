@@ -0,0 +1,526 @@
+#include "mip_chain.h"
+#include "gl_resources.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIP_CHAIN_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    const int KAISER_TAPS = 6;
+    const int ENCODE_TABLE_SIZE = 4096;
+    const double PI = 3.14159265358979323846;
+
+    struct Tables
+    {
+        float srgb_to_linear[256];
+        float unorm_to_float[256];
+        unsigned char linear_to_srgb[ENCODE_TABLE_SIZE];
+        // Source pixels 2x - 2 ... 2x + 3 for output pixel x, normalized
+        float kaiser[KAISER_TAPS];
+
+        Tables()
+        {
+            for(int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+                unorm_to_float[i] = c;
+            }
+            for(int i = 0; i < ENCODE_TABLE_SIZE; i++)
+            {
+                float l = (float)i / (ENCODE_TABLE_SIZE - 1);
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+                linear_to_srgb[i] = (unsigned char)(c * 255.0f + 0.5f);
+            }
+
+            // Sinc at half the source rate, under a Kaiser window reaching 3 source pixels out
+            const double radius = 3.0;
+            const double beta = 4.0;
+            double sum = 0.0;
+            double weights[KAISER_TAPS];
+            for(int k = 0; k < KAISER_TAPS; k++)
+            {
+                double d = k - 2.5;
+                double x = d / 2.0;
+                double sinc = x == 0.0 ? 1.0 : sin(PI * x) / (PI * x);
+                double r = d / radius;
+                double window = bessel_i0(beta * sqrt(std::max(0.0, 1.0 - r * r))) / bessel_i0(beta);
+                weights[k] = sinc * window;
+                sum += weights[k];
+            }
+            for(int k = 0; k < KAISER_TAPS; k++)
+                kaiser[k] = (float)(weights[k] / sum);
+        }
+
+        static double bessel_i0(double x)
+        {
+            double sum = 1.0;
+            double term = 1.0;
+            for(int k = 1; k < 32; k++)
+            {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+            return sum;
+        }
+    };
+
+    const Tables& tables()
+    {
+        static const Tables instance;
+        return instance;
+    }
+
+    // Calls body(first, last) over [0, rows) in bands on the pool's workers, or inline
+    void for_rows(ThreadPool* pool, int rows, const std::function<void(int, int)> &body)
+    {
+        unsigned int threads = pool ? pool->get_thread_count() : 1;
+        // Small levels are over before the workers would wake up
+        if(threads <= 1 || rows < 32)
+        {
+            body(0, rows);
+            return;
+        }
+
+        int bands = std::min((int)threads * 2, rows / 16);
+        std::mutex mutex;
+        std::condition_variable done;
+        int remaining = bands;
+        for(int band = 0; band < bands; band++)
+        {
+            int first = rows * band / bands;
+            int last = rows * (band + 1) / bands;
+            pool->submit([&, first, last]
+            {
+                body(first, last);
+                std::lock_guard<std::mutex> lock(mutex);
+                if(--remaining == 0)
+                    done.notify_one();
+            });
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&remaining] { return remaining == 0; });
+    }
+
+    // Box: output rows [first, last) of a width x height float RGBA level
+
+    void box_scalar(const float* src, float* dst, int width, int height, int first, int last)
+    {
+        int out_width = std::max(1, width / 2);
+        for(int y = first; y < last; y++)
+        {
+            const float* r0 = src + (size_t)std::min(2 * y, height - 1) * width * 4;
+            const float* r1 = src + (size_t)std::min(2 * y + 1, height - 1) * width * 4;
+            float* out = dst + (size_t)y * out_width * 4;
+            for(int x = 0; x < out_width; x++)
+            {
+                int x0 = std::min(2 * x, width - 1) * 4;
+                int x1 = std::min(2 * x + 1, width - 1) * 4;
+                for(int c = 0; c < 4; c++)
+                    out[x * 4 + c] = 0.25f * (r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c]);
+            }
+        }
+    }
+
+#ifdef MIP_CHAIN_X86
+    // One RGBA pixel per register
+    void box_sse2(const float* src, float* dst, int width, int height, int first, int last)
+    {
+        int out_width = std::max(1, width / 2);
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        for(int y = first; y < last; y++)
+        {
+            const float* r0 = src + (size_t)std::min(2 * y, height - 1) * width * 4;
+            const float* r1 = src + (size_t)std::min(2 * y + 1, height - 1) * width * 4;
+            float* out = dst + (size_t)y * out_width * 4;
+            int x = 0;
+            for(; 2 * x + 1 < width; x++)
+            {
+                __m128 top = _mm_add_ps(_mm_loadu_ps(r0 + 8 * x), _mm_loadu_ps(r0 + 8 * x + 4));
+                __m128 bottom = _mm_add_ps(_mm_loadu_ps(r1 + 8 * x), _mm_loadu_ps(r1 + 8 * x + 4));
+                _mm_storeu_ps(out + 4 * x, _mm_mul_ps(_mm_add_ps(top, bottom), quarter));
+            }
+            // A 1 pixel wide level
+            for(; x < out_width; x++)
+                _mm_storeu_ps(out + 4 * x, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(r0), _mm_loadu_ps(r1)), _mm_set1_ps(0.5f)));
+        }
+    }
+
+    // Two output pixels per register: lanes (p0, p2) and (p1, p3) added give (p0 + p1, p2 + p3)
+    __attribute__((target("avx2")))
+    void box_avx2(const float* src, float* dst, int width, int height, int first, int last)
+    {
+        int out_width = std::max(1, width / 2);
+        const __m256 quarter = _mm256_set1_ps(0.25f);
+        for(int y = first; y < last; y++)
+        {
+            const float* r0 = src + (size_t)std::min(2 * y, height - 1) * width * 4;
+            const float* r1 = src + (size_t)std::min(2 * y + 1, height - 1) * width * 4;
+            float* out = dst + (size_t)y * out_width * 4;
+            int x = 0;
+            for(; 2 * x + 3 < width; x += 2)
+            {
+                __m256 a0 = _mm256_loadu_ps(r0 + 8 * x);
+                __m256 b0 = _mm256_loadu_ps(r0 + 8 * x + 8);
+                __m256 a1 = _mm256_loadu_ps(r1 + 8 * x);
+                __m256 b1 = _mm256_loadu_ps(r1 + 8 * x + 8);
+                __m256 top = _mm256_add_ps(_mm256_permute2f128_ps(a0, b0, 0x20), _mm256_permute2f128_ps(a0, b0, 0x31));
+                __m256 bottom = _mm256_add_ps(_mm256_permute2f128_ps(a1, b1, 0x20), _mm256_permute2f128_ps(a1, b1, 0x31));
+                _mm256_storeu_ps(out + 4 * x, _mm256_mul_ps(_mm256_add_ps(top, bottom), quarter));
+            }
+            for(; 2 * x + 1 < width; x++)
+            {
+                __m128 top = _mm_add_ps(_mm_loadu_ps(r0 + 8 * x), _mm_loadu_ps(r0 + 8 * x + 4));
+                __m128 bottom = _mm_add_ps(_mm_loadu_ps(r1 + 8 * x), _mm_loadu_ps(r1 + 8 * x + 4));
+                _mm_storeu_ps(out + 4 * x, _mm_mul_ps(_mm_add_ps(top, bottom), _mm256_castps256_ps128(quarter)));
+            }
+            for(; x < out_width; x++)
+                _mm_storeu_ps(out + 4 * x, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(r0), _mm_loadu_ps(r1)), _mm_set1_ps(0.5f)));
+        }
+    }
+#endif
+
+    // Kaiser, horizontal pass: source rows [first, last) into a half width temporary
+    void kaiser_rows(const float* src, float* tmp, int width, int first, int last, bool simd)
+    {
+        const float* weights = tables().kaiser;
+        int out_width = std::max(1, width / 2);
+        for(int y = first; y < last; y++)
+        {
+            const float* row = src + (size_t)y * width * 4;
+            float* out = tmp + (size_t)y * out_width * 4;
+            for(int x = 0; x < out_width; x++)
+            {
+                int start = 2 * x - 2;
+#ifdef MIP_CHAIN_X86
+                if(simd)
+                {
+                    __m128 sum = _mm_setzero_ps();
+                    for(int k = 0; k < KAISER_TAPS; k++)
+                    {
+                        int source = std::max(0, std::min(width - 1, start + k));
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(row + source * 4)));
+                    }
+                    _mm_storeu_ps(out + x * 4, sum);
+                    continue;
+                }
+#endif
+                float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                for(int k = 0; k < KAISER_TAPS; k++)
+                {
+                    int source = std::max(0, std::min(width - 1, start + k));
+                    for(int c = 0; c < 4; c++)
+                        sum[c] += weights[k] * row[source * 4 + c];
+                }
+                for(int c = 0; c < 4; c++)
+                    out[x * 4 + c] = sum[c];
+            }
+        }
+    }
+
+    // Kaiser, vertical pass: output rows [first, last), floats are contiguous along the row
+    void kaiser_columns_scalar(const float* tmp, float* dst, int floats, int height, int first, int last)
+    {
+        const float* weights = tables().kaiser;
+        for(int y = first; y < last; y++)
+        {
+            float* out = dst + (size_t)y * floats;
+            std::fill(out, out + floats, 0.0f);
+            for(int k = 0; k < KAISER_TAPS; k++)
+            {
+                const float* row = tmp + (size_t)std::max(0, std::min(height - 1, 2 * y - 2 + k)) * floats;
+                for(int i = 0; i < floats; i++)
+                    out[i] += weights[k] * row[i];
+            }
+        }
+    }
+
+#ifdef MIP_CHAIN_X86
+    void kaiser_columns_sse2(const float* tmp, float* dst, int floats, int height, int first, int last)
+    {
+        const float* weights = tables().kaiser;
+        for(int y = first; y < last; y++)
+        {
+            const float* rows[KAISER_TAPS];
+            for(int k = 0; k < KAISER_TAPS; k++)
+                rows[k] = tmp + (size_t)std::max(0, std::min(height - 1, 2 * y - 2 + k)) * floats;
+            float* out = dst + (size_t)y * floats;
+            // Rows are whole RGBA pixels, always a multiple of 4 floats
+            for(int i = 0; i < floats; i += 4)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for(int k = 0; k < KAISER_TAPS; k++)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+                _mm_storeu_ps(out + i, sum);
+            }
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void kaiser_columns_avx2(const float* tmp, float* dst, int floats, int height, int first, int last)
+    {
+        const float* weights = tables().kaiser;
+        for(int y = first; y < last; y++)
+        {
+            const float* rows[KAISER_TAPS];
+            for(int k = 0; k < KAISER_TAPS; k++)
+                rows[k] = tmp + (size_t)std::max(0, std::min(height - 1, 2 * y - 2 + k)) * floats;
+            float* out = dst + (size_t)y * floats;
+            int i = 0;
+            for(; i + 8 <= floats; i += 8)
+            {
+                __m256 sum = _mm256_setzero_ps();
+                for(int k = 0; k < KAISER_TAPS; k++)
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+                _mm256_storeu_ps(out + i, sum);
+            }
+            for(; i < floats; i += 4)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for(int k = 0; k < KAISER_TAPS; k++)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+                _mm_storeu_ps(out + i, sum);
+            }
+        }
+    }
+#endif
+
+    float coverage(const float* pixels, size_t count, float scale, float cutoff)
+    {
+        size_t passing = 0;
+        for(size_t i = 0; i < count; i++)
+            if(pixels[i * 4 + 3] * scale >= cutoff)
+                passing++;
+        return (float)passing / count;
+    }
+
+    // Alpha scale that brings a level's coverage closest to the target
+    float coverage_scale(const float* pixels, size_t count, float cutoff, float target)
+    {
+        // Coverage only steps as whole pixels cross the cutoff, keep the closest scale seen
+        float low = 0.0f;
+        float high = 4.0f;
+        float best = 1.0f;
+        float best_error = fabsf(coverage(pixels, count, 1.0f, cutoff) - target);
+        for(int i = 0; i < 12; i++)
+        {
+            float scale = 0.5f * (low + high);
+            float current = coverage(pixels, count, scale, cutoff);
+            if(fabsf(current - target) < best_error)
+            {
+                best = scale;
+                best_error = fabsf(current - target);
+            }
+            if(current < target)
+                low = scale;
+            else
+                high = scale;
+        }
+        return best;
+    }
+
+    void encode_rows(const float* src, unsigned char* dst, int width, int first, int last, bool srgb, float alpha_scale)
+    {
+        const Tables &t = tables();
+        for(int y = first; y < last; y++)
+        {
+            const float* in = src + (size_t)y * width * 4;
+            unsigned char* out = dst + (size_t)y * width * 4;
+            for(int x = 0; x < width * 4; x += 4)
+            {
+                for(int c = 0; c < 3; c++)
+                {
+                    float v = std::max(0.0f, std::min(1.0f, in[x + c]));
+                    out[x + c] = srgb ? t.linear_to_srgb[(int)(v * (ENCODE_TABLE_SIZE - 1) + 0.5f)] : (unsigned char)(v * 255.0f + 0.5f);
+                }
+                float a = std::max(0.0f, std::min(1.0f, in[x + 3] * alpha_scale));
+                out[x + 3] = (unsigned char)(a * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
+MipOptions::MipOptions()
+{
+    filter = MIP_FILTER_BOX;
+    srgb = true;
+    preserve_coverage = false;
+    alpha_cutoff = 0.5f;
+    max_levels = 0;
+    simd = MipChain::get_supported_simd();
+}
+
+MipSimd MipChain::get_supported_simd()
+{
+#ifdef MIP_CHAIN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return MIP_SIMD_AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return MIP_SIMD_SSE2;
+#endif
+    return MIP_SIMD_SCALAR;
+}
+
+void MipChain::generate(const unsigned char* rgba, int width, int height, const MipOptions &options, ThreadPool* pool)
+{
+    PROFILE_ZONE("Generate Mips");
+
+    const Tables &t = tables();
+    MipSimd simd = std::min(options.simd, get_supported_simd());
+
+    int count = 1;
+    while((std::max(width, height) >> count) > 0)
+        count++;
+    if(options.max_levels > 0)
+        count = std::min(count, options.max_levels);
+
+    levels.resize(count);
+    levels[0].width = width;
+    levels[0].height = height;
+    levels[0].pixels.assign(rgba, rgba + (size_t)width * height * 4);
+    if(count == 1)
+        return;
+
+    // Level 0 to float, decoding sRGB colours to linear
+    const float* colour_table = options.srgb ? t.srgb_to_linear : t.unorm_to_float;
+    std::vector<float> current((size_t)width * height * 4);
+    for_rows(pool, height, [&](int first, int last)
+    {
+        for(size_t i = (size_t)first * width * 4; i < (size_t)last * width * 4; i += 4)
+        {
+            current[i] = colour_table[rgba[i]];
+            current[i + 1] = colour_table[rgba[i + 1]];
+            current[i + 2] = colour_table[rgba[i + 2]];
+            current[i + 3] = t.unorm_to_float[rgba[i + 3]];
+        }
+    });
+
+    float target_coverage = 0.0f;
+    if(options.preserve_coverage)
+        target_coverage = coverage(&current[0], (size_t)width * height, 1.0f, options.alpha_cutoff);
+
+    std::vector<float> next;
+    std::vector<float> tmp;
+    for(int level = 1; level < count; level++)
+    {
+        int out_width = std::max(1, width / 2);
+        int out_height = std::max(1, height / 2);
+        next.resize((size_t)out_width * out_height * 4);
+
+        if(options.filter == MIP_FILTER_BOX)
+        {
+            for_rows(pool, out_height, [&](int first, int last)
+            {
+#ifdef MIP_CHAIN_X86
+                if(simd == MIP_SIMD_AVX2)
+                    box_avx2(&current[0], &next[0], width, height, first, last);
+                else if(simd == MIP_SIMD_SSE2)
+                    box_sse2(&current[0], &next[0], width, height, first, last);
+                else
+#endif
+                    box_scalar(&current[0], &next[0], width, height, first, last);
+            });
+        }
+        else
+        {
+            tmp.resize((size_t)out_width * height * 4);
+            for_rows(pool, height, [&](int first, int last)
+            {
+                kaiser_rows(&current[0], &tmp[0], width, first, last, simd != MIP_SIMD_SCALAR);
+            });
+            int floats = out_width * 4;
+            for_rows(pool, out_height, [&](int first, int last)
+            {
+#ifdef MIP_CHAIN_X86
+                if(simd == MIP_SIMD_AVX2)
+                    kaiser_columns_avx2(&tmp[0], &next[0], floats, height, first, last);
+                else if(simd == MIP_SIMD_SSE2)
+                    kaiser_columns_sse2(&tmp[0], &next[0], floats, height, first, last);
+                else
+#endif
+                    kaiser_columns_scalar(&tmp[0], &next[0], floats, height, first, last);
+            });
+        }
+
+        // Alpha tested edges thin out as alpha averages down, scale it back to the original coverage
+        float alpha_scale = 1.0f;
+        if(options.preserve_coverage)
+            alpha_scale = coverage_scale(&next[0], (size_t)out_width * out_height, options.alpha_cutoff, target_coverage);
+
+        MipLevel &mip = levels[level];
+        mip.width = out_width;
+        mip.height = out_height;
+        mip.pixels.resize((size_t)out_width * out_height * 4);
+        for_rows(pool, out_height, [&](int first, int last)
+        {
+            encode_rows(&next[0], &mip.pixels[0], out_width, first, last, options.srgb, alpha_scale);
+        });
+
+        // The next level filters this one's unrounded, unscaled values
+        current.swap(next);
+        width = out_width;
+        height = out_height;
+    }
+}
+
+void MipChain::clear()
+{
+    levels.clear();
+}
+
+int MipChain::get_level_count() const
+{
+    return (int)levels.size();
+}
+
+const MipLevel& MipChain::get_level(int level) const
+{
+    return levels[level];
+}
+
+size_t MipChain::get_bytes() const
+{
+    size_t bytes = 0;
+    for(size_t i = 0; i < levels.size(); i++)
+        bytes += levels[i].pixels.size();
+    return bytes;
+}
+
+void MipChain::upload(GLenum target, GLint internal_format) const
+{
+    for(size_t level = 0; level < levels.size(); level++)
+    {
+        const MipLevel &mip = levels[level];
+        glTexImage2D(target, (GLint)level, internal_format, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &mip.pixels[0]);
+    }
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+}
+
+void MipChain::upload_sub(GLenum target) const
+{
+    for(size_t level = 0; level < levels.size(); level++)
+    {
+        const MipLevel &mip = levels[level];
+        glTexSubImage2D(target, (GLint)level, 0, 0, mip.width, mip.height, GL_RGBA, GL_UNSIGNED_BYTE, &mip.pixels[0]);
+    }
+}
+
+void MipChain::upload_layer(GLuint texture, GLenum target, int layer) const
+{
+    for(size_t level = 0; level < levels.size(); level++)
+    {
+        const MipLevel &mip = levels[level];
+        GLResources::texture_sub_image_3d(texture, target, (GLint)level, 0, 0, layer, mip.width, mip.height, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, &mip.pixels[0]);
+    }
+}
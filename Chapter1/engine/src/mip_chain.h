@@ -0,0 +1,69 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "thread_pool.h"
+
+enum MipFilter { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+// Kernels used for filtering, the widest the CPU supports unless a benchmark picks
+enum MipSimd { MIP_SIMD_SCALAR, MIP_SIMD_SSE2, MIP_SIMD_AVX2 };
+
+struct MipOptions
+{
+    MipOptions();
+
+    MipFilter filter;
+    bool srgb;              // Colour channels are sRGB encoded, filter them in linear space
+    bool preserve_coverage; // Keep the fraction of pixels passing alpha_cutoff the same on every level
+    float alpha_cutoff;
+    int max_levels;         // 0 for the full chain down to 1x1
+    MipSimd simd;
+};
+
+struct MipLevel
+{
+    int width;
+    int height;
+    std::vector<unsigned char> pixels; // RGBA8
+};
+
+// Mip chain built on the CPU instead of with glGenerateMipmap.
+//
+// Levels are filtered in float from the previous level's float result, so
+// rounding doesn't build up down the chain, and sRGB colours are averaged as
+// linear light (a decode table in, an encode table out) rather than as the
+// stored values, which darkens minified textures. Box is the 2x2 average;
+// Kaiser is a 6 tap Kaiser windowed sinc per axis, sharper at the cost of
+// some ringing. Odd sizes round down, dropping the last row or column.
+class MipChain
+{
+private:
+    std::vector<MipLevel> levels;
+
+public:
+    // Builds every level from RGBA8 pixels. With a pool each level is split
+    // into row bands across its workers; the caller must not be one of them.
+    void generate(const unsigned char* rgba, int width, int height, const MipOptions &options, ThreadPool* pool = NULL);
+    void clear();
+
+    int get_level_count() const;
+    const MipLevel& get_level(int level) const;
+    size_t get_bytes() const;
+
+    // glTexImage2D for each level of the texture bound to target, limiting
+    // GL_TEXTURE_MAX_LEVEL to the chain
+    void upload(GLenum target, GLint internal_format = GL_RGBA8) const;
+    // glTexSubImage2D for each level, into storage that already exists
+    void upload_sub(GLenum target) const;
+    // Each level of one layer of texture, through GLResources so it needs no
+    // binding with DSA. The storage must exist.
+    void upload_layer(GLuint texture, GLenum target, int layer) const;
+
+    static MipSimd get_supported_simd();
+};
+
+#endif // MIP_CHAIN_H
@@ -0,0 +1,371 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <GL/glew.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Zones a thread can buffer between two PROFILE_FRAME() calls
+    const uint32_t RING_SIZE = 1 << 14;
+    // Upper bound on zones kept for export (~32 MB)
+    const size_t MAX_COLLECTED = 1 << 20;
+
+    // GPU results are read back this many frames after they were issued
+    const unsigned int GPU_FRAME_LATENCY = 4;
+    const unsigned int GPU_ZONES_PER_FRAME = 64;
+    const unsigned int GPU_ZONE_INVALID = 0xFFFFFFFF;
+    const unsigned int GPU_TID = 0;
+
+    struct ZoneEvent
+    {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Single producer (owning thread), single consumer (PROFILE_FRAME caller)
+    struct ThreadBuffer
+    {
+        ZoneEvent events[RING_SIZE];
+        std::atomic<uint32_t> head;
+        std::atomic<uint32_t> tail;
+        std::atomic<uint32_t> dropped;
+        unsigned int tid;
+        const char* name;       // Guarded by registry_mutex
+        bool released;          // Owner exited, recycled once drained
+    };
+
+    struct CollectedEvent
+    {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+        unsigned int tid;
+        bool gpu; // GPU events are already in nanoseconds on the CPU timeline
+    };
+
+    struct GpuZone
+    {
+        const char* name;
+        GLuint queries[2];
+    };
+
+    uint64_t steady_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Calibration point for converting ticks to nanoseconds at export time
+    const uint64_t base_ticks = Profiler::ticks();
+    const uint64_t base_ns = steady_ns();
+
+    struct ThreadName
+    {
+        unsigned int tid;
+        const char* name;
+    };
+
+    std::mutex registry_mutex;
+    std::vector<ThreadBuffer*> thread_buffers;
+    // Buffers of exited threads, reused by the next thread to record
+    std::vector<ThreadBuffer*> free_buffers;
+    // Names and drops of exited threads, their buffers now belong to others
+    std::vector<ThreadName> retired_names;
+    size_t retired_dropped = 0;
+    unsigned int next_tid = 1;
+    thread_local ThreadBuffer* local_buffer = NULL;
+
+    // Hands the thread's buffer back when the thread exits
+    struct ThreadRelease
+    {
+        ~ThreadRelease();
+    };
+    thread_local ThreadRelease thread_release;
+
+    std::vector<CollectedEvent> collected;
+    size_t collected_dropped = 0;
+
+    bool gpu_initialised = false;
+    GpuZone gpu_zones[GPU_FRAME_LATENCY][GPU_ZONES_PER_FRAME];
+    unsigned int gpu_zone_count[GPU_FRAME_LATENCY];
+    unsigned int gpu_frame = 0;
+    int64_t gpu_base_ns = 0;
+    uint64_t gpu_base_cpu_ns = 0;
+    size_t gpu_dropped = 0;
+
+    ThreadBuffer* register_thread()
+    {
+        // Touching it makes sure its destructor runs when this thread exits
+        (void)&thread_release;
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        ThreadBuffer* buffer;
+        if(!free_buffers.empty())
+        {
+            buffer = free_buffers.back();
+            free_buffers.pop_back();
+        }
+        else
+            buffer = new ThreadBuffer();
+        buffer->head.store(0);
+        buffer->tail.store(0);
+        buffer->dropped.store(0);
+        buffer->name = NULL;
+        buffer->released = false;
+        buffer->tid = next_tid++;
+        thread_buffers.push_back(buffer);
+        local_buffer = buffer;
+        return buffer;
+    }
+
+    ThreadRelease::~ThreadRelease()
+    {
+        if(!local_buffer)
+            return;
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        local_buffer->released = true;
+        local_buffer = NULL;
+    }
+
+    void collect(const char* name, uint64_t start, uint64_t end, unsigned int tid, bool gpu)
+    {
+        if(collected.size() >= MAX_COLLECTED)
+        {
+            collected_dropped++;
+            return;
+        }
+        CollectedEvent event = { name, start, end, tid, gpu };
+        collected.push_back(event);
+    }
+
+    void drain_thread_buffers()
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for(size_t i = 0; i < thread_buffers.size(); i++)
+        {
+            ThreadBuffer* buffer = thread_buffers[i];
+            uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+            uint32_t head = buffer->head.load(std::memory_order_acquire);
+            for(; tail != head; tail++)
+            {
+                const ZoneEvent &event = buffer->events[tail & (RING_SIZE - 1)];
+                collect(event.name, event.start, event.end, buffer->tid, false);
+            }
+            buffer->tail.store(tail, std::memory_order_release);
+
+            if(buffer->released)
+            {
+                // Nothing left to read, keep what the trace still needs and recycle it
+                if(buffer->name)
+                {
+                    ThreadName retired = { buffer->tid, buffer->name };
+                    retired_names.push_back(retired);
+                }
+                retired_dropped += buffer->dropped.load();
+                free_buffers.push_back(buffer);
+                thread_buffers[i--] = thread_buffers.back();
+                thread_buffers.pop_back();
+            }
+        }
+    }
+
+    void init_gpu()
+    {
+        for(unsigned int frame = 0; frame < GPU_FRAME_LATENCY; frame++)
+        {
+            for(unsigned int i = 0; i < GPU_ZONES_PER_FRAME; i++)
+                glGenQueries(2, gpu_zones[frame][i].queries);
+            gpu_zone_count[frame] = 0;
+        }
+
+        // Pair the GPU clock with the CPU clock so both share one timeline
+        GLint64 gpu_now = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+        gpu_base_ns = gpu_now;
+        gpu_base_cpu_ns = steady_ns();
+        gpu_initialised = true;
+    }
+
+    // Read back the zones of a frame slot before it is reused
+    void resolve_gpu_frame(unsigned int frame)
+    {
+        for(unsigned int i = 0; i < gpu_zone_count[frame]; i++)
+        {
+            GpuZone &zone = gpu_zones[frame][i];
+            GLint available = 0;
+            glGetQueryObjectiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available)
+            {
+                gpu_dropped++;
+                continue;
+            }
+
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+            uint64_t start_ns = gpu_base_cpu_ns + (int64_t)begin - gpu_base_ns;
+            uint64_t end_ns = gpu_base_cpu_ns + (int64_t)end - gpu_base_ns;
+            collect(zone.name, start_ns, end_ns, GPU_TID, true);
+        }
+        gpu_zone_count[frame] = 0;
+    }
+
+    void write_json_string(FILE* file, const char* str)
+    {
+        fputc('"', file);
+        for(; *str; str++)
+        {
+            if(*str == '"' || *str == '\\')
+                fputc('\\', file);
+            fputc(*str, file);
+        }
+        fputc('"', file);
+    }
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer* buffer = local_buffer;
+    if(!buffer)
+        buffer = register_thread();
+
+    uint32_t head = buffer->head.load(std::memory_order_relaxed);
+    if(head - buffer->tail.load(std::memory_order_acquire) >= RING_SIZE)
+    {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ZoneEvent &event = buffer->events[head & (RING_SIZE - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+unsigned int Profiler::gpu_begin(const char* name)
+{
+    if(!gpu_initialised)
+        init_gpu();
+
+    unsigned int &count = gpu_zone_count[gpu_frame];
+    if(count == GPU_ZONES_PER_FRAME)
+    {
+        gpu_dropped++;
+        return GPU_ZONE_INVALID;
+    }
+
+    GpuZone &zone = gpu_zones[gpu_frame][count];
+    zone.name = name;
+    glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+    return gpu_frame * GPU_ZONES_PER_FRAME + count++;
+}
+
+void Profiler::gpu_end(unsigned int zone)
+{
+    if(zone == GPU_ZONE_INVALID)
+        return;
+    glQueryCounter(gpu_zones[zone / GPU_ZONES_PER_FRAME][zone % GPU_ZONES_PER_FRAME].queries[1], GL_TIMESTAMP);
+}
+
+void Profiler::end_frame()
+{
+    ProfileZone zone("Profiler::end_frame");
+
+    drain_thread_buffers();
+
+    if(gpu_initialised)
+    {
+        // The next slot is the oldest in the ring, its queries are GPU_FRAME_LATENCY frames old
+        gpu_frame = (gpu_frame + 1) % GPU_FRAME_LATENCY;
+        resolve_gpu_frame(gpu_frame);
+    }
+}
+
+void Profiler::set_thread_name(const char* name)
+{
+    ThreadBuffer* buffer = local_buffer;
+    if(!buffer)
+        buffer = register_thread();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffer->name = name;
+}
+
+bool Profiler::write_chrome_trace(const char* path)
+{
+    drain_thread_buffers();
+
+    FILE* file = fopen(path, "w");
+    if(!file)
+    {
+        printf("ERROR::PROFILER::FAILED_TO_OPEN %s\n", path);
+        return false;
+    }
+
+    // Convert raw ticks with the rate observed over the whole run
+    uint64_t now_ticks = Profiler::ticks();
+    uint64_t now_ns = steady_ns();
+    double ns_per_tick = 1.0;
+    if(now_ticks > base_ticks)
+        ns_per_tick = (double)(now_ns - base_ns) / (double)(now_ticks - base_ticks);
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}", GPU_TID);
+
+    size_t dropped = collected_dropped + gpu_dropped;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        dropped += retired_dropped;
+        for(size_t i = 0; i < retired_names.size(); i++)
+        {
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", retired_names[i].tid);
+            write_json_string(file, retired_names[i].name);
+            fprintf(file, "}}");
+        }
+        for(size_t i = 0; i < thread_buffers.size(); i++)
+        {
+            dropped += thread_buffers[i]->dropped.load();
+            if(!thread_buffers[i]->name)
+                continue;
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", thread_buffers[i]->tid);
+            write_json_string(file, thread_buffers[i]->name);
+            fprintf(file, "}}");
+        }
+    }
+
+    for(size_t i = 0; i < collected.size(); i++)
+    {
+        const CollectedEvent &event = collected[i];
+        double start_us, duration_us;
+        if(event.gpu)
+        {
+            start_us = ((double)event.start - (double)base_ns) / 1000.0;
+            duration_us = (double)(event.end - event.start) / 1000.0;
+        }
+        else
+        {
+            start_us = (double)(event.start - base_ticks) * ns_per_tick / 1000.0;
+            duration_us = (double)(event.end - event.start) * ns_per_tick / 1000.0;
+        }
+
+        fprintf(file, ",\n{\"name\":");
+        write_json_string(file, event.name);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+            event.gpu ? "gpu" : "cpu", event.tid, start_us, duration_us);
+    }
+
+    fprintf(file, "\n],\"otherData\":{\"droppedZones\":%zu}}\n", dropped);
+    fclose(file);
+
+    printf("Profiler: wrote %zu zones to %s (%zu dropped)\n", collected.size(), path, dropped);
+    return true;
+}
+
+#endif // ENABLE_PROFILER
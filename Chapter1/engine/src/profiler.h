@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// Scoped CPU/GPU profiler. Zones are recorded into per-thread lock-free ring
+// buffers and exported in the Chrome about:tracing / Perfetto JSON format.
+//
+// Build with `make PROFILE=1` to enable. Without ENABLE_PROFILER every macro
+// below expands to nothing, so release builds carry no instrumentation.
+//
+//   PROFILE_ZONE("name")         CPU zone until the end of the enclosing scope
+//   PROFILE_GPU_ZONE("name")     GPU zone (GL_TIMESTAMP queries), main thread only
+//   PROFILE_FRAME()              Marks the end of a frame, collects finished zones
+//   PROFILE_THREAD_NAME("name")  Labels the calling thread in the trace
+//   PROFILE_WRITE("file.json")   Writes everything collected so far
+//
+// Zone names must be string literals (or otherwise outlive the profiler).
+
+#ifdef ENABLE_PROFILER
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace Profiler
+{
+    // Raw timestamp: rdtsc where available, steady_clock nanoseconds otherwise
+    inline uint64_t ticks()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Push a finished zone into the calling thread's ring buffer
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    unsigned int gpu_begin(const char* name);
+    void gpu_end(unsigned int zone);
+
+    void end_frame();
+    void set_thread_name(const char* name);
+    bool write_chrome_trace(const char* path);
+}
+
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name) : name(name), start(Profiler::ticks()) {}
+    ~ProfileZone() { Profiler::record(name, start, Profiler::ticks()); }
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+class GpuProfileZone
+{
+public:
+    explicit GpuProfileZone(const char* name) : zone(Profiler::gpu_begin(name)) {}
+    ~GpuProfileZone() { Profiler::gpu_end(zone); }
+
+private:
+    unsigned int zone;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) GpuProfileZone PROFILE_CONCAT(gpu_profile_zone_, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::end_frame()
+#define PROFILE_THREAD_NAME(name) Profiler::set_thread_name(name)
+#define PROFILE_WRITE(path) Profiler::write_chrome_trace(path)
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_ZONE(name)
+#define PROFILE_FRAME()
+#define PROFILE_THREAD_NAME(name)
+#define PROFILE_WRITE(path)
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
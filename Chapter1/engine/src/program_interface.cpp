@@ -0,0 +1,230 @@
+#include "program_interface.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+    // FNV-1a, 64 bit
+    const uint64_t HASH_START = 14695981039346656037ULL;
+
+    uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for(size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        return hash;
+    }
+
+    bool by_location(const ProgramAttribute &a, const ProgramAttribute &b)
+    {
+        return a.location < b.location;
+    }
+
+    std::string strip_array(const char* name)
+    {
+        std::string result = name;
+        if(result.size() > 3 && result.compare(result.size() - 3, 3, "[0]") == 0)
+            result.erase(result.size() - 3);
+        return result;
+    }
+}
+
+ProgramInterface::ProgramInterface()
+{
+    program = 0;
+    vertex_hash = HASH_START;
+}
+
+void ProgramInterface::reflect(GLuint program)
+{
+    this->program = program;
+    attributes.clear();
+    uniforms.clear();
+    blocks.clear();
+
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+    std::vector<char> name(max_length > 0 ? max_length : 1);
+    for(GLint i = 0; i < count; i++)
+    {
+        ProgramAttribute attribute;
+        glGetActiveAttrib(program, i, (GLsizei)name.size(), NULL, &attribute.size, &attribute.type, &name[0]);
+        // gl_VertexID and friends have no location and need no buffer
+        if(strncmp(&name[0], "gl_", 3) == 0)
+            continue;
+        attribute.name = strip_array(&name[0]);
+        attribute.location = glGetAttribLocation(program, &name[0]);
+        attributes.push_back(attribute);
+    }
+    // The active index order is up to the driver, locations are what matters
+    std::sort(attributes.begin(), attributes.end(), by_location);
+
+    vertex_hash = HASH_START;
+    for(size_t i = 0; i < attributes.size(); i++)
+    {
+        const ProgramAttribute &attribute = attributes[i];
+        vertex_hash = hash_bytes(vertex_hash, attribute.name.c_str(), attribute.name.size() + 1);
+        vertex_hash = hash_bytes(vertex_hash, &attribute.location, sizeof(attribute.location));
+        vertex_hash = hash_bytes(vertex_hash, &attribute.type, sizeof(attribute.type));
+        vertex_hash = hash_bytes(vertex_hash, &attribute.size, sizeof(attribute.size));
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+    name.assign(max_length > 0 ? max_length : 1, 0);
+    for(GLint i = 0; i < count; i++)
+    {
+        ProgramBlock block;
+        glGetActiveUniformBlockName(program, i, (GLsizei)name.size(), NULL, &name[0]);
+        block.name = &name[0];
+        block.index = (GLuint)i;
+        glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.data_size);
+        glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &block.binding);
+        blocks.push_back(block);
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    name.assign(max_length > 0 ? max_length : 1, 0);
+    std::vector<GLuint> indices(count);
+    std::vector<GLint> block_indices(count, -1);
+    for(GLint i = 0; i < count; i++)
+        indices[i] = (GLuint)i;
+    if(count > 0)
+        glGetActiveUniformsiv(program, count, &indices[0], GL_UNIFORM_BLOCK_INDEX, &block_indices[0]);
+    for(GLint i = 0; i < count; i++)
+    {
+        ProgramUniform uniform;
+        glGetActiveUniform(program, i, (GLsizei)name.size(), NULL, &uniform.size, &uniform.type, &name[0]);
+        if(strncmp(&name[0], "gl_", 3) == 0)
+            continue;
+        uniform.name = strip_array(&name[0]);
+        uniform.block = block_indices[i];
+        uniform.location = uniform.block < 0 ? glGetUniformLocation(program, &name[0]) : -1;
+        uniforms.push_back(uniform);
+    }
+}
+
+GLuint ProgramInterface::get_program() const
+{
+    return program;
+}
+
+uint64_t ProgramInterface::get_vertex_hash() const
+{
+    return vertex_hash;
+}
+
+const std::vector<ProgramAttribute>& ProgramInterface::get_attributes() const
+{
+    return attributes;
+}
+
+const std::vector<ProgramUniform>& ProgramInterface::get_uniforms() const
+{
+    return uniforms;
+}
+
+const std::vector<ProgramBlock>& ProgramInterface::get_blocks() const
+{
+    return blocks;
+}
+
+const ProgramAttribute* ProgramInterface::find_attribute(const std::string &name) const
+{
+    for(size_t i = 0; i < attributes.size(); i++)
+        if(attributes[i].name == name)
+            return &attributes[i];
+    return NULL;
+}
+
+const ProgramUniform* ProgramInterface::find_uniform(const std::string &name) const
+{
+    for(size_t i = 0; i < uniforms.size(); i++)
+        if(uniforms[i].name == name)
+            return &uniforms[i];
+    return NULL;
+}
+
+const ProgramBlock* ProgramInterface::find_block(const std::string &name) const
+{
+    for(size_t i = 0; i < blocks.size(); i++)
+        if(blocks[i].name == name)
+            return &blocks[i];
+    return NULL;
+}
+
+GLint ProgramInterface::get_uniform_location(const std::string &name) const
+{
+    const ProgramUniform* uniform = find_uniform(name);
+    return uniform ? uniform->location : -1;
+}
+
+int ProgramInterface::get_components(GLenum type, GLenum &scalar)
+{
+    switch(type)
+    {
+    case GL_FLOAT:             scalar = GL_FLOAT;        return 1;
+    case GL_FLOAT_VEC2:        scalar = GL_FLOAT;        return 2;
+    case GL_FLOAT_VEC3:        scalar = GL_FLOAT;        return 3;
+    case GL_FLOAT_VEC4:        scalar = GL_FLOAT;        return 4;
+    case GL_INT:               scalar = GL_INT;          return 1;
+    case GL_INT_VEC2:          scalar = GL_INT;          return 2;
+    case GL_INT_VEC3:          scalar = GL_INT;          return 3;
+    case GL_INT_VEC4:          scalar = GL_INT;          return 4;
+    case GL_UNSIGNED_INT:      scalar = GL_UNSIGNED_INT; return 1;
+    case GL_UNSIGNED_INT_VEC2: scalar = GL_UNSIGNED_INT; return 2;
+    case GL_UNSIGNED_INT_VEC3: scalar = GL_UNSIGNED_INT; return 3;
+    case GL_UNSIGNED_INT_VEC4: scalar = GL_UNSIGNED_INT; return 4;
+    default:                   scalar = GL_NONE;         return 0;
+    }
+}
+
+UniformBlockBindings::UniformBlockBindings()
+{
+}
+
+UniformBlockBindings& UniformBlockBindings::get()
+{
+    static UniformBlockBindings instance;
+    return instance;
+}
+
+void UniformBlockBindings::add(const std::string &name, GLuint point, GLint size)
+{
+    Binding binding;
+    binding.point = point;
+    binding.size = size;
+    bindings[name] = binding;
+}
+
+bool UniformBlockBindings::apply(const ProgramInterface &program) const
+{
+    bool ok = true;
+    const std::vector<ProgramBlock> &blocks = program.get_blocks();
+    for(size_t i = 0; i < blocks.size(); i++)
+    {
+        std::map<std::string, Binding>::const_iterator found = bindings.find(blocks[i].name);
+        if(found == bindings.end())
+        {
+            printf("ERROR::UNIFORM_BLOCK::NOT_REGISTERED %s\n", blocks[i].name.c_str());
+            ok = false;
+            continue;
+        }
+        if(found->second.size > 0 && blocks[i].data_size > found->second.size)
+        {
+            printf("ERROR::UNIFORM_BLOCK::SIZE_MISMATCH %s needs %d bytes, its buffer holds %d\n",
+                blocks[i].name.c_str(), blocks[i].data_size, found->second.size);
+            ok = false;
+        }
+        // The index looked up by name rather than the reflected one, a trace replay
+        // can only remap indices it saw glGetUniformBlockIndex return
+        GLuint index = glGetUniformBlockIndex(program.get_program(), blocks[i].name.c_str());
+        if(index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program.get_program(), index, found->second.point);
+    }
+    return ok;
+}
@@ -0,0 +1,103 @@
+#ifndef PROGRAM_INTERFACE_H
+#define PROGRAM_INTERFACE_H
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+struct ProgramAttribute
+{
+    std::string name;
+    GLint location;
+    GLenum type;        // GL_FLOAT_VEC3, GL_UNSIGNED_INT, ...
+    GLint size;         // Array length, 1 for plain attributes
+};
+
+struct ProgramUniform
+{
+    std::string name;   // Arrays without the trailing [0]
+    GLint location;     // -1 for members of a uniform block
+    GLenum type;
+    GLint size;
+    GLint block;        // Index into get_blocks(), -1 in the default block
+};
+
+struct ProgramBlock
+{
+    std::string name;
+    GLuint index;
+    GLint data_size;    // Bytes the buffer bound to it must cover
+    GLint binding;
+};
+
+// What a linked program reads, queried once with glGetActiveAttrib,
+// glGetActiveUniform and glGetActiveUniformBlock* instead of one
+// glGet*Location call per name.
+//
+// get_vertex_hash() covers the attribute names, locations and types only, so
+// two programs (or one program before and after a hot reload) that read their
+// vertices the same way hash the same and can share vertex arrays.
+class ProgramInterface
+{
+private:
+    GLuint program;
+    std::vector<ProgramAttribute> attributes;
+    std::vector<ProgramUniform> uniforms;
+    std::vector<ProgramBlock> blocks;
+    uint64_t vertex_hash;
+
+public:
+    ProgramInterface();
+
+    // Replaces everything with what program has, program must be linked
+    void reflect(GLuint program);
+
+    GLuint get_program() const;
+    uint64_t get_vertex_hash() const;
+
+    const std::vector<ProgramAttribute>& get_attributes() const;
+    const std::vector<ProgramUniform>& get_uniforms() const;
+    const std::vector<ProgramBlock>& get_blocks() const;
+
+    // NULL or -1 if the program doesn't use it
+    const ProgramAttribute* find_attribute(const std::string &name) const;
+    const ProgramUniform* find_uniform(const std::string &name) const;
+    const ProgramBlock* find_block(const std::string &name) const;
+    GLint get_uniform_location(const std::string &name) const;
+
+    // Components and scalar type of a GLSL type: GL_FLOAT_VEC3 is 3 GL_FLOAT.
+    // 0 components for types attributes can't have.
+    static int get_components(GLenum type, GLenum &scalar);
+};
+
+// Which binding point each named uniform block lives at, for the whole
+// program run. Buffers are bound to the points once, every program using the
+// block is pointed at the same one by apply().
+class UniformBlockBindings
+{
+private:
+    struct Binding
+    {
+        GLuint point;
+        GLint size;
+    };
+
+    std::map<std::string, Binding> bindings;
+
+    UniformBlockBindings();
+
+public:
+    static UniformBlockBindings& get();
+
+    // size is what the buffer bound there holds, 0 skips the size check
+    void add(const std::string &name, GLuint point, GLint size = 0);
+
+    // Sets glUniformBlockBinding for every block of the program. False, with
+    // the reason printed, if a block isn't registered or needs more than its
+    // buffer holds; the other blocks are still bound.
+    bool apply(const ProgramInterface &program) const;
+};
+
+#endif // PROGRAM_INTERFACE_H
@@ -0,0 +1,261 @@
+#include "program_pipeline.h"
+#include "shader_preprocessor.h"
+
+#include <stdio.h>
+
+namespace
+{
+    const char* stage_name(GLenum type)
+    {
+        return type == GL_VERTEX_SHADER ? "VERTEX" : type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "STAGE";
+    }
+
+    // Adds the gl_PerVertex block a separable vertex stage has to declare,
+    // with a #line so errors keep their line numbers
+    std::string redeclare_per_vertex(const std::string &source)
+    {
+        if(source.find("gl_PerVertex") != std::string::npos)
+            return source;
+        size_t start = 0;
+        int line = 1;
+        while(start < source.size())
+        {
+            size_t end = source.find('\n', start);
+            if(end == std::string::npos)
+                end = source.size();
+            size_t first = source.find_first_not_of(" \t", start);
+            if(first < end && source.compare(first, 8, "#version") == 0)
+            {
+                char line_directive[32];
+                snprintf(line_directive, sizeof(line_directive), "#line %d 0\n", line + 1);
+                return source.substr(0, end) + "\n"
+                    "#extension GL_ARB_separate_shader_objects : enable\n"
+                    "out gl_PerVertex { vec4 gl_Position; float gl_PointSize; };\n"
+                    + line_directive + (end < source.size() ? source.substr(end + 1) : std::string());
+            }
+            start = end + 1;
+            line++;
+        }
+        return source;
+    }
+}
+
+ProgramPipelineCache::ProgramPipelineCache()
+{
+    separable = false;
+    links = 0;
+    hits = 0;
+}
+
+void ProgramPipelineCache::init(bool allow_separable)
+{
+    separable = allow_separable && (GLEW_VERSION_4_1 || GLEW_ARB_separate_shader_objects);
+}
+
+void ProgramPipelineCache::destroy()
+{
+    for(std::map<std::pair<int, int>, GLuint>::iterator it = combinations.begin(); it != combinations.end(); ++it)
+    {
+        if(!it->second)
+            continue;
+        if(separable)
+            glDeleteProgramPipelines(1, &it->second);
+        else
+            glDeleteProgram(it->second);
+    }
+    combinations.clear();
+    for(size_t i = 0; i < stages.size(); i++)
+    {
+        if(separable)
+            glDeleteProgram(stages[i].object);
+        else
+            glDeleteShader(stages[i].object);
+    }
+    stages.clear();
+    stage_sources.clear();
+}
+
+bool ProgramPipelineCache::is_separable() const
+{
+    return separable;
+}
+
+int ProgramPipelineCache::compile(GLenum type, const std::string &source, const std::string &label,
+                                  const std::vector<std::string> &files)
+{
+    std::pair<GLenum, std::string> key(type, source);
+    std::map<std::pair<GLenum, std::string>, int>::iterator found = stage_sources.find(key);
+    if(found != stage_sources.end())
+        return found->second;
+
+    char infoLog[4096];
+    int success;
+    GLuint object;
+    if(separable)
+    {
+        // Compiles and links in one go, the compile log ends up in the program's
+        std::string text = type == GL_VERTEX_SHADER ? redeclare_per_vertex(source) : source;
+        const char* code = text.c_str();
+        object = glCreateShaderProgramv(type, 1, &code);
+        links++;
+        glGetProgramiv(object, GL_LINK_STATUS, &success);
+        if(!success)
+        {
+            glGetProgramInfoLog(object, sizeof(infoLog), NULL, infoLog);
+            glDeleteProgram(object);
+        }
+    }
+    else
+    {
+        const char* code = source.c_str();
+        object = glCreateShader(type);
+        glShaderSource(object, 1, &code, NULL);
+        glCompileShader(object);
+        glGetShaderiv(object, GL_COMPILE_STATUS, &success);
+        if(!success)
+        {
+            glGetShaderInfoLog(object, sizeof(infoLog), NULL, infoLog);
+            glDeleteShader(object);
+        }
+    }
+    if(!success)
+    {
+        std::string log = ShaderPreprocessor::remap_log(infoLog, files);
+        printf("ERROR::PIPELINE::%s::FAILED_COMPILATION %s\n%s\n", stage_name(type), label.c_str(), log.c_str());
+        return -1;
+    }
+
+    Stage stage;
+    stage.type = type;
+    stage.object = object;
+    stage.label = label;
+    stages.push_back(stage);
+    stage_sources[key] = (int)stages.size() - 1;
+    return (int)stages.size() - 1;
+}
+
+int ProgramPipelineCache::add_stage(GLenum type, const char* source, const char* label)
+{
+    return compile(type, source, label, std::vector<std::string>());
+}
+
+int ProgramPipelineCache::add_stage_file(GLenum type, const char* path)
+{
+    ShaderSource source;
+    std::string error;
+    if(!ShaderPreprocessor::get().process(path, source, error))
+    {
+        printf("ERROR::PIPELINE::FILE_READ_FAILURE %s\n", error.c_str());
+        return -1;
+    }
+    return compile(type, source.text, path, source.files);
+}
+
+GLuint ProgramPipelineCache::build(int vertex, int fragment)
+{
+    char infoLog[4096];
+    int success;
+    const Stage &vertex_stage = stages[vertex];
+    const Stage &fragment_stage = stages[fragment];
+    if(separable)
+    {
+        GLuint pipeline;
+        glGenProgramPipelines(1, &pipeline);
+        glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertex_stage.object);
+        glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragment_stage.object);
+        // Catches stages whose outputs and inputs don't match
+        glValidateProgramPipeline(pipeline);
+        glGetProgramPipelineiv(pipeline, GL_VALIDATE_STATUS, &success);
+        if(!success)
+        {
+            glGetProgramPipelineInfoLog(pipeline, sizeof(infoLog), NULL, infoLog);
+            printf("ERROR::PIPELINE::VALIDATION_FAILED %s + %s\n%s\n", vertex_stage.label.c_str(), fragment_stage.label.c_str(), infoLog);
+            glDeleteProgramPipelines(1, &pipeline);
+            return 0;
+        }
+        return pipeline;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_stage.object);
+    glAttachShader(program, fragment_stage.object);
+    glLinkProgram(program);
+    links++;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success)
+    {
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        printf("ERROR::PROGRAM::FAILED_LINKING %s + %s\n%s\n", vertex_stage.label.c_str(), fragment_stage.label.c_str(), infoLog);
+        glDeleteProgram(program);
+        return 0;
+    }
+    // Shared with the other combinations, so the shaders stay attached
+    return program;
+}
+
+bool ProgramPipelineCache::use(int vertex, int fragment)
+{
+    if(vertex < 0 || vertex >= (int)stages.size() || stages[vertex].type != GL_VERTEX_SHADER
+        || fragment < 0 || fragment >= (int)stages.size() || stages[fragment].type != GL_FRAGMENT_SHADER)
+        return false;
+
+    std::pair<int, int> key(vertex, fragment);
+    std::map<std::pair<int, int>, GLuint>::iterator found = combinations.find(key);
+    GLuint object;
+    if(found != combinations.end())
+    {
+        hits++;
+        object = found->second;
+    }
+    else
+    {
+        // Failures are kept too, so a broken pair isn't relinked every frame
+        object = build(vertex, fragment);
+        combinations[key] = object;
+    }
+    if(!object)
+        return false;
+
+    if(separable)
+    {
+        // A program from glUseProgram takes precedence over the bound pipeline
+        glUseProgram(0);
+        glBindProgramPipeline(object);
+    }
+    else
+        glUseProgram(object);
+    return true;
+}
+
+GLint ProgramPipelineCache::select_uniform(int vertex, int fragment, int stage, const char* name)
+{
+    std::map<std::pair<int, int>, GLuint>::iterator found = combinations.find(std::make_pair(vertex, fragment));
+    if(found == combinations.end() || !found->second || (stage != vertex && stage != fragment))
+        return -1;
+    if(!separable)
+        return glGetUniformLocation(found->second, name);
+
+    glActiveShaderProgram(found->second, stages[stage].object);
+    return glGetUniformLocation(stages[stage].object, name);
+}
+
+unsigned int ProgramPipelineCache::get_link_count() const
+{
+    return links;
+}
+
+size_t ProgramPipelineCache::get_stage_count() const
+{
+    return stages.size();
+}
+
+size_t ProgramPipelineCache::get_combination_count() const
+{
+    return combinations.size();
+}
+
+void ProgramPipelineCache::print_report() const
+{
+    printf("Program pipelines: %s, %zu stages, %zu combinations, %u links, %u binds from the cache\n",
+        separable ? "separable" : "classic linking", stages.size(), combinations.size(), links, hits);
+}
@@ -0,0 +1,70 @@
+#ifndef PROGRAM_PIPELINE_H
+#define PROGRAM_PIPELINE_H
+
+#include <GL/glew.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Vertex and fragment stages compiled once each and combined as needed.
+//
+// With GL 4.1 or ARB_separate_shader_objects every stage is its own
+// separable program and a combination is a program pipeline object put
+// together with glUseProgramStages, so links grow with the number of stages
+// instead of the number of combinations. Without it, or with separable
+// turned off, stages stay shader objects and each combination is linked into
+// a classic program the first time it is used. Either way combinations are
+// built once and cached.
+//
+// Separable vertex stages must redeclare gl_PerVertex; sources that don't
+// get the redeclaration added after their #version line.
+class ProgramPipelineCache
+{
+private:
+    struct Stage
+    {
+        GLenum type;
+        GLuint object;          // Separable program, or shader object when linking classically
+        std::string label;
+    };
+
+    bool separable;
+    std::vector<Stage> stages;
+    // Same type and text give the same stage
+    std::map<std::pair<GLenum, std::string>, int> stage_sources;
+    // Pipeline, or linked program, per vertex and fragment stage
+    std::map<std::pair<int, int>, GLuint> combinations;
+    unsigned int links;
+    unsigned int hits;
+
+    int compile(GLenum type, const std::string &source, const std::string &label, const std::vector<std::string> &files);
+    GLuint build(int vertex, int fragment);
+
+public:
+    ProgramPipelineCache();
+
+    // Picks separable pipelines if the context has them and allow_separable is set
+    void init(bool allow_separable = true);
+    void destroy();
+    bool is_separable() const;
+
+    // Stage id, -1 with the compile log printed on failure
+    int add_stage(GLenum type, const char* source, const char* label);
+    // Read through ShaderPreprocessor, #include works and errors name the file
+    int add_stage_file(GLenum type, const char* path);
+
+    // Binds the combination, building it the first time. False, with the
+    // reason printed, if the stages don't link or don't fit together.
+    bool use(int vertex, int fragment);
+    // Location of a uniform of stage in the bound combination. Also points
+    // glUniform* at that stage's program, which a pipeline needs first.
+    GLint select_uniform(int vertex, int fragment, int stage, const char* name);
+
+    unsigned int get_link_count() const;
+    size_t get_stage_count() const;
+    size_t get_combination_count() const;
+    void print_report() const;
+};
+
+#endif // PROGRAM_PIPELINE_H
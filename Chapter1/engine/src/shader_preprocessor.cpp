@@ -0,0 +1,395 @@
+#include "shader_preprocessor.h"
+#include "shaders.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+namespace
+{
+    bool modified_time(const std::string &path, long long &modified)
+    {
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            return false;
+        modified = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+        return true;
+    }
+
+    // Folds "." and ".." so one file is cached under one name
+    std::string normalize(const std::string &path)
+    {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while(start <= path.size())
+        {
+            size_t end = path.find('/', start);
+            if(end == std::string::npos)
+                end = path.size();
+            std::string part = path.substr(start, end - start);
+            if(part == ".." && !parts.empty() && parts.back() != ".." && !parts.back().empty())
+                parts.pop_back();
+            else if(part != "." && (!part.empty() || parts.empty()))
+                parts.push_back(part);
+            start = end + 1;
+        }
+
+        std::string result;
+        for(size_t i = 0; i < parts.size(); i++)
+            result += (i ? "/" : "") + parts[i];
+        return result;
+    }
+
+    std::string directory_of(const std::string &path)
+    {
+        size_t slash = path.rfind('/');
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    // The directive name after '#', empty if line isn't a directive. rest is what follows it.
+    std::string directive(const std::string &line, std::string &rest)
+    {
+        size_t pos = line.find_first_not_of(" \t");
+        if(pos == std::string::npos || line[pos] != '#')
+            return std::string();
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if(pos == std::string::npos)
+            return std::string();
+        size_t end = line.find_first_of(" \t", pos);
+        if(end == std::string::npos)
+            end = line.size();
+        size_t next = line.find_first_not_of(" \t", end);
+        rest = next == std::string::npos ? std::string() : line.substr(next);
+        return line.substr(pos, end - pos);
+    }
+
+    // First word of a directive's arguments
+    std::string first_word(const std::string &rest)
+    {
+        size_t end = rest.find_first_of(" \t/");
+        return rest.substr(0, end);
+    }
+
+    bool is_blank_or_comment(const std::string &line)
+    {
+        size_t pos = line.find_first_not_of(" \t");
+        return pos == std::string::npos || line.compare(pos, 2, "//") == 0;
+    }
+}
+
+ShaderPreprocessor::ShaderPreprocessor()
+{
+}
+
+ShaderPreprocessor& ShaderPreprocessor::get()
+{
+    static ShaderPreprocessor preprocessor;
+    return preprocessor;
+}
+
+void ShaderPreprocessor::add_include_dir(const std::string &dir)
+{
+    std::string normalized = normalize(dir);
+    if(!normalized.empty() && normalized[normalized.size() - 1] != '/')
+        normalized += '/';
+    include_dirs.push_back(normalized);
+}
+
+// Remembers a file that failed to load, so reload_changed() retries it once it changes
+void ShaderPreprocessor::fail(const std::string &path)
+{
+    long long modified = -1;
+    modified_time(path, modified);
+    failed[path] = modified;
+}
+
+// Where an include is looked for, in order
+std::vector<std::string> ShaderPreprocessor::candidates(const std::string &from, const std::string &target, bool quoted) const
+{
+    std::vector<std::string> paths;
+    if(quoted)
+        paths.push_back(normalize(directory_of(from) + target));
+    for(size_t i = 0; i < include_dirs.size(); i++)
+        paths.push_back(normalize(include_dirs[i] + target));
+    return paths;
+}
+
+bool ShaderPreprocessor::resolve(const std::string &from, const std::string &target, bool quoted, std::string &path) const
+{
+    long long modified;
+    std::vector<std::string> paths = candidates(from, target, quoted);
+    for(size_t i = 0; i < paths.size(); i++)
+    {
+        if(files.count(paths[i]) || modified_time(paths[i], modified))
+        {
+            path = paths[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+const ShaderPreprocessor::File* ShaderPreprocessor::load(const std::string &path, std::string &error)
+{
+    std::map<std::string, File>::iterator cached = files.find(path);
+    if(cached != files.end())
+        return &cached->second;
+
+    File file;
+    file.version_line = -1;
+    file.once_line = -1;
+    file.once = false;
+    FILE* handle = fopen(path.c_str(), "rb");
+    if(!handle || !modified_time(path, file.modified))
+    {
+        if(handle)
+            fclose(handle);
+        fail(path);
+        error = "can't open " + path;
+        return NULL;
+    }
+    std::string text;
+    char buffer[4096];
+    size_t count;
+    while((count = fread(buffer, 1, sizeof(buffer), handle)) > 0)
+        text.append(buffer, count);
+    fclose(handle);
+
+    size_t start = 0;
+    while(start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if(end == std::string::npos)
+            end = text.size();
+        std::string line = text.substr(start, end - start);
+        if(!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        file.lines.push_back(line);
+        start = end + 1;
+    }
+    file.includes.resize(file.lines.size());
+
+    // Directives first, then whether the file is wrapped in an include guard
+    std::vector<size_t> code_lines;
+    for(size_t i = 0; i < file.lines.size(); i++)
+    {
+        std::string rest;
+        std::string name = directive(file.lines[i], rest);
+        if(!is_blank_or_comment(file.lines[i]))
+            code_lines.push_back(i);
+        if(name == "version" && file.version_line < 0)
+            file.version_line = (int)i;
+        else if(name == "pragma" && first_word(rest) == "once")
+        {
+            file.once_line = (int)i;
+            file.once = true;
+        }
+        else if(name == "include")
+        {
+            char close = rest.empty() ? 0 : rest[0] == '"' ? '"' : rest[0] == '<' ? '>' : 0;
+            size_t end = close ? rest.find(close, 1) : std::string::npos;
+            if(end == std::string::npos)
+            {
+                fail(path);
+                error = path + ":" + std::to_string(i + 1) + ": malformed #include";
+                return NULL;
+            }
+            std::string target = rest.substr(1, end - 1);
+            if(!resolve(path, target, close == '"', file.includes[i]))
+            {
+                // Creating the include anywhere it is looked for also counts as fixing this file
+                std::vector<std::string> paths = candidates(path, target, close == '"');
+                for(size_t j = 0; j < paths.size(); j++)
+                {
+                    failed[paths[j]] = -1;
+                    included_by[paths[j]].insert(path);
+                }
+                fail(path);
+                error = path + ":" + std::to_string(i + 1) + ": can't find " + target;
+                return NULL;
+            }
+        }
+    }
+    if(code_lines.size() >= 3)
+    {
+        std::string first_rest, second_rest, last_rest;
+        std::string first = directive(file.lines[code_lines[0]], first_rest);
+        std::string second = directive(file.lines[code_lines[1]], second_rest);
+        std::string last = directive(file.lines[code_lines.back()], last_rest);
+        if(first == "ifndef" && second == "define" && last == "endif"
+            && !first_word(first_rest).empty() && first_word(first_rest) == first_word(second_rest))
+            file.once = true;
+    }
+
+    for(size_t i = 0; i < file.includes.size(); i++)
+        if(!file.includes[i].empty())
+            included_by[file.includes[i]].insert(path);
+    failed.erase(path);
+    return &files.insert(std::make_pair(path, file)).first->second;
+}
+
+void ShaderPreprocessor::forget(const std::string &path)
+{
+    failed.erase(path);
+    std::map<std::string, File>::iterator cached = files.find(path);
+    if(cached == files.end())
+        return;
+    // Its own includes may change, what includes it is kept
+    const std::vector<std::string> &includes = cached->second.includes;
+    for(size_t i = 0; i < includes.size(); i++)
+        if(!includes[i].empty())
+            included_by[includes[i]].erase(path);
+    files.erase(cached);
+}
+
+bool ShaderPreprocessor::expand(const std::string &path, ShaderSource &source, std::vector<std::string> &stack,
+                                std::set<std::string> &pasted, std::string &error)
+{
+    if(std::find(stack.begin(), stack.end(), path) != stack.end())
+    {
+        error = "include cycle:";
+        for(size_t i = 0; i < stack.size(); i++)
+            error += " " + stack[i] + " ->";
+        error += " " + path;
+        return false;
+    }
+    const File* file = load(path, error);
+    if(!file)
+        return false;
+    if(file->once && pasted.count(path))
+        return true;
+    pasted.insert(path);
+
+    bool root = stack.empty();
+    int index = (int)source.files.size();
+    source.files.push_back(path);
+    if(!root)
+        source.text += "#line 1 " + std::to_string(index) + "\n";
+
+    stack.push_back(path);
+    for(size_t i = 0; i < file->lines.size(); i++)
+    {
+        if(!file->includes[i].empty())
+        {
+            if(!expand(file->includes[i], source, stack, pasted, error))
+                return false;
+            // Back to the line after the #include, in this file's numbering
+            source.text += "#line " + std::to_string(i + 2) + " " + std::to_string(index) + "\n";
+        }
+        else if((int)i == file->once_line || (!root && (int)i == file->version_line))
+            source.text += "\n";
+        else
+            source.text += file->lines[i] + "\n";
+    }
+    stack.pop_back();
+    return true;
+}
+
+bool ShaderPreprocessor::process(const char* path, ShaderSource &source, std::string &error)
+{
+    source.text.clear();
+    source.files.clear();
+    std::vector<std::string> stack;
+    std::set<std::string> pasted;
+    return expand(normalize(path), source, stack, pasted, error);
+}
+
+std::string ShaderPreprocessor::remap_log(const std::string &log, const std::vector<std::string> &files)
+{
+    std::string result;
+    size_t start = 0;
+    while(start < log.size())
+    {
+        size_t end = log.find('\n', start);
+        end = end == std::string::npos ? log.size() : end + 1;
+        std::string line = log.substr(start, end - start);
+        start = end;
+
+        size_t pos = 0;
+        if(line.compare(0, 7, "ERROR: ") == 0)
+            pos = 7;
+        else if(line.compare(0, 9, "WARNING: ") == 0)
+            pos = 9;
+        size_t digits = pos;
+        while(digits < line.size() && line[digits] >= '0' && line[digits] <= '9')
+            digits++;
+        // A source string number is followed by the line, as :12 or (12)
+        if(digits > pos && digits + 1 < line.size() && (line[digits] == ':' || line[digits] == '(')
+            && line[digits + 1] >= '0' && line[digits + 1] <= '9')
+        {
+            size_t number = (size_t)atoi(line.substr(pos, digits - pos).c_str());
+            if(number < files.size())
+                line = line.substr(0, pos) + files[number] + line.substr(digits);
+        }
+        result += line;
+    }
+    return result;
+}
+
+void ShaderPreprocessor::track(Shader* shader, const std::vector<std::string> &roots)
+{
+    std::vector<std::string> normalized;
+    for(size_t i = 0; i < roots.size(); i++)
+        normalized.push_back(normalize(roots[i]));
+    programs[shader] = normalized;
+}
+
+void ShaderPreprocessor::untrack(Shader* shader)
+{
+    programs.erase(shader);
+}
+
+std::vector<Shader*> ShaderPreprocessor::reload_changed()
+{
+    std::vector<std::string> changed;
+    for(std::map<std::string, File>::iterator it = files.begin(); it != files.end(); ++it)
+    {
+        long long modified;
+        if(!modified_time(it->first, modified) || modified != it->second.modified)
+            changed.push_back(it->first);
+    }
+    for(std::map<std::string, long long>::iterator it = failed.begin(); it != failed.end(); ++it)
+    {
+        long long modified = -1;
+        modified_time(it->first, modified);
+        if(modified != it->second)
+            changed.push_back(it->first);
+    }
+    std::vector<Shader*> reloaded;
+    if(changed.empty())
+        return reloaded;
+
+    // Everything that reaches a changed file through its includes
+    std::set<std::string> affected(changed.begin(), changed.end());
+    std::vector<std::string> pending = changed;
+    while(!pending.empty())
+    {
+        std::string path = pending.back();
+        pending.pop_back();
+        const std::set<std::string> &includers = included_by[path];
+        for(std::set<std::string>::const_iterator it = includers.begin(); it != includers.end(); ++it)
+            if(affected.insert(*it).second)
+                pending.push_back(*it);
+    }
+    for(size_t i = 0; i < changed.size(); i++)
+        forget(changed[i]);
+
+    std::vector<Shader*> stale;
+    for(std::map<Shader*, std::vector<std::string> >::iterator it = programs.begin(); it != programs.end(); ++it)
+        for(size_t i = 0; i < it->second.size(); i++)
+            if(affected.count(it->second[i]))
+            {
+                stale.push_back(it->first);
+                break;
+            }
+    for(size_t i = 0; i < stale.size(); i++)
+        if(stale[i]->reload())
+            reloaded.push_back(stale[i]);
+    return reloaded;
+}
+
+size_t ShaderPreprocessor::get_cached_files() const
+{
+    return files.size();
+}
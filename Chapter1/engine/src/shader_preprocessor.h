@@ -0,0 +1,91 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class Shader;
+
+// A shader stage ready for glShaderSource, with includes pasted in
+struct ShaderSource
+{
+    std::string text;
+    // Name of each GLSL source string number used by the #line directives,
+    // 0 is the file that was asked for
+    std::vector<std::string> files;
+};
+
+// Resolves #include "file" (relative to the including file, then the include
+// directories) and #include <file> (include directories only) before GLSL
+// sees the source.
+//
+// Each include is wrapped in #line directives giving it its own source string
+// number, so compile errors point at the right line of the right file;
+// remap_log() puts the file names back in. Files with #pragma once or a
+// classic #ifndef/#define/#endif guard are pasted once per stage. Includes are
+// expanded whether or not they sit inside an #if, and #version is only kept
+// from the top file.
+//
+// Parsed files are cached and shared by every program. The cache also keeps
+// which file includes which, so reload_changed() can recompile just the
+// programs that reach an edited file. Files that failed to load, and the
+// places a missing include was looked for, are watched the same way so
+// fixing them triggers a reload too.
+class ShaderPreprocessor
+{
+private:
+    struct File
+    {
+        std::vector<std::string> lines;
+        // For each line, the resolved file it includes, empty for other lines
+        std::vector<std::string> includes;
+        int version_line;        // -1 without #version
+        int once_line;           // #pragma once, -1 without
+        bool once;               // #pragma once or an include guard
+        long long modified;      // Modification time in nanoseconds
+    };
+
+    std::map<std::string, File> files;
+    // Files that failed to load and their modification time then, -1 if missing
+    std::map<std::string, long long> failed;
+    std::map<std::string, std::set<std::string> > included_by;
+    std::vector<std::string> include_dirs;
+    // Programs and the files their stages start from
+    std::map<Shader*, std::vector<std::string> > programs;
+
+    ShaderPreprocessor();
+
+    const File* load(const std::string &path, std::string &error);
+    void forget(const std::string &path);
+    void fail(const std::string &path);
+    std::vector<std::string> candidates(const std::string &from, const std::string &target, bool quoted) const;
+    bool resolve(const std::string &from, const std::string &target, bool quoted, std::string &path) const;
+    bool expand(const std::string &path, ShaderSource &source, std::vector<std::string> &stack,
+                std::set<std::string> &pasted, std::string &error);
+
+public:
+    static ShaderPreprocessor& get();
+
+    void add_include_dir(const std::string &dir);
+
+    // False with the reason in error if a file is missing or includes itself
+    bool process(const char* path, ShaderSource &source, std::string &error);
+    // Replaces the source string numbers at the start of each compiler message
+    // (Mesa's 0:12(5), NVIDIA's 0(12), AMD's ERROR: 0:12) with file names
+    static std::string remap_log(const std::string &log, const std::vector<std::string> &files);
+
+    // Called by Shader, roots are the files its stages were built from
+    void track(Shader* shader, const std::vector<std::string> &roots);
+    void untrack(Shader* shader);
+
+    // Checks every cached or failed file for changes, drops the changed ones
+    // from the cache and reloads each program that includes one of them,
+    // directly or not. Returns the programs that were rebuilt.
+    std::vector<Shader*> reload_changed();
+
+    size_t get_cached_files() const;
+};
+
+#endif // SHADER_PREPROCESSOR_H
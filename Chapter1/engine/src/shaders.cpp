@@ -0,0 +1,277 @@
+#include "shaders.h"
+#include "shader_preprocessor.h"
+
+#include <vector>
+
+namespace
+{
+    enum UniformKind { UNIFORM_FLOAT, UNIFORM_INT, UNIFORM_UINT, UNIFORM_MATRIX };
+
+    // How a uniform's value is read back and set. Everything GL 3.3 has
+    // besides these is a sampler, which holds a texture unit as an int.
+    void uniform_kind(GLenum type, UniformKind &kind, int &components)
+    {
+        switch(type)
+        {
+        case GL_FLOAT:             kind = UNIFORM_FLOAT;  components = 1; break;
+        case GL_FLOAT_VEC2:        kind = UNIFORM_FLOAT;  components = 2; break;
+        case GL_FLOAT_VEC3:        kind = UNIFORM_FLOAT;  components = 3; break;
+        case GL_FLOAT_VEC4:        kind = UNIFORM_FLOAT;  components = 4; break;
+        case GL_INT:
+        case GL_BOOL:              kind = UNIFORM_INT;    components = 1; break;
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2:         kind = UNIFORM_INT;    components = 2; break;
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3:         kind = UNIFORM_INT;    components = 3; break;
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4:         kind = UNIFORM_INT;    components = 4; break;
+        case GL_UNSIGNED_INT:      kind = UNIFORM_UINT;   components = 1; break;
+        case GL_UNSIGNED_INT_VEC2: kind = UNIFORM_UINT;   components = 2; break;
+        case GL_UNSIGNED_INT_VEC3: kind = UNIFORM_UINT;   components = 3; break;
+        case GL_UNSIGNED_INT_VEC4: kind = UNIFORM_UINT;   components = 4; break;
+        case GL_FLOAT_MAT2:        kind = UNIFORM_MATRIX; components = 4; break;
+        case GL_FLOAT_MAT3:        kind = UNIFORM_MATRIX; components = 9; break;
+        case GL_FLOAT_MAT4:        kind = UNIFORM_MATRIX; components = 16; break;
+        case GL_FLOAT_MAT2x3:
+        case GL_FLOAT_MAT3x2:      kind = UNIFORM_MATRIX; components = 6; break;
+        case GL_FLOAT_MAT2x4:
+        case GL_FLOAT_MAT4x2:      kind = UNIFORM_MATRIX; components = 8; break;
+        case GL_FLOAT_MAT3x4:
+        case GL_FLOAT_MAT4x3:      kind = UNIFORM_MATRIX; components = 12; break;
+        default:                   kind = UNIFORM_INT;    components = 1; break;
+        }
+    }
+
+    void set_float_uniform(GLint location, int components, const GLfloat* value)
+    {
+        switch(components)
+        {
+        case 1: glUniform1fv(location, 1, value); break;
+        case 2: glUniform2fv(location, 1, value); break;
+        case 3: glUniform3fv(location, 1, value); break;
+        case 4: glUniform4fv(location, 1, value); break;
+        }
+    }
+
+    void set_matrix_uniform(GLenum type, GLint location, const GLfloat* value)
+    {
+        switch(type)
+        {
+        case GL_FLOAT_MAT2:   glUniformMatrix2fv(location, 1, GL_FALSE, value); break;
+        case GL_FLOAT_MAT3:   glUniformMatrix3fv(location, 1, GL_FALSE, value); break;
+        case GL_FLOAT_MAT4:   glUniformMatrix4fv(location, 1, GL_FALSE, value); break;
+        case GL_FLOAT_MAT2x3: glUniformMatrix2x3fv(location, 1, GL_FALSE, value); break;
+        case GL_FLOAT_MAT3x2: glUniformMatrix3x2fv(location, 1, GL_FALSE, value); break;
+        case GL_FLOAT_MAT2x4: glUniformMatrix2x4fv(location, 1, GL_FALSE, value); break;
+        case GL_FLOAT_MAT4x2: glUniformMatrix4x2fv(location, 1, GL_FALSE, value); break;
+        case GL_FLOAT_MAT3x4: glUniformMatrix3x4fv(location, 1, GL_FALSE, value); break;
+        case GL_FLOAT_MAT4x3: glUniformMatrix4x3fv(location, 1, GL_FALSE, value); break;
+        }
+    }
+
+    // Copies every default block uniform the two programs share, element by
+    // element for arrays. to must be the current program.
+    void copy_uniforms(unsigned int from, unsigned int to)
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(from, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for(GLint i = 0; i < count; i++)
+        {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(from, i, (GLsizei)nameBuffer.size(), NULL, &size, &type, &nameBuffer[0]);
+            string name = &nameBuffer[0];
+            if(name.compare(0, 3, "gl_") == 0)
+                continue;
+            if(name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+                name.erase(name.size() - 3);
+
+            UniformKind kind;
+            int components;
+            uniform_kind(type, kind, components);
+            for(GLint element = 0; element < size; element++)
+            {
+                string elementName = size > 1 ? name + "[" + to_string(element) + "]" : name;
+                // Uniforms in blocks have no location, the block binding covers them
+                GLint oldLocation = glGetUniformLocation(from, elementName.c_str());
+                GLint newLocation = glGetUniformLocation(to, elementName.c_str());
+                if(oldLocation < 0 || newLocation < 0)
+                    continue;
+
+                GLfloat floats[16];
+                GLint ints[4];
+                GLuint uints[4];
+                if(kind == UNIFORM_FLOAT || kind == UNIFORM_MATRIX)
+                {
+                    glGetUniformfv(from, oldLocation, floats);
+                    if(kind == UNIFORM_FLOAT)
+                        set_float_uniform(newLocation, components, floats);
+                    else
+                        set_matrix_uniform(type, newLocation, floats);
+                }
+                else if(kind == UNIFORM_INT)
+                {
+                    glGetUniformiv(from, oldLocation, ints);
+                    switch(components)
+                    {
+                    case 1: glUniform1iv(newLocation, 1, ints); break;
+                    case 2: glUniform2iv(newLocation, 1, ints); break;
+                    case 3: glUniform3iv(newLocation, 1, ints); break;
+                    case 4: glUniform4iv(newLocation, 1, ints); break;
+                    }
+                }
+                else
+                {
+                    glGetUniformuiv(from, oldLocation, uints);
+                    switch(components)
+                    {
+                    case 1: glUniform1uiv(newLocation, 1, uints); break;
+                    case 2: glUniform2uiv(newLocation, 1, uints); break;
+                    case 3: glUniform3uiv(newLocation, 1, uints); break;
+                    case 4: glUniform4uiv(newLocation, 1, uints); break;
+                    }
+                }
+            }
+        }
+    }
+
+    void copy_block_bindings(unsigned int from, unsigned int to)
+    {
+        GLint count = 0;
+        glGetProgramiv(from, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        for(GLint i = 0; i < count; i++)
+        {
+            char name[256];
+            GLint binding;
+            glGetActiveUniformBlockName(from, i, sizeof(name), NULL, name);
+            glGetActiveUniformBlockiv(from, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+            GLuint index = glGetUniformBlockIndex(to, name);
+            if(index != GL_INVALID_INDEX)
+                glUniformBlockBinding(to, index, binding);
+        }
+    }
+
+    // 0 and the remapped info log on failure
+    unsigned int compile(GLenum stage, const char* path, const char* stageName)
+    {
+        ShaderSource source;
+        string error;
+        if(!ShaderPreprocessor::get().process(path, source, error))
+        {
+            printf("ERROR::SHADER::FILE_READ_FAILURE %s\n", error.c_str());
+            return 0;
+        }
+
+        const char* code = source.text.c_str();
+        unsigned int shader = glCreateShader(stage);
+        glShaderSource(shader, 1, &code, NULL);
+        glCompileShader(shader);
+        int success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[4096];
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            string log = ShaderPreprocessor::remap_log(infoLog, source.files);
+            printf("ERROR::SHADER::%s::FAILED_COMPILATION%s\n", stageName, log.c_str());
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+}
+
+ Shader::Shader(const char* vertexPath, const char* fragmentPath)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath)
+ {
+    ID = 0;
+    revision = 0;
+    build();
+
+    // Watched even if the first build failed, fixing the file brings it up
+    vector<string> roots;
+    roots.push_back(this->vertexPath);
+    roots.push_back(this->fragmentPath);
+    ShaderPreprocessor::get().track(this, roots);
+ }
+
+ Shader::~Shader()
+ {
+    ShaderPreprocessor::get().untrack(this);
+ }
+
+ bool Shader::build()
+ {
+    // Compile Shaders
+    unsigned int vertex = compile(GL_VERTEX_SHADER, vertexPath.c_str(), "VERTEX");
+    if(!vertex)
+        return false;
+    unsigned int fragment = compile(GL_FRAGMENT_SHADER, fragmentPath.c_str(), "FRAGMENT");
+    if(!fragment)
+    {
+        glDeleteShader(vertex);
+        return false;
+    }
+
+    // Shader program, a new one so a failed reload leaves the old one working
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    // Print linking errors
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[4096];
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        printf("ERROR::PROGRAM::FAILED_LINKING%s\n", infoLog);
+        glDeleteProgram(program);
+        return false;
+    }
+
+    if(ID)
+    {
+        GLint current;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+        glUseProgram(program);
+        copy_uniforms(ID, program);
+        copy_block_bindings(ID, program);
+        glUseProgram((GLuint)current == ID ? program : (GLuint)current);
+        glDeleteProgram(ID);
+    }
+    ID = program;
+    return true;
+ }
+
+ bool Shader::reload()
+ {
+    if(!build())
+        return false;
+    revision++;
+    return true;
+ }
+
+ void Shader::use()
+ {
+    glUseProgram(ID);
+ }
+
+ void Shader::setBool(const string &name, bool value) const
+ {
+    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+ }
+
+ void Shader::setInt(const string &name, int value) const
+ {
+    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+ }
+
+ void Shader::setFloat(const string &name, float value) const
+ {
+    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+ }
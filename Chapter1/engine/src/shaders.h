@@ -0,0 +1,48 @@
+#ifndef SHADERS_H
+#define SHADERS_H
+
+#include <GL/glew.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+using namespace std;
+
+class Shader
+{
+public:
+    // The program ID, replaced by a new program each time reload() succeeds
+    unsigned int ID;
+    // Bumped on every successful reload, so users know to look up uniform
+    // locations again
+    unsigned int revision;
+
+    // Constructor reads and builds the shader. #include is resolved by
+    // ShaderPreprocessor, which also watches the files for reload_changed()
+    Shader(const char* vertexPath, const char* vertextPath);
+    ~Shader();
+
+    // Use/activate shaders
+    void use();
+
+    // Rebuilds from the files on disk. On failure the old program stays and
+    // the errors are printed. Uniform values and block bindings carry over.
+    bool reload();
+
+    // Utility uniform functions
+    void setBool(const string &name, bool value) const;
+    void setInt(const string &name, int value) const;
+    void setFloat(const string &name, float value) const;
+
+private:
+    string vertexPath;
+    string fragmentPath;
+
+    // Owns a GL program, not copyable
+    Shader(const Shader &other);
+    Shader& operator=(const Shader &other);
+
+    bool build();
+};
+#endif // SHADERS_H
@@ -0,0 +1,10 @@
+// stb_image allocates through the decode arena while a decode_image() call is
+// running on the thread, and through the C heap otherwise (see image_decode.h)
+#include "image_decode.h"
+
+#define STBI_MALLOC(size) image_decode_malloc(size)
+#define STBI_REALLOC(pointer, size) image_decode_realloc(pointer, size)
+#define STBI_FREE(pointer) image_decode_free(pointer)
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
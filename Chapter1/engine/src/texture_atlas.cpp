@@ -0,0 +1,420 @@
+#include "texture_atlas.h"
+#include "gl_resources.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "image_decode.h"
+#include "stb/stb_image.h"
+
+SkylinePacker::SkylinePacker()
+{
+    width = 0;
+    height = 0;
+}
+
+void SkylinePacker::reset(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    Segment floor = { 0, 0, width };
+    skyline.assign(1, floor);
+}
+
+int SkylinePacker::fit(size_t index, int rect_width, int rect_height) const
+{
+    if(skyline[index].x + rect_width > width)
+        return -1;
+
+    // Rests on the highest segment it spans
+    int y = 0;
+    int remaining = rect_width;
+    for(size_t i = index; remaining > 0; i++)
+    {
+        y = std::max(y, skyline[i].y);
+        if(y + rect_height > height)
+            return -1;
+        remaining -= skyline[i].width;
+    }
+    return y;
+}
+
+bool SkylinePacker::insert(int rect_width, int rect_height, int &x, int &y)
+{
+    int best_y = height;
+    size_t best_index = skyline.size();
+    for(size_t i = 0; i < skyline.size(); i++)
+    {
+        int rest = fit(i, rect_width, rect_height);
+        if(rest >= 0 && rest < best_y)
+        {
+            best_y = rest;
+            best_index = i;
+        }
+    }
+    if(best_index == skyline.size())
+        return false;
+
+    x = skyline[best_index].x;
+    y = best_y;
+
+    // The rectangle's top becomes a new segment, covering what it sits on
+    Segment top = { x, y + rect_height, rect_width };
+    skyline.insert(skyline.begin() + best_index, top);
+    int right = x + rect_width;
+    size_t i = best_index + 1;
+    while(i < skyline.size() && skyline[i].x < right)
+    {
+        int overlap = right - skyline[i].x;
+        if(overlap >= skyline[i].width)
+        {
+            skyline.erase(skyline.begin() + i);
+            continue;
+        }
+        skyline[i].x += overlap;
+        skyline[i].width -= overlap;
+        break;
+    }
+
+    // Neighbours at the same height are one segment
+    for(i = 0; i + 1 < skyline.size();)
+    {
+        if(skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else
+            i++;
+    }
+    return true;
+}
+
+TextureAtlas::TextureAtlas()
+{
+    texture = 0;
+    mode = ATLAS_AUTO;
+    layer_width = 0;
+    layer_height = 0;
+    layers = 0;
+    mip_levels = 0;
+    gutter = 0;
+    occupancy = 0.0f;
+    gpu_bytes = 0;
+    cpu_mips = false;
+    mip_pool = NULL;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+}
+
+int TextureAtlas::add_image(const char* path)
+{
+    int width, height, channels;
+    unsigned char* data = decode_image(path, &width, &height, &channels, 4);
+    if(!data)
+    {
+        printf("ERROR::TEXTURE_ATLAS::LOAD_FAILED %s: %s\n", path, stbi_failure_reason());
+        return -1;
+    }
+    int index = add_pixels(width, height, data);
+    release_image(data);
+    return index;
+}
+
+int TextureAtlas::add_pixels(int width, int height, const unsigned char* rgba)
+{
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(rgba, rgba + (size_t)width * height * 4);
+    images.push_back(image);
+    return (int)images.size() - 1;
+}
+
+int TextureAtlas::padded_size(int size) const
+{
+    return (size + 2 * gutter + gutter - 1) / gutter * gutter;
+}
+
+bool TextureAtlas::build(AtlasMode requested, int gutter_size)
+{
+    destroy();
+    if(images.empty())
+    {
+        printf("ERROR::TEXTURE_ATLAS::NO_IMAGES\n");
+        return false;
+    }
+
+    gutter = 1;
+    while(gutter < gutter_size)
+        gutter <<= 1;
+
+    GLint max_size, max_layers;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    // Past this a page is mostly upload time and memory for little gain
+    max_size = std::min(max_size, 4096);
+
+    bool same_size = true;
+    for(size_t i = 1; i < images.size(); i++)
+        if(images[i].width != images[0].width || images[i].height != images[0].height)
+            same_size = false;
+
+    bool built;
+    if(requested != ATLAS_PACKED && same_size && (int)images.size() <= max_layers)
+        built = build_array();
+    else
+    {
+        if(requested == ATLAS_ARRAY)
+            printf("Texture atlas: images differ in size, packing them instead of one per layer\n");
+        built = build_packed(max_size, max_layers);
+    }
+
+    // The packed copies are on the GPU now
+    for(size_t i = 0; i < images.size(); i++)
+        std::vector<unsigned char>().swap(images[i].pixels);
+    return built;
+}
+
+bool TextureAtlas::build_array()
+{
+    mode = ATLAS_ARRAY;
+    layer_width = images[0].width;
+    layer_height = images[0].height;
+    layers = (int)images.size();
+    mip_levels = 1;
+    while((std::max(layer_width, layer_height) >> mip_levels) > 0)
+        mip_levels++;
+    occupancy = 1.0f;
+
+    regions.resize(images.size());
+    for(size_t i = 0; i < images.size(); i++)
+    {
+        AtlasRegion region = { (int)i, 0.0f, 0.0f, 1.0f, 1.0f };
+        regions[i] = region;
+    }
+
+    std::vector<int> origin(images.size(), 0);
+    upload(origin, origin);
+    return true;
+}
+
+bool TextureAtlas::build_packed(int max_size, int max_layers)
+{
+    mode = ATLAS_PACKED;
+
+    long long padded_area = 0;
+    long long image_area = 0;
+    int largest = 0;
+    std::vector<int> order(images.size());
+    for(size_t i = 0; i < images.size(); i++)
+    {
+        int width = padded_size(images[i].width);
+        int height = padded_size(images[i].height);
+        padded_area += (long long)width * height;
+        image_area += (long long)images[i].width * images[i].height;
+        largest = std::max(largest, std::max(width, height));
+        order[i] = (int)i;
+    }
+    if(largest > max_size)
+    {
+        printf("ERROR::TEXTURE_ATLAS::IMAGE_TOO_LARGE %d pixels with gutters, pages are at most %d\n", largest, max_size);
+        return false;
+    }
+
+    // Tallest first leaves the fewest gaps under the skyline
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        int height_a = images[a].height, height_b = images[b].height;
+        return height_a != height_b ? height_a > height_b : images[a].width > images[b].width;
+    });
+
+    // Smallest square page that holds everything, more layers only once pages are as large as allowed
+    int page = 64;
+    while(page < largest || (long long)page * page < padded_area)
+        page <<= 1;
+    page = std::min(page, max_size);
+
+    std::vector<int> x(images.size()), y(images.size());
+    std::vector<SkylinePacker> pages;
+    regions.resize(images.size());
+    for(;;)
+    {
+        pages.assign(1, SkylinePacker());
+        pages[0].reset(page, page);
+
+        bool fits = true;
+        for(size_t k = 0; k < order.size(); k++)
+        {
+            int i = order[k];
+            int width = padded_size(images[i].width);
+            int height = padded_size(images[i].height);
+
+            size_t layer = 0;
+            while(layer < pages.size() && !pages[layer].insert(width, height, x[i], y[i]))
+                layer++;
+            if(layer == pages.size())
+            {
+                if(page < max_size)
+                {
+                    fits = false;
+                    break;
+                }
+                if((int)pages.size() == max_layers)
+                {
+                    printf("ERROR::TEXTURE_ATLAS::TOO_MANY_LAYERS %d layers of %dx%d are full\n", max_layers, page, page);
+                    return false;
+                }
+                pages.push_back(SkylinePacker());
+                pages.back().reset(page, page);
+                pages.back().insert(width, height, x[i], y[i]);
+            }
+            regions[i].layer = (int)layer;
+        }
+        if(fits)
+            break;
+        page <<= 1;
+    }
+
+    layer_width = page;
+    layer_height = page;
+    layers = (int)pages.size();
+    occupancy = (float)((double)image_area / ((double)page * page * layers));
+
+    // Level L averages 2^L x 2^L blocks, which stay inside one padded rectangle while 2^L <= gutter
+    mip_levels = 1;
+    while((1 << mip_levels) <= gutter && (page >> mip_levels) > 0)
+        mip_levels++;
+
+    for(size_t i = 0; i < images.size(); i++)
+    {
+        AtlasRegion &region = regions[i];
+        region.u = (float)(x[i] + gutter) / page;
+        region.v = (float)(y[i] + gutter) / page;
+        region.scale_u = (float)images[i].width / page;
+        region.scale_v = (float)images[i].height / page;
+    }
+
+    upload(x, y);
+    return true;
+}
+
+void TextureAtlas::upload(const std::vector<int> &x, const std::vector<int> &y)
+{
+    texture = GLResources::create_texture(GL_TEXTURE_2D_ARRAY);
+    MipOptions options = mip_options;
+    options.max_levels = mip_levels;
+    // Kaiser taps reach a texel further than a box at each level, one level
+    // less keeps the deepest one inside the gutter
+    if(mode == ATLAS_PACKED && options.filter == MIP_FILTER_KAISER && mip_levels > 1)
+        options.max_levels = mip_levels - 1;
+    if(cpu_mips)
+        mip_levels = options.max_levels;
+    MipChain chain;
+
+    // Every level is allocated up front, for the CPU chain or for glGenerateMipmap to fill
+    GLResources::texture_storage_3d(texture, GL_TEXTURE_2D_ARRAY, mip_levels, GL_RGBA8, layer_width, layer_height, layers);
+
+    int pad = mode == ATLAS_PACKED ? gutter : 0;
+    std::vector<unsigned char> layer_pixels((size_t)layer_width * layer_height * 4);
+    for(int layer = 0; layer < layers; layer++)
+    {
+        if(mode == ATLAS_PACKED)
+            memset(&layer_pixels[0], 0, layer_pixels.size());
+
+        for(size_t i = 0; i < images.size(); i++)
+        {
+            if(regions[i].layer != layer)
+                continue;
+
+            // Gutters repeat the nearest edge pixel, so filtering and the first
+            // mip levels see the image's own border rather than a neighbour
+            const Image &image = images[i];
+            int width = pad ? padded_size(image.width) : image.width;
+            int height = pad ? padded_size(image.height) : image.height;
+            for(int row = 0; row < height; row++)
+            {
+                int source_row = std::max(0, std::min(image.height - 1, row - pad));
+                const unsigned char* source = &image.pixels[(size_t)source_row * image.width * 4];
+                unsigned char* dest = &layer_pixels[((size_t)(y[i] + row) * layer_width + x[i]) * 4];
+                for(int column = 0; column < pad; column++)
+                    memcpy(dest + column * 4, source, 4);
+                memcpy(dest + pad * 4, source, (size_t)image.width * 4);
+                for(int column = pad + image.width; column < width; column++)
+                    memcpy(dest + column * 4, source + (image.width - 1) * 4, 4);
+            }
+        }
+
+        if(cpu_mips)
+        {
+            chain.generate(&layer_pixels[0], layer_width, layer_height, options, mip_pool);
+            chain.upload_layer(texture, GL_TEXTURE_2D_ARRAY, layer);
+        }
+        else
+            GLResources::texture_sub_image_3d(texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, layer_width, layer_height, 1,
+                GL_RGBA, GL_UNSIGNED_BYTE, &layer_pixels[0]);
+    }
+
+    // Packed pages repeat inside each region in the shader, the edges of the page itself are never tiled
+    GLint wrap = mode == ATLAS_PACKED ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    GLResources::texture_parameter(texture, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+    GLResources::texture_parameter(texture, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+    GLResources::texture_parameter(texture, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    GLResources::texture_parameter(texture, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if(!cpu_mips)
+        GLResources::generate_mipmap(texture, GL_TEXTURE_2D_ARRAY);
+
+    gpu_bytes = 0;
+    for(int level = 0; level < mip_levels; level++)
+        gpu_bytes += (size_t)std::max(1, layer_width >> level) * std::max(1, layer_height >> level) * 4 * layers;
+}
+
+void TextureAtlas::set_mip_generation(const MipOptions* options, ThreadPool* pool)
+{
+    cpu_mips = options != NULL;
+    if(options)
+        mip_options = *options;
+    mip_pool = pool;
+}
+
+void TextureAtlas::destroy()
+{
+    if(texture)
+        glDeleteTextures(1, &texture);
+    texture = 0;
+    regions.clear();
+}
+
+void TextureAtlas::bind(GLuint unit) const
+{
+    GLResources::bind_texture_unit(unit, GL_TEXTURE_2D_ARRAY, texture);
+}
+
+const AtlasRegion& TextureAtlas::get_region(int image) const
+{
+    return regions[image];
+}
+
+void TextureAtlas::apply_region(GLint region_location, GLint layer_location, int image) const
+{
+    const AtlasRegion &region = regions[image];
+    glUniform4f(region_location, region.u, region.v, region.scale_u, region.scale_v);
+    glUniform1f(layer_location, (float)region.layer);
+}
+
+GLuint TextureAtlas::get_texture() const
+{
+    return texture;
+}
+
+void TextureAtlas::print_report() const
+{
+    const char* mode_names[] = { "auto", "one image per layer", "packed" };
+    const char* mip_source = !cpu_mips ? "driver" : mip_options.filter == MIP_FILTER_KAISER ? "kaiser" : "box";
+    printf("Texture atlas: %u images in %d layers of %dx%d (%s), %d mip levels (%s), %.0f%% of the layers used, %.1f MB\n",
+        (unsigned int)images.size(), layers, layer_width, layer_height, mode_names[mode], mip_levels, mip_source,
+        occupancy * 100.0f, gpu_bytes / (1024.0 * 1024.0));
+}
@@ -0,0 +1,121 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <stddef.h>
+#include <GL/glew.h>
+#include <vector>
+
+#include "mip_chain.h"
+
+// Skyline bottom-left rectangle packer. The skyline is the top edge of
+// everything placed so far, a rectangle goes where it rests lowest (leftmost
+// on ties). Space under overhangs is lost, which costs little when the
+// rectangles are inserted tallest first.
+class SkylinePacker
+{
+private:
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    int width;
+    int height;
+    std::vector<Segment> skyline;
+
+    // Height a rectangle starting at segment index would rest at, -1 if it doesn't fit there
+    int fit(size_t index, int rect_width, int rect_height) const;
+
+public:
+    SkylinePacker();
+
+    void reset(int width, int height);
+    // Finds a spot for the rectangle, false when the page has no room for it
+    bool insert(int rect_width, int rect_height, int &x, int &y);
+};
+
+enum AtlasMode { ATLAS_AUTO, ATLAS_ARRAY, ATLAS_PACKED };
+
+// Where an image ended up: its layer of the array texture and the part of the
+// layer it covers, as offset and scale in texture coordinates
+struct AtlasRegion
+{
+    int layer;
+    float u;
+    float v;
+    float scale_u;
+    float scale_v;
+};
+
+// Combines textures into one GL_TEXTURE_2D_ARRAY so a scene samples all of
+// them through a single binding.
+//
+// Images of one size become a layer each and keep a full mip chain. Mixed
+// sizes are packed into square pages, one page per layer. Packed images are
+// surrounded by a gutter of their own edge pixels and start on a multiple of
+// the gutter size, so mip levels up to log2(gutter) never blend neighbours;
+// the mip chain stops there.
+class TextureAtlas
+{
+private:
+    struct Image
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels; // RGBA8, freed once uploaded
+    };
+
+    std::vector<Image> images;
+    std::vector<AtlasRegion> regions;
+
+    GLuint texture;
+    AtlasMode mode; // What build() settled on
+    int layer_width;
+    int layer_height;
+    int layers;
+    int mip_levels;
+    int gutter;
+    float occupancy; // Fraction of the layers covered by image pixels
+    size_t gpu_bytes;
+
+    bool cpu_mips;
+    MipOptions mip_options;
+    ThreadPool* mip_pool;
+
+    bool build_array();
+    bool build_packed(int max_size, int max_layers);
+    // Padded size of an image, a multiple of the gutter with the gutter on each side
+    int padded_size(int size) const;
+    // x and y are where each image's padded rectangle starts on its layer
+    void upload(const std::vector<int> &x, const std::vector<int> &y);
+
+public:
+    TextureAtlas();
+    ~TextureAtlas();
+
+    // Loads an image file as RGBA. Returns its index for get_region, -1 on failure.
+    int add_image(const char* path);
+    int add_pixels(int width, int height, const unsigned char* rgba);
+
+    // Packs and uploads everything added so far, then frees the pixels. ATLAS_AUTO
+    // uses layers when all images share a size, ATLAS_ARRAY falls back to
+    // packing when they don't. gutter is rounded up to a power of two.
+    bool build(AtlasMode mode = ATLAS_AUTO, int gutter = 8);
+    // Builds the mip levels of later builds on the CPU with these options,
+    // splitting each level across pool's workers when given one. NULL goes
+    // back to glGenerateMipmap.
+    void set_mip_generation(const MipOptions* options, ThreadPool* pool = NULL);
+    void destroy();
+
+    void bind(GLuint unit) const;
+    const AtlasRegion& get_region(int image) const;
+    // Sets the region of an image on the current program: a vec4 (offset, scale) and a float layer
+    void apply_region(GLint region_location, GLint layer_location, int image) const;
+
+    GLuint get_texture() const;
+    void print_report() const;
+};
+
+#endif // TEXTURE_ATLAS_H
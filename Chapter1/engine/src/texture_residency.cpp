@@ -0,0 +1,472 @@
+#include "texture_residency.h"
+#include "profiler.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+#include "image_decode.h"
+
+namespace
+{
+    double now_seconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int level_size(int size, int level)
+    {
+        return std::max(1, size >> level);
+    }
+}
+
+size_t TextureResidency::mip_chain_bytes(int width, int height, int levels)
+{
+    size_t bytes = 0;
+    for(int level = 0; level < levels; level++)
+        bytes += (size_t)level_size(width, level) * level_size(height, level) * 4;
+    return bytes;
+}
+
+TextureResidency::TextureResidency()
+{
+    fallback = 0;
+    read_fbo = 0;
+    draw_fbo = 0;
+    budget = 0;
+    resident_bytes = 0;
+    peak_bytes = 0;
+    frame = 0;
+    loads = 0;
+    restreams = 0;
+    mip_drops = 0;
+    evictions = 0;
+    frames_over_budget = 0;
+    decodes = 0;
+    decode_ms_total = 0.0;
+    cpu_mips = false;
+}
+
+TextureResidency::~TextureResidency()
+{
+}
+
+bool TextureResidency::init(size_t budget_bytes, unsigned int threads)
+{
+    budget = budget_bytes;
+
+    const unsigned char grey[4] = { 128, 128, 128, 255 };
+    glGenTextures(1, &fallback);
+    glBindTexture(GL_TEXTURE_2D, fallback);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenFramebuffers(1, &read_fbo);
+    glGenFramebuffers(1, &draw_fbo);
+
+    pool.start(threads, "Texture Decode");
+    return true;
+}
+
+void TextureResidency::destroy()
+{
+    pool.stop();
+    for(size_t i = 0; i < decoded.size(); i++)
+    {
+        release_image(decoded[i].pixels);
+        delete decoded[i].mips;
+    }
+    decoded.clear();
+    requested.clear();
+
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        if(entries[i].texture)
+            glDeleteTextures(1, &entries[i].texture);
+        if(entries[i].storage)
+            glDeleteTextures(1, &entries[i].storage);
+        entries[i].texture = 0;
+        entries[i].storage = 0;
+        entries[i].loading = false;
+        entries[i].failed = false;
+    }
+    resident_bytes = 0;
+
+    if(fallback)
+        glDeleteTextures(1, &fallback);
+    if(read_fbo)
+        glDeleteFramebuffers(1, &read_fbo);
+    if(draw_fbo)
+        glDeleteFramebuffers(1, &draw_fbo);
+    fallback = read_fbo = draw_fbo = 0;
+}
+
+int TextureResidency::add(const char* path)
+{
+    Entry entry;
+    entry.path = path;
+    entry.texture = 0;
+    entry.width = 0;
+    entry.height = 0;
+    entry.levels = 0;
+    entry.bytes = 0;
+    entry.full_width = 0;
+    entry.full_height = 0;
+    entry.loading = false;
+    entry.failed = false;
+    entry.last_used = 0;
+    entry.storage = 0;
+    entry.storage_width = 0;
+    entry.storage_height = 0;
+    entry.storage_levels = 0;
+    entries.push_back(entry);
+    return (int)entries.size() - 1;
+}
+
+void TextureResidency::request(int handle)
+{
+    Entry &entry = entries[handle];
+    entry.loading = true;
+    requested.push_back(handle);
+    // Workers only see the copied path, entries may grow meanwhile
+    std::string path = entry.path;
+    bool build_mips = cpu_mips;
+    MipOptions options = mip_options;
+    pool.submit([this, handle, path, build_mips, options]
+    {
+        PROFILE_ZONE("Decode Texture");
+        double start = now_seconds();
+        Decoded image;
+        image.handle = handle;
+        image.mips = NULL;
+        int channels;
+        image.pixels = decode_image(path.c_str(), &image.width, &image.height, &channels, 4);
+        // Already on a worker, the levels are built here in one piece rather than split further
+        if(image.pixels && build_mips)
+        {
+            image.mips = new MipChain();
+            image.mips->generate(image.pixels, image.width, image.height, options);
+            release_image(image.pixels);
+            image.pixels = NULL;
+        }
+        image.decode_ms = (now_seconds() - start) * 1000.0;
+
+        std::lock_guard<std::mutex> lock(decoded_mutex);
+        decoded.push_back(image);
+    });
+}
+
+GLuint TextureResidency::use(int handle)
+{
+    Entry &entry = entries[handle];
+    entry.last_used = frame;
+
+    // Anything short of the full image streams back in
+    bool reduced = entry.texture && entry.width < entry.full_width;
+    if(!entry.loading && !entry.failed && (!entry.texture || reduced))
+        request(handle);
+    return entry.texture ? entry.texture : fallback;
+}
+
+void TextureResidency::reset(int handle)
+{
+    entries[handle].failed = false;
+}
+
+void TextureResidency::presize(Entry &entry)
+{
+    int width, height, channels;
+    if(entry.storage || !probe_image(entry.path.c_str(), &width, &height, &channels))
+        return;
+
+    int levels = 1;
+    while((std::max(width, height) >> levels) > 0)
+        levels++;
+    if(cpu_mips && mip_options.max_levels > 0)
+        levels = std::min(levels, mip_options.max_levels);
+
+    glGenTextures(1, &entry.storage);
+    glBindTexture(GL_TEXTURE_2D, entry.storage);
+    for(int level = 0; level < levels; level++)
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, level_size(width, level), level_size(height, level), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    entry.storage_width = width;
+    entry.storage_height = height;
+    entry.storage_levels = levels;
+}
+
+void TextureResidency::upload(const Decoded &image)
+{
+    Entry &entry = entries[image.handle];
+    entry.loading = false;
+    decodes++;
+    decode_ms_total += image.decode_ms;
+    if(!image.pixels && !image.mips)
+    {
+        printf("ERROR::TEXTURE_RESIDENCY::LOAD_FAILED %s\n", entry.path.c_str());
+        entry.failed = true;
+        if(entry.storage)
+            glDeleteTextures(1, &entry.storage);
+        entry.storage = 0;
+        return;
+    }
+
+    if(entry.full_width == 0)
+        loads++;
+    else
+        restreams++;
+    if(entry.texture)
+        evict(entry);
+
+    entry.full_width = image.width;
+    entry.full_height = image.height;
+    entry.width = image.width;
+    entry.height = image.height;
+    entry.levels = 1;
+    while((std::max(image.width, image.height) >> entry.levels) > 0)
+        entry.levels++;
+
+    if(image.mips)
+        entry.levels = image.mips->get_level_count();
+
+    // Storage sized from the header only fits if the file didn't change meanwhile
+    bool presized = entry.storage && entry.storage_width == image.width && entry.storage_height == image.height
+        && entry.storage_levels == entry.levels;
+    if(presized)
+    {
+        entry.texture = entry.storage;
+        glBindTexture(GL_TEXTURE_2D, entry.texture);
+        if(image.mips)
+            image.mips->upload_sub(GL_TEXTURE_2D);
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+    }
+    else
+    {
+        if(entry.storage)
+            glDeleteTextures(1, &entry.storage);
+        glGenTextures(1, &entry.texture);
+        glBindTexture(GL_TEXTURE_2D, entry.texture);
+        if(image.mips)
+            image.mips->upload(GL_TEXTURE_2D);
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    entry.storage = 0;
+    if(!image.mips)
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+    entry.bytes = mip_chain_bytes(entry.width, entry.height, entry.levels);
+    resident_bytes += entry.bytes;
+    peak_bytes = std::max(peak_bytes, resident_bytes);
+}
+
+void TextureResidency::drop_mips(Entry &entry, int count)
+{
+    // Level 0 of the smaller texture must exist
+    count = std::min(count, entry.levels - 1);
+    if(count <= 0)
+        return;
+    int width = level_size(entry.width, count);
+    int height = level_size(entry.height, count);
+    int levels = entry.levels - count;
+
+    GLuint smaller;
+    glGenTextures(1, &smaller);
+    glBindTexture(GL_TEXTURE_2D, smaller);
+    for(int level = 0; level < levels; level++)
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, level_size(width, level), level_size(height, level), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    // The remaining levels are already on the GPU, copy them down instead of decoding again
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_fbo);
+    for(int level = 0; level < levels; level++)
+    {
+        int level_width = level_size(width, level);
+        int level_height = level_size(height, level);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, entry.texture, level + count);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, smaller, level);
+        glBlitFramebuffer(0, 0, level_width, level_height, 0, 0, level_width, level_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    // Leave the FBOs empty, an attachment would keep the deleted texture alive
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glDeleteTextures(1, &entry.texture);
+    resident_bytes -= entry.bytes;
+    entry.texture = smaller;
+    entry.width = width;
+    entry.height = height;
+    entry.levels = levels;
+    entry.bytes = mip_chain_bytes(width, height, levels);
+    resident_bytes += entry.bytes;
+    mip_drops += count;
+}
+
+void TextureResidency::evict(Entry &entry)
+{
+    glDeleteTextures(1, &entry.texture);
+    resident_bytes -= entry.bytes;
+    entry.texture = 0;
+    entry.width = 0;
+    entry.height = 0;
+    entry.levels = 0;
+    entry.bytes = 0;
+}
+
+void TextureResidency::enforce_budget()
+{
+    if(resident_bytes <= budget)
+        return;
+
+    // Least recently used first, what the last two frames drew stays
+    std::vector<int> order;
+    for(size_t i = 0; i < entries.size(); i++)
+        if(entries[i].texture && entries[i].last_used + 1 < frame)
+            order.push_back((int)i);
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        return entries[a].last_used < entries[b].last_used;
+    });
+
+    // Plan mip drops first, a level at a time across all candidates, so detail
+    // goes from everything idle before anything is deleted outright
+    std::vector<int> drops(order.size(), 0);
+    size_t projected = resident_bytes;
+    bool shrunk = true;
+    while(projected > budget && shrunk)
+    {
+        shrunk = false;
+        for(size_t k = 0; k < order.size() && projected > budget; k++)
+        {
+            const Entry &entry = entries[order[k]];
+            int width = level_size(entry.width, drops[k]);
+            int height = level_size(entry.height, drops[k]);
+            int levels = entry.levels - drops[k];
+            // A chain capped by MipOptions::max_levels can run out before the size limit
+            if(std::min(width, height) / 2 < MIN_REDUCED_SIZE || levels <= 1)
+                continue;
+            projected -= mip_chain_bytes(width, height, levels) - mip_chain_bytes(width / 2, height / 2, levels - 1);
+            drops[k]++;
+            shrunk = true;
+        }
+    }
+    for(size_t k = 0; k < order.size(); k++)
+        if(drops[k] > 0)
+            drop_mips(entries[order[k]], drops[k]);
+
+    for(size_t k = 0; k < order.size() && resident_bytes > budget; k++)
+    {
+        evict(entries[order[k]]);
+        evictions++;
+    }
+
+    // Only textures in use are left, the working set is larger than the budget
+    if(resident_bytes > budget)
+        frames_over_budget++;
+}
+
+void TextureResidency::update()
+{
+    PROFILE_ZONE("Texture Residency");
+
+    // Storage for what was requested since the last update, before the decodes that need it come back
+    for(size_t i = 0; i < requested.size(); i++)
+    {
+        Entry &entry = entries[requested[i]];
+        if(entry.loading)
+            presize(entry);
+    }
+    requested.clear();
+
+    std::vector<Decoded> ready;
+    {
+        std::lock_guard<std::mutex> lock(decoded_mutex);
+        ready.swap(decoded);
+    }
+    for(size_t i = 0; i < ready.size(); i++)
+    {
+        // Uploaded pixels go back to the pool for the next decode
+        upload(ready[i]);
+        release_image(ready[i].pixels);
+        delete ready[i].mips;
+    }
+
+    enforce_budget();
+    frame++;
+}
+
+void TextureResidency::set_budget(size_t bytes)
+{
+    budget = bytes;
+}
+
+void TextureResidency::set_mip_generation(const MipOptions* options)
+{
+    cpu_mips = options != NULL;
+    if(options)
+        mip_options = *options;
+}
+
+bool TextureResidency::is_resident(int handle) const
+{
+    return entries[handle].texture != 0;
+}
+
+ResidencyStats TextureResidency::get_stats() const
+{
+    ResidencyStats stats;
+    stats.budget_bytes = budget;
+    stats.resident_bytes = resident_bytes;
+    stats.peak_bytes = peak_bytes;
+    stats.textures = (unsigned int)entries.size();
+    stats.resident = 0;
+    stats.reduced = 0;
+    stats.loading = 0;
+    stats.failed = 0;
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        const Entry &entry = entries[i];
+        if(entry.texture)
+            stats.resident++;
+        if(entry.texture && entry.width < entry.full_width)
+            stats.reduced++;
+        if(entry.loading)
+            stats.loading++;
+        if(entry.failed)
+            stats.failed++;
+    }
+    stats.loads = loads;
+    stats.restreams = restreams;
+    stats.mip_drops = mip_drops;
+    stats.evictions = evictions;
+    stats.frames_over_budget = frames_over_budget;
+    return stats;
+}
+
+void TextureResidency::print_report() const
+{
+    ResidencyStats stats = get_stats();
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    printf("Texture residency: %.1f of %.1f MB (peak %.1f), %u of %u textures resident, %u reduced, %u loading, %u failed\n",
+        stats.resident_bytes * mb, stats.budget_bytes * mb, stats.peak_bytes * mb, stats.resident, stats.textures, stats.reduced, stats.loading,
+        stats.failed);
+    printf("  %llu loads, %llu restreams, %llu mip levels dropped, %llu evictions, %llu frames over budget, decode %.2f ms average\n",
+        stats.loads, stats.restreams, stats.mip_drops, stats.evictions, stats.frames_over_budget,
+        decodes ? decode_ms_total / decodes : 0.0);
+}
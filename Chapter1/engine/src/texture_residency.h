@@ -0,0 +1,142 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include <stddef.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "mip_chain.h"
+#include "thread_pool.h"
+
+struct ResidencyStats
+{
+    size_t budget_bytes;
+    size_t resident_bytes;     // Estimated GPU bytes of every mip level on the GPU
+    size_t peak_bytes;
+    unsigned int textures;
+    unsigned int resident;
+    unsigned int reduced;      // Resident with top mip levels dropped
+    unsigned int loading;
+    unsigned int failed;       // Not requested again until reset()
+    unsigned long long loads;      // First uploads
+    unsigned long long restreams;  // Uploads of a texture that had been evicted or reduced
+    unsigned long long mip_drops;  // Levels dropped, summed over textures
+    unsigned long long evictions;
+    unsigned long long frames_over_budget;
+};
+
+// Streams textures from image files and keeps them within a GPU memory budget.
+//
+// Textures are asked for by handle: use() returns whatever is resident and
+// queues the rest to be decoded on worker threads. update() uploads finished
+// decodes, then frees memory from the least recently used textures while over
+// budget, first by dropping their top mip levels (copied down on the GPU),
+// then by deleting them. Textures used this frame or the last are left
+// alone. A texture used again after losing detail is streamed back in.
+// Image headers are probed while the pixels decode, so the texture storage
+// exists by the time they arrive and the upload only copies into it.
+class TextureResidency
+{
+private:
+    struct Entry
+    {
+        std::string path;
+        GLuint texture;      // 0 while evicted
+        int width;           // Level 0 on the GPU
+        int height;
+        int levels;
+        size_t bytes;
+        int full_width;      // Source image, 0 until first decoded
+        int full_height;
+        bool loading;
+        bool failed;         // Last decode failed, use() stops requesting it
+        unsigned long long last_used;
+        // Allocated from the probed header while the decode runs, becomes texture on upload
+        GLuint storage;
+        int storage_width;
+        int storage_height;
+        int storage_levels;
+    };
+
+    struct Decoded
+    {
+        int handle;
+        int width;
+        int height;
+        unsigned char* pixels; // RGBA8 from decode_image, NULL on failure or once mips holds it
+        MipChain* mips;        // Levels built on the worker, NULL when the driver builds them
+        double decode_ms;
+    };
+
+    std::vector<Entry> entries;
+    ThreadPool pool;
+    // Worker output, collected by update()
+    std::mutex decoded_mutex;
+    std::vector<Decoded> decoded;
+    std::vector<int> requested; // Waiting for storage, see presize()
+
+    bool cpu_mips;
+    MipOptions mip_options;
+
+    GLuint fallback;     // 1x1 grey, returned until a texture arrives
+    GLuint read_fbo;     // For copying levels into a smaller texture
+    GLuint draw_fbo;
+
+    size_t budget;
+    size_t resident_bytes;
+    size_t peak_bytes;
+    unsigned long long frame;
+
+    unsigned long long loads;
+    unsigned long long restreams;
+    unsigned long long mip_drops;
+    unsigned long long evictions;
+    unsigned long long frames_over_budget;
+    unsigned long long decodes;
+    double decode_ms_total;
+
+    void request(int handle);
+    void presize(Entry &entry);
+    void upload(const Decoded &image);
+    void drop_mips(Entry &entry, int count);
+    void evict(Entry &entry);
+    void enforce_budget();
+
+public:
+    // Textures are not shrunk below this on their short side, they are evicted instead
+    static const int MIN_REDUCED_SIZE = 64;
+
+    TextureResidency();
+    ~TextureResidency();
+
+    // threads decode images, 0 picks from the core count
+    bool init(size_t budget_bytes, unsigned int threads = 0);
+    void destroy();
+
+    // Registers an image file, nothing is loaded until it is used. Returns its handle.
+    int add(const char* path);
+    // Texture to bind for this frame: the resident one, at whatever detail it
+    // has, or a grey placeholder while it streams in or if it failed to load
+    GLuint use(int handle);
+    // Forgets a failed load, so the next use() decodes the file again
+    void reset(int handle);
+    // Uploads finished decodes and enforces the budget. Call once per frame
+    // before binding render targets, shrinking textures binds framebuffer 0.
+    void update();
+
+    void set_budget(size_t bytes);
+    // Builds the mip chain on the decode thread after each load and uploads it
+    // level by level. NULL goes back to glGenerateMipmap. Affects later loads.
+    void set_mip_generation(const MipOptions* options);
+    bool is_resident(int handle) const;
+    ResidencyStats get_stats() const;
+    void print_report() const;
+
+    // Estimated bytes of an RGBA8 texture with levels mip levels
+    static size_t mip_chain_bytes(int width, int height, int levels);
+};
+
+#endif // TEXTURE_RESIDENCY_H
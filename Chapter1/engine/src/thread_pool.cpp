@@ -0,0 +1,97 @@
+#include "thread_pool.h"
+#include "profiler.h"
+
+ThreadPool::ThreadPool()
+{
+    busy = 0;
+    stopping = false;
+    name = "Worker";
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::start(unsigned int count, const char* name)
+{
+    if(!workers.empty())
+        return;
+    if(count == 0)
+    {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        count = hardware > 1 ? hardware - 1 : 1;
+    }
+    this->name = name;
+    stopping = false;
+    for(unsigned int i = 0; i < count; i++)
+        workers.push_back(std::thread(&ThreadPool::worker_loop, this));
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    job_ready.notify_all();
+    idle.notify_all();
+    for(size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    workers.clear();
+}
+
+void ThreadPool::submit(const std::function<void()> &job, bool urgent)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(urgent)
+            jobs.push_front(job);
+        else
+            jobs.push_back(job);
+    }
+    job_ready.notify_one();
+}
+
+void ThreadPool::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return stopping || (jobs.empty() && busy == 0); });
+}
+
+unsigned int ThreadPool::get_thread_count() const
+{
+    return (unsigned int)workers.size();
+}
+
+size_t ThreadPool::get_pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + busy;
+}
+
+void ThreadPool::worker_loop()
+{
+    PROFILE_THREAD_NAME(name);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        job_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if(stopping)
+            break;
+
+        std::function<void()> job = jobs.front();
+        jobs.pop_front();
+        busy++;
+        lock.unlock();
+
+        job();
+
+        lock.lock();
+        busy--;
+        if(jobs.empty() && busy == 0)
+            idle.notify_all();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs from one FIFO queue. Jobs must not
+// touch GL, results are handed back to the main thread by the caller.
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > jobs;
+    mutable std::mutex mutex;
+    std::condition_variable job_ready;
+    std::condition_variable idle;
+    unsigned int busy;
+    bool stopping;
+    const char* name;
+
+    void worker_loop();
+
+public:
+    ThreadPool();
+    ~ThreadPool();
+
+    // Starts count workers, 0 picks one less than the hardware threads (at
+    // least one) so the main thread keeps a core. name labels the workers in
+    // profiler traces and must outlive the pool.
+    void start(unsigned int count = 0, const char* name = "Worker");
+    // Drops queued jobs and joins the workers once their current job is done
+    void stop();
+
+    // Urgent jobs go to the front of the queue
+    void submit(const std::function<void()> &job, bool urgent = false);
+    // Blocks until the queue is empty and no job is running
+    void wait_idle();
+
+    unsigned int get_thread_count() const;
+    size_t get_pending() const; // Queued plus running jobs
+};
+
+#endif // THREAD_POOL_H
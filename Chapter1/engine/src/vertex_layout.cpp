@@ -0,0 +1,228 @@
+#include "vertex_layout.h"
+#include "gl_resources.h"
+
+#include <stdio.h>
+
+namespace
+{
+    // FNV-1a, 64 bit
+    const uint64_t HASH_START = 14695981039346656037ULL;
+
+    uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for(size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        return hash;
+    }
+
+    GLsizei element_size(GLint components, GLenum type)
+    {
+        switch(type)
+        {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:  return components;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:     return components * 2;
+        // All four components share one 32 bit word
+        case GL_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_2_10_10_10_REV: return 4;
+        default:                return components * 4;
+        }
+    }
+}
+
+VertexFormat::VertexFormat()
+{
+    stride = 0;
+    hash = HASH_START;
+}
+
+VertexFormat& VertexFormat::push(const char* name, GLint components, GLenum type, bool normalized, bool integer)
+{
+    VertexElement element;
+    element.name = name;
+    element.components = components;
+    element.type = type;
+    element.normalized = normalized;
+    element.integer = integer;
+    element.offset = (GLuint)stride;
+    elements.push_back(element);
+    stride += element_size(components, type);
+
+    hash = hash_bytes(hash, name, element.name.size() + 1);
+    hash = hash_bytes(hash, &components, sizeof(components));
+    hash = hash_bytes(hash, &type, sizeof(type));
+    hash = hash_bytes(hash, &normalized, sizeof(normalized));
+    hash = hash_bytes(hash, &integer, sizeof(integer));
+    hash = hash_bytes(hash, &element.offset, sizeof(element.offset));
+    return *this;
+}
+
+VertexFormat& VertexFormat::add(const char* name, GLint components, GLenum type, bool normalized)
+{
+    return push(name, components, type, normalized, false);
+}
+
+VertexFormat& VertexFormat::add_integer(const char* name, GLint components, GLenum type)
+{
+    return push(name, components, type, false, true);
+}
+
+VertexFormat& VertexFormat::skip(GLsizei bytes)
+{
+    stride += bytes;
+    hash = hash_bytes(hash, &bytes, sizeof(bytes));
+    return *this;
+}
+
+const std::vector<VertexElement>& VertexFormat::get_elements() const
+{
+    return elements;
+}
+
+const VertexElement* VertexFormat::find(const std::string &name) const
+{
+    for(size_t i = 0; i < elements.size(); i++)
+        if(elements[i].name == name)
+            return &elements[i];
+    return NULL;
+}
+
+GLsizei VertexFormat::get_stride() const
+{
+    return stride;
+}
+
+uint64_t VertexFormat::get_hash() const
+{
+    // The stride changes with trailing skip() calls the elements don't show
+    return hash_bytes(hash, &stride, sizeof(stride));
+}
+
+bool VertexFormat::validate(const ProgramInterface &program, std::string &error) const
+{
+    const std::vector<ProgramAttribute> &attributes = program.get_attributes();
+    for(size_t i = 0; i < attributes.size(); i++)
+    {
+        const ProgramAttribute &attribute = attributes[i];
+        GLenum scalar;
+        if(ProgramInterface::get_components(attribute.type, scalar) == 0 || attribute.size != 1)
+        {
+            error = "input " + attribute.name + " is a matrix or array, only scalars and vectors are supported";
+            return false;
+        }
+        const VertexElement* element = find(attribute.name);
+        if(!element)
+        {
+            error = "input " + attribute.name + " isn't in the vertex format";
+            return false;
+        }
+        if(element->integer != (scalar != GL_FLOAT))
+        {
+            error = "input " + attribute.name + (element->integer
+                ? " is float but the format has integers, use add()"
+                : " is an integer but the format converts to float, use add_integer()");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VertexArrayCache::Key::operator<(const Key &other) const
+{
+    if(program_hash != other.program_hash)
+        return program_hash < other.program_hash;
+    if(format_hash != other.format_hash)
+        return format_hash < other.format_hash;
+    if(vertex_buffer != other.vertex_buffer)
+        return vertex_buffer < other.vertex_buffer;
+    return index_buffer < other.index_buffer;
+}
+
+VertexArrayCache::VertexArrayCache()
+{
+    hits = 0;
+    misses = 0;
+}
+
+VertexArrayCache& VertexArrayCache::get()
+{
+    static VertexArrayCache cache;
+    return cache;
+}
+
+GLuint VertexArrayCache::acquire(const ProgramInterface &program, const VertexFormat &format,
+                                 GLuint vertex_buffer, GLuint index_buffer)
+{
+    Key key;
+    key.program_hash = program.get_vertex_hash();
+    key.format_hash = format.get_hash();
+    key.vertex_buffer = vertex_buffer;
+    key.index_buffer = index_buffer;
+    std::map<Key, GLuint>::iterator found = arrays.find(key);
+    if(found != arrays.end())
+    {
+        hits++;
+        return found->second;
+    }
+
+    std::string error;
+    if(!format.validate(program, error))
+    {
+        printf("ERROR::VERTEX_LAYOUT::MISMATCH %s\n", error.c_str());
+        return 0;
+    }
+    misses++;
+
+    // One buffer binding for the interleaved vertex, every attribute reads from it
+    GLuint vao = GLResources::create_vertex_array();
+    GLResources::vertex_array_buffer(vao, 0, vertex_buffer, 0, format.get_stride());
+    // Only what the program reads is enabled, the rest of the format is skipped over
+    const std::vector<ProgramAttribute> &attributes = program.get_attributes();
+    for(size_t i = 0; i < attributes.size(); i++)
+    {
+        const VertexElement* element = format.find(attributes[i].name);
+        GLResources::vertex_array_attribute(vao, (GLuint)attributes[i].location, 0, element->components, element->type,
+            element->normalized, element->integer, element->offset);
+    }
+    if(index_buffer)
+        GLResources::vertex_array_element_buffer(vao, index_buffer);
+    arrays[key] = vao;
+    return vao;
+}
+
+void VertexArrayCache::release_buffer(GLuint buffer)
+{
+    std::map<Key, GLuint>::iterator it = arrays.begin();
+    while(it != arrays.end())
+    {
+        if(it->first.vertex_buffer == buffer || it->first.index_buffer == buffer)
+        {
+            GLResources::delete_vertex_array(it->second);
+            arrays.erase(it++);
+        }
+        else
+            ++it;
+    }
+}
+
+void VertexArrayCache::clear()
+{
+    for(std::map<Key, GLuint>::iterator it = arrays.begin(); it != arrays.end(); ++it)
+        GLResources::delete_vertex_array(it->second);
+    arrays.clear();
+}
+
+size_t VertexArrayCache::get_array_count() const
+{
+    return arrays.size();
+}
+
+void VertexArrayCache::print_report() const
+{
+    unsigned long long lookups = hits + misses;
+    printf("Vertex arrays: %zu cached, %llu lookups, %.0f%% shared an existing array\n",
+        arrays.size(), lookups, lookups ? 100.0 * hits / lookups : 0.0);
+}
@@ -0,0 +1,103 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "program_interface.h"
+
+struct VertexElement
+{
+    std::string name;   // The shader's input variable
+    GLint components;
+    GLenum type;        // Type in the buffer: GL_FLOAT, GL_UNSIGNED_BYTE, ...
+    bool normalized;
+    bool integer;       // Read with glVertexAttribIPointer, for int/uint inputs
+    GLuint offset;
+};
+
+// What one interleaved vertex in a buffer looks like, described by the names
+// of the shader inputs rather than their locations. Offsets and the stride
+// follow from the order elements are added in:
+//
+//     VertexFormat format;
+//     format.add("aPos", 3).add("aTexCoord", 2);
+class VertexFormat
+{
+private:
+    std::vector<VertexElement> elements;
+    GLsizei stride;
+    uint64_t hash;
+
+    VertexFormat& push(const char* name, GLint components, GLenum type, bool normalized, bool integer);
+
+public:
+    VertexFormat();
+
+    VertexFormat& add(const char* name, GLint components, GLenum type = GL_FLOAT, bool normalized = false);
+    VertexFormat& add_integer(const char* name, GLint components, GLenum type);
+    // Bytes the shader doesn't read
+    VertexFormat& skip(GLsizei bytes);
+
+    const std::vector<VertexElement>& get_elements() const;
+    const VertexElement* find(const std::string &name) const;
+    GLsizei get_stride() const;
+    uint64_t get_hash() const;
+
+    // False with the reason in error if the program reads an input the format
+    // doesn't have, or reads it as float when the buffer holds integers for
+    // glVertexAttribIPointer (or the other way around). Elements the program
+    // doesn't read are fine.
+    bool validate(const ProgramInterface &program, std::string &error) const;
+};
+
+// Vertex array objects built from a program's reflected inputs and a
+// VertexFormat, so attribute locations, types and strides come from the
+// shader and the format instead of being written out by hand.
+//
+// Arrays are keyed by the program's vertex hash, the format and the buffers.
+// GL 3.3 keeps the buffer inside the array (there is no separate vertex
+// binding before 4.3), so the buffers are part of the key: programs that read
+// the same inputs share one array per buffer, and a hot reloaded program
+// keeps its arrays unless its inputs moved.
+class VertexArrayCache
+{
+private:
+    struct Key
+    {
+        uint64_t program_hash;
+        uint64_t format_hash;
+        GLuint vertex_buffer;
+        GLuint index_buffer;
+
+        bool operator<(const Key &other) const;
+    };
+
+    std::map<Key, GLuint> arrays;
+    unsigned long long hits;
+    unsigned long long misses;
+
+    VertexArrayCache();
+
+public:
+    static VertexArrayCache& get();
+
+    // The array reading vertex_buffer as format for program, with
+    // index_buffer (0 for none) as its element buffer. Built through
+    // GLResources, so with DSA no binding changes.
+    // 0 with the reason printed if the format doesn't fit the program.
+    GLuint acquire(const ProgramInterface &program, const VertexFormat &format,
+                   GLuint vertex_buffer, GLuint index_buffer = 0);
+
+    // Deletes the arrays reading from buffer, call before deleting it
+    void release_buffer(GLuint buffer);
+    void clear();
+
+    size_t get_array_count() const;
+    void print_report() const;
+};
+
+#endif // VERTEX_LAYOUT_H
@@ -0,0 +1,91 @@
+#include "window.h"
+
+#include <stdio.h>
+
+Window::Window()
+{
+    window = NULL;
+    context = NULL;
+}
+
+bool Window::init(const char* title, int width, int height, Uint32 flags, int major_version, int minor_version)
+{
+    // Setup SDL Stuff
+    if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
+    {
+        printf("Failed to initialize SDL");
+        return false;
+    }
+
+    // Setup OpenGL Attributes
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, major_version);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minor_version);
+
+    // Create Window
+    window = SDL_CreateWindow(title, 0, 0, width, height, SDL_WINDOW_OPENGL | flags);
+    if (!window)
+    {
+        printf("Failed to create SDL window");
+        return false;
+    }
+
+    // Create Context
+    context = SDL_GL_CreateContext(window);
+    if (!context)
+    {
+        printf("Failed to create context");
+        return false;
+    }
+
+    // Make Current Context
+    SDL_GL_MakeCurrent(window, context);
+
+    // Create View Port
+    int drawable_width, drawable_height;
+    get_drawable_size(&drawable_width, &drawable_height);
+    glViewport(0, 0, drawable_width, drawable_height);
+
+    // Initialize GLEW
+    glewExperimental = GL_TRUE;
+    GLenum glewError = glewInit();
+    if (glewError != GLEW_OK)
+    {
+        printf("Error initializing GLEW %s\n", glewGetErrorString(glewError));
+        return false;
+    }
+
+    return true;
+}
+
+void Window::destroy()
+{
+    // SDL Cleanup
+    if(context)
+        SDL_GL_DeleteContext(context);
+    if(window)
+        SDL_DestroyWindow(window);
+    context = NULL;
+    window = NULL;
+    SDL_Quit();
+}
+
+void Window::swap()
+{
+    SDL_GL_SwapWindow(window);
+}
+
+SDL_Window* Window::get_window() const
+{
+    return window;
+}
+
+SDL_GLContext Window::get_context() const
+{
+    return context;
+}
+
+void Window::get_drawable_size(int* width, int* height) const
+{
+    SDL_GL_GetDrawableSize(window, width, height);
+}
@@ -0,0 +1,33 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+// SDL window with a core profile GL context and GLEW loaded, the setup every
+// chapter starts with
+class Window
+{
+private:
+    SDL_Window* window;
+    SDL_GLContext context;
+
+public:
+    Window();
+
+    // Initializes SDL, creates the window and context, sets the viewport to
+    // the drawable size and loads GL through GLEW. Prints what failed and
+    // returns false on error.
+    bool init(const char* title, int width, int height, Uint32 flags = 0, int major_version = 3, int minor_version = 3);
+    // Deletes the context and window and shuts SDL down
+    void destroy();
+
+    void swap();
+
+    SDL_Window* get_window() const;
+    SDL_GLContext get_context() const;
+    // Drawable size can differ from the window size on high DPI displays
+    void get_drawable_size(int* width, int* height) const;
+};
+
+#endif // WINDOW_H
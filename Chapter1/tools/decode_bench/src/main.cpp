@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "image_decode.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "stb/stb_image.h"
+
+// Decodes an image corpus over and over and reports throughput and peak RSS.
+// --alloc=heap is plain stb, every allocation from malloc; --alloc=arena
+// is decode_image, scratch memory from the thread's DecodeArena and the
+// pixels from ImageBufferPool. Peak RSS is for the whole process, compare
+// allocators across separate runs (make run does both).
+//
+// --io picks how files are read: stb's buffered stdio (stbi_load) or a
+// memory mapping (stbi_load_from_memory). --cache=cold drops the corpus from
+// the page cache before every pass, --read-only skips decoding to time the
+// reads alone.
+
+static double now_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool is_image(const std::string &name)
+{
+    const char* extensions[] = { ".png", ".jpg", ".jpeg", ".PNG", ".JPG", ".JPEG" };
+    for(size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+    {
+        size_t length = strlen(extensions[i]);
+        if(name.size() > length && name.compare(name.size() - length, length, extensions[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Files are taken as they are, directories for the images directly inside them
+static void add_path(const char* path, std::vector<std::string> &files)
+{
+    struct stat info;
+    if(stat(path, &info) != 0)
+    {
+        printf("ERROR::DECODE_BENCH::MISSING %s\n", path);
+        return;
+    }
+    if(!S_ISDIR(info.st_mode))
+    {
+        files.push_back(path);
+        return;
+    }
+
+    DIR* dir = opendir(path);
+    if(!dir)
+        return;
+    while(struct dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if(is_image(name))
+            files.push_back(std::string(path) + "/" + name);
+    }
+    closedir(dir);
+}
+
+// Reads a file the way a decode would without decoding it. Returns a sum of
+// the bytes so the reads can't be optimised away.
+static unsigned int read_file(const char* path, ImageIO io)
+{
+    unsigned int sum = 0;
+    if(io == IMAGE_IO_MMAP)
+    {
+        MappedFile file;
+        if(!file.open(path))
+            return 0;
+        for(size_t i = 0; i < file.get_size(); i += 4096)
+            sum += file.get_data()[i];
+        return sum;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if(!file)
+        return 0;
+    unsigned char buffer[65536];
+    size_t count;
+    while((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        for(size_t i = 0; i < count; i += 4096)
+            sum += buffer[i];
+    fclose(file);
+    return sum;
+}
+
+static unsigned char* decode_heap(const char* path, int* width, int* height, int* channels, ImageIO io)
+{
+    if(io == IMAGE_IO_STDIO)
+        return stbi_load(path, width, height, channels, 4);
+    MappedFile file;
+    if(!file.open(path) || file.get_size() > 0x7fffffff)
+        return NULL;
+    return stbi_load_from_memory(file.get_data(), (int)file.get_size(), width, height, channels, 4);
+}
+
+static size_t current_rss_kb()
+{
+    long pages = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if(file)
+    {
+        long size;
+        if(fscanf(file, "%ld %ld", &size, &pages) != 2)
+            pages = 0;
+        fclose(file);
+    }
+    return (size_t)pages * 4;
+}
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s [options] [image or directory ...]\n", program);
+    printf("  --alloc=MODE     heap (stb and malloc) or arena (decode_image, default)\n");
+    printf("  --io=MODE        mmap (default) or stdio\n");
+    printf("  --cache=STATE    warm (default) or cold, dropping the files from the page cache before each pass\n");
+    printf("  --read-only      Only read the files, no decoding\n");
+    printf("  --passes=N       Times the corpus is decoded (default 10)\n");
+    printf("  --threads=N      Decoding threads, 0 for one per spare core (default 1)\n");
+    printf("  --pool-cache=MB  Released pixel buffers the arena mode keeps for reuse (default 128)\n");
+    printf("Images default to the 07_Camera textures.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    bool arena = true;
+    ImageIO io = IMAGE_IO_MMAP;
+    bool cold = false;
+    bool read_only = false;
+    unsigned int passes = 10;
+    unsigned int threads = 1;
+    std::vector<std::string> files;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--alloc=heap") == 0)
+            arena = false;
+        else if(strcmp(argv[i], "--alloc=arena") == 0)
+            arena = true;
+        else if(strcmp(argv[i], "--io=mmap") == 0)
+            io = IMAGE_IO_MMAP;
+        else if(strcmp(argv[i], "--io=stdio") == 0)
+            io = IMAGE_IO_STDIO;
+        else if(strcmp(argv[i], "--cache=warm") == 0)
+            cold = false;
+        else if(strcmp(argv[i], "--cache=cold") == 0)
+            cold = true;
+        else if(strcmp(argv[i], "--read-only") == 0)
+            read_only = true;
+        else if(strncmp(argv[i], "--passes=", 9) == 0)
+            passes = (unsigned int)atoi(argv[i] + 9);
+        else if(strncmp(argv[i], "--threads=", 10) == 0)
+            threads = (unsigned int)atoi(argv[i] + 10);
+        else if(strncmp(argv[i], "--pool-cache=", 13) == 0)
+            ImageBufferPool::get().set_max_cached((size_t)(atof(argv[i] + 13) * 1024.0 * 1024.0));
+        else if(argv[i][0] != '-')
+            add_path(argv[i], files);
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    if(passes == 0)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+    if(files.empty())
+    {
+        add_path("../../07_Camera/textures/container.jpg", files);
+        add_path("../../07_Camera/textures/awesomeface.png", files);
+    }
+    if(files.empty())
+        return -1;
+
+    size_t file_bytes = 0;
+    for(size_t i = 0; i < files.size(); i++)
+    {
+        struct stat info;
+        if(stat(files[i].c_str(), &info) == 0)
+            file_bytes += (size_t)info.st_size;
+    }
+
+    size_t start_rss = current_rss_kb();
+    std::mutex totals_mutex;
+    double pixels = 0.0;
+    unsigned int decoded = 0;
+    unsigned int failed = 0;
+
+    ThreadPool pool;
+    pool.start(threads, "Decode");
+    // A warm run reads everything once first, so the first pass isn't cold
+    if(!cold)
+        for(size_t i = 0; i < files.size(); i++)
+            read_file(files[i].c_str(), io);
+
+    double seconds = 0.0;
+    unsigned int checksum = 0;
+    for(unsigned int pass = 0; pass < passes; pass++)
+    {
+        // Dropping the cache isn't part of the time
+        if(cold)
+            for(size_t i = 0; i < files.size(); i++)
+                MappedFile::drop_cached(files[i].c_str());
+
+        double start = now_seconds();
+        for(size_t i = 0; i < files.size(); i++)
+        {
+            std::string path = files[i];
+            pool.submit([&, path]
+            {
+                if(read_only)
+                {
+                    unsigned int sum = read_file(path.c_str(), io);
+                    std::lock_guard<std::mutex> lock(totals_mutex);
+                    checksum += sum;
+                    decoded++;
+                    return;
+                }
+
+                int width = 0, height = 0, channels;
+                unsigned char* data;
+                if(arena)
+                    data = decode_image(path.c_str(), &width, &height, &channels, 4, io);
+                else
+                    data = decode_heap(path.c_str(), &width, &height, &channels, io);
+
+                // Where the upload would go, the buffer is handed straight back
+                if(arena)
+                    release_image(data);
+                else
+                    stbi_image_free(data);
+
+                std::lock_guard<std::mutex> lock(totals_mutex);
+                if(data)
+                {
+                    decoded++;
+                    pixels += (double)width * height;
+                }
+                else
+                    failed++;
+            });
+        }
+        pool.wait_idle();
+        seconds += now_seconds() - start;
+    }
+    unsigned int thread_count = pool.get_thread_count();
+    pool.stop();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    printf("Decode bench (%s, %s, %s cache%s): %u images (%u failed) from %u files over %u passes on %u threads in %.2f s\n",
+        arena ? "arena" : "heap", io == IMAGE_IO_MMAP ? "mmap" : "stdio", cold ? "cold" : "warm", read_only ? ", read only" : "",
+        decoded, failed, (unsigned int)files.size(), passes, thread_count, seconds);
+    printf("  %.1f images/s, %.1f MB/s compressed, %.1f MP/s decoded\n",
+        decoded / seconds, file_bytes * (double)passes * mb / seconds, pixels / seconds / 1000000.0);
+    printf("  RSS %.1f MB at start, %.1f MB at end, %.1f MB peak\n",
+        start_rss / 1024.0, current_rss_kb() / 1024.0, usage.ru_maxrss / 1024.0);
+    if(arena)
+    {
+        ImagePoolStats stats = ImageBufferPool::get().get_stats();
+        printf("  Buffer pool: %llu of %llu buffers reused, %.1f MB cached, %.1f MB peak outstanding\n",
+            stats.reuses, stats.acquires, stats.cached_bytes * mb, stats.peak_outstanding_bytes * mb);
+    }
+    if(read_only)
+        printf("  Checksum %u\n", checksum);
+    return failed ? 1 : 0;
+}
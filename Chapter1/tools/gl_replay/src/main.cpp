@@ -0,0 +1,968 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+#include "gl_trace.h"
+
+// Replays a trace recorded with `07_Camera --capture=FILE` as fast as possible.
+// The setup part runs once, then the captured frame is looped to measure
+// driver throughput independently of the application.
+
+// Object names the application can have used. Name tables are allocated once
+// up front so replaying a command never allocates.
+const uint32_t MAX_NAMES = 1 << 16;
+const uint32_t MAX_UNIFORM_LOCATIONS = 1024;
+const uint32_t MAX_UNIFORM_BLOCKS = 64;
+
+struct Reader
+{
+    const unsigned char* p;
+
+    uint32_t u32() { uint32_t v; memcpy(&v, p, sizeof(v)); p += sizeof(v); return v; }
+    int32_t i32() { int32_t v; memcpy(&v, p, sizeof(v)); p += sizeof(v); return v; }
+    float f32() { float v; memcpy(&v, p, sizeof(v)); p += sizeof(v); return v; }
+    uint64_t u64() { uint64_t v; memcpy(&v, p, sizeof(v)); p += sizeof(v); return v; }
+
+    // Blobs point straight into the mapped file
+    const unsigned char* blob(uint32_t &length)
+    {
+        length = u32();
+        const unsigned char* data = p;
+        p += (length + 3) & ~3u;
+        return data;
+    }
+};
+
+// glTexStorage2D/3D, or each level allocated with glTexImage where the
+// replaying context lacks ARB_texture_storage
+static void tex_storage(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height, GLsizei depth)
+{
+    bool layered = target == GL_TEXTURE_2D_ARRAY || target == GL_TEXTURE_3D;
+    if(GLEW_ARB_texture_storage)
+    {
+        if(layered)
+            glTexStorage3D(target, levels, internal_format, width, height, depth);
+        else
+            glTexStorage2D(target, levels, internal_format, width, height);
+        return;
+    }
+
+    GLenum format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+    if(internal_format == GL_DEPTH_COMPONENT32F)
+    {
+        format = GL_DEPTH_COMPONENT;
+        type = GL_FLOAT;
+    }
+    else if(internal_format == GL_DEPTH_COMPONENT16 || internal_format == GL_DEPTH_COMPONENT24 || internal_format == GL_DEPTH_COMPONENT32)
+    {
+        format = GL_DEPTH_COMPONENT;
+        type = GL_UNSIGNED_INT;
+    }
+    else if(internal_format == GL_DEPTH24_STENCIL8)
+    {
+        format = GL_DEPTH_STENCIL;
+        type = GL_UNSIGNED_INT_24_8;
+    }
+    for(GLsizei level = 0; level < levels; level++)
+    {
+        GLsizei level_width = std::max(width >> level, 1);
+        GLsizei level_height = std::max(height >> level, 1);
+        // Array layers don't shrink with the levels, 3D depth does
+        GLsizei level_depth = target == GL_TEXTURE_3D ? std::max(depth >> level, 1) : depth;
+        if(layered)
+            glTexImage3D(target, level, internal_format, level_width, level_height, level_depth, 0, format, type, NULL);
+        else
+            glTexImage2D(target, level, internal_format, level_width, level_height, 0, format, type, NULL);
+    }
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+class Replayer
+{
+public:
+    // Must be constructed after glewInit()
+    Replayer() : errors(0), dsa(GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access), textures(MAX_NAMES, 0), buffers(MAX_NAMES, 0), vertex_arrays(MAX_NAMES, 0), framebuffers(MAX_NAMES, 0),
+        objects(MAX_NAMES, 0), uniform_locations(MAX_NAMES), uniform_blocks(MAX_NAMES), current_program(0) {}
+
+    // Executes the commands in [begin, end). Returns the number executed.
+    unsigned int execute(const unsigned char* begin, const unsigned char* end);
+
+    unsigned int errors;
+
+private:
+    bool dsa;
+    std::vector<GLuint> textures;
+    std::vector<GLuint> buffers;
+    std::vector<GLuint> vertex_arrays;
+    std::vector<GLuint> framebuffers;
+    std::vector<GLuint> objects; // Shaders and programs share one namespace
+    std::vector<std::vector<GLint> > uniform_locations;
+    std::vector<std::vector<GLuint> > uniform_blocks;
+    uint32_t current_program;
+
+    GLuint lookup(std::vector<GLuint> &table, uint32_t name)
+    {
+        if(name >= MAX_NAMES)
+        {
+            errors++;
+            return 0;
+        }
+        return table[name];
+    }
+
+    GLint location(int32_t captured)
+    {
+        if(captured < 0 || captured >= (int32_t)MAX_UNIFORM_LOCATIONS || current_program >= MAX_NAMES)
+            return -1;
+        const std::vector<GLint> &locations = uniform_locations[current_program];
+        return locations.empty() ? -1 : locations[captured];
+    }
+
+    GLuint block_index(uint32_t program, uint32_t captured)
+    {
+        if(program >= MAX_NAMES || captured >= MAX_UNIFORM_BLOCKS || uniform_blocks[program].empty())
+            return GL_INVALID_INDEX;
+        return uniform_blocks[program][captured];
+    }
+
+    bool read_name(Reader &in, char* buffer, size_t size);
+    void gen_names(Reader &in, std::vector<GLuint> &table, void (GLAPIENTRY *gen)(GLsizei, GLuint*));
+    void delete_names(Reader &in, std::vector<GLuint> &table, void (GLAPIENTRY *del)(GLsizei, const GLuint*));
+};
+
+// Copies a name blob into a NUL terminated buffer
+bool Replayer::read_name(Reader &in, char* buffer, size_t size)
+{
+    uint32_t length;
+    const unsigned char* name = in.blob(length);
+    if(length >= size)
+        return false;
+    memcpy(buffer, name, length);
+    buffer[length] = '\0';
+    return true;
+}
+
+void Replayer::gen_names(Reader &in, std::vector<GLuint> &table, void (GLAPIENTRY *gen)(GLsizei, GLuint*))
+{
+    uint32_t n = in.u32();
+    for(uint32_t i = 0; i < n; i++)
+    {
+        uint32_t name = in.u32();
+        GLuint created = 0;
+        gen(1, &created);
+        if(name < MAX_NAMES)
+            table[name] = created;
+        else
+            errors++;
+    }
+}
+
+void Replayer::delete_names(Reader &in, std::vector<GLuint> &table, void (GLAPIENTRY *del)(GLsizei, const GLuint*))
+{
+    uint32_t n = in.u32();
+    for(uint32_t i = 0; i < n; i++)
+    {
+        GLuint name = lookup(table, in.u32());
+        del(1, &name);
+    }
+}
+
+// GL 1.1 entry points are plain functions, wrap the GLEW ones to match
+static void GLAPIENTRY gen_vertex_arrays(GLsizei n, GLuint* names) { glGenVertexArrays(n, names); }
+static void GLAPIENTRY delete_vertex_arrays(GLsizei n, const GLuint* names) { glDeleteVertexArrays(n, names); }
+static void GLAPIENTRY gen_buffers(GLsizei n, GLuint* names) { glGenBuffers(n, names); }
+static void GLAPIENTRY delete_buffers(GLsizei n, const GLuint* names) { glDeleteBuffers(n, names); }
+static void GLAPIENTRY gen_framebuffers(GLsizei n, GLuint* names) { glGenFramebuffers(n, names); }
+static void GLAPIENTRY delete_framebuffers(GLsizei n, const GLuint* names) { glDeleteFramebuffers(n, names); }
+static void GLAPIENTRY create_buffers(GLsizei n, GLuint* names) { glCreateBuffers(n, names); }
+static void GLAPIENTRY create_vertex_arrays(GLsizei n, GLuint* names) { glCreateVertexArrays(n, names); }
+
+unsigned int Replayer::execute(const unsigned char* begin, const unsigned char* end)
+{
+    unsigned int executed = 0;
+    const unsigned char* p = begin;
+
+    while(p + sizeof(TraceCommand) <= end)
+    {
+        TraceCommand command;
+        memcpy(&command, p, sizeof(command));
+        Reader in = { p + sizeof(command) };
+        p += sizeof(command) + command.size;
+        executed++;
+
+        // Commands recorded through direct state access need it to replay
+        if(command.opcode >= TRACE_CREATE_BUFFERS && command.opcode <= TRACE_VERTEX_ARRAY_ELEMENT_BUFFER && !dsa)
+        {
+            errors++;
+            continue;
+        }
+
+        switch(command.opcode)
+        {
+            case(TRACE_FRAME_END):
+                break;
+            case(TRACE_ACTIVE_TEXTURE):
+                glActiveTexture(in.u32());
+                break;
+            case(TRACE_GEN_TEXTURES):
+                gen_names(in, textures, glGenTextures);
+                break;
+            case(TRACE_DELETE_TEXTURES):
+                delete_names(in, textures, glDeleteTextures);
+                break;
+            case(TRACE_BIND_TEXTURE):
+            {
+                GLenum target = in.u32();
+                glBindTexture(target, lookup(textures, in.u32()));
+                break;
+            }
+            case(TRACE_TEX_PARAMETERI):
+            {
+                GLenum target = in.u32();
+                GLenum name = in.u32();
+                glTexParameteri(target, name, in.i32());
+                break;
+            }
+            case(TRACE_TEX_IMAGE_2D):
+            {
+                GLenum target = in.u32();
+                GLint level = in.i32();
+                GLint internal_format = in.i32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                GLint border = in.i32();
+                GLenum format = in.u32();
+                GLenum type = in.u32();
+                uint32_t length;
+                const unsigned char* pixels = in.blob(length);
+                glTexImage2D(target, level, internal_format, width, height, border, format, type, length ? pixels : NULL);
+                break;
+            }
+            case(TRACE_TEX_SUB_IMAGE_2D):
+            {
+                GLenum target = in.u32();
+                GLint level = in.i32();
+                GLint x = in.i32();
+                GLint y = in.i32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                GLenum format = in.u32();
+                GLenum type = in.u32();
+                uint32_t length;
+                const unsigned char* pixels = in.blob(length);
+                glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+                break;
+            }
+            case(TRACE_TEX_IMAGE_3D):
+            {
+                GLenum target = in.u32();
+                GLint level = in.i32();
+                GLint internal_format = in.i32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                GLsizei depth = in.i32();
+                GLint border = in.i32();
+                GLenum format = in.u32();
+                GLenum type = in.u32();
+                uint32_t length;
+                const unsigned char* pixels = in.blob(length);
+                glTexImage3D(target, level, internal_format, width, height, depth, border, format, type, length ? pixels : NULL);
+                break;
+            }
+            case(TRACE_TEX_SUB_IMAGE_3D):
+            {
+                GLenum target = in.u32();
+                GLint level = in.i32();
+                GLint x = in.i32();
+                GLint y = in.i32();
+                GLint z = in.i32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                GLsizei depth = in.i32();
+                GLenum format = in.u32();
+                GLenum type = in.u32();
+                uint32_t length;
+                const unsigned char* pixels = in.blob(length);
+                glTexSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+                break;
+            }
+            case(TRACE_GENERATE_MIPMAP):
+                glGenerateMipmap(in.u32());
+                break;
+            case(TRACE_CREATE_SHADER):
+            {
+                GLenum type = in.u32();
+                uint32_t name = in.u32();
+                if(name < MAX_NAMES)
+                    objects[name] = glCreateShader(type);
+                break;
+            }
+            case(TRACE_SHADER_SOURCE):
+            {
+                GLuint shader = lookup(objects, in.u32());
+                uint32_t length;
+                const GLchar* source = (const GLchar*)in.blob(length);
+                GLint source_length = (GLint)length;
+                glShaderSource(shader, 1, &source, &source_length);
+                break;
+            }
+            case(TRACE_COMPILE_SHADER):
+                glCompileShader(lookup(objects, in.u32()));
+                break;
+            case(TRACE_DELETE_SHADER):
+                glDeleteShader(lookup(objects, in.u32()));
+                break;
+            case(TRACE_CREATE_PROGRAM):
+            {
+                uint32_t name = in.u32();
+                if(name < MAX_NAMES)
+                    objects[name] = glCreateProgram();
+                break;
+            }
+            case(TRACE_ATTACH_SHADER):
+            {
+                GLuint program = lookup(objects, in.u32());
+                glAttachShader(program, lookup(objects, in.u32()));
+                break;
+            }
+            case(TRACE_LINK_PROGRAM):
+                glLinkProgram(lookup(objects, in.u32()));
+                break;
+            case(TRACE_DELETE_PROGRAM):
+                glDeleteProgram(lookup(objects, in.u32()));
+                break;
+            case(TRACE_USE_PROGRAM):
+                current_program = in.u32();
+                glUseProgram(lookup(objects, current_program));
+                break;
+            case(TRACE_GET_UNIFORM_LOCATION):
+            {
+                uint32_t program = in.u32();
+                int32_t captured = in.i32();
+                char name_buffer[256];
+                if(!read_name(in, name_buffer, sizeof(name_buffer)) || program >= MAX_NAMES)
+                {
+                    errors++;
+                    break;
+                }
+
+                GLint replayed = glGetUniformLocation(lookup(objects, program), name_buffer);
+                if(captured >= 0 && captured < (int32_t)MAX_UNIFORM_LOCATIONS)
+                {
+                    std::vector<GLint> &locations = uniform_locations[program];
+                    if(locations.empty())
+                        locations.assign(MAX_UNIFORM_LOCATIONS, -1);
+                    locations[captured] = replayed;
+                }
+                break;
+            }
+            case(TRACE_UNIFORM_1I):
+            {
+                GLint loc = location(in.i32());
+                glUniform1i(loc, in.i32());
+                break;
+            }
+            case(TRACE_UNIFORM_1F):
+            {
+                GLint loc = location(in.i32());
+                glUniform1f(loc, in.f32());
+                break;
+            }
+            case(TRACE_UNIFORM_3F):
+            {
+                GLint loc = location(in.i32());
+                GLfloat x = in.f32();
+                GLfloat y = in.f32();
+                glUniform3f(loc, x, y, in.f32());
+                break;
+            }
+            case(TRACE_UNIFORM_4F):
+            {
+                GLint loc = location(in.i32());
+                GLfloat x = in.f32();
+                GLfloat y = in.f32();
+                GLfloat z = in.f32();
+                glUniform4f(loc, x, y, z, in.f32());
+                break;
+            }
+            case(TRACE_UNIFORM_MATRIX_4FV):
+            {
+                GLint loc = location(in.i32());
+                GLsizei count = in.i32();
+                GLboolean transpose = (GLboolean)in.u32();
+                glUniformMatrix4fv(loc, count, transpose, (const GLfloat*)in.p);
+                break;
+            }
+#define GL_REPLAY_UNIFORM_VECTOR(name, type, components, opcode) \
+            case(opcode): \
+            { \
+                GLint loc = location(in.i32()); \
+                GLsizei count = in.i32(); \
+                gl##name(loc, count, (const type*)in.p); \
+                break; \
+            }
+#define GL_REPLAY_UNIFORM_MATRIX(name, components, opcode) \
+            case(opcode): \
+            { \
+                GLint loc = location(in.i32()); \
+                GLsizei count = in.i32(); \
+                GLboolean transpose = (GLboolean)in.u32(); \
+                gl##name(loc, count, transpose, (const GLfloat*)in.p); \
+                break; \
+            }
+            GL_TRACE_UNIFORM_VECTORS(GL_REPLAY_UNIFORM_VECTOR)
+            GL_TRACE_UNIFORM_MATRICES(GL_REPLAY_UNIFORM_MATRIX)
+#undef GL_REPLAY_UNIFORM_VECTOR
+#undef GL_REPLAY_UNIFORM_MATRIX
+            case(TRACE_GEN_VERTEX_ARRAYS):
+                gen_names(in, vertex_arrays, gen_vertex_arrays);
+                break;
+            case(TRACE_DELETE_VERTEX_ARRAYS):
+                delete_names(in, vertex_arrays, delete_vertex_arrays);
+                break;
+            case(TRACE_BIND_VERTEX_ARRAY):
+                glBindVertexArray(lookup(vertex_arrays, in.u32()));
+                break;
+            case(TRACE_GEN_BUFFERS):
+                gen_names(in, buffers, gen_buffers);
+                break;
+            case(TRACE_DELETE_BUFFERS):
+                delete_names(in, buffers, delete_buffers);
+                break;
+            case(TRACE_BIND_BUFFER):
+            {
+                GLenum target = in.u32();
+                glBindBuffer(target, lookup(buffers, in.u32()));
+                break;
+            }
+            case(TRACE_BUFFER_DATA):
+            {
+                GLenum target = in.u32();
+                GLenum usage = in.u32();
+                GLsizeiptr size = (GLsizeiptr)in.u64();
+                uint32_t length;
+                const unsigned char* data = in.blob(length);
+                glBufferData(target, size, length ? data : NULL, usage);
+                break;
+            }
+            case(TRACE_BUFFER_SUB_DATA):
+            {
+                GLenum target = in.u32();
+                GLintptr offset = (GLintptr)in.u64();
+                uint32_t length;
+                const unsigned char* data = in.blob(length);
+                glBufferSubData(target, offset, length, data);
+                break;
+            }
+            case(TRACE_BIND_BUFFER_BASE):
+            {
+                GLenum target = in.u32();
+                GLuint index = in.u32();
+                glBindBufferBase(target, index, lookup(buffers, in.u32()));
+                break;
+            }
+            case(TRACE_GET_UNIFORM_BLOCK_INDEX):
+            {
+                uint32_t program = in.u32();
+                uint32_t captured = in.u32();
+                char name_buffer[256];
+                if(!read_name(in, name_buffer, sizeof(name_buffer)) || program >= MAX_NAMES)
+                {
+                    errors++;
+                    break;
+                }
+
+                GLuint replayed = glGetUniformBlockIndex(lookup(objects, program), name_buffer);
+                if(captured < MAX_UNIFORM_BLOCKS)
+                {
+                    std::vector<GLuint> &blocks = uniform_blocks[program];
+                    if(blocks.empty())
+                        blocks.assign(MAX_UNIFORM_BLOCKS, GL_INVALID_INDEX);
+                    blocks[captured] = replayed;
+                }
+                break;
+            }
+            case(TRACE_UNIFORM_BLOCK_BINDING):
+            {
+                uint32_t program = in.u32();
+                GLuint index = block_index(program, in.u32());
+                GLuint binding = in.u32();
+                if(index != GL_INVALID_INDEX)
+                    glUniformBlockBinding(lookup(objects, program), index, binding);
+                break;
+            }
+            case(TRACE_GEN_FRAMEBUFFERS):
+                gen_names(in, framebuffers, gen_framebuffers);
+                break;
+            case(TRACE_DELETE_FRAMEBUFFERS):
+                delete_names(in, framebuffers, delete_framebuffers);
+                break;
+            case(TRACE_BIND_FRAMEBUFFER):
+            {
+                GLenum target = in.u32();
+                glBindFramebuffer(target, lookup(framebuffers, in.u32()));
+                break;
+            }
+            case(TRACE_FRAMEBUFFER_TEXTURE_2D):
+            {
+                GLenum target = in.u32();
+                GLenum attachment = in.u32();
+                GLenum texture_target = in.u32();
+                GLuint texture = lookup(textures, in.u32());
+                glFramebufferTexture2D(target, attachment, texture_target, texture, in.i32());
+                break;
+            }
+            case(TRACE_BLIT_FRAMEBUFFER):
+            {
+                GLint rects[8];
+                for(int i = 0; i < 8; i++)
+                    rects[i] = in.i32();
+                GLbitfield mask = in.u32();
+                GLenum filter = in.u32();
+                glBlitFramebuffer(rects[0], rects[1], rects[2], rects[3], rects[4], rects[5], rects[6], rects[7], mask, filter);
+                break;
+            }
+            case(TRACE_CLIP_CONTROL):
+            {
+                GLenum origin = in.u32();
+                GLenum depth = in.u32();
+                // Reverse-Z traces still depth test correctly without it, just with less precision
+                if(glClipControl)
+                    glClipControl(origin, depth);
+                break;
+            }
+            case(TRACE_DEPTH_FUNC):
+                glDepthFunc(in.u32());
+                break;
+            case(TRACE_CLEAR_DEPTH):
+                glClearDepth(in.f32());
+                break;
+            case(TRACE_VERTEX_ATTRIB_POINTER):
+            {
+                GLuint index = in.u32();
+                GLint size = in.i32();
+                GLenum type = in.u32();
+                GLboolean normalized = (GLboolean)in.u32();
+                GLsizei stride = in.i32();
+                glVertexAttribPointer(index, size, type, normalized, stride, (const void*)(uintptr_t)in.u64());
+                break;
+            }
+            case(TRACE_VERTEX_ATTRIB_I_POINTER):
+            {
+                GLuint index = in.u32();
+                GLint size = in.i32();
+                GLenum type = in.u32();
+                GLsizei stride = in.i32();
+                glVertexAttribIPointer(index, size, type, stride, (const void*)(uintptr_t)in.u64());
+                break;
+            }
+            case(TRACE_ENABLE_VERTEX_ATTRIB_ARRAY):
+                glEnableVertexAttribArray(in.u32());
+                break;
+            case(TRACE_ENABLE):
+                glEnable(in.u32());
+                break;
+            case(TRACE_DISABLE):
+                glDisable(in.u32());
+                break;
+            case(TRACE_CLEAR):
+                glClear(in.u32());
+                break;
+            case(TRACE_CLEAR_COLOR):
+            {
+                GLfloat r = in.f32();
+                GLfloat g = in.f32();
+                GLfloat b = in.f32();
+                glClearColor(r, g, b, in.f32());
+                break;
+            }
+            case(TRACE_VIEWPORT):
+            {
+                GLint x = in.i32();
+                GLint y = in.i32();
+                GLsizei width = in.i32();
+                glViewport(x, y, width, in.i32());
+                break;
+            }
+            case(TRACE_DRAW_ARRAYS):
+            {
+                GLenum mode = in.u32();
+                GLint first = in.i32();
+                glDrawArrays(mode, first, in.i32());
+                break;
+            }
+            case(TRACE_DRAW_ELEMENTS):
+            {
+                GLenum mode = in.u32();
+                GLsizei count = in.i32();
+                GLenum type = in.u32();
+                glDrawElements(mode, count, type, (const void*)(uintptr_t)in.u64());
+                break;
+            }
+            case(TRACE_DRAW_ELEMENTS_BASE_VERTEX):
+            {
+                GLenum mode = in.u32();
+                GLsizei count = in.i32();
+                GLenum type = in.u32();
+                const void* offset = (const void*)(uintptr_t)in.u64();
+                glDrawElementsBaseVertex(mode, count, type, offset, in.i32());
+                break;
+            }
+            case(TRACE_TEX_STORAGE_2D):
+            {
+                GLenum target = in.u32();
+                GLsizei levels = in.i32();
+                GLenum internal_format = in.u32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                tex_storage(target, levels, internal_format, width, height, 1);
+                break;
+            }
+            case(TRACE_TEX_STORAGE_3D):
+            {
+                GLenum target = in.u32();
+                GLsizei levels = in.i32();
+                GLenum internal_format = in.u32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                tex_storage(target, levels, internal_format, width, height, in.i32());
+                break;
+            }
+            case(TRACE_CREATE_BUFFERS):
+                gen_names(in, buffers, create_buffers);
+                break;
+            case(TRACE_NAMED_BUFFER_STORAGE):
+            {
+                GLuint buffer = lookup(buffers, in.u32());
+                GLbitfield flags = in.u32();
+                GLsizeiptr size = (GLsizeiptr)in.u64();
+                uint32_t length;
+                const unsigned char* data = in.blob(length);
+                glNamedBufferStorage(buffer, size, length ? data : NULL, flags);
+                break;
+            }
+            case(TRACE_NAMED_BUFFER_DATA):
+            {
+                GLuint buffer = lookup(buffers, in.u32());
+                GLenum usage = in.u32();
+                GLsizeiptr size = (GLsizeiptr)in.u64();
+                uint32_t length;
+                const unsigned char* data = in.blob(length);
+                glNamedBufferData(buffer, size, length ? data : NULL, usage);
+                break;
+            }
+            case(TRACE_NAMED_BUFFER_SUB_DATA):
+            {
+                GLuint buffer = lookup(buffers, in.u32());
+                GLintptr offset = (GLintptr)in.u64();
+                uint32_t length;
+                const unsigned char* data = in.blob(length);
+                glNamedBufferSubData(buffer, offset, length, data);
+                break;
+            }
+            case(TRACE_CREATE_TEXTURES):
+            {
+                GLenum target = in.u32();
+                uint32_t n = in.u32();
+                for(uint32_t i = 0; i < n; i++)
+                {
+                    uint32_t name = in.u32();
+                    GLuint created = 0;
+                    glCreateTextures(target, 1, &created);
+                    if(name < MAX_NAMES)
+                        textures[name] = created;
+                    else
+                        errors++;
+                }
+                break;
+            }
+            case(TRACE_TEXTURE_STORAGE_2D):
+            {
+                GLuint texture = lookup(textures, in.u32());
+                GLsizei levels = in.i32();
+                GLenum internal_format = in.u32();
+                GLsizei width = in.i32();
+                glTextureStorage2D(texture, levels, internal_format, width, in.i32());
+                break;
+            }
+            case(TRACE_TEXTURE_STORAGE_3D):
+            {
+                GLuint texture = lookup(textures, in.u32());
+                GLsizei levels = in.i32();
+                GLenum internal_format = in.u32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                glTextureStorage3D(texture, levels, internal_format, width, height, in.i32());
+                break;
+            }
+            case(TRACE_TEXTURE_SUB_IMAGE_2D):
+            {
+                GLuint texture = lookup(textures, in.u32());
+                GLint level = in.i32();
+                GLint x = in.i32();
+                GLint y = in.i32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                GLenum format = in.u32();
+                GLenum type = in.u32();
+                uint32_t length;
+                const unsigned char* pixels = in.blob(length);
+                glTextureSubImage2D(texture, level, x, y, width, height, format, type, pixels);
+                break;
+            }
+            case(TRACE_TEXTURE_SUB_IMAGE_3D):
+            {
+                GLuint texture = lookup(textures, in.u32());
+                GLint level = in.i32();
+                GLint x = in.i32();
+                GLint y = in.i32();
+                GLint z = in.i32();
+                GLsizei width = in.i32();
+                GLsizei height = in.i32();
+                GLsizei depth = in.i32();
+                GLenum format = in.u32();
+                GLenum type = in.u32();
+                uint32_t length;
+                const unsigned char* pixels = in.blob(length);
+                glTextureSubImage3D(texture, level, x, y, z, width, height, depth, format, type, pixels);
+                break;
+            }
+            case(TRACE_TEXTURE_PARAMETERI):
+            {
+                GLuint texture = lookup(textures, in.u32());
+                GLenum name = in.u32();
+                glTextureParameteri(texture, name, in.i32());
+                break;
+            }
+            case(TRACE_GENERATE_TEXTURE_MIPMAP):
+                glGenerateTextureMipmap(lookup(textures, in.u32()));
+                break;
+            case(TRACE_BIND_TEXTURE_UNIT):
+            {
+                GLuint unit = in.u32();
+                glBindTextureUnit(unit, lookup(textures, in.u32()));
+                break;
+            }
+            case(TRACE_CREATE_VERTEX_ARRAYS):
+                gen_names(in, vertex_arrays, create_vertex_arrays);
+                break;
+            case(TRACE_ENABLE_VERTEX_ARRAY_ATTRIB):
+            {
+                GLuint vao = lookup(vertex_arrays, in.u32());
+                glEnableVertexArrayAttrib(vao, in.u32());
+                break;
+            }
+            case(TRACE_VERTEX_ARRAY_VERTEX_BUFFER):
+            {
+                GLuint vao = lookup(vertex_arrays, in.u32());
+                GLuint binding = in.u32();
+                GLuint buffer = lookup(buffers, in.u32());
+                GLintptr offset = (GLintptr)in.u64();
+                glVertexArrayVertexBuffer(vao, binding, buffer, offset, in.i32());
+                break;
+            }
+            case(TRACE_VERTEX_ARRAY_ATTRIB_FORMAT):
+            {
+                GLuint vao = lookup(vertex_arrays, in.u32());
+                GLuint index = in.u32();
+                GLint size = in.i32();
+                GLenum type = in.u32();
+                GLboolean normalized = (GLboolean)in.u32();
+                glVertexArrayAttribFormat(vao, index, size, type, normalized, in.u32());
+                break;
+            }
+            case(TRACE_VERTEX_ARRAY_ATTRIB_I_FORMAT):
+            {
+                GLuint vao = lookup(vertex_arrays, in.u32());
+                GLuint index = in.u32();
+                GLint size = in.i32();
+                GLenum type = in.u32();
+                glVertexArrayAttribIFormat(vao, index, size, type, in.u32());
+                break;
+            }
+            case(TRACE_VERTEX_ARRAY_ATTRIB_BINDING):
+            {
+                GLuint vao = lookup(vertex_arrays, in.u32());
+                GLuint index = in.u32();
+                glVertexArrayAttribBinding(vao, index, in.u32());
+                break;
+            }
+            case(TRACE_VERTEX_ARRAY_ELEMENT_BUFFER):
+            {
+                GLuint vao = lookup(vertex_arrays, in.u32());
+                glVertexArrayElementBuffer(vao, lookup(buffers, in.u32()));
+                break;
+            }
+            default:
+                errors++;
+                break;
+        }
+    }
+    return executed;
+}
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s TRACE [options]\n", program);
+    printf("  --frames=N    Times the captured frame is replayed (default 1000)\n");
+    printf("  --finish      glFinish after every frame instead of swapping\n");
+    printf("  --show        Show the window while replaying\n");
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = NULL;
+    unsigned int frames = 1000;
+    bool finish = false;
+    bool show = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strncmp(argv[i], "--frames=", 9) == 0)
+            frames = (unsigned int)atoi(argv[i] + 9);
+        else if(strcmp(argv[i], "--finish") == 0)
+            finish = true;
+        else if(strcmp(argv[i], "--show") == 0)
+            show = true;
+        else if(argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    if(!path)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    // Map the trace, the replayer reads commands and resources in place
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        printf("Failed to open trace %s\n", path);
+        return -1;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size_t file_size = (size_t)info.st_size;
+    if(file_size < sizeof(TraceHeader))
+    {
+        printf("Trace %s is truncated\n", path);
+        close(fd);
+        return -1;
+    }
+    const unsigned char* trace = (const unsigned char*)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(trace == MAP_FAILED)
+    {
+        printf("Failed to map trace %s\n", path);
+        return -1;
+    }
+    madvise((void*)trace, file_size, MADV_WILLNEED);
+
+    TraceHeader header;
+    memcpy(&header, trace, sizeof(header));
+    if(header.magic != GL_TRACE_MAGIC || header.version != GL_TRACE_VERSION ||
+        header.frame_offset > header.frame_end_offset || header.frame_end_offset > file_size)
+    {
+        printf("%s is not a version %u GL trace\n", path, GL_TRACE_VERSION);
+        return -1;
+    }
+
+    // Setup SDL Stuff
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        printf("Failed to initialize SDL");
+        return -1;
+    }
+
+    // Setup OpenGL Attributes
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+    Uint32 flags = SDL_WINDOW_OPENGL | (show ? 0 : SDL_WINDOW_HIDDEN);
+    SDL_Window* window = SDL_CreateWindow("GL Replay", 0, 0, header.width, header.height, flags);
+    if (!window)
+    {
+        printf("Failed to create SDL window");
+        return -1;
+    }
+
+    SDL_GLContext context = SDL_GL_CreateContext(window);
+    if (!context)
+    {
+        printf("Failed to create context");
+        return -1;
+    }
+    SDL_GL_MakeCurrent(window, context);
+
+    // Measure throughput, not the display
+    SDL_GL_SetSwapInterval(0);
+
+    glewExperimental = GL_TRUE;
+    GLenum glewError = glewInit();
+    if (glewError != GLEW_OK)
+    {
+        printf("Error initializing GLEW %s\n", glewGetErrorString(glewError));
+        return -1;
+    }
+
+    glViewport(0, 0, header.width, header.height);
+
+    Replayer replayer;
+    const unsigned char* frame_begin = trace + header.frame_offset;
+    const unsigned char* frame_end = trace + header.frame_end_offset;
+
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 setup_start = SDL_GetPerformanceCounter();
+    replayer.execute(trace + sizeof(TraceHeader), frame_end);
+    glFinish();
+    double setup_ms = (SDL_GetPerformanceCounter() - setup_start) * 1000.0 / frequency;
+
+    // Loop the captured frame
+    Uint64 submit_ticks = 0;
+    unsigned long long commands = 0;
+    Uint64 loop_start = SDL_GetPerformanceCounter();
+    for(unsigned int frame = 0; frame < frames; frame++)
+    {
+        Uint64 submit_start = SDL_GetPerformanceCounter();
+        commands += replayer.execute(frame_begin, frame_end);
+        submit_ticks += SDL_GetPerformanceCounter() - submit_start;
+
+        if(finish)
+            glFinish();
+        else
+            SDL_GL_SwapWindow(window);
+    }
+    glFinish();
+    double total_s = (double)(SDL_GetPerformanceCounter() - loop_start) / frequency;
+    double submit_s = (double)submit_ticks / frequency;
+
+    printf("Trace: %s (%u commands, %u per frame)\n", path, header.command_count, header.frame_command_count);
+    printf("Renderer: %s\n", glGetString(GL_RENDERER));
+    printf("Setup: %.2f ms\n", setup_ms);
+    printf("Frames: %u in %.3f s, %.1f fps, %.3f ms/frame\n", frames, total_s, frames / total_s, total_s * 1000.0 / frames);
+    printf("Submit: %.3f ms/frame, %.0f commands/s\n", submit_s * 1000.0 / frames, commands / submit_s);
+    if(replayer.errors)
+        printf("Warning: %u commands could not be replayed\n", replayer.errors);
+
+    munmap((void*)trace, file_size);
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return 0;
+}
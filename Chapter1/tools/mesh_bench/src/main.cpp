@@ -0,0 +1,249 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "mesh_loader.h"
+#include "mapped_file.h"
+
+// Loads meshes over and over and reports parse throughput in MB/s of file and
+// triangles/s. --generate writes a large grid as grid.obj and grid.glb into
+// a directory and measures those, the repo ships no models. --scalar turns
+// off the SSE2 digit scan in the OBJ parser to see what it buys.
+
+static double now_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A gently rolling grid, so every coordinate has a full set of digits
+static float grid_height(int x, int z, int size)
+{
+    float u = (float)x / size, v = (float)z / size;
+    return 0.05f * sinf(u * 25.0f) * cosf(v * 17.0f);
+}
+
+static bool write_grid_obj(const char* path, int size)
+{
+    FILE* file = fopen(path, "wb");
+    if(!file)
+        return false;
+    fprintf(file, "# %dx%d grid written by mesh_bench\n", size, size);
+    for(int z = 0; z <= size; z++)
+        for(int x = 0; x <= size; x++)
+            fprintf(file, "v %.6f %.6f %.6f\n", (float)x / size - 0.5f, grid_height(x, z, size), (float)z / size - 0.5f);
+    for(int z = 0; z <= size; z++)
+        for(int x = 0; x <= size; x++)
+            fprintf(file, "vt %.6f %.6f\n", (float)x / size, (float)z / size);
+    for(int z = 0; z <= size; z++)
+        for(int x = 0; x <= size; x++)
+        {
+            float dx = grid_height(x + 1, z, size) - grid_height(x - 1, z, size);
+            float dz = grid_height(x, z + 1, size) - grid_height(x, z - 1, size);
+            float step = 2.0f / size;
+            float length = sqrtf(dx * dx + step * step + dz * dz);
+            fprintf(file, "vn %.6f %.6f %.6f\n", -dx / length, step / length, -dz / length);
+        }
+    // Quads, as most exporters write them
+    for(int z = 0; z < size; z++)
+        for(int x = 0; x < size; x++)
+        {
+            int a = z * (size + 1) + x + 1;
+            int b = a + size + 1;
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+        }
+    fclose(file);
+    return true;
+}
+
+static void put_u32(std::string &out, uint32_t value)
+{
+    out.append((const char*)&value, sizeof(value));
+}
+
+// The same grid as one indexed primitive in a .glb
+static bool write_grid_glb(const char* path, int size)
+{
+    uint32_t vertices = (uint32_t)((size + 1) * (size + 1));
+    uint32_t indices = (uint32_t)(size * size * 6);
+    std::vector<float> positions, normals, texcoords;
+    for(int z = 0; z <= size; z++)
+        for(int x = 0; x <= size; x++)
+        {
+            positions.push_back((float)x / size - 0.5f);
+            positions.push_back(grid_height(x, z, size));
+            positions.push_back((float)z / size - 0.5f);
+            normals.push_back(0.0f);
+            normals.push_back(1.0f);
+            normals.push_back(0.0f);
+            texcoords.push_back((float)x / size);
+            texcoords.push_back(1.0f - (float)z / size);
+        }
+    std::vector<uint32_t> index_data;
+    for(int z = 0; z < size; z++)
+        for(int x = 0; x < size; x++)
+        {
+            uint32_t a = (uint32_t)(z * (size + 1) + x);
+            uint32_t b = a + size + 1;
+            uint32_t quad[6] = { a, b, b + 1, a, b + 1, a + 1 };
+            index_data.insert(index_data.end(), quad, quad + 6);
+        }
+
+    size_t position_bytes = positions.size() * sizeof(float);
+    size_t normal_bytes = normals.size() * sizeof(float);
+    size_t texcoord_bytes = texcoords.size() * sizeof(float);
+    size_t index_bytes = index_data.size() * sizeof(uint32_t);
+    std::string bin;
+    bin.append((const char*)&positions[0], position_bytes);
+    bin.append((const char*)&normals[0], normal_bytes);
+    bin.append((const char*)&texcoords[0], texcoord_bytes);
+    bin.append((const char*)&index_data[0], index_bytes);
+
+    char json[2048];
+    snprintf(json, sizeof(json),
+        "{\"asset\":{\"version\":\"2.0\",\"generator\":\"mesh_bench\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+        "\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+        "\"buffers\":[{\"byteLength\":%zu}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\"},"
+        "{\"bufferView\":1,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\"},"
+        "{\"bufferView\":2,\"componentType\":5126,\"count\":%u,\"type\":\"VEC2\"},"
+        "{\"bufferView\":3,\"componentType\":5125,\"count\":%u,\"type\":\"SCALAR\"}]}",
+        bin.size(), position_bytes, position_bytes, normal_bytes, position_bytes + normal_bytes, texcoord_bytes,
+        position_bytes + normal_bytes + texcoord_bytes, index_bytes, vertices, vertices, vertices, indices);
+    std::string json_chunk = json;
+    // Chunks are padded to 4 bytes, JSON with spaces
+    while(json_chunk.size() % 4)
+        json_chunk += ' ';
+
+    std::string out;
+    put_u32(out, 0x46546C67);
+    put_u32(out, 2);
+    put_u32(out, (uint32_t)(12 + 8 + json_chunk.size() + 8 + bin.size()));
+    put_u32(out, (uint32_t)json_chunk.size());
+    put_u32(out, 0x4E4F534A);
+    out += json_chunk;
+    put_u32(out, (uint32_t)bin.size());
+    put_u32(out, 0x004E4942);
+    out += bin;
+
+    FILE* file = fopen(path, "wb");
+    if(!file)
+        return false;
+    bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+    fclose(file);
+    return written;
+}
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s [options] [mesh.obj or mesh.glb ...]\n", program);
+    printf("  --generate=DIR   Write grid.obj and grid.glb into DIR and measure them\n");
+    printf("  --grid=N         Quads along each side of the generated grid (default 1024)\n");
+    printf("  --passes=N       Times each mesh is loaded (default 5)\n");
+    printf("  --scalar         Parse OBJ numbers without SSE2\n");
+    printf("  --cache=STATE    warm (default) or cold, dropping the file from the page cache before each pass\n");
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> files;
+    std::string generate;
+    int grid = 1024;
+    unsigned int passes = 5;
+    bool cold = false;
+    MeshLoadOptions options;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strncmp(argv[i], "--generate=", 11) == 0)
+            generate = argv[i] + 11;
+        else if(strncmp(argv[i], "--grid=", 7) == 0)
+            grid = atoi(argv[i] + 7);
+        else if(strncmp(argv[i], "--passes=", 9) == 0)
+            passes = (unsigned int)atoi(argv[i] + 9);
+        else if(strcmp(argv[i], "--scalar") == 0)
+            options.simd = false;
+        else if(strcmp(argv[i], "--cache=warm") == 0)
+            cold = false;
+        else if(strcmp(argv[i], "--cache=cold") == 0)
+            cold = true;
+        else if(argv[i][0] != '-')
+            files.push_back(argv[i]);
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    if(passes == 0 || grid <= 0 || (files.empty() && generate.empty()))
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    if(!generate.empty())
+    {
+        std::string obj = generate + "/grid.obj";
+        std::string glb = generate + "/grid.glb";
+        double start = now_seconds();
+        if(!write_grid_obj(obj.c_str(), grid) || !write_grid_glb(glb.c_str(), grid))
+        {
+            printf("ERROR::MESH_BENCH::WRITE_FAILED %s\n", generate.c_str());
+            return -1;
+        }
+        printf("Generated a %dx%d grid in %.2f s\n", grid, grid, now_seconds() - start);
+        files.push_back(obj);
+        files.push_back(glb);
+    }
+
+    // One MeshData for every load, so after the first pass the loaders reuse its buffers
+    MeshData mesh;
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    int failed = 0;
+    for(size_t i = 0; i < files.size(); i++)
+    {
+        const char* path = files[i].c_str();
+        struct stat info;
+        size_t file_bytes = stat(path, &info) == 0 ? (size_t)info.st_size : 0;
+
+        double total = 0.0, best = 0.0;
+        std::string error;
+        bool loaded = true;
+        for(unsigned int pass = 0; pass < passes && loaded; pass++)
+        {
+            if(cold)
+                MappedFile::drop_cached(path);
+            double start = now_seconds();
+            loaded = load_mesh(path, mesh, error, options);
+            double seconds = now_seconds() - start;
+            total += seconds;
+            if(pass == 0 || seconds < best)
+                best = seconds;
+        }
+        if(!loaded)
+        {
+            printf("ERROR::MESH_BENCH::LOAD_FAILED %s\n", error.c_str());
+            failed++;
+            continue;
+        }
+
+        double triangles = (double)mesh.get_triangle_count();
+        double average = total / passes;
+        printf("%s (%s%s cache): %.1f MB, %zu vertices, %.0f triangles, %zu bytes per vertex\n",
+            path, options.simd ? "" : "scalar, ", cold ? "cold" : "warm", file_bytes * mb, mesh.vertices.size(), triangles,
+            sizeof(MeshVertex));
+        printf("  %.1f ms average, %.1f ms best over %u passes: %.1f MB/s, %.1f M triangles/s\n",
+            average * 1000.0, best * 1000.0, passes, file_bytes * mb / average, triangles / average / 1000000.0);
+        printf("  bounds (%.2f, %.2f, %.2f) to (%.2f, %.2f, %.2f), %s normals, %s texture coordinates\n",
+            mesh.bounds_min[0], mesh.bounds_min[1], mesh.bounds_min[2], mesh.bounds_max[0], mesh.bounds_max[1], mesh.bounds_max[2],
+            mesh.has_normals ? "with" : "generated", mesh.has_texcoords ? "with" : "no");
+    }
+    return failed ? 1 : 0;
+}
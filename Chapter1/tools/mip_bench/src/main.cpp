@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+#include "window.h"
+#include "mip_chain.h"
+#include "thread_pool.h"
+#include "stb/stb_image.h"
+
+// Times building mip chains on the CPU with every filter and kernel, on one
+// thread and split across a pool, then against glGenerateMipmap on whatever
+// driver the hidden window gets (llvmpipe on machines without a GPU, where
+// the driver's mips are built on the CPU as well).
+
+struct Image
+{
+    const char* path;
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+static double seconds_since(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s [options] [image ...]\n", program);
+    printf("  --iterations=N   Chains built per image and configuration (default 20)\n");
+    printf("  --threads=N      Workers for the pooled runs, 0 for one per spare core (default 0)\n");
+    printf("  --no-gl          Skip the comparison with glGenerateMipmap\n");
+    printf("Images default to the 07_Camera textures.\n");
+}
+
+static void print_result(const char* label, double seconds, unsigned int iterations, double pixels)
+{
+    double ms = seconds * 1000.0 / iterations;
+    printf("  %-34s %8.2f ms %10.1f MP/s\n", label, ms, pixels * iterations / seconds / 1000000.0);
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int iterations = 20;
+    unsigned int threads = 0;
+    bool compare_gl = true;
+    std::vector<const char*> paths;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strncmp(argv[i], "--iterations=", 13) == 0)
+            iterations = (unsigned int)atoi(argv[i] + 13);
+        else if(strncmp(argv[i], "--threads=", 10) == 0)
+            threads = (unsigned int)atoi(argv[i] + 10);
+        else if(strcmp(argv[i], "--no-gl") == 0)
+            compare_gl = false;
+        else if(argv[i][0] != '-')
+            paths.push_back(argv[i]);
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    if(iterations == 0)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+    if(paths.empty())
+    {
+        paths.push_back("../../07_Camera/textures/container.jpg");
+        paths.push_back("../../07_Camera/textures/awesomeface.png");
+    }
+
+    std::vector<Image> images;
+    for(size_t i = 0; i < paths.size(); i++)
+    {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(paths[i], &width, &height, &channels, 4);
+        if(!pixels)
+        {
+            printf("ERROR::MIP_BENCH::LOAD_FAILED %s\n", paths[i]);
+            return -1;
+        }
+        Image image;
+        image.path = paths[i];
+        image.width = width;
+        image.height = height;
+        image.pixels.assign(pixels, pixels + (size_t)width * height * 4);
+        stbi_image_free(pixels);
+        images.push_back(image);
+    }
+
+    ThreadPool pool;
+    pool.start(threads, "Mip Worker");
+
+    const char* simd_names[] = { "scalar", "sse2", "avx2" };
+    const char* filter_names[] = { "box", "kaiser" };
+    MipSimd supported = MipChain::get_supported_simd();
+    printf("Mip bench: %u iterations, %u pool threads, widest kernel %s\n", iterations, pool.get_thread_count(), simd_names[supported]);
+
+    for(size_t i = 0; i < images.size(); i++)
+    {
+        const Image &image = images[i];
+        double pixels = (double)image.width * image.height;
+        printf("%s (%dx%d)\n", image.path, image.width, image.height);
+
+        MipChain chain;
+        char label[64];
+        for(int filter = MIP_FILTER_BOX; filter <= MIP_FILTER_KAISER; filter++)
+        {
+            for(int simd = MIP_SIMD_SCALAR; simd <= supported; simd++)
+            {
+                for(int pooled = 0; pooled < 2; pooled++)
+                {
+                    MipOptions options;
+                    options.filter = (MipFilter)filter;
+                    options.simd = (MipSimd)simd;
+                    Uint64 start = SDL_GetPerformanceCounter();
+                    for(unsigned int k = 0; k < iterations; k++)
+                        chain.generate(&image.pixels[0], image.width, image.height, options, pooled ? &pool : NULL);
+                    snprintf(label, sizeof(label), "%s %s %s", filter_names[filter], simd_names[simd], pooled ? "pool" : "1 thread");
+                    print_result(label, seconds_since(start), iterations, pixels);
+                }
+            }
+        }
+
+        // Coverage preservation searches for an alpha scale on every level
+        MipOptions coverage;
+        coverage.preserve_coverage = true;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(unsigned int k = 0; k < iterations; k++)
+            chain.generate(&image.pixels[0], image.width, image.height, coverage, &pool);
+        print_result("box coverage pool", seconds_since(start), iterations, pixels);
+    }
+
+    if(compare_gl)
+    {
+        Window window;
+        if(!window.init("Mip Bench", 64, 64, SDL_WINDOW_HIDDEN))
+            return -1;
+        printf("GL: %s\n", (const char*)glGetString(GL_RENDERER));
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        for(size_t i = 0; i < images.size(); i++)
+        {
+            const Image &image = images[i];
+            double pixels = (double)image.width * image.height;
+            printf("%s (%dx%d), upload included\n", image.path, image.width, image.height);
+
+            // glFinish after each one, the driver may otherwise defer the work past the timer
+            Uint64 start = SDL_GetPerformanceCounter();
+            for(unsigned int k = 0; k < iterations; k++)
+            {
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &image.pixels[0]);
+                glGenerateMipmap(GL_TEXTURE_2D);
+                glFinish();
+            }
+            print_result("glGenerateMipmap", seconds_since(start), iterations, pixels);
+
+            MipChain chain;
+            for(int filter = MIP_FILTER_BOX; filter <= MIP_FILTER_KAISER; filter++)
+            {
+                MipOptions options;
+                options.filter = (MipFilter)filter;
+                start = SDL_GetPerformanceCounter();
+                for(unsigned int k = 0; k < iterations; k++)
+                {
+                    chain.generate(&image.pixels[0], image.width, image.height, options, &pool);
+                    chain.upload(GL_TEXTURE_2D);
+                    glFinish();
+                }
+                char label[64];
+                snprintf(label, sizeof(label), "%s %s pool, level by level", filter_names[filter], simd_names[supported]);
+                print_result(label, seconds_since(start), iterations, pixels);
+            }
+        }
+        glDeleteTextures(1, &texture);
+        window.destroy();
+    }
+
+    pool.stop();
+    return 0;
+}
@@ -0,0 +1,408 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "stb/stb_image.h"
+#include "stb_no_simd.h"
+
+// Decodes an image corpus with stb_image on 1..N threads, with and without
+// its SSE2 paths, and reports throughput and per-format latency. Files are
+// read into memory up front so only decoding is timed; tools/decode_bench
+// covers the I/O and allocation side. Formats are told apart from the file
+// headers: JPEG by its start-of-frame marker, PNG by its bit depth.
+//
+// stb only has SIMD for JPEG (IDCT, upsampling and colour conversion), PNG
+// times should match between the two builds.
+
+enum Format { FORMAT_JPEG_BASELINE, FORMAT_JPEG_PROGRESSIVE, FORMAT_PNG_8, FORMAT_PNG_16, FORMAT_OTHER, FORMAT_COUNT };
+const char* format_names[FORMAT_COUNT] = { "jpeg_baseline", "jpeg_progressive", "png_8", "png_16", "other" };
+
+// Upper bounds of the latency histogram buckets in ms, the last one is open
+const double bucket_limits[] = { 0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 32.0, 64.0, 128.0, 256.0 };
+const int BUCKET_COUNT = sizeof(bucket_limits) / sizeof(bucket_limits[0]) + 1;
+
+struct Source
+{
+    std::string path;
+    std::vector<unsigned char> data;
+    Format format;
+    int width;
+    int height;
+};
+
+struct LatencySummary
+{
+    unsigned int count;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    unsigned int buckets[BUCKET_COUNT];
+};
+
+struct Run
+{
+    bool simd;
+    unsigned int threads;
+    double seconds;
+    unsigned int images;
+    unsigned int failed;
+    double bytes;
+    double pixels;
+    std::vector<double> latencies[FORMAT_COUNT]; // ms per decode
+};
+
+static double now_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static Format classify(const std::vector<unsigned char> &data)
+{
+    const unsigned char png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    if(data.size() > 25 && memcmp(&data[0], png_signature, 8) == 0)
+        return data[24] == 16 ? FORMAT_PNG_16 : FORMAT_PNG_8; // IHDR bit depth
+
+    if(data.size() < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return FORMAT_OTHER;
+    // Walk the marker segments up to the frame header
+    size_t pos = 2;
+    while(pos + 4 <= data.size() && data[pos] == 0xFF)
+    {
+        while(pos < data.size() && data[pos] == 0xFF)
+            pos++;
+        if(pos + 3 > data.size())
+            break;
+        unsigned char marker = data[pos++];
+        if(marker == 0xC0 || marker == 0xC1)
+            return FORMAT_JPEG_BASELINE;
+        if(marker == 0xC2)
+            return FORMAT_JPEG_PROGRESSIVE;
+        if(marker == 0xDA || (marker >= 0xC3 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC))
+            break;
+        if(marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+            continue;
+        pos += (data[pos] << 8) | data[pos + 1];
+    }
+    return FORMAT_OTHER;
+}
+
+static bool is_image(const std::string &name)
+{
+    const char* extensions[] = { ".png", ".jpg", ".jpeg", ".PNG", ".JPG", ".JPEG" };
+    for(size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+    {
+        size_t length = strlen(extensions[i]);
+        if(name.size() > length && name.compare(name.size() - length, length, extensions[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Files are taken as they are, directories for the images directly inside them
+static void add_path(const char* path, std::vector<std::string> &files)
+{
+    struct stat info;
+    if(stat(path, &info) != 0)
+    {
+        printf("ERROR::STB_BENCH::MISSING %s\n", path);
+        return;
+    }
+    if(!S_ISDIR(info.st_mode))
+    {
+        files.push_back(path);
+        return;
+    }
+
+    DIR* dir = opendir(path);
+    if(!dir)
+        return;
+    std::vector<std::string> names;
+    while(struct dirent* entry = readdir(dir))
+        if(is_image(entry->d_name))
+            names.push_back(entry->d_name);
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for(size_t i = 0; i < names.size(); i++)
+        files.push_back(std::string(path) + "/" + names[i]);
+}
+
+static LatencySummary summarize(std::vector<double> latencies)
+{
+    LatencySummary summary;
+    memset(&summary, 0, sizeof(summary));
+    summary.count = (unsigned int)latencies.size();
+    if(latencies.empty())
+        return summary;
+
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0.0;
+    for(size_t i = 0; i < latencies.size(); i++)
+    {
+        total += latencies[i];
+        int bucket = 0;
+        while(bucket < BUCKET_COUNT - 1 && latencies[i] > bucket_limits[bucket])
+            bucket++;
+        summary.buckets[bucket]++;
+    }
+    summary.mean = total / latencies.size();
+    summary.p50 = latencies[(latencies.size() - 1) * 50 / 100];
+    summary.p90 = latencies[(latencies.size() - 1) * 90 / 100];
+    summary.p99 = latencies[(latencies.size() - 1) * 99 / 100];
+    summary.max = latencies.back();
+    return summary;
+}
+
+static Run run_corpus(const std::vector<Source> &corpus, bool simd, unsigned int threads, unsigned int passes, int channels)
+{
+    Run run;
+    run.simd = simd;
+    run.threads = threads;
+    run.images = 0;
+    run.failed = 0;
+    run.bytes = 0.0;
+    run.pixels = 0.0;
+    std::mutex run_mutex;
+
+    ThreadPool pool;
+    pool.start(threads, "Decode");
+    double start = now_seconds();
+    for(unsigned int pass = 0; pass < passes; pass++)
+    {
+        for(size_t i = 0; i < corpus.size(); i++)
+        {
+            const Source* source = &corpus[i];
+            pool.submit([&, source]
+            {
+                double begin = now_seconds();
+                int width, height, components;
+                int length = (int)source->data.size();
+                unsigned char* pixels = simd
+                    ? stbi_load_from_memory(&source->data[0], length, &width, &height, &components, channels)
+                    : stbi_load_from_memory_no_simd(&source->data[0], length, &width, &height, &components, channels);
+                double ms = (now_seconds() - begin) * 1000.0;
+                stbi_image_free(pixels);
+
+                std::lock_guard<std::mutex> lock(run_mutex);
+                if(!pixels)
+                {
+                    run.failed++;
+                    return;
+                }
+                run.images++;
+                run.bytes += length;
+                run.pixels += (double)width * height;
+                run.latencies[source->format].push_back(ms);
+            });
+        }
+    }
+    pool.wait_idle();
+    run.seconds = now_seconds() - start;
+    pool.stop();
+    return run;
+}
+
+static void print_latencies(const Run &run)
+{
+    printf("Latency, SIMD %s, %u thread%s (ms):\n", run.simd ? "on" : "off", run.threads, run.threads == 1 ? "" : "s");
+    printf("  %-17s %6s %8s %8s %8s %8s %8s   histogram", "format", "count", "mean", "p50", "p90", "p99", "max");
+    for(int bucket = 0; bucket < BUCKET_COUNT - 1; bucket++)
+        printf(" <%g", bucket_limits[bucket]);
+    printf(" more\n");
+    for(int format = 0; format < FORMAT_COUNT; format++)
+    {
+        LatencySummary summary = summarize(run.latencies[format]);
+        if(summary.count == 0)
+            continue;
+        printf("  %-17s %6u %8.2f %8.2f %8.2f %8.2f %8.2f  ", format_names[format], summary.count,
+            summary.mean, summary.p50, summary.p90, summary.p99, summary.max);
+        for(int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+            printf(" %u", summary.buckets[bucket]);
+        printf("\n");
+    }
+}
+
+static bool write_json(const char* path, const std::vector<Source> &corpus, const std::vector<Run> &runs, unsigned int passes)
+{
+    FILE* file = fopen(path, "w");
+    if(!file)
+    {
+        printf("ERROR::STB_BENCH::FAILED_TO_OPEN %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"stb_image\": \"2.27\",\n  \"passes\": %u,\n  \"corpus\": [", passes);
+    for(size_t i = 0; i < corpus.size(); i++)
+        fprintf(file, "%s\n    { \"path\": \"%s\", \"format\": \"%s\", \"bytes\": %u, \"width\": %d, \"height\": %d }",
+            i ? "," : "", corpus[i].path.c_str(), format_names[corpus[i].format], (unsigned int)corpus[i].data.size(),
+            corpus[i].width, corpus[i].height);
+    fprintf(file, "\n  ],\n  \"histogram_limits_ms\": [");
+    for(int bucket = 0; bucket < BUCKET_COUNT - 1; bucket++)
+        fprintf(file, "%s%g", bucket ? ", " : "", bucket_limits[bucket]);
+    fprintf(file, "],\n  \"runs\": [");
+
+    for(size_t r = 0; r < runs.size(); r++)
+    {
+        const Run &run = runs[r];
+        fprintf(file, "%s\n    {\n      \"simd\": %s,\n      \"threads\": %u,\n      \"seconds\": %.6f,\n", r ? "," : "",
+            run.simd ? "true" : "false", run.threads, run.seconds);
+        fprintf(file, "      \"images\": %u,\n      \"failed\": %u,\n      \"images_per_second\": %.3f,\n", run.images, run.failed, run.images / run.seconds);
+        fprintf(file, "      \"mb_per_second\": %.3f,\n      \"megapixels_per_second\": %.3f,\n      \"formats\": {",
+            run.bytes / (1024.0 * 1024.0) / run.seconds, run.pixels / 1000000.0 / run.seconds);
+        bool first = true;
+        for(int format = 0; format < FORMAT_COUNT; format++)
+        {
+            LatencySummary summary = summarize(run.latencies[format]);
+            if(summary.count == 0)
+                continue;
+            fprintf(file, "%s\n        \"%s\": { \"count\": %u, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"histogram\": [",
+                first ? "" : ",", format_names[format], summary.count, summary.mean, summary.p50, summary.p90, summary.p99, summary.max);
+            for(int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+                fprintf(file, "%s%u", bucket ? ", " : "", summary.buckets[bucket]);
+            fprintf(file, "] }");
+            first = false;
+        }
+        fprintf(file, "\n      }\n    }");
+    }
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s [options] [image or directory ...]\n", program);
+    printf("  --max-threads=N  Thread counts run are powers of two up to N, and N (default: hardware threads)\n");
+    printf("  --passes=N       Times the corpus is decoded per run (default 5)\n");
+    printf("  --simd=MODE      on, off or both (default both)\n");
+    printf("  --channels=N     Channels asked of stb, 0 for the file's own (default 4, as the engine loads)\n");
+    printf("  --json=FILE      Also write every run as JSON\n");
+    printf("Images default to the 07_Camera textures.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int passes = 5;
+    bool simd_on = true;
+    bool simd_off = true;
+    int channels = 4;
+    const char* json_path = NULL;
+    std::vector<std::string> files;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strncmp(argv[i], "--max-threads=", 14) == 0)
+            max_threads = (unsigned int)atoi(argv[i] + 14);
+        else if(strncmp(argv[i], "--passes=", 9) == 0)
+            passes = (unsigned int)atoi(argv[i] + 9);
+        else if(strcmp(argv[i], "--simd=on") == 0)
+            simd_on = true, simd_off = false;
+        else if(strcmp(argv[i], "--simd=off") == 0)
+            simd_on = false, simd_off = true;
+        else if(strcmp(argv[i], "--simd=both") == 0)
+            simd_on = simd_off = true;
+        else if(strncmp(argv[i], "--channels=", 11) == 0)
+            channels = atoi(argv[i] + 11);
+        else if(strncmp(argv[i], "--json=", 7) == 0)
+            json_path = argv[i] + 7;
+        else if(argv[i][0] != '-')
+            add_path(argv[i], files);
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    if(max_threads == 0 || passes == 0 || channels < 0 || channels > 4)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+    if(files.empty())
+    {
+        add_path("../../07_Camera/textures/container.jpg", files);
+        add_path("../../07_Camera/textures/awesomeface.png", files);
+    }
+
+    std::vector<Source> corpus;
+    unsigned int format_counts[FORMAT_COUNT] = { 0 };
+    double corpus_bytes = 0.0;
+    for(size_t i = 0; i < files.size(); i++)
+    {
+        MappedFile file;
+        if(!file.open(files[i].c_str()) || file.get_size() == 0 || file.get_size() > 0x7fffffff)
+        {
+            printf("ERROR::STB_BENCH::LOAD_FAILED %s\n", files[i].c_str());
+            continue;
+        }
+        Source source;
+        source.path = files[i];
+        source.data.assign(file.get_data(), file.get_data() + file.get_size());
+        source.format = classify(source.data);
+        int components;
+        if(!stbi_info_from_memory(&source.data[0], (int)source.data.size(), &source.width, &source.height, &components))
+        {
+            printf("ERROR::STB_BENCH::UNSUPPORTED %s: %s\n", files[i].c_str(), stbi_failure_reason());
+            continue;
+        }
+        format_counts[source.format]++;
+        corpus_bytes += source.data.size();
+        corpus.push_back(source);
+    }
+    if(corpus.empty())
+        return -1;
+
+    printf("stb bench: %u images, %.1f MB,", (unsigned int)corpus.size(), corpus_bytes / (1024.0 * 1024.0));
+    for(int format = 0; format < FORMAT_COUNT; format++)
+        if(format_counts[format])
+            printf(" %u %s", format_counts[format], format_names[format]);
+    printf(", %u passes per run\n", passes);
+
+    std::vector<unsigned int> thread_counts;
+    for(unsigned int threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    // One untimed pass so the first run doesn't pay for page faults and lazy setup
+    run_corpus(corpus, true, 1, 1, channels);
+
+    std::vector<Run> runs;
+    printf("  %-5s %7s %10s %10s %10s %8s\n", "SIMD", "threads", "images/s", "MB/s", "MP/s", "scaling");
+    for(int simd = 1; simd >= 0; simd--)
+    {
+        if((simd && !simd_on) || (!simd && !simd_off))
+            continue;
+        double single = 0.0;
+        for(size_t t = 0; t < thread_counts.size(); t++)
+        {
+            Run run = run_corpus(corpus, simd != 0, thread_counts[t], passes, channels);
+            if(t == 0)
+                single = run.images / run.seconds;
+            printf("  %-5s %7u %10.1f %10.1f %10.1f %7.2fx\n", simd ? "on" : "off", run.threads, run.images / run.seconds,
+                run.bytes / (1024.0 * 1024.0) / run.seconds, run.pixels / 1000000.0 / run.seconds,
+                single > 0.0 ? run.images / run.seconds / single : 0.0);
+            runs.push_back(run);
+        }
+    }
+
+    // Single thread latencies are the decoder's own, more threads add contention
+    for(size_t r = 0; r < runs.size(); r++)
+        if(runs[r].threads == 1)
+            print_latencies(runs[r]);
+
+    if(json_path && !write_json(json_path, corpus, runs, passes))
+        return -1;
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include "stb_no_simd.h"
+#include "image_decode.h"
+
+// Everything static, so this copy doesn't clash with the engine's. It
+// allocates through the same hooks, only the SIMD paths differ.
+#define STB_IMAGE_STATIC
+#define STBI_NO_SIMD
+#define STBI_MALLOC(size) image_decode_malloc(size)
+#define STBI_REALLOC(pointer, size) image_decode_realloc(pointer, size)
+#define STBI_FREE(pointer) image_decode_free(pointer)
+
+// Only stbi_load_from_memory is used, the rest of the static API is dead code
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+#pragma GCC diagnostic pop
+
+unsigned char* stbi_load_from_memory_no_simd(const unsigned char* buffer, int length, int* width, int* height, int* channels, int desired_channels)
+{
+    return stbi_load_from_memory(buffer, length, width, height, channels, desired_channels);
+}
@@ -0,0 +1,8 @@
+#ifndef STB_NO_SIMD_H
+#define STB_NO_SIMD_H
+
+// stbi_load_from_memory from a second copy of stb_image built with
+// STBI_NO_SIMD, to compare against the engine's SSE2 build in one binary
+unsigned char* stbi_load_from_memory_no_simd(const unsigned char* buffer, int length, int* width, int* height, int* channels, int desired_channels);
+
+#endif // STB_NO_SIMD_H
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+#include "window.h"
+#include "shaders.h"
+#include "texture_residency.h"
+
+// Runs a TextureResidency against a texture set larger than its budget. Every
+// frame draws one quad per texture in a working set that slides along the
+// set, so textures keep going idle, losing detail or being evicted, and
+// streaming back in when the window comes round again.
+
+const int WINDOW_SIZE = 512;
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s [options] [image ...]\n", program);
+    printf("  --count=N        Textures in the set, cycling through the images (default 64)\n");
+    printf("  --budget=MB      GPU memory the textures may use (default 32)\n");
+    printf("  --working-set=N  Textures drawn each frame (default 8)\n");
+    printf("  --step=N         Frames before the working set moves on by one texture (default 10)\n");
+    printf("  --frames=N       Frames to run (default 600)\n");
+    printf("  --threads=N      Decode threads, 0 for one per spare core (default 0)\n");
+    printf("  --mips=FILTER    driver (default), or box or kaiser built on the decode threads\n");
+    printf("  --show           Show the window instead of drawing hidden\n");
+    printf("Images default to the 07_Camera textures.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int count = 64;
+    double budget_mb = 32.0;
+    unsigned int working_set = 8;
+    unsigned int step = 10;
+    unsigned int frames = 600;
+    unsigned int threads = 0;
+    int mip_filter = -1;
+    bool show = false;
+    std::vector<const char*> images;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strncmp(argv[i], "--count=", 8) == 0)
+            count = (unsigned int)atoi(argv[i] + 8);
+        else if(strncmp(argv[i], "--budget=", 9) == 0)
+            budget_mb = atof(argv[i] + 9);
+        else if(strncmp(argv[i], "--working-set=", 14) == 0)
+            working_set = (unsigned int)atoi(argv[i] + 14);
+        else if(strncmp(argv[i], "--step=", 7) == 0)
+            step = (unsigned int)atoi(argv[i] + 7);
+        else if(strncmp(argv[i], "--frames=", 9) == 0)
+            frames = (unsigned int)atoi(argv[i] + 9);
+        else if(strncmp(argv[i], "--threads=", 10) == 0)
+            threads = (unsigned int)atoi(argv[i] + 10);
+        else if(strcmp(argv[i], "--mips=driver") == 0)
+            mip_filter = -1;
+        else if(strcmp(argv[i], "--mips=box") == 0)
+            mip_filter = MIP_FILTER_BOX;
+        else if(strcmp(argv[i], "--mips=kaiser") == 0)
+            mip_filter = MIP_FILTER_KAISER;
+        else if(strcmp(argv[i], "--show") == 0)
+            show = true;
+        else if(argv[i][0] != '-')
+            images.push_back(argv[i]);
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    if(count == 0 || working_set == 0 || step == 0 || budget_mb <= 0.0)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+    if(images.empty())
+    {
+        images.push_back("../../07_Camera/textures/container.jpg");
+        images.push_back("../../07_Camera/textures/awesomeface.png");
+    }
+
+    Window window;
+    if(!window.init("Texture Stream", WINDOW_SIZE, WINDOW_SIZE, show ? 0 : SDL_WINDOW_HIDDEN))
+        return -1;
+    // Measure the streaming, not the display
+    SDL_GL_SetSwapInterval(0);
+
+    Shader shader("shaders/quad.vertex", "shaders/quad.fragment");
+    shader.use();
+    shader.setInt("image", 0);
+    GLint rectLoc = glGetUniformLocation(shader.ID, "rect");
+
+    // Quads come from gl_VertexID, the core profile still needs a VAO bound
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    TextureResidency residency;
+    residency.init((size_t)(budget_mb * 1024.0 * 1024.0), threads);
+    MipOptions mipOptions;
+    mipOptions.filter = (MipFilter)(mip_filter < 0 ? MIP_FILTER_BOX : mip_filter);
+    if(mip_filter >= 0)
+        residency.set_mip_generation(&mipOptions);
+    std::vector<int> handles;
+    for(unsigned int i = 0; i < count; i++)
+        handles.push_back(residency.add(images[i % images.size()]));
+
+    unsigned int grid = (unsigned int)ceil(sqrt((double)working_set));
+    float cell = 2.0f / grid;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for(unsigned int frame = 0; frame < frames; frame++)
+    {
+        SDL_PumpEvents();
+        residency.update();
+
+        glViewport(0, 0, WINDOW_SIZE, WINDOW_SIZE);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        unsigned int first = frame / step;
+        for(unsigned int k = 0; k < working_set; k++)
+        {
+            int handle = handles[(first + k) % count];
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, residency.use(handle));
+            glUniform4f(rectLoc, -1.0f + (k % grid) * cell, -1.0f + (k / grid) * cell, cell, cell);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+
+        window.swap();
+        if((frame + 1) % 120 == 0)
+            residency.print_report();
+    }
+    glFinish();
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    printf("Texture stream: %u frames in %.2f s (%.2f ms per frame), %u textures, working set %u, budget %.1f MB\n",
+        frames, seconds, seconds * 1000.0 / frames, count, working_set, budget_mb);
+    residency.print_report();
+
+    residency.destroy();
+    glDeleteVertexArrays(1, &vao);
+    window.destroy();
+    return 0;
+}